@@ -0,0 +1,354 @@
+//
+//  scan.cpp
+//  csoup
+//
+//  Created by mac on 10/17/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include "scan.h"
+
+#if defined(CSOUP_SSE2) || defined(CSOUP_SSE42)
+#define CSOUP_SCAN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(CSOUP_AVX2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CSOUP_SCAN_AVX2 1
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+    using csoup::CharType;
+    using csoup::size_t;
+
+    // The SIMD kernels only handle small sets; bigger ones go through the table.
+    const size_t kMaxSimdSetSize = 8;
+
+    inline unsigned countTrailingZeros(uint32_t mask) {
+        CSOUP_ASSERT(mask != 0);
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // scalar
+
+    const CharType* scalarFindByte(const CharType* begin, const CharType* end, CharType c) {
+        while (begin < end && *begin != c) ++ begin;
+        return begin;
+    }
+
+    const CharType* scalarFindAnyOf(const CharType* begin, const CharType* end,
+                                    const CharType* set, size_t setSize) {
+        if (setSize == 1) {
+            return scalarFindByte(begin, end, set[0]);
+        }
+
+        bool table[256] = {false};
+        for (size_t i = 0; i < setSize; ++ i) {
+            table[static_cast<unsigned char>(set[i])] = true;
+        }
+
+        while (begin < end && !table[static_cast<unsigned char>(*begin)]) ++ begin;
+        return begin;
+    }
+
+    // verifies a candidate found by the first/last byte filter
+    inline bool sequenceAt(const CharType* p, const CharType* seq, size_t seqSize) {
+        return std::memcmp(p + 1, seq + 1, seqSize - 2) == 0;
+    }
+
+    const CharType* scalarFindSequence(const CharType* begin, const CharType* end,
+                                       const CharType* seq, size_t seqSize) {
+        if (seqSize == 0) return begin;
+        if (static_cast<size_t>(end - begin) < seqSize) return end;
+
+        const CharType* last = end - seqSize;
+        for (const CharType* p = begin; p <= last; ++ p) {
+            p = scalarFindByte(p, last + 1, seq[0]);
+            if (p > last) break;
+            if (std::memcmp(p + 1, seq + 1, seqSize - 1) == 0) return p;
+        }
+
+        return end;
+    }
+
+    const CharType* scalarSkipPlainAscii(const CharType* begin, const CharType* end) {
+        while (begin < end && csoup::internal::isPlainAscii(static_cast<unsigned char>(*begin))) ++ begin;
+        return begin;
+    }
+
+    const csoup::internal::ScanKernels kScalarKernels = {
+        "scalar", scalarFindByte, scalarFindAnyOf, scalarFindSequence, scalarSkipPlainAscii
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // SSE2
+
+#ifdef CSOUP_SCAN_SSE2
+    const CharType* sse2FindByte(const CharType* begin, const CharType* end, CharType c) {
+        const __m128i needle = _mm_set1_epi8(c);
+        const CharType* p = begin;
+
+        for (; end - p >= 16; p += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+            if (mask != 0) return p + countTrailingZeros(mask);
+        }
+
+        return scalarFindByte(p, end, c);
+    }
+
+    const CharType* sse2FindAnyOf(const CharType* begin, const CharType* end,
+                                  const CharType* set, size_t setSize) {
+        if (setSize == 1) return sse2FindByte(begin, end, set[0]);
+        if (setSize > kMaxSimdSetSize) return scalarFindAnyOf(begin, end, set, setSize);
+
+        __m128i needles[kMaxSimdSetSize];
+        for (size_t i = 0; i < setSize; ++ i) {
+            needles[i] = _mm_set1_epi8(set[i]);
+        }
+
+        const CharType* p = begin;
+        for (; end - p >= 16; p += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i hits = _mm_cmpeq_epi8(chunk, needles[0]);
+            for (size_t i = 1; i < setSize; ++ i) {
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, needles[i]));
+            }
+
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+            if (mask != 0) return p + countTrailingZeros(mask);
+        }
+
+        return scalarFindAnyOf(p, end, set, setSize);
+    }
+
+    const CharType* sse2FindSequence(const CharType* begin, const CharType* end,
+                                     const CharType* seq, size_t seqSize) {
+        if (seqSize < 2) {
+            return seqSize == 0 ? begin : sse2FindByte(begin, end, seq[0]);
+        }
+
+        // Compare the first and the last byte of the needle at 16 positions at
+        // once and only run memcmp on positions where both of them match.
+        const __m128i first = _mm_set1_epi8(seq[0]);
+        const __m128i last = _mm_set1_epi8(seq[seqSize - 1]);
+        const CharType* p = begin;
+
+        for (; static_cast<size_t>(end - p) >= seqSize - 1 + 16; p += 16) {
+            __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + seqSize - 1));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+                                _mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last))));
+
+            while (mask != 0) {
+                unsigned bit = countTrailingZeros(mask);
+                if (sequenceAt(p + bit, seq, seqSize)) return p + bit;
+                mask &= mask - 1;
+            }
+        }
+
+        return scalarFindSequence(p, end, seq, seqSize);
+    }
+
+    const CharType* sse2SkipPlainAscii(const CharType* begin, const CharType* end) {
+        // signed compares: bytes >= 0x80 are negative and fail the first one
+        const __m128i low = _mm_set1_epi8(0x1F);
+        const __m128i high = _mm_set1_epi8(0x7F);
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i lf = _mm_set1_epi8('\n');
+        const CharType* p = begin;
+
+        for (; end - p >= 16; p += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i plain = _mm_and_si128(_mm_cmpgt_epi8(chunk, low), _mm_cmplt_epi8(chunk, high));
+            plain = _mm_or_si128(plain, _mm_or_si128(_mm_cmpeq_epi8(chunk, tab), _mm_cmpeq_epi8(chunk, lf)));
+
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(plain)) ^ 0xFFFFu;
+            if (mask != 0) return p + countTrailingZeros(mask);
+        }
+
+        return scalarSkipPlainAscii(p, end);
+    }
+
+    const csoup::internal::ScanKernels kSse2Kernels = {
+        "sse2", sse2FindByte, sse2FindAnyOf, sse2FindSequence, sse2SkipPlainAscii
+    };
+#endif // CSOUP_SCAN_SSE2
+
+    ///////////////////////////////////////////////////////////////////////////
+    // AVX2
+
+#ifdef CSOUP_SCAN_AVX2
+#define CSOUP_TARGET_AVX2 __attribute__((target("avx2")))
+
+    CSOUP_TARGET_AVX2
+    const CharType* avx2FindByte(const CharType* begin, const CharType* end, CharType c) {
+        const __m256i needle = _mm256_set1_epi8(c);
+        const CharType* p = begin;
+
+        for (; end - p >= 32; p += 32) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+            if (mask != 0) return p + countTrailingZeros(mask);
+        }
+
+        return scalarFindByte(p, end, c);
+    }
+
+    CSOUP_TARGET_AVX2
+    const CharType* avx2FindAnyOf(const CharType* begin, const CharType* end,
+                                  const CharType* set, size_t setSize) {
+        if (setSize == 1) return avx2FindByte(begin, end, set[0]);
+        if (setSize > kMaxSimdSetSize) return scalarFindAnyOf(begin, end, set, setSize);
+
+        __m256i needles[kMaxSimdSetSize];
+        for (size_t i = 0; i < setSize; ++ i) {
+            needles[i] = _mm256_set1_epi8(set[i]);
+        }
+
+        const CharType* p = begin;
+        for (; end - p >= 32; p += 32) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i hits = _mm256_cmpeq_epi8(chunk, needles[0]);
+            for (size_t i = 1; i < setSize; ++ i) {
+                hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, needles[i]));
+            }
+
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+            if (mask != 0) return p + countTrailingZeros(mask);
+        }
+
+        return scalarFindAnyOf(p, end, set, setSize);
+    }
+
+    CSOUP_TARGET_AVX2
+    const CharType* avx2FindSequence(const CharType* begin, const CharType* end,
+                                     const CharType* seq, size_t seqSize) {
+        if (seqSize < 2) {
+            return seqSize == 0 ? begin : avx2FindByte(begin, end, seq[0]);
+        }
+
+        const __m256i first = _mm256_set1_epi8(seq[0]);
+        const __m256i last = _mm256_set1_epi8(seq[seqSize - 1]);
+        const CharType* p = begin;
+
+        for (; static_cast<size_t>(end - p) >= seqSize - 1 + 32; p += 32) {
+            __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + seqSize - 1));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                                _mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last))));
+
+            while (mask != 0) {
+                unsigned bit = countTrailingZeros(mask);
+                if (sequenceAt(p + bit, seq, seqSize)) return p + bit;
+                mask &= mask - 1;
+            }
+        }
+
+        return scalarFindSequence(p, end, seq, seqSize);
+    }
+
+    CSOUP_TARGET_AVX2
+    const CharType* avx2SkipPlainAscii(const CharType* begin, const CharType* end) {
+        const __m256i low = _mm256_set1_epi8(0x1F);
+        const __m256i high = _mm256_set1_epi8(0x7F);
+        const __m256i tab = _mm256_set1_epi8('\t');
+        const __m256i lf = _mm256_set1_epi8('\n');
+        const CharType* p = begin;
+
+        for (; end - p >= 32; p += 32) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i plain = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, low), _mm256_cmpgt_epi8(high, chunk));
+            plain = _mm256_or_si256(plain, _mm256_or_si256(_mm256_cmpeq_epi8(chunk, tab), _mm256_cmpeq_epi8(chunk, lf)));
+
+            uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(plain));
+            if (mask != 0) return p + countTrailingZeros(mask);
+        }
+
+        return scalarSkipPlainAscii(p, end);
+    }
+
+#undef CSOUP_TARGET_AVX2
+
+    const csoup::internal::ScanKernels kAvx2Kernels = {
+        "avx2", avx2FindByte, avx2FindAnyOf, avx2FindSequence, avx2SkipPlainAscii
+    };
+#endif // CSOUP_SCAN_AVX2
+
+    ///////////////////////////////////////////////////////////////////////////
+    // runtime dispatch
+
+    // activeScanKernels starts out pointing at these. The first call through
+    // them picks the kernels for this CPU and replaces the pointer, so later
+    // calls go straight to the selected kernel.
+    const csoup::internal::ScanKernels* resolveScanKernels() {
+        using namespace csoup::internal;
+
+        const ScanKernels* kernels = avx2ScanKernels();
+        if (kernels == NULL) kernels = sse2ScanKernels();
+        if (kernels == NULL) kernels = scalarScanKernels();
+
+        activeScanKernels.store(kernels, std::memory_order_relaxed);
+        return kernels;
+    }
+
+    const CharType* resolveFindByte(const CharType* begin, const CharType* end, CharType c) {
+        return resolveScanKernels()->findByte(begin, end, c);
+    }
+
+    const CharType* resolveFindAnyOf(const CharType* begin, const CharType* end,
+                                     const CharType* set, size_t setSize) {
+        return resolveScanKernels()->findAnyOf(begin, end, set, setSize);
+    }
+
+    const CharType* resolveFindSequence(const CharType* begin, const CharType* end,
+                                        const CharType* seq, size_t seqSize) {
+        return resolveScanKernels()->findSequence(begin, end, seq, seqSize);
+    }
+
+    const CharType* resolveSkipPlainAscii(const CharType* begin, const CharType* end) {
+        return resolveScanKernels()->skipPlainAscii(begin, end);
+    }
+
+    const csoup::internal::ScanKernels kResolveKernels = {
+        "unresolved", resolveFindByte, resolveFindAnyOf, resolveFindSequence, resolveSkipPlainAscii
+    };
+}
+
+namespace csoup {
+    namespace internal {
+        std::atomic<const ScanKernels*> activeScanKernels(&kResolveKernels);
+
+        const ScanKernels* scalarScanKernels() {
+            return &kScalarKernels;
+        }
+
+        const ScanKernels* sse2ScanKernels() {
+#ifdef CSOUP_SCAN_SSE2
+            return &kSse2Kernels;
+#else
+            return NULL;
+#endif
+        }
+
+        const ScanKernels* avx2ScanKernels() {
+#ifdef CSOUP_SCAN_AVX2
+            return __builtin_cpu_supports("avx2") ? &kAvx2Kernels : NULL;
+#else
+            return NULL;
+#endif
+        }
+    }
+}
@@ -0,0 +1,82 @@
+//
+//  scan.h
+//  csoup
+//
+//  Created by mac on 10/17/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#ifndef CSOUP_INTERNAL_SCAN_H_
+#define CSOUP_INTERNAL_SCAN_H_
+
+#include <atomic>
+#include "../util/common.h"
+
+// Byte scanning kernels used by CharacterReader to skip over long runs of
+// text. Every kernel works on raw bytes and returns a pointer to the first
+// match in [begin, end), or end if there is none.
+//
+// SSE2 kernels are compiled when CSOUP_SSE2 (or CSOUP_SSE42) is defined, AVX2
+// kernels when CSOUP_AVX2 is defined. The best kernel set supported by the
+// running CPU is picked on first use; the scalar kernels are always available.
+
+namespace csoup {
+    namespace internal {
+        struct ScanKernels {
+            const char* name;
+
+            const CharType* (*findByte)(const CharType* begin, const CharType* end, CharType c);
+
+            const CharType* (*findAnyOf)(const CharType* begin, const CharType* end,
+                                         const CharType* set, size_t setSize);
+
+            const CharType* (*findSequence)(const CharType* begin, const CharType* end,
+                                            const CharType* seq, size_t seqSize);
+
+            // returns the first byte that is not plain ascii
+            const CharType* (*skipPlainAscii)(const CharType* begin, const CharType* end);
+        };
+
+        // Plain ascii is what CharacterReader can hand out as is: printable
+        // characters, tab and line feed. \r, \f, NUL and the other control
+        // characters need the slow path.
+        inline bool isPlainAscii(unsigned char c) {
+            return (c >= 0x20 && c < 0x7F) || c == '\t' || c == '\n';
+        }
+
+        const ScanKernels* scalarScanKernels();
+
+        // return NULL if the kernels were not compiled in or the CPU can't run them
+        const ScanKernels* sse2ScanKernels();
+        const ScanKernels* avx2ScanKernels();
+
+        // The kernels selected for this CPU. Parsers on several threads may
+        // resolve it at the same time; they all store the same pointer to
+        // immutable tables, so relaxed ordering is enough.
+        extern std::atomic<const ScanKernels*> activeScanKernels;
+
+        inline const ScanKernels* scanKernels() {
+            return activeScanKernels.load(std::memory_order_relaxed);
+        }
+
+        inline const CharType* scanByte(const CharType* begin, const CharType* end, CharType c) {
+            return scanKernels()->findByte(begin, end, c);
+        }
+
+        inline const CharType* scanAnyOf(const CharType* begin, const CharType* end,
+                                         const CharType* set, size_t setSize) {
+            return scanKernels()->findAnyOf(begin, end, set, setSize);
+        }
+
+        inline const CharType* scanSequence(const CharType* begin, const CharType* end,
+                                            const CharType* seq, size_t seqSize) {
+            return scanKernels()->findSequence(begin, end, seq, seqSize);
+        }
+
+        inline const CharType* skipPlainAscii(const CharType* begin, const CharType* end) {
+            return scanKernels()->skipPlainAscii(begin, end);
+        }
+    }
+}
+
+#endif // CSOUP_INTERNAL_SCAN_H_
@@ -84,6 +84,22 @@ namespace csoup {
             return (reinterpret_cast<const char*>(&s1) == reinterpret_cast<const char*>(&s2)) ||
             ((s1.size() == s2.size() && 0 == strCmpIgnoreCase(s1.data(), s2.data(), s1.size())));
         }
+
+        // FNV-1a hash of s with ASCII letters folded to lower case, so strings
+        // that strEqualsIgnoreCase() calls equal hash the same.
+        template <typename C>
+        inline uint32_t strHashIgnoreCase(const C& s) {
+            CSOUP_STATIC_ASSERT(C::CSOUP_STRING_COMPARE_SUPPORTED == 1);
+            
+            uint32_t h = 2166136261u;
+            for (size_t i = 0; i < s.size(); ++ i) {
+                unsigned char c = static_cast<unsigned char>(s.data()[i]);
+                if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+                h = (h ^ c) * 16777619u;
+            }
+            
+            return h;
+        }
     
     } // namespace internal
 } // namespace csoup
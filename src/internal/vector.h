@@ -6,21 +6,29 @@
 namespace csoup {
     namespace internal {
         
-        template <typename T>
+        template <typename T, typename AllocatorT>
         class VectorIterator;
         
         ///////////////////////////////////////////////////////////////////////////////
         // Vector
         
         //! A container used for storing elements of the same type
-        /*! \tparam Allocator Allocator for allocating stack memory.
+        /*! \tparam AllocatorT Allocator for allocating stack memory. The
+                default goes through the virtual Allocator interface; naming a
+                concrete allocator such as MemoryPoolAllocator makes the calls
+                direct, so a push that has to grow inlines the allocation.
+                The parser's own vectors keep the default: their allocator can
+                be swapped at run time (TreeBuilder::setScratchAllocator()),
+                and they are reused, so they seldom allocate at all.
          */
-        template <typename T>
+        template <typename T, typename AllocatorT = Allocator>
         class Vector {
         public:
+            typedef AllocatorT AllocatorType;
+            
             // Optimization note: Do not allocate memory for vector_ in constructor.
             // Do it lazily when first Push() -> Expand() -> Resize().
-            Vector(size_t vectorCapacity = 1, Allocator* allocator = NULL) :
+            Vector(size_t vectorCapacity = 1, AllocatorT* allocator = NULL) :
                                     allocator_(allocator), stack_(0),stackTop_(0), stackEnd_(0), initialCapacity_(vectorCapacity) {
                 CSOUP_ASSERT(vectorCapacity > 0);
                 CSOUP_ASSERT(allocator_ != NULL);
@@ -143,19 +151,19 @@ namespace csoup {
                 return stack_;
             }
             
-            Allocator* allocator() {
+            AllocatorT* allocator() {
                 return allocator_;
             }
             
-            VectorIterator<T> begin() {
-                return VectorIterator<T>(size(), 0, stack_);
+            VectorIterator<T, AllocatorT> begin() {
+                return VectorIterator<T, AllocatorT>(size(), 0, stack_);
             }
             
-            VectorIterator<T> end() {
-                return VectorIterator<T>(size(), size(), stack_);
+            VectorIterator<T, AllocatorT> end() {
+                return VectorIterator<T, AllocatorT>(size(), size(), stack_);
             }
             
-            void remove(const VectorIterator<T>& it, bool del = true) {
+            void remove(const VectorIterator<T, AllocatorT>& it, bool del = true) {
                 remove(it->pos_);
             }
             
@@ -165,7 +173,7 @@ namespace csoup {
             bool empty() const { return size() == 0; }
             
         private:
-            friend class VectorIterator<T>;
+            friend class VectorIterator<T, AllocatorT>;
             
             // Prohibit copy constructor & assignment operator.
             Vector(const Vector&);
@@ -202,14 +210,14 @@ namespace csoup {
                 stackEnd_ = stack_ + count;
             }
             
-            Allocator* allocator_;
+            AllocatorT* allocator_;
             T *stack_;
             T *stackTop_;
             T *stackEnd_;
             size_t initialCapacity_;
         };
         
-        template <class T>
+        template <class T, class AllocatorT = Allocator>
         class VectorIterator {
         public:
             bool hasNext() const {
@@ -242,11 +250,11 @@ namespace csoup {
             }
             
             bool valid() const {
-                return CSOUP_ASSERT(pos_ < size_);
+                return pos_ < size_;
             }
             
         private:
-            friend class Vector<T>;
+            friend class Vector<T, AllocatorT>;
             VectorIterator(size_t s, size_t p, T* base) : pos_(p), size_(s), base_(base) {}
             
             size_t pos_;
@@ -21,14 +21,16 @@ namespace csoup {
     public:
         Attribute(AttributeNamespaceEnum space, const StringRef& key,
                   const StringRef& value, Allocator* allocator)
-        : attrKey_(key, allocator), attrValue_(value, allocator), attrNamespace_(space) {
+        : attrKey_(key, allocator), attrValue_(value, allocator), attrNamespace_(space),
+          keyHash_(hashKey(key)) {
             CSOUP_ASSERT(attrKey_.data() != NULL);
             CSOUP_ASSERT(attrValue_.data() != NULL);
         }
         
         Attribute(AttributeNamespaceEnum space, const CharType* key,
                   const CharType* value, Allocator* allocator)
-        : attrKey_(key, allocator), attrValue_(value, allocator), attrNamespace_(space) {
+        : attrKey_(key, allocator), attrValue_(value, allocator), attrNamespace_(space),
+          keyHash_(hashKey(attrKey_.ref())) {
             CSOUP_ASSERT(key != NULL);
             CSOUP_ASSERT(value != NULL);
         }
@@ -45,6 +47,15 @@ namespace csoup {
             return attrNamespace_;
         }
         
+        // The hash of the key ignoring case; keys that differ in it differ.
+        uint32_t keyHash() const {
+            return keyHash_;
+        }
+        
+        static uint32_t hashKey(const StringRef& key) {
+            return internal::strHashIgnoreCase(key);
+        }
+        
         Attribute& setKey(const String& key, Allocator* allocator) {
             CSOUP_ASSERT(key.data());
             
@@ -52,6 +63,7 @@ namespace csoup {
             attrKey_.~String();
             
             new (&attrKey_) String(key, allocator);
+            keyHash_ = hashKey(attrKey_.ref());
             return *this;
         }
         
@@ -86,6 +98,7 @@ namespace csoup {
         String attrKey_;
         String attrValue_;
         AttributeNamespaceEnum attrNamespace_;
+        uint32_t keyHash_;
     };
 
 //    namespace internal {
@@ -1,49 +1,65 @@
 #ifndef CSOUP_ATTRIBUTES_H_
 #define CSOUP_ATTRIBUTES_H_
 
+#include <cstring>
 #include "../internal/vector.h"
 #include "../util/allocators.h"
 #include "../util/csoup_string.h"
 #include "attribute.h"
 
 namespace csoup {
+    // The attributes of an element. Attributes made by create() have room
+    // for a number of attributes right behind the object, in the same
+    // allocation, so an element whose attributes fit costs one allocation
+    // for all of them and a scan doesn't leave the block. Past that room
+    // they move to an array from the allocator, which grows like a Vector.
+    //
+    // Each attribute carries a hash of its key, so a scan compares whole
+    // strings only when the hashes agree. Past kIndexThreshold attributes
+    // the positions also go into an open addressing table keyed by those
+    // hashes, so that looking up, adding or replacing an attribute doesn't
+    // get slower with the number of attributes an element has.
     class Attributes {
     public:
-        Attributes(Allocator* allocator) : allocator_(allocator),
-                                            attributes_(NULL) {
+        // the room create() leaves when the caller doesn't know better
+        static const size_t kInlineCapacity = 2;
+        
+        // the most attributes looked up by a scan
+        static const size_t kIndexThreshold = 8;
+        
+        // An Attributes without room of its own, which allocates for the
+        // first attribute.
+        Attributes(Allocator* allocator) : allocator_(allocator), heap_(NULL), index_(NULL),
+                                            size_(0), capacity_(0) {
             CSOUP_ASSERT(allocator != NULL);
         }
         
+        // An Attributes in memory from allocator with room for capacity
+        // attributes; free it with CSOUP_DELETE.
+        static Attributes* create(Allocator* allocator, size_t capacity = kInlineCapacity) {
+            AllocationScope scope(CSOUP_ALLOCATION_ATTRIBUTES);
+            void* p = allocator->malloc(sizeof(Attributes) + capacity * sizeof(Attribute));
+            return new (p) Attributes(allocator, capacity);
+        }
+        
         ~Attributes() {
-            if (!allocator_ || !attributes_) return;
-            
-            attributes_->~Vector();
-            allocator_->free(attributes_);
+            Attribute* attrs = data();
+            for (size_t i = 0; i < size_; ++ i) {
+                attrs[i].~Attribute();
+            }
+            allocator_->free(heap_);
+            allocator_->free(index_);
         }
         
-        Attributes(const Attributes& attrs, Allocator* allocator) : allocator_(allocator) {
+        Attributes(const Attributes& attrs, Allocator* allocator) : allocator_(allocator), heap_(NULL), index_(NULL),
+                                                                    size_(0), capacity_(0) {
             CSOUP_ASSERT(allocator != NULL);
-            if (attrs.size() == 0) {
-                return ;
-            }
-            
-            // Use a very naive style;  Vector didn't have a copy constructor
-            for (size_t i = 0; i < attrs.size(); ++ i) {
-                const Attribute* attr = attrs.get(i);
-                addAttribute(attr->key(), attr->value());
-            }
+            addAttributes(attrs);
         }
         
         StringRef get(AttributeNamespaceEnum space, const StringRef& key) const {
-            if (!attributes_ || !key.size())
-                return StringRef("");
-            
-            for (size_t i = 0; i < attributes_->size(); ++ i) {
-                if (isAttributeHasKey(attributes_->at(i), space, key))
-                    return attributes_->at(i)->value().ref();
-            }
-            
-            return StringRef("");
+            const Attribute* attr = find(space, key);
+            return attr ? attr->value().ref() : StringRef("");
         }
         
         StringRef get(const StringRef& key) const {
@@ -52,17 +68,26 @@ namespace csoup {
         
         const Attribute* get(const size_t index) const {
             CSOUP_ASSERT(index < size());
-            return attributes_->at(index);
+            return data() + index;
         }
         
         void removeAttribute(AttributeNamespaceEnum space, const StringRef& key) {
-            if (!attributes_ || !key.size()) return ;
+            const Attribute* attr = find(space, key);
+            if (!attr) return ;
             
-            for (size_t i = 0; i < attributes_->size(); ++ i) {
-                if (isAttributeHasKey(attributes_->at(i), space, key)) {
-                    attributes_->remove(i);
-                    return ;
-                }
+            // attributes are moved around as bytes, like a Vector moves them
+            Attribute* attrs = data();
+            const size_t index = attr - attrs;
+            if (index_) removeFromIndex(index);
+            attrs[index].~Attribute();
+            std::memmove(static_cast<void*>(attrs + index), attrs + index + 1,
+                         sizeof(Attribute) * (size_ - index - 1));
+            -- size_;
+            
+            // back to scanning, without building anything
+            if (index_ && size_ <= kIndexThreshold) {
+                allocator_->free(index_);
+                index_ = NULL;
             }
         }
         
@@ -73,15 +98,30 @@ namespace csoup {
         void addAttribute(AttributeNamespaceEnum space, const StringRef& key,
                           const StringRef& value) {
             if (!key.size()) return ;
-            if (!attributes_) {
-                attributes_ = allocator_->malloc_t< internal::Vector<Attribute> >();
+            
+            AllocationScope scope(CSOUP_ALLOCATION_ATTRIBUTES);
+            
+            // an attribute that is already there gets the new value in its place
+            Attribute* attr = const_cast<Attribute*>(find(space, key));
+            if (attr) {
+                // key and value may point into the attribute they replace,
+                // so the new one is built before the old one goes
+                union {
+                    char bytes_[sizeof(Attribute)];
+                    void* align_;
+                } replacement;
+                new (replacement.bytes_) Attribute(space, key, value, allocator_);
+                attr->~Attribute();
+                std::memcpy(static_cast<void*>(attr), replacement.bytes_, sizeof(Attribute));
+                return ;
             }
             
-            // try to remove the attribute entry 
-            removeAttribute(space, key);
+            reserve(size_ + 1);
+            new (data() + size_) Attribute(space, key, value, allocator_);
+            ++ size_;
             
-            Attribute* newAttribute = attributes_->push();
-            new (newAttribute) Attribute(space, key, value, allocator_);
+            if (index_) addToIndex(size_ - 1);
+            else if (size_ > kIndexThreshold) reindex();
         }
         
         void addAttribute(const StringRef& key,const StringRef& value) {
@@ -89,6 +129,7 @@ namespace csoup {
         }
 
         void addAttributes(const Attributes& attrs) {
+            reserve(size_ + attrs.size());
             for (size_t i = 0; i < attrs.size(); ++ i) {
                 const Attribute* attr = attrs.get(i);
                 this->addAttribute(attr->key(), attr->value());
@@ -96,14 +137,7 @@ namespace csoup {
         }
         
         bool hasAttribute(AttributeNamespaceEnum space, const StringRef& key) const {
-            if (!key.size() || !attributes_) return false;
-            
-            for (size_t i = 0; i < attributes_->size(); ++ i) {
-                if (isAttributeHasKey(attributes_->at(i), space, key))
-                    return true;
-            }
-            
-            return false;
+            return find(space, key) != NULL;
         }
         
         bool hasAttribute(const StringRef& key) const {
@@ -111,7 +145,43 @@ namespace csoup {
         }
         
         size_t size() const {
-            return attributes_ == NULL ? 0 : attributes_->size();
+            return size_;
+        }
+        
+        // true while the attributes are in the room create() left
+        bool isInline() const {
+            return heap_ == NULL;
+        }
+        
+        // true when lookups go through the hash table
+        bool isIndexed() const {
+            return index_ != NULL;
+        }
+        
+        // Makes room for count attributes, moving them out of the object's
+        // own room the first time they don't fit.
+        void reserve(size_t count) {
+            if (count <= capacity_) return;
+            
+            size_t newCapacity = capacity_ + (capacity_ + 1) / 2;
+            if (newCapacity < count) newCapacity = count;
+            
+            // Only create() leaves room behind the object. The public
+            // constructor starts at capacity 0, with nothing there to move.
+            const Attribute* inRoom = heap_ == NULL && capacity_ > 0 ? room() : NULL;
+            
+            AllocationScope scope(CSOUP_ALLOCATION_ATTRIBUTES);
+            if (heap_) {
+                heap_ = static_cast<Attribute*>(allocator_->realloc(heap_, capacity_ * sizeof(Attribute),
+                                                                    newCapacity * sizeof(Attribute)));
+            } else {
+                heap_ = static_cast<Attribute*>(allocator_->malloc(newCapacity * sizeof(Attribute)));
+                if (inRoom && size_) std::memcpy(static_cast<void*>(heap_), inRoom, size_ * sizeof(Attribute));
+            }
+            capacity_ = static_cast<uint32_t>(newCapacity);
+            
+            // the table is sized by the capacity
+            if (index_) reindex();
         }
         
         Allocator* allocator() {
@@ -132,8 +202,109 @@ namespace csoup {
                 internal::strEqualsIgnoreCase(attr->key(), key);
         }
         
+        Attributes(Allocator* allocator, size_t capacity) : allocator_(allocator), heap_(NULL), index_(NULL),
+                                                            size_(0), capacity_(static_cast<uint32_t>(capacity)) {
+            CSOUP_ASSERT(allocator != NULL);
+        }
+        
+        // the room behind the object
+        const Attribute* room() const {
+            return reinterpret_cast<const Attribute*>(this + 1);
+        }
+        
+        Attribute* data() {
+            return heap_ ? heap_ : reinterpret_cast<Attribute*>(this + 1);
+        }
+        
+        const Attribute* data() const {
+            return heap_ ? heap_ : room();
+        }
+        
+        const Attribute* find(AttributeNamespaceEnum space, const StringRef& key) const {
+            if (!key.size()) return NULL;
+            
+            const uint32_t hash = Attribute::hashKey(key);
+            const Attribute* attrs = data();
+            if (index_) {
+                const size_t mask = indexSlots() - 1;
+                for (size_t slot = hash & mask; index_[slot]; slot = (slot + 1) & mask) {
+                    const Attribute* attr = attrs + index_[slot] - 1;
+                    if (attr->keyHash() == hash && isAttributeHasKey(attr, space, key))
+                        return attr;
+                }
+                
+                return NULL;
+            }
+            
+            for (size_t i = 0; i < size_; ++ i) {
+                if (attrs[i].keyHash() == hash && isAttributeHasKey(attrs + i, space, key))
+                    return attrs + i;
+            }
+            
+            return NULL;
+        }
+        
+        // A power of two at least twice the capacity, so the table is never
+        // more than half full.
+        size_t indexSlots() const {
+            size_t slots = 16;
+            while (slots < 2 * capacity_) slots *= 2;
+            return slots;
+        }
+        
+        // Builds the table for the current capacity. Only adding past
+        // kIndexThreshold and growing call it; removing edits it in place.
+        void reindex() {
+            CSOUP_ASSERT(size_ > kIndexThreshold);
+            allocator_->free(index_);
+            
+            AllocationScope scope(CSOUP_ALLOCATION_ATTRIBUTES);
+            const size_t slots = indexSlots();
+            index_ = static_cast<uint32_t*>(allocator_->malloc(slots * sizeof(uint32_t)));
+            std::memset(index_, 0, slots * sizeof(uint32_t));
+            for (size_t i = 0; i < size_; ++ i) {
+                addToIndex(i);
+            }
+        }
+        
+        // Slots hold the position of an attribute + 1, or 0 for none.
+        void addToIndex(size_t i) {
+            const size_t mask = indexSlots() - 1;
+            size_t slot = data()[i].keyHash() & mask;
+            while (index_[slot]) slot = (slot + 1) & mask;
+            index_[slot] = static_cast<uint32_t>(i + 1);
+        }
+        
+        // Takes attribute i out of the table before it is removed, and
+        // numbers the ones after it a place down, where they are moving.
+        void removeFromIndex(size_t i) {
+            const size_t slots = indexSlots();
+            const size_t mask = slots - 1;
+            const Attribute* attrs = data();
+            size_t hole = attrs[i].keyHash() & mask;
+            while (index_[hole] != i + 1) hole = (hole + 1) & mask;
+            
+            // moves back the positions after the hole that probing would no
+            // longer reach, instead of leaving a tombstone
+            for (size_t slot = (hole + 1) & mask; index_[slot]; slot = (slot + 1) & mask) {
+                const size_t home = attrs[index_[slot] - 1].keyHash() & mask;
+                if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+                    index_[hole] = index_[slot];
+                    hole = slot;
+                }
+            }
+            index_[hole] = 0;
+            
+            for (size_t slot = 0; slot < slots; ++ slot) {
+                if (index_[slot] > i + 1) -- index_[slot];
+            }
+        }
+        
         Allocator* allocator_;
-        internal::Vector<Attribute>* attributes_;
+        Attribute* heap_;   // NULL while the attributes are inline
+        uint32_t* index_;   // NULL while the attributes are scanned
+        uint32_t size_;
+        uint32_t capacity_;
     };
 }
 
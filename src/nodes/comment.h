@@ -7,17 +7,17 @@
 namespace csoup {
     class CommentNode : public Node {
     public:
-        CommentNode(const StringRef& comment, const StringRef& baseUri, Allocator* allocator) :
-            Node(CSOUP_NODE_COMMENT, NULL, 0, baseUri, allocator) {
+        CommentNode(const StringRef& comment, BaseUri* baseUri, Allocator* allocator) :
+            Node(CSOUP_NODE_COMMENT, NULL, 0, baseUri, allocator), comment_(NULL) {
             setComment(comment);
         }
         
-        CommentNode(const StringRef& baseUri, Allocator* allocator) : Node(CSOUP_NODE_COMMENT, NULL, 0, baseUri, allocator) {
+        CommentNode(BaseUri* baseUri, Allocator* allocator) : Node(CSOUP_NODE_COMMENT, NULL, 0, baseUri, allocator) {
             comment_ = NULL;
         }
         
         ~CommentNode() {
-            if (comment_) {
+            if (comment_ && releasesMemory()) {
                 comment_->~String();
                 allocator()->free(comment_);
                 comment_ = NULL;
@@ -34,7 +34,7 @@ namespace csoup {
             new (comment_) String(data, allocator());
         }
         
-        StringRef comment() {
+        StringRef comment() const {
             return comment_ ? comment_->ref() : StringRef("");
         }
         
@@ -7,19 +7,19 @@
 namespace csoup {
     class DataNode : public Node {
     public:
-        DataNode(const StringRef& data, const StringRef& baseUri, Allocator* allocator) :
-            Node(CSOUP_NODE_CDATA, NULL, 0, baseUri, allocator) {
+        DataNode(const StringRef& data, BaseUri* baseUri, Allocator* allocator) :
+            Node(CSOUP_NODE_CDATA, NULL, 0, baseUri, allocator), data_(NULL) {
             setWholeData(data);
         }
         
-        DataNode(const StringRef& baseUri, Allocator* allocator) :
+        DataNode(BaseUri* baseUri, Allocator* allocator) :
             Node(CSOUP_NODE_CDATA, NULL, 0, baseUri, allocator) {
             data_ = NULL;
         }
 
         
         ~DataNode() {
-            if (data_) {
+            if (data_ && releasesMemory()) {
                 data_->~String();
                 allocator()->free(data_);
                 data_ = NULL;
@@ -36,7 +36,7 @@ namespace csoup {
             new (data_) String(data, allocator());
         }
         
-        StringRef wholeData() {
+        StringRef wholeData() const {
             return data_ ? data_->ref() : StringRef("");
         }
         
@@ -6,41 +6,59 @@
 //  Copyright (c) 2014 windpls. All rights reserved.
 //
 
+#include <cstdarg>
+#include <cstdio>
 #include "../util/stringref.h"
 #include "../util/csoup_string.h"
+#include "../util/stringbuffer.h"
 #include "token.h"
 #include "document.h"
+#include "elementindex.h"
+#include "../selector/elementsref.h"
 
 namespace csoup {
     Document::Document(const StringRef& baseUri, Allocator* allocator) :
-    Element(CSOUP_NODE_DOCUMENT, "html", baseUri, allocator ? allocator : new MemoryPoolAllocator()),
-    quirksMode_(CSOUP_DOCTYPE_NO_QUIRKS), ownAllocator_(NULL), publicIdentifier_(NULL),
-    systemIdentifier_(NULL), name_(NULL), baseUri_(NULL) {
-        if (allocator == NULL) {
-            ownAllocator_ = Element::allocator();
-        }
-        
-        baseUri_ = new (Node::allocator()->malloc_t<String>()) String(baseUri, Node::allocator());
+    DocumentAllocatorHolder(allocator),
+    Element(CSOUP_NODE_DOCUMENT, "html", BaseUri::create(baseUri, allocator ? allocator : ownAllocator_), allocator ? allocator : ownAllocator_),
+    quirksMode_(CSOUP_DOCTYPE_NO_QUIRKS), publicIdentifier_(NULL),
+    systemIdentifier_(NULL), name_(NULL), source_(NULL), sourceLength_(0), cleanups_(NULL), index_(NULL) {
     }
     
     Document::Document(const StringRef& baseUri, const Attributes& attributes, Allocator* allocator) :
-    Element(CSOUP_NODE_DOCUMENT, "html", attributes, baseUri, allocator ? allocator : new MemoryPoolAllocator()),
-    quirksMode_(CSOUP_DOCTYPE_NO_QUIRKS), ownAllocator_(NULL), publicIdentifier_(NULL),
-    systemIdentifier_(NULL), name_(NULL), baseUri_(NULL) {
-        if (allocator == NULL) {
-            ownAllocator_ = Element::allocator();
-        }
-        
-        baseUri_ = new (Node::allocator()->malloc_t<String>()) String(baseUri, Node::allocator());
+    DocumentAllocatorHolder(allocator),
+    Element(CSOUP_NODE_DOCUMENT, "html", attributes, BaseUri::create(baseUri, allocator ? allocator : ownAllocator_), allocator ? allocator : ownAllocator_),
+    quirksMode_(CSOUP_DOCTYPE_NO_QUIRKS), publicIdentifier_(NULL),
+    systemIdentifier_(NULL), name_(NULL), source_(NULL), sourceLength_(0), cleanups_(NULL), index_(NULL) {
     }
     
     Document::~Document() {
+        runCleanups();
+        
+        // the nodes, strings and vectors go away with the pool
+        if (!releasesMemory()) return;
+        
         allocator()->deconstructAndFree(publicIdentifier_);
         allocator()->deconstructAndFree(systemIdentifier_);
         allocator()->deconstructAndFree(name_);
-        
-        // it's not necessary to check if ownAllocator_ is NULL or not;
-        delete ownAllocator_;
+        allocator()->free(source_);
+        CSOUP_DELETE(allocator(), index_);
+    }
+    
+    void Document::addCleanup(void (*fn)(void*), void* data) {
+        Cleanup* cleanup = allocator()->malloc_t<Cleanup>();
+        cleanup->fn = fn;
+        cleanup->data = data;
+        cleanup->next = cleanups_;
+        cleanups_ = cleanup;
+    }
+    
+    void Document::runCleanups() {
+        while (cleanups_) {
+            Cleanup* cleanup = cleanups_;
+            cleanups_ = cleanup->next;
+            cleanup->fn(cleanup->data);
+            allocator()->free(cleanup);
+        }
     }
     
     void Document::setSystemIdentifier(const csoup::StringRef &systemIdentifier) {
@@ -53,8 +71,117 @@ namespace csoup {
         publicIdentifier_ = CSOUP_NEW2(allocator(), String, publicIdentifier, allocator());
     }
     
+    StringRef Document::setSource(const StringRef& input) {
+        allocator()->free(source_);
+        
+        AllocationScope scope(CSOUP_ALLOCATION_STRINGS);
+        source_ = static_cast<CharType*>(allocator()->malloc(input.size() + 1));
+        std::memcpy(source_, input.data(), input.size());
+        source_[input.size()] = '\0';
+        sourceLength_ = input.size();
+        
+        return source();
+    }
+    
     void Document::setName(const csoup::StringRef &name) {
         CSOUP_DELETE(allocator(), name_);
         name_ = CSOUP_NEW2(allocator(), String, name, allocator());
     }
-}
\ No newline at end of file
+    
+    namespace {
+        bool isElement(const Node* node) {
+            return node->type() == CSOUP_NODE_ELEMENT || node->type() == CSOUP_NODE_FORMELEMENT ||
+                node->type() == CSOUP_NODE_DOCUMENT;
+        }
+        
+        // the node after node in document order, or NULL after the last
+        Node* nextNode(Node* node) {
+            if (isElement(node)) {
+                Node* child = static_cast<Element*>(node)->firstChild();
+                if (child) return child;
+            }
+            
+            while (node != NULL && node->nextSibling() == NULL) node = node->parentNode();
+            return node ? node->nextSibling() : NULL;
+        }
+        
+        // a walk rather than recursion, as trees can be deep
+        void countNodes(const Node* root, MemoryUsage* usage) {
+            for (Node* node = const_cast<Node*>(root); node != NULL; node = nextNode(node)) {
+                ++ usage->nodes;
+                if (!isElement(node)) continue;
+                
+                const Element* el = static_cast<const Element*>(node);
+                ++ usage->elements;
+                if (el->attributes()) usage->attributes += el->attributes()->size();
+            }
+        }
+        
+        void appendLine(StringBuffer* out, const char* format, ...) {
+            char line[160];
+            va_list args;
+            va_start(args, format);
+            int len = std::vsnprintf(line, sizeof(line), format, args);
+            va_end(args);
+            if (len > 0) out->appendString(line, static_cast<size_t>(len) < sizeof(line) ? len : sizeof(line) - 1);
+        }
+    }
+    
+    MemoryUsage Document::memoryUsage() const {
+        MemoryUsage usage;
+        std::memset(&usage, 0, sizeof(usage));
+        countNodes(this, &usage);
+        usage.sourceBytes = sourceLength_;
+        usage.allocations = allocator_->instrumentation();
+        return usage;
+    }
+    
+    void Document::writeMemoryReport(StringBuffer* out) const {
+        const MemoryUsage usage = memoryUsage();
+        appendLine(out, "%zu nodes, %zu elements, %zu attributes, %zu bytes of source\n",
+                   usage.nodes, usage.elements, usage.attributes, usage.sourceBytes);
+        if (!usage.allocations) return;
+        
+        appendLine(out, "%-12s %10s %10s %10s %12s %12s\n", "category", "allocs", "frees", "reallocs", "live bytes", "peak bytes");
+        for (size_t i = 0; i <= CSOUP_ALLOCATION_CATEGORY_COUNT; ++ i) {
+            const AllocationCategoryEnum category = static_cast<AllocationCategoryEnum>(i);
+            const AllocationStats stats = i < CSOUP_ALLOCATION_CATEGORY_COUNT ?
+                usage.allocations->stats(category) : usage.allocations->total();
+            appendLine(out, "%-12s %10zu %10zu %10zu %12zu %12zu\n",
+                       i < CSOUP_ALLOCATION_CATEGORY_COUNT ? InstrumentingAllocator::categoryName(category) : "total",
+                       stats.allocations, stats.frees, stats.reallocs, stats.liveBytes, stats.peakBytes);
+        }
+    }
+    
+    void Document::indexIdsAndClasses() {
+        if (index_) return;
+        
+        index_ = CSOUP_NEW1(allocator(), internal::ElementIndex, allocator());
+        enterIndex();
+    }
+    
+    Element* Document::getElementById(const StringRef& id) {
+        if (index_) return index_->findById(id);
+        
+        for (Node* node = this; node != NULL; node = nextNode(node)) {
+            if (isElement(node) && static_cast<Element*>(node)->attr("id").equals(id)) {
+                return static_cast<Element*>(node);
+            }
+        }
+        
+        return NULL;
+    }
+    
+    void Document::getElementsByClass(const StringRef& className, ElementsRef* output) {
+        if (index_) {
+            index_->findByClass(className, output);
+            return;
+        }
+        
+        for (Node* node = this; node != NULL; node = nextNode(node)) {
+            if (isElement(node) && static_cast<Element*>(node)->hasClass(className)) {
+                output->append(static_cast<Element*>(node));
+            }
+        }
+    }
+}
@@ -4,7 +4,43 @@
 #include "element.h"
 
 namespace csoup {
-    class Document : public Element {
+    class ElementsRef;
+    class StringBuffer;
+    
+    namespace internal {
+        class ElementIndex;
+    }
+    
+    // What a document is made of, see Document::memoryUsage().
+    struct MemoryUsage {
+        size_t nodes;           // nodes in the tree, the document included
+        size_t elements;        // element nodes, the document included
+        size_t attributes;      // attributes of all elements
+        size_t sourceBytes;     // the copy of the input, see setSource()
+        
+        // the counts of the document's allocator, NULL unless it is an
+        // InstrumentingAllocator
+        const InstrumentingAllocator* allocations;
+    };
+    
+    namespace internal {
+        // Owns the allocator of a document that was created without one. It is
+        // a base of Document so that it goes away after the Element and Node
+        // parts, whose destructors still free through the allocator.
+        struct DocumentAllocatorHolder {
+            explicit DocumentAllocatorHolder(Allocator* allocator) :
+                ownAllocator_(allocator ? NULL : new MemoryPoolAllocator()) {
+            }
+            
+            ~DocumentAllocatorHolder() {
+                delete ownAllocator_;
+            }
+            
+            Allocator* ownAllocator_;
+        };
+    }
+    
+    class Document : private internal::DocumentAllocatorHolder, public Element {
     public:
         Document(const StringRef& baseUri, Allocator* allocator = NULL);
         Document(const StringRef& baseUri, const Attributes& attributes, Allocator* allocator = NULL);
@@ -26,10 +62,6 @@ namespace csoup {
             
         }
         
-        StringRef baseUri() const {
-            return baseUri_->ref();
-        }
-        
         // createElement
         
         // Moves any text content that is not in the body element into the body.
@@ -53,32 +85,88 @@ namespace csoup {
         void setPublicIdentifier(const StringRef& publicIdentifier);
         
         StringRef publicIdentifier() const {
-            CSOUP_ASSERT(publicIdentifier_ != NULL);
-            return publicIdentifier_->ref();
+            return publicIdentifier_ ? publicIdentifier_->ref() : StringRef("");
         }
         
         void setSystemIdentifier(const StringRef& systemIdentifier);
         
         StringRef systemIdentifier() const {
-            CSOUP_ASSERT(systemIdentifier_ != NULL);
-            return systemIdentifier_->ref();
+            return systemIdentifier_ ? systemIdentifier_->ref() : StringRef("");
         }
         
         void setName(const StringRef& name);
         
         StringRef name() const {
-            return name_->ref();
+            return name_ ? name_->ref() : StringRef("");
+        }
+        
+        // Keeps a copy of the input the document is parsed from. Text nodes
+        // created by the parser refer to it instead of holding their own copy.
+        StringRef setSource(const StringRef& input);
+        
+        StringRef source() const {
+            return source_ ? StringRef(source_, sourceLength_) : StringRef("");
         }
         
+        // Registers fn(data) to be called when the document is destroyed, last
+        // registered first. A document whose allocator doesn't free (the
+        // default MemoryPoolAllocator) destroys none of its nodes, so anything
+        // the tree refers to that lives outside the allocator has to be
+        // released here.
+        void addCleanup(void (*fn)(void*), void* data);
+        
+        // Counts the nodes and attributes of the tree. To get the bytes they
+        // take, broken down by what they are for, build the document on an
+        // InstrumentingAllocator.
+        MemoryUsage memoryUsage() const;
+        
+        // Appends memoryUsage() to out as a table, one line per allocation
+        // category when the allocator is instrumented.
+        void writeMemoryReport(StringBuffer* out) const;
+        
+        ////////////////////////////////////////////////
+        // Finding elements by id and class
+        
+        // Starts keeping an index of the elements by id and by class name,
+        // built from the tree as it is and kept up to date as elements come
+        // and go or change their id or class attribute. Lookups then cost a
+        // hash instead of a walk over the tree. Documents don't keep one
+        // unless asked, so the tree builder and edits pay nothing for it;
+        // TreeBuilder::setIndexDocuments() has parse() start one before it
+        // builds the tree.
+        void indexIdsAndClasses();
+        
+        bool isIndexed() const {
+            return index_ != NULL;
+        }
+        
+        // The first element in document order whose id is id, or NULL.
+        Element* getElementById(const StringRef& id);
+        
+        // Appends the elements with the class name className, ignoring case,
+        // to output in document order.
+        void getElementsByClass(const StringRef& className, ElementsRef* output);
+        
     private:
+        friend class Element;
+        
+        struct Cleanup {
+            void (*fn)(void*);
+            void* data;
+            Cleanup* next;
+        };
+        
+        void runCleanups();
+        
         QuirksModeEnum quirksMode_;
         String* publicIdentifier_;
         String* systemIdentifier_;
         String* name_;
-        String* baseUri_;
         bool hasDocType_;
-        
-        Allocator* ownAllocator_;
+        CharType* source_;
+        size_t sourceLength_;
+        Cleanup* cleanups_;
+        internal::ElementIndex* index_;     // NULL unless indexIdsAndClasses()
     };
 }
 
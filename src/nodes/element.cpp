@@ -7,7 +7,9 @@
 //
 
 #include "element.h"
+#include "document.h"
 #include "../selector/elementsref.h"
+#include "../util/stringbuffer.h"
 
 namespace csoup {
     void Element::accumulateParents(csoup::Element *ele, csoup::ElementsRef *output) {
@@ -22,4 +24,69 @@ namespace csoup {
             accumulateParents(parElement, output);
         }
     }
+    
+    bool Element::hasClass(const StringRef& className) const {
+        internal::ClassNameReader names(attr("class"));
+        while (names.next()) {
+            if (names.name().equalsIgnoreCase(className)) return true;
+        }
+        
+        return false;
+    }
+    
+    internal::ElementIndex* Element::documentIndex() {
+        Document* doc = ownerDocument();
+        CSOUP_ASSERT(doc != NULL && doc->index_ != NULL);
+        return doc->index_;
+    }
+    
+    void Element::enterIndex() {
+        markIndexed(documentIndex(), true);
+    }
+    
+    void Element::leaveIndex() {
+        markIndexed(documentIndex(), false);
+    }
+    
+    void Element::enterIndex(int attributes) {
+        documentIndex()->add(this, attributes);
+    }
+    
+    void Element::leaveIndex(int attributes) {
+        documentIndex()->remove(this, attributes);
+    }
+    
+    void Element::markIndexed(internal::ElementIndex* index, bool indexed) {
+        // a preorder walk over the links, as trees can be deep
+        Node* node = this;
+        while (node != NULL) {
+            if (isElementNode(node)) {
+                Element* el = static_cast<Element*>(node);
+                el->inIndexedDocument_ = indexed;
+                if (indexed) {
+                    index->add(el);
+                } else {
+                    index->remove(el);
+                }
+                
+                if (el->firstChild_ != NULL) {
+                    node = el->firstChild_;
+                    continue;
+                }
+            }
+            
+            while (node != this && node->next_ == NULL) node = node->parent_;
+            node = node == this ? NULL : node->next_;
+        }
+    }
+    
+    void Element::appendWholeText(StringBuffer* out) const {
+        for (const Node* child = firstChild(); child != NULL; child = child->nextSibling()) {
+            if (child->type() == CSOUP_NODE_TEXT) {
+                out->appendString(static_cast<const TextNode*>(child)->wholeText());
+            } else if (isElementNode(const_cast<Node*>(child))) {
+                static_cast<const Element*>(child)->appendWholeText(out);
+            }
+        }
+    }
 }
\ No newline at end of file
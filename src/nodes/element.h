@@ -7,41 +7,52 @@
 #include "node.h"
 #include "textnode.h"
 #include "datanode.h"
+#include "elementindex.h"
 #include "comment.h"
 #include "tag.h"
 
 namespace csoup {
     class ElementsRef;
+    class StringBuffer;
     
     class Element : public Node {
     public:
-        Element(const StringRef& tagName, const Attributes& attributes, const StringRef& baseUri, Allocator* allocator) :
+        Element(const StringRef& tagName, const Attributes& attributes, BaseUri* baseUri, Allocator* allocator) :
                 Node(CSOUP_NODE_ELEMENT, NULL, 0, baseUri, allocator) {
-            CSOUP_ASSERT(Tag::isKnownTag(tagName));
-                    
-            tag_ = Tag::valueOf(tagName);
-            attributes_ = new (allocator->malloc_t<Attributes>()) Attributes(attributes, allocator);
-            childNodes_ =  NULL;
+            tag_ = NULL;
+            setTag(tagName);
+            attributes_ = Attributes::create(allocator, attributes.size());
+            attributes_->addAttributes(attributes);
+            firstChild_ = lastChild_ = NULL;
+            childCount_ = 0;
+            childrenIndexed_ = true;
+            inIndexedDocument_ = false;
             classes_ = NULL;
         }
         
-        Element(const StringRef& tagName, const StringRef& baseUri, Allocator* allocator) :
+        Element(const StringRef& tagName, BaseUri* baseUri, Allocator* allocator) :
         Node(CSOUP_NODE_ELEMENT, NULL, 0, baseUri, allocator) {
-            CSOUP_ASSERT(Tag::isKnownTag(tagName));
-            
-            tag_ = Tag::valueOf(tagName);
+            tag_ = NULL;
+            setTag(tagName);
             attributes_ = NULL;
-            childNodes_ =  NULL;
+            firstChild_ = lastChild_ = NULL;
+            childCount_ = 0;
+            childrenIndexed_ = true;
+            inIndexedDocument_ = false;
             classes_ = NULL;
         }
 
         ~Element() {
-            for (size_t i = 0; i < childNodes_->size(); ++ i) {
-                CSOUP_DELETE(allocator(), (*childNodes_->at(i)));
+            if (!releasesMemory()) return;
+            
+            for (Node* child = firstChild_; child != NULL; ) {
+                Node* next = child->next_;
+                CSOUP_DELETE(allocator(), child);
+                child = next;
             }
             CSOUP_DELETE(allocator(), attributes_);
-            CSOUP_DELETE(allocator(), childNodes_);
             CSOUP_DELETE(allocator(), classes_);
+            freeUnknownTag();
         }
         
         //////////////////////////////////////////////////
@@ -51,40 +62,20 @@ namespace csoup {
             return tag_;
         }
         
+        TagIdEnum tagId() const {
+            return tag_->id();
+        }
+        
         StringRef tagName() const {
             return tag_->tagName();
         }
         
         void setTagName(const StringRef& tagName) {
-            tag_ = Tag::valueOf(tagName);
+            setTag(tagName);
         }
         
         /////////////////////////////////////////////////
         // Methods about siblings
-        Node* previousSibling() {
-            Node* par = parentNode();
-            if (par == NULL || par->siblingIndex() == 0) {
-                return NULL;
-            }
-            
-            CSOUP_ASSERT(par->type() == CSOUP_NODE_ELEMENT || CSOUP_NODE_DOCUMENT);
-            return static_cast<Element*>(par)->childNode(siblingIndex() - 1);
-        }
-        
-        Node* nextSibling() {
-            Node* par = parentNode();
-            if (par == NULL) {
-                return NULL;
-            }
-            
-            CSOUP_ASSERT(par->type() == CSOUP_NODE_ELEMENT || CSOUP_NODE_DOCUMENT);
-            
-            Element* elementPar = static_cast<Element*>(par);
-            size_t siblingCount = elementPar->childNodeSize();
-            return (siblingIndex() + 1 < siblingCount) ?
-                            elementPar->childNode(siblingIndex() + 1) : NULL;
-        }
-        
         void parents(ElementsRef* output) {
             accumulateParents(this, output);
         }
@@ -111,11 +102,27 @@ namespace csoup {
         
         void addAttribute(AttributeNamespaceEnum space, const StringRef& key,
                           const StringRef& value) {
+            const int indexed = indexedAttribute(space, key);
+            if (indexed) leaveIndex(indexed);
             ensureAttributes()->addAttribute(space, key, value);
+            if (indexed) enterIndex(indexed);
         }
         
         void addAttributes(const Attributes& attrs) {
+            const bool indexed = inIndexedDocument_;
+            if (indexed) leaveIndex(internal::ElementIndex::kAll);
             ensureAttributes()->addAttributes(attrs);
+            if (indexed) enterIndex(internal::ElementIndex::kAll);
+        }
+        
+        // Makes room for count attributes, so that adding them allocates at
+        // most once.
+        void reserveAttributes(size_t count) {
+            if (attributes_) {
+                attributes_->reserve(count);
+            } else {
+                attributes_ = Attributes::create(allocator(), count);
+            }
         }
         
         bool hasAttribute(const StringRef& key) const {
@@ -131,42 +138,80 @@ namespace csoup {
         }
         
         void removeAttribute(AttributeNamespaceEnum space, const StringRef& key) {
-            if (attributes_) attributes_->removeAttribute(space, key);
+            if (!attributes_) return;
+            
+            const int indexed = indexedAttribute(space, key);
+            if (indexed) leaveIndex(indexed);
+            attributes_->removeAttribute(space, key);
+            if (indexed) enterIndex(indexed);
         }
         
+        // Whether the class attribute names className, ignoring case.
+        bool hasClass(const StringRef& className) const;
+        
         ////////////////////////////////////////////////
         // Methods about children node
+        //
+        // The children are a list linked through the nodes themselves, so
+        // appending, inserting next to a node and removing are O(1).
+        // childNode(index) walks the list from the nearer end; to visit every
+        // child, follow firstChild() and nextSibling() instead.
         size_t childNodeSize() const {
-            return childNodes_ ? childNodes_->size() : 0;
+            return childCount_;
+        }
+        
+        Node* firstChild() {
+            return firstChild_;
+        }
+        
+        const Node* firstChild() const {
+            return firstChild_;
+        }
+        
+        Node* lastChild() {
+            return lastChild_;
+        }
+        
+        const Node* lastChild() const {
+            return lastChild_;
         }
         
         const Node* childNode(size_t index) const {
-            CSOUP_ASSERT(index < childNodeSize());
-            return *childNodes_->at(index);
+            return const_cast<Element*>(this)->childNode(index);
         }
         
         Node* childNode(size_t index) {
             CSOUP_ASSERT(index < childNodeSize());
-            return *childNodes_->at(index);
+            
+            Node* node;
+            if (index < childCount_ / 2) {
+                node = firstChild_;
+                for (size_t i = 0; i < index; ++ i) node = node->next_;
+            } else {
+                node = lastChild_;
+                for (size_t i = childCount_ - 1; i > index; -- i) node = node->prev_;
+            }
+            return node;
         }
         
         void removeChild(size_t index, bool del) {
-            CSOUP_ASSERT(index < childNodeSize());
-            
-            // the node in vector would be destroyed
-            if (del) {
-                CSOUP_DELETE(allocator(), *childNodes_->at(index));
-            }
-            
-            childNodes_->remove(index);
-            reindexChildren();
+            removeChild(childNode(index), del);
         }
         
         void removeChild(Node* node, bool del) {
             CSOUP_ASSERT(node->parentNode() == this);
-            removeChild(node->siblingIndex(), del);
+            unlink(node);
+            
+            // the node would be destroyed
+            if (del) {
+                CSOUP_DELETE(allocator(), node);
+            }
         }
         
+        // Appends the text of every text node below this element, in
+        // document order and without normalising whitespace.
+        void appendWholeText(StringBuffer* out) const;
+        
         ///////////////////////////////////////////////
         // !!!!!!!!!!!!!!!!
         //template <NodeTypeEnum>
@@ -185,79 +230,61 @@ namespace csoup {
                 return countOfChildren;
             }
             
-            for (size_t i = 0; i < countOfChildren; ++ i) {
-                arrayBuffer[i] = *(childNodes_->at(i));
+            const Node* child = firstChild_;
+            for (size_t i = 0; i < countOfChildren; ++ i, child = child->next_) {
+                arrayBuffer[i] = child;
             }
             
             return countOfChildren;
         }
         
         void insertNode(size_t index, Node* node) {
-            *insert(index) = node;
-            reindexChildren(index);
+            CSOUP_ASSERT(node->parent_ == NULL);
+            CSOUP_ASSERT(index <= childNodeSize());
+            link(node, index < childCount_ ? childNode(index) : NULL);
         }
         
         void appendNode(Node* node) {
-            *append() = node;
-            reindexChildren(childNodes_->size() - 1);
+            CSOUP_ASSERT(node->parent_ == NULL);
+            link(node, NULL);
         }
         
         Element* insertElement(size_t index, const StringRef& tagName, const Attributes& attributes) {
-            Element* ret = new (allocator()->malloc_t<Element>()) Element(tagName, attributes, baseUri(), allocator());
-            ret->setParentNode(this);
-            
-            childNodes_->insert(index, ret);
-            reindexChildren(index);
-            
+            Element* ret = new (allocator()->malloc_t<Element>()) Element(tagName, attributes, sharedBaseUri(), allocator());
+            insertNode(index, ret);
             return ret;
         }
         
         Element* insertElement(size_t index, const StringRef& tagName) {
-            Element* ret = new (allocator()->malloc_t<Element>()) Element(tagName, baseUri(), allocator());
-            ret->setParentNode(this);
-            
-            childNodes_->insert(index, ret);
-            reindexChildren(index);
-            
+            Element* ret = new (allocator()->malloc_t<Element>()) Element(tagName, sharedBaseUri(), allocator());
+            insertNode(index, ret);
             return ret;
         }
         
         Element* appendElement(const StringRef& tagName, const Attributes& attributes) {
-            Element* ret = new (allocator()->malloc_t<Element>()) Element(tagName, attributes, baseUri(), allocator());
-            ret->setParentNode(this);
-            
-            childNodes_->push(ret);
-            ret->setSiblingIndex(childNodeSize() - 1);
-            
+            Element* ret = new (allocator()->malloc_t<Element>()) Element(tagName, attributes, sharedBaseUri(), allocator());
+            link(ret, NULL);
             return ret;
         }
         
         Element* appendElement(const StringRef& tagName) {
-            Element* ret = new (allocator()->malloc_t<Element>()) Element(tagName, baseUri(), allocator());
-            ret->setParentNode(this);
-            
-            childNodes_->push(ret);
-            ret->setSiblingIndex(childNodeSize() - 1);
-            
+            Element* ret = new (allocator()->malloc_t<Element>()) Element(tagName, sharedBaseUri(), allocator());
+            link(ret, NULL);
             return ret;
         }
         
 #define CREATE_TEXT_BASED_NODE_METHOD(NodeTypeName) \
     NodeTypeName* insert##NodeTypeName(size_t index, const StringRef& text) {\
         NodeTypeName* ret = allocator()->malloc_t<NodeTypeName>(); \
-        new (ret) NodeTypeName(text, baseUri(), allocator()); \
-        ret->setParentNode(this); \
-        childNodes_->insert(index, ret); \
-        reindexChildren(index); \
+        new (ret) NodeTypeName(text, sharedBaseUri(), allocator()); \
+        insertNode(index, ret); \
         return ret; \
     } \
     \
     NodeTypeName* append##NodeTypeName(size_t index, const StringRef& text) { \
         NodeTypeName* ret = allocator()->malloc_t<NodeTypeName>(); \
-        new (ret) NodeTypeName(text, baseUri(), allocator()); \
-        ret->setParentNode(this); \
-        childNodes_->push(ret); \
-        ret->setSiblingIndex(childNodeSize() - 1); \
+        new (ret) NodeTypeName(text, sharedBaseUri(), allocator()); \
+        link(ret, NULL); \
         return ret; \
     }
         
@@ -266,67 +293,144 @@ namespace csoup {
     CREATE_TEXT_BASED_NODE_METHOD(TextNode)
         
     protected:
-        Element(NodeTypeEnum nodeType, const StringRef& tagName, const StringRef& baseUri, Allocator* allocator) :
+        // While an element is in a document that keeps an index of ids and
+        // classes, it and the elements put below it are flagged, and adding
+        // or removing them or changing their id or class attribute updates
+        // the index. Elements in other documents only test the flag.
+        //
+        // enterIndex() adds the element and the elements below it to the
+        // index of the document it is in; leaveIndex() takes them out again.
+        void enterIndex();
+        void leaveIndex();
+        
+        Element(NodeTypeEnum nodeType, const StringRef& tagName, BaseUri* baseUri, Allocator* allocator) :
         Node(nodeType, NULL, 0, baseUri, allocator) {
-            CSOUP_ASSERT(Tag::isKnownTag(tagName));
             CSOUP_ASSERT(nodeType == CSOUP_NODE_FORMELEMENT || nodeType == CSOUP_NODE_DOCUMENT);
             
-            tag_ = Tag::valueOf(tagName);
+            tag_ = NULL;
+            setTag(tagName);
             attributes_ = NULL;
-            childNodes_ =  NULL;
+            firstChild_ = lastChild_ = NULL;
+            childCount_ = 0;
+            childrenIndexed_ = true;
+            inIndexedDocument_ = false;
             classes_ = NULL;
         }
         
-        Element(NodeTypeEnum nodeType, const StringRef& tagName, const Attributes& attributes, const StringRef& baseUri, Allocator* allocator) :
+        Element(NodeTypeEnum nodeType, const StringRef& tagName, const Attributes& attributes, BaseUri* baseUri, Allocator* allocator) :
         Node(nodeType, NULL, 0, baseUri, allocator) {
-            CSOUP_ASSERT(Tag::isKnownTag(tagName));
             CSOUP_ASSERT(nodeType == CSOUP_NODE_FORMELEMENT || nodeType == CSOUP_NODE_DOCUMENT);
             
-            tag_ = Tag::valueOf(tagName);
-            attributes_ = new (allocator->malloc_t<Attributes>()) Attributes(attributes, allocator);
-            childNodes_ =  NULL;
+            tag_ = NULL;
+            setTag(tagName);
+            attributes_ = Attributes::create(allocator, attributes.size());
+            attributes_->addAttributes(attributes);
+            firstChild_ = lastChild_ = NULL;
+            childCount_ = 0;
+            childrenIndexed_ = true;
+            inIndexedDocument_ = false;
             classes_ = NULL;
         }
         
     private:
-        // to be conitnued;
-        Node** insert(size_t index) {
-            return ensureChildNodes()->insert(index);
+        // Known tags are shared; an element with a tag we don't know owns a
+        // Tag of its own.
+        void setTag(const StringRef& tagName) {
+            Tag* tag = Tag::valueOf(tagName);
+            if (tag == NULL) {
+                tag = Tag::newUnknown(tagName, allocator());
+            }
+            
+            freeUnknownTag();
+            tag_ = tag;
         }
         
-        Node** append() {
-            return ensureChildNodes()->push();
+        void freeUnknownTag() {
+            if (tag_ != NULL && !tag_->isKnownTag()) {
+                Tag::deleteUnknown(tag_, allocator());
+            }
+            tag_ = NULL;
         }
         
         Attributes* ensureAttributes() {
             if (!attributes_) {
-                attributes_ = allocator()->malloc_t<Attributes>();
-                new (attributes_) Attributes(allocator());
+                attributes_ = Attributes::create(allocator());
             }
             
             return attributes_;
         }
         
-        internal::Vector<Node*>* ensureChildNodes() {
-            if (!childNodes_) {
-                childNodes_ = allocator()->malloc_t< internal::Vector<Node*> >();
-                new (childNodes_) internal::Vector<Node*>(4, allocator());
+        // Links node in before ref, or at the end when ref is NULL. Appending
+        // keeps the sibling indexes current; inserting anywhere else leaves
+        // them to be renumbered when one is asked for.
+        void link(Node* node, Node* ref) {
+            CSOUP_ASSERT(ref == NULL || ref->parent_ == this);
+            node->setParentNode(this);
+            
+            Node* prev = ref ? ref->prev_ : lastChild_;
+            node->prev_ = prev;
+            node->next_ = ref;
+            (prev ? prev->next_ : firstChild_) = node;
+            (ref ? ref->prev_ : lastChild_) = node;
+            
+            if (ref == NULL) {
+                node->siblingIndex_ = childCount_;
+            } else {
+                childrenIndexed_ = false;
             }
+            ++ childCount_;
             
-            return childNodes_;
+            if (inIndexedDocument_ && isElementNode(node)) static_cast<Element*>(node)->enterIndex();
         }
         
-        void reindexChildren(size_t from = 0) {
-            // we can ignore whether childNodes_ is NULL or not;
-            const size_t countOfChildren = childNodeSize();
+        void unlink(Node* node) {
+            if (inIndexedDocument_ && isElementNode(node)) static_cast<Element*>(node)->leaveIndex();
             
-            for (size_t i = from; i < countOfChildren; ++ i) {
-                (*childNodes_->at(i))->setSiblingIndex(i);
+            (node->prev_ ? node->prev_->next_ : firstChild_) = node->next_;
+            (node->next_ ? node->next_->prev_ : lastChild_) = node->prev_;
+            if (node->next_ != NULL) {
+                childrenIndexed_ = false;
             }
+            
+            node->parent_ = node->prev_ = node->next_ = NULL;
+            -- childCount_;
+        }
+        
+        // Renumbers the children if an insertion or removal has left their
+        // sibling indexes stale.
+        void indexChildren() const {
+            if (childrenIndexed_) return;
+            
+            size_t index = 0;
+            for (Node* child = firstChild_; child != NULL; child = child->next_) {
+                child->siblingIndex_ = index ++;
+            }
+            childrenIndexed_ = true;
         }
         
         static void accumulateParents(Element* ele, ElementsRef* output);
         
+        // The ElementIndex flag of the attribute when the document keeps an
+        // index and the attribute is one it uses, or 0, so that changing one
+        // leaves the element under the other.
+        int indexedAttribute(AttributeNamespaceEnum space, const StringRef& key) const {
+            if (!inIndexedDocument_ || space != CSOUP_ATTR_NAMESPACE_NONE) return 0;
+            if (key.equalsIgnoreCase("id")) return internal::ElementIndex::kId;
+            return key.equalsIgnoreCase("class") ? internal::ElementIndex::kClass : 0;
+        }
+        
+        // the index of the document this element is in
+        internal::ElementIndex* documentIndex();
+        
+        // Takes this element out of the index under the attributes given, or
+        // puts it back.
+        void leaveIndex(int attributes);
+        void enterIndex(int attributes);
+        
+        // Sets the flag of this element and the elements below it, adding
+        // them to index or taking them out.
+        void markIndexed(internal::ElementIndex* index, bool indexed);
+        
         static bool isElementNode(Node* node) {
             if (node == NULL) {
                 return false;
@@ -343,7 +447,12 @@ namespace csoup {
         internal::Vector<StringRef>* classes_;
         
         Attributes* attributes_;
-        internal::Vector<Node*>* childNodes_;
+        
+        Node* firstChild_;
+        Node* lastChild_;
+        size_t childCount_;
+        mutable bool childrenIndexed_;
+        bool inIndexedDocument_;
     };
     
 }
@@ -0,0 +1,340 @@
+//
+//  elementindex.cpp
+//  csoup
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include <algorithm>
+#include <cstring>
+#include "elementindex.h"
+#include "element.h"
+#include "../selector/elementsref.h"
+
+namespace {
+    using namespace csoup;
+
+    bool isClassSeparator(CharType c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\f' || c == '\r';
+    }
+
+    size_t depthOf(const Node* node) {
+        size_t depth = 0;
+        for (; node->parentNode() != NULL; node = node->parentNode()) ++ depth;
+        return depth;
+    }
+
+    // an element with its depth, which sorting would otherwise find again
+    // for every comparison
+    struct Placed {
+        Element* el;
+        size_t depth;
+    };
+
+    // true when a comes before b in their document
+    bool precedes(const Placed& placedA, const Placed& placedB) {
+        const Node* a = placedA.el;
+        const Node* b = placedB.el;
+        if (a == b) return false;
+
+        // bring both to the same depth; an ancestor comes first
+        size_t depthA = placedA.depth, depthB = placedB.depth;
+        for (; depthA > depthB; -- depthA) {
+            a = a->parentNode();
+            if (a == b) return false;
+        }
+        for (; depthB > depthA; -- depthB) {
+            b = b->parentNode();
+            if (b == a) return true;
+        }
+
+        // then to children of the same parent
+        while (a->parentNode() != b->parentNode()) {
+            a = a->parentNode();
+            b = b->parentNode();
+        }
+        return a->siblingIndex() < b->siblingIndex();
+    }
+}
+
+namespace csoup {
+    namespace internal {
+        bool ClassNameReader::next() {
+            begin_ = end_;
+            while (begin_ < classes_.size() && isClassSeparator(classes_.data()[begin_])) ++ begin_;
+
+            end_ = begin_;
+            while (end_ < classes_.size() && !isClassSeparator(classes_.data()[end_])) ++ end_;
+
+            return begin_ < end_;
+        }
+
+        ////////////////////////////////////////////////
+        // ElementIndex::Table
+
+        ElementIndex::Table::Table(bool ignoreCase, Allocator* allocator) :
+            entries_(NULL), entrySlots_(0), entryCount_(0), freeSerials_(1, allocator),
+            members_(NULL), memberSlots_(0), memberCount_(0),
+            ignoreCase_(ignoreCase), allocator_(allocator) {
+        }
+
+        ElementIndex::Table::~Table() {
+            for (size_t i = 0; i < entrySlots_; ++ i) {
+                if (entries_[i].used) entries_[i].~Entry();
+            }
+            allocator_->free(entries_);
+            allocator_->free(members_);
+        }
+
+        void ElementIndex::Table::add(const StringRef& key, Element* el) {
+            if (key.size() == 0) return;
+            Entry* entry = insert(key);
+
+            // a class name an element repeats counts once
+            if (findMember(entry, el)) return;
+
+            if (!entry->elements.empty()) entry->ordered = false;
+            insertMember(entry, el, entry->elements.size());
+            entry->elements.push(el);
+        }
+
+        void ElementIndex::Table::remove(const StringRef& key, Element* el) {
+            Entry* entry = find(key);
+            Member* member = entry ? findMember(entry, el) : NULL;
+            if (!member) return;
+
+            const size_t position = member->position;
+            eraseMember(member);
+
+            const size_t last = entry->elements.size() - 1;
+            if (position != last) {
+                Element* moved = *entry->elements.at(last);
+                *entry->elements.at(position) = moved;
+                findMember(entry, moved)->position = static_cast<uint32_t>(position);
+                entry->ordered = false;
+            }
+            entry->elements.pop();
+
+            if (entry->elements.empty()) eraseEntry(entry);
+        }
+
+        const Vector<Element*>* ElementIndex::Table::elements(const StringRef& key) {
+            Entry* entry = find(key);
+            if (!entry || entry->elements.empty()) return NULL;
+            if (entry->ordered) return &entry->elements;
+
+            const size_t count = entry->elements.size();
+            Vector<Placed> placed(count, allocator_);
+            for (size_t i = 0; i < count; ++ i) {
+                Placed* p = placed.push();
+                p->el = *entry->elements.at(i);
+                p->depth = depthOf(p->el);
+            }
+
+            Placed* begin = placed.base();
+            Placed* end = begin + count;
+            for (Placed* p = begin + 1; p < end; ++ p) {
+                if (precedes(p[-1], p[0])) continue;
+
+                std::sort(begin, end, precedes);
+                for (size_t i = 0; i < count; ++ i) {
+                    *entry->elements.at(i) = begin[i].el;
+                    findMember(entry, begin[i].el)->position = static_cast<uint32_t>(i);
+                }
+                break;
+            }
+
+            entry->ordered = true;
+            return &entry->elements;
+        }
+
+        bool ElementIndex::Table::matches(const Entry* entry, const StringRef& key, uint32_t hash) const {
+            if (entry->hash != hash) return false;
+            return ignoreCase_ ? strEqualsIgnoreCase(entry->key.ref(), key) : strEquals(entry->key.ref(), key);
+        }
+
+        ElementIndex::Table::Entry* ElementIndex::Table::find(const StringRef& key) {
+            if (entryCount_ == 0 || key.size() == 0) return NULL;
+
+            const uint32_t hash = strHashIgnoreCase(key);
+            const size_t mask = entrySlots_ - 1;
+            for (size_t slot = hash & mask; entries_[slot].used; slot = (slot + 1) & mask) {
+                if (matches(entries_ + slot, key, hash)) return entries_ + slot;
+            }
+
+            return NULL;
+        }
+
+        ElementIndex::Table::Entry* ElementIndex::Table::insert(const StringRef& key) {
+            Entry* entry = find(key);
+            if (entry) return entry;
+
+            if (2 * (entryCount_ + 1) > entrySlots_) growEntries();
+
+            const uint32_t hash = strHashIgnoreCase(key);
+            const size_t mask = entrySlots_ - 1;
+            size_t slot = hash & mask;
+            while (entries_[slot].used) slot = (slot + 1) & mask;
+
+            AllocationScope scope(CSOUP_ALLOCATION_NODES);
+            uint32_t serial = static_cast<uint32_t>(entryCount_ ++);
+            if (!freeSerials_.empty()) {
+                serial = *freeSerials_.back();
+                freeSerials_.pop();
+            }
+            return new (entries_ + slot) Entry(key, hash, serial, allocator_);
+        }
+
+        void ElementIndex::Table::eraseEntry(Entry* entry) {
+            AllocationScope scope(CSOUP_ALLOCATION_NODES);
+            *freeSerials_.push() = entry->serial;
+            entry->~Entry();
+
+            // moves back the entries probing would no longer reach, as
+            // eraseMember() does
+            const size_t mask = entrySlots_ - 1;
+            size_t hole = entry - entries_;
+            for (size_t slot = (hole + 1) & mask; entries_[slot].used; slot = (slot + 1) & mask) {
+                const size_t home = entries_[slot].hash & mask;
+                if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+                    std::memcpy(static_cast<void*>(entries_ + hole), entries_ + slot, sizeof(Entry));
+                    hole = slot;
+                }
+            }
+
+            entries_[hole].used = false;
+            -- entryCount_;
+        }
+
+        size_t ElementIndex::Table::hashOf(uint32_t serial, const Element* el) {
+            // elements sit at regular distances in memory, which linear
+            // probing would turn into long runs, so the bits are mixed
+            uint64_t h = static_cast<uint64_t>(reinterpret_cast<size_t>(el)) ^ (static_cast<uint64_t>(serial) << 40);
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdull;
+            h ^= h >> 33;
+            return static_cast<size_t>(h);
+        }
+
+        ElementIndex::Table::Member* ElementIndex::Table::findMember(const Entry* entry, const Element* el) {
+            if (memberCount_ == 0) return NULL;
+
+            const size_t mask = memberSlots_ - 1;
+            for (size_t slot = hashOf(entry->serial, el) & mask; members_[slot].el; slot = (slot + 1) & mask) {
+                if (members_[slot].el == el && members_[slot].serial == entry->serial) return members_ + slot;
+            }
+
+            return NULL;
+        }
+
+        void ElementIndex::Table::insertMember(const Entry* entry, Element* el, size_t position) {
+            if (2 * (memberCount_ + 1) > memberSlots_) growMembers();
+
+            const size_t mask = memberSlots_ - 1;
+            size_t slot = hashOf(entry->serial, el) & mask;
+            while (members_[slot].el) slot = (slot + 1) & mask;
+
+            members_[slot].el = el;
+            members_[slot].serial = entry->serial;
+            members_[slot].position = static_cast<uint32_t>(position);
+            ++ memberCount_;
+        }
+
+        void ElementIndex::Table::eraseMember(Member* member) {
+            // moves back the members after the hole that probing would no
+            // longer reach, instead of leaving a tombstone
+            const size_t mask = memberSlots_ - 1;
+            size_t hole = member - members_;
+            for (size_t slot = (hole + 1) & mask; members_[slot].el; slot = (slot + 1) & mask) {
+                const size_t home = hashOf(members_[slot].serial, members_[slot].el) & mask;
+                if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+                    members_[hole] = members_[slot];
+                    hole = slot;
+                }
+            }
+
+            members_[hole].el = NULL;
+            -- memberCount_;
+        }
+
+        void ElementIndex::Table::growEntries() {
+            AllocationScope scope(CSOUP_ALLOCATION_NODES);
+            const size_t count = entrySlots_ ? 2 * entrySlots_ : 64;
+            Entry* entries = static_cast<Entry*>(allocator_->malloc(count * sizeof(Entry)));
+            std::memset(static_cast<void*>(entries), 0, count * sizeof(Entry));
+
+            const size_t mask = count - 1;
+            for (size_t i = 0; i < entrySlots_; ++ i) {
+                if (!entries_[i].used) continue;
+
+                size_t slot = entries_[i].hash & mask;
+                while (entries[slot].used) slot = (slot + 1) & mask;
+                std::memcpy(static_cast<void*>(entries + slot), entries_ + i, sizeof(Entry));
+            }
+
+            allocator_->free(entries_);
+            entries_ = entries;
+            entrySlots_ = count;
+        }
+
+        void ElementIndex::Table::growMembers() {
+            AllocationScope scope(CSOUP_ALLOCATION_NODES);
+            const size_t count = memberSlots_ ? 2 * memberSlots_ : 64;
+            Member* members = static_cast<Member*>(allocator_->malloc(count * sizeof(Member)));
+            std::memset(members, 0, count * sizeof(Member));
+
+            const size_t mask = count - 1;
+            for (size_t i = 0; i < memberSlots_; ++ i) {
+                if (!members_[i].el) continue;
+
+                size_t slot = hashOf(members_[i].serial, members_[i].el) & mask;
+                while (members[slot].el) slot = (slot + 1) & mask;
+                members[slot] = members_[i];
+            }
+
+            allocator_->free(members_);
+            members_ = members;
+            memberSlots_ = count;
+        }
+
+        ////////////////////////////////////////////////
+        // ElementIndex
+
+        ElementIndex::ElementIndex(Allocator* allocator) :
+            ids_(false, allocator), classes_(true, allocator) {
+        }
+
+        void ElementIndex::add(Element* el, int attributes) {
+            if (attributes & kId) ids_.add(el->attr("id"), el);
+            if (!(attributes & kClass)) return;
+
+            ClassNameReader names(el->attr("class"));
+            while (names.next()) {
+                classes_.add(names.name(), el);
+            }
+        }
+
+        void ElementIndex::remove(Element* el, int attributes) {
+            if (attributes & kId) ids_.remove(el->attr("id"), el);
+            if (!(attributes & kClass)) return;
+
+            ClassNameReader names(el->attr("class"));
+            while (names.next()) {
+                classes_.remove(names.name(), el);
+            }
+        }
+
+        Element* ElementIndex::findById(const StringRef& id) {
+            const Vector<Element*>* elements = ids_.elements(id);
+            return elements ? *elements->front() : NULL;
+        }
+
+        void ElementIndex::findByClass(const StringRef& className, ElementsRef* output) {
+            const Vector<Element*>* elements = classes_.elements(className);
+            for (size_t i = 0; elements && i < elements->size(); ++ i) {
+                output->append(*elements->at(i));
+            }
+        }
+    }
+}
@@ -0,0 +1,161 @@
+//
+//  elementindex.h
+//  csoup
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#ifndef CSOUP_ELEMENTINDEX_H_
+#define CSOUP_ELEMENTINDEX_H_
+
+#include "../internal/vector.h"
+#include "../util/allocators.h"
+#include "../util/csoup_string.h"
+#include "../util/stringref.h"
+
+namespace csoup {
+    class Element;
+    class ElementsRef;
+
+    namespace internal {
+        // Reads the class names out of a class attribute, which separates
+        // them by ASCII whitespace.
+        class ClassNameReader {
+        public:
+            explicit ClassNameReader(const StringRef& classes) : classes_(classes), begin_(0), end_(0) {
+            }
+
+            // Moves to the next class name; false when there are no more.
+            bool next();
+
+            StringRef name() const {
+                return StringRef(classes_.data() + begin_, end_ - begin_);
+            }
+
+        private:
+            const StringRef classes_;
+            size_t begin_;
+            size_t end_;
+        };
+
+        // The elements of a document by id and by class name, see
+        // Document::indexIdsAndClasses(). Ids are compared as they are,
+        // class names ignoring case.
+        class ElementIndex {
+        public:
+            // the attributes an element is kept under
+            enum {
+                kId = 1,
+                kClass = 2,
+                kAll = kId | kClass
+            };
+
+            explicit ElementIndex(Allocator* allocator);
+
+            // Adds el under its id and class names, or removes it, for the
+            // attributes given. Removing has to happen before they change.
+            void add(Element* el, int attributes = kAll);
+            void remove(Element* el, int attributes = kAll);
+
+            // The first element with the id in document order, or NULL.
+            Element* findById(const StringRef& id);
+
+            // Appends the elements with the class name to output in document
+            // order.
+            void findByClass(const StringRef& className, ElementsRef* output);
+
+            // The ids and class names some element has.
+            size_t keyCount() const {
+                return ids_.size() + classes_.size();
+            }
+
+        private:
+            ElementIndex(const ElementIndex&);
+            ElementIndex& operator=(const ElementIndex&);
+
+            // A hash table from keys to the elements that have them. The
+            // keys are copies, as attribute values move when an element's
+            // attributes grow, and go when the last element with them
+            // leaves. A second table finds where an element is among those
+            // of a key, so that adding and removing are O(1) however many
+            // elements share it.
+            //
+            // Removing an element moves the last one of its key into its
+            // place, and an edit can add an element anywhere in the tree;
+            // elements() puts them back in document order when asked for
+            // them. After a parse they are in order already, which it checks
+            // in one pass.
+            class Table {
+            public:
+                Table(bool ignoreCase, Allocator* allocator);
+                ~Table();
+
+                void add(const StringRef& key, Element* el);
+                void remove(const StringRef& key, Element* el);
+
+                // The elements with key in document order, or NULL.
+                const Vector<Element*>* elements(const StringRef& key);
+
+                size_t size() const {
+                    return entryCount_;
+                }
+
+            private:
+                Table(const Table&);
+                Table& operator=(const Table&);
+
+                struct Entry {
+                    Entry(const StringRef& k, uint32_t h, uint32_t s, Allocator* allocator) :
+                        key(k, allocator), elements(1, allocator), hash(h), serial(s), used(true), ordered(true) {
+                    }
+
+                    String key;
+                    Vector<Element*> elements;
+                    uint32_t hash;
+                    uint32_t serial;    // tells the entry apart in members_, unique among entries
+                    bool used;          // false for an empty slot
+                    bool ordered;       // elements is known to be in document order
+                };
+
+                // el is elements[position] of the entry with serial
+                struct Member {
+                    Element* el;        // NULL for an empty slot
+                    uint32_t serial;
+                    uint32_t position;
+                };
+
+                Entry* find(const StringRef& key);
+                Entry* insert(const StringRef& key);
+                void eraseEntry(Entry* entry);
+                bool matches(const Entry* entry, const StringRef& key, uint32_t hash) const;
+
+                static size_t hashOf(uint32_t serial, const Element* el);
+                Member* findMember(const Entry* entry, const Element* el);
+                void insertMember(const Entry* entry, Element* el, size_t position);
+                void eraseMember(Member* member);
+
+                // Both tables are open addressing with linear probing, at
+                // most half full, and move their slots as bytes when they
+                // grow.
+                void growEntries();
+                void growMembers();
+
+                Entry* entries_;
+                size_t entrySlots_;     // a power of two
+                size_t entryCount_;
+                Vector<uint32_t> freeSerials_;  // of erased entries
+                Member* members_;
+                size_t memberSlots_;    // a power of two
+                size_t memberCount_;
+                bool ignoreCase_;
+                Allocator* allocator_;
+            };
+
+            Table ids_;
+            Table classes_;
+        };
+    }
+}
+
+#endif // CSOUP_ELEMENTINDEX_H_
@@ -6,9 +6,7 @@
 //  Copyright (c) 2014 windpls. All rights reserved.
 //
 
-#include <map>
-#include <string>
-#include <cstring>
+#include <algorithm>
 #include "entities.h"
 #include "../util/stringref.h"
 #include "../util/allocators.h"
@@ -19,7 +17,9 @@ namespace {
         int code_;
     };
     
-    ReferenceEntry baseEntries[] {
+    // Both tables must stay sorted by strcmp() order of the names; the lookup
+    // below depends on it.
+    const ReferenceEntry baseEntries[] = {
         {"AElig", 0x000C6},
         {"AMP", 0x00026},
         {"Aacute", 0x000C1},
@@ -128,7 +128,7 @@ namespace {
         {"yuml", 0x000FF},
     };
     
-    ReferenceEntry fullEntries[] = {
+    const ReferenceEntry fullEntries[] = {
         {"AElig", 0x000C6},
         {"AMP", 0x00026},
         {"Aacute", 0x000C1},
@@ -1061,9 +1061,9 @@ namespace {
         {"empty", 0x02205},
         {"emptyset", 0x02205},
         {"emptyv", 0x02205},
+        {"emsp", 0x02003},
         {"emsp13", 0x02004},
         {"emsp14", 0x02005},
-        {"emsp", 0x02003},
         {"eng", 0x0014B},
         {"ensp", 0x02002},
         {"eogon", 0x00119},
@@ -1937,10 +1937,10 @@ namespace {
         {"succsim", 0x0227F},
         {"sum", 0x02211},
         {"sung", 0x0266A},
+        {"sup", 0x02283},
         {"sup1", 0x000B9},
         {"sup2", 0x000B2},
         {"sup3", 0x000B3},
-        {"sup", 0x02283},
         {"supE", 0x02AC6},
         {"supdot", 0x02ABE},
         {"supdsub", 0x02AD8},
@@ -2163,95 +2163,85 @@ namespace {
         {"zwnj", 0x0200C},
     };
     
-    ReferenceEntry xhtmlEntities[] = {
-        {"quot", 0x00022},
-        {"amp", 0x00026},
-        {"lt", 0x0003C},
-        {"gt", 0x0003E}
-    };
-    
-    struct StrComp {
-        bool operator () (const csoup::CharType* s1, const csoup::CharType* s2) const {
-            return std::strcmp(s1, s2) < 0;
+    // Orders the entries that share their first depth_ characters by the next one.
+    // A name that ends at depth_ has '\0' there, so it comes first.
+    struct CharAtDepth {
+        explicit CharAtDepth(size_t depth) : depth_(depth) {}
+        
+        bool operator () (const ReferenceEntry& entry, unsigned char c) const {
+            return static_cast<unsigned char>(entry.name_[depth_]) < c;
+        }
+        
+        bool operator () (unsigned char c, const ReferenceEntry& entry) const {
+            return c < static_cast<unsigned char>(entry.name_[depth_]);
         }
+        
+        size_t depth_;
     };
     
-    typedef std::map<const csoup::CharType*, int, StrComp> NameToCodeMap;
-    typedef std::map<int, const csoup::CharType*> CodeToNameMap;
-    
-    NameToCodeMap base;
-    NameToCodeMap full;
-    CodeToNameMap baseByVal;
-    CodeToNameMap fullByVal;
-    
-    CodeToNameMap xhtmlByVal;
-    
-    // simulae "static block" mechanism in java
-    struct EntitiesLoader {
-        EntitiesLoader() {
-            loadEntities(&base, &baseByVal, baseEntries, sizeof(baseEntries) / sizeof(*baseEntries));
-            loadEntities(&full, &fullByVal, fullEntries, sizeof(fullEntries) / sizeof(*fullEntries));
-            loadEntities(NULL,  &xhtmlByVal, xhtmlEntities, sizeof(xhtmlEntities) / sizeof(*xhtmlEntities));
-        }
-    private:
-        static void loadEntities(std::map<const csoup::CharType*, int, StrComp>* refToCode,
-            std::map<int, const csoup::CharType*>* codeToRef, ReferenceEntry* start, size_t cnt) {
-            for (size_t i = 0; i < cnt; ++ i) {
-                if (refToCode) (*refToCode)[start[i].name_] = start[i].code_;
-                if (codeToRef) (*codeToRef)[start[i].code_] = start[i].name_;
+    // Walks a sorted table like a trie: after depth characters, [begin, end) are
+    // the entries that start with those characters. Returns the length of the
+    // longest name that is a prefix of input, or 0, and its code point in code.
+    size_t longestMatch(const ReferenceEntry* begin, const ReferenceEntry* end,
+                        const csoup::StringRef& input, int* code) {
+        size_t matched = 0;
+        for (size_t depth = 0; depth < input.size() && begin != end; ++ depth) {
+            const unsigned char c = static_cast<unsigned char>(input.data()[depth]);
+            if (c == '\0') break;
+            
+            CharAtDepth comp(depth);
+            begin = std::lower_bound(begin, end, c, comp);
+            end = std::upper_bound(begin, end, c, comp);
+            
+            if (begin != end && begin->name_[depth + 1] == '\0') {
+                matched = depth + 1;
+                if (code) *code = begin->code_;
             }
         }
-    };
-    
-    // very ugly
-    csoup::CharType* makeZeroTerminatedString(const csoup::StringRef& str, csoup::Allocator* allocator) {
-        using csoup::CharType;
-        
-        CharType* buffer = reinterpret_cast<CharType*>(allocator->malloc(sizeof(CharType) * (str.size() + 1)));
-        memcpy(buffer, str.data(), sizeof(CharType) * str.size());
-        buffer[str.size()] = '\0';
         
-        return buffer;
+        return matched;
+    }
+    
+    template <size_t N>
+    size_t longestMatch(const ReferenceEntry (&table)[N], const csoup::StringRef& input, int* code) {
+        return longestMatch(table, table + N, input, code);
+    }
+    
+    template <size_t N>
+    size_t tableSize(const ReferenceEntry (&)[N]) {
+        return N;
     }
 }
 
 namespace csoup {
-    bool Entities::isBaseNamedEntity(const CharType *name) {
-        return base.find(name) != base.end();
+    bool Entities::isBaseNamedEntity(const StringRef& name) {
+        return name.size() > 0 && longestMatch(baseEntries, name, NULL) == name.size();
     }
     
-    bool Entities::isBaseNamedEntity(const csoup::StringRef &name, Allocator* allocator) {
-        CharType* buffer = makeZeroTerminatedString(name, allocator);
-        
-        bool ret = isBaseNamedEntity(buffer);
-        allocator->free(buffer);
-        
-        return ret;
+    bool Entities::isNamedEntity(const StringRef& name) {
+        return name.size() > 0 && longestMatch(fullEntries, name, NULL) == name.size();
     }
     
-    bool Entities::isNamedEntity(const CharType *name) {
-        return full.find(name) != base.end();
+    int Entities::getCharacterByName(const StringRef& name) {
+        int code = -1;
+        if (name.size() == 0 || longestMatch(fullEntries, name, &code) != name.size()) {
+            return -1;
+        }
+        
+        return code;
     }
     
-    bool Entities::isNamedEntity(const csoup::StringRef &name, Allocator* allocator) {
-        CharType* buffer = makeZeroTerminatedString(name, allocator);
-        
-        bool ret = isNamedEntity(buffer);
-        allocator->free(buffer);
-        
-        return ret;
+    size_t Entities::matchNamedEntity(const StringRef& input, bool baseOnly, int* codePoint) {
+        return baseOnly ? longestMatch(baseEntries, input, codePoint) :
+                          longestMatch(fullEntries, input, codePoint);
     }
     
-    int Entities::getCharacterByName(const CharType *name) {
-        NameToCodeMap::iterator it = full.find(name);
-        return it == full.end() ? -1 : it->second;
+    size_t Entities::entityCount(bool baseOnly) {
+        return baseOnly ? tableSize(baseEntries) : tableSize(fullEntries);
     }
     
-    int Entities::getCharacterByName(const StringRef& name, Allocator* allocator) {
-        CharType* buffer = makeZeroTerminatedString(name, allocator);
-        int ret = getCharacterByName(buffer);
-        allocator->free(buffer);
-        
-        return ret;
+    const char* Entities::entityName(bool baseOnly, size_t index) {
+        CSOUP_ASSERT(index < entityCount(baseOnly));
+        return baseOnly ? baseEntries[index].name_ : fullEntries[index].name_;
     }
-}
\ No newline at end of file
+}
@@ -5,23 +5,30 @@
 
 namespace csoup {
     class StringRef;
-    class Allocator;
     
+    // Named character references. The tables are sorted arrays in read-only
+    // data that are searched like a trie, so there is nothing to build at
+    // startup and no lookup allocates.
     class Entities {
     public:
-        static bool isNamedEntity(const StringRef& name, Allocator* allocator);
+        // whether name is a whole entity name, e.g. "amp"
+        static bool isNamedEntity(const StringRef& name);
         
-        static bool isNamedEntity(const CharType* name);
+        // whether name is one of the entities that may appear without ';'
+        static bool isBaseNamedEntity(const StringRef& name);
         
-        static bool isBaseNamedEntity(const StringRef& name, Allocator* allocator);
-        
-        static bool isBaseNamedEntity(const CharType* name);
-        
-        static int getCharacterByName(const StringRef& name, Allocator* allocator);
-        
-        static int getCharacterByName(const CharType* name);
+        // the code point of the entity, or -1 if there is none
+        static int getCharacterByName(const StringRef& name);
         
+        // Returns the length of the longest entity name that input starts
+        // with, or 0 if there is none, and sets *codePoint to its code point.
+        // baseOnly restricts the search to the entities without ';'.
+        static size_t matchNamedEntity(const StringRef& input, bool baseOnly, int* codePoint);
         
+        // The number of entities and the name at index, in table order.
+        // baseOnly selects the table of entities without ';'.
+        static size_t entityCount(bool baseOnly);
+        static const char* entityName(bool baseOnly, size_t index);
     };
 }
 
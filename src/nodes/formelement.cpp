@@ -19,6 +19,7 @@ namespace csoup {
     }
     
     FormElement::~FormElement() {
+        if (!releasesMemory()) return;
         CSOUP_DELETE(allocator(), elements_);
     }
 }
\ No newline at end of file
@@ -8,12 +8,12 @@ namespace csoup {
     
     class FormElement : public Element {
     public:
-        FormElement(const StringRef& tagName, const StringRef& baseUri, Allocator* allocator) :
+        FormElement(const StringRef& tagName, BaseUri* baseUri, Allocator* allocator) :
         Element(CSOUP_NODE_FORMELEMENT, tagName, baseUri, allocator), elements_(NULL) {
             
         }
         
-        FormElement(const StringRef& tagName, const Attributes& attributes, const StringRef& baseUri, Allocator* allocator) :
+        FormElement(const StringRef& tagName, const Attributes& attributes, BaseUri* baseUri, Allocator* allocator) :
         Element(CSOUP_NODE_FORMELEMENT, tagName, attributes, baseUri, allocator), elements_(NULL) {
             
         }
@@ -0,0 +1,478 @@
+//
+//  frozendocument.cpp
+//  csoup
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "frozendocument.h"
+#include "document.h"
+#include "../internal/vector.h"
+#include "../util/stringbuffer.h"
+
+namespace csoup {
+    const size_t FrozenDocument::kNoNode;
+    const uint32_t FrozenDocument::kSnapshotVersion;
+    const uint32_t FrozenDocument::kNone;
+
+    namespace {
+        const char kMagic[8] = { 'C', 'S', 'O', 'U', 'P', 'D', 'O', 'M' };
+
+        // reads back as something else on a machine of the other byte order
+        const uint32_t kByteOrderMark = 0x01020304u;
+
+        size_t align8(size_t size) {
+            return (size + 7) & ~static_cast<size_t>(7);
+        }
+
+        const uint64_t kFnvPrime = CSOUP_UINT64_C2(0x00000100, 0x000001b3);
+        const uint64_t kFnvOffset = CSOUP_UINT64_C2(0xcbf29ce4, 0x84222325);
+
+        // FNV-1a, eight bytes at a time
+        uint64_t fnv(uint64_t h, const void* data, size_t n) {
+            const unsigned char* p = static_cast<const unsigned char*>(data);
+            for (; n >= 8; n -= 8, p += 8) {
+                uint64_t word;
+                std::memcpy(&word, p, sizeof(word));
+                h = (h ^ word) * kFnvPrime;
+            }
+            for (; n > 0; -- n, ++ p) {
+                h = (h ^ *p) * kFnvPrime;
+            }
+            return h;
+        }
+
+        // Snapshots store tag ids, which are positions in CSOUP_TAGS, so a
+        // snapshot only reads back with the same list in the same order.
+        uint64_t tagTableHash() {
+            uint64_t h = kFnvOffset;
+            for (size_t id = 0; id < CSOUP_TAG_UNKNOWN; ++ id) {
+                const StringRef name = Tag::valueOf(static_cast<TagIdEnum>(id))->tagName();
+                h = fnv(h, name.data(), name.size());
+                h = (h ^ '/') * kFnvPrime;
+            }
+            return h;
+        }
+
+        bool inBounds(uint32_t offset, uint32_t length, uint32_t chars) {
+            return static_cast<uint64_t>(offset) + length <= chars;
+        }
+    }
+
+    // Where the arrays of a snapshot with the given counts start.
+    struct FrozenDocument::Layout {
+        Layout(size_t nodes, size_t attributeCount, size_t charCount) {
+            types = align8(sizeof(Header));
+            tagIds = align8(types + nodes * sizeof(uint8_t));
+            parents = align8(tagIds + nodes * sizeof(uint16_t));
+            firstChildren = align8(parents + nodes * sizeof(uint32_t));
+            nextSiblings = align8(firstChildren + nodes * sizeof(uint32_t));
+            attributeBegins = align8(nextSiblings + nodes * sizeof(uint32_t));
+            attributes = align8(attributeBegins + (nodes + 1) * sizeof(uint32_t));
+            texts = align8(attributes + attributeCount * sizeof(FrozenAttribute));
+            chars = align8(texts + nodes * sizeof(Range));
+            size = align8(chars + charCount * sizeof(CharType));
+        }
+
+        size_t types, tagIds, parents, firstChildren, nextSiblings;
+        size_t attributeBegins, attributes, texts, chars;
+        size_t size;
+    };
+
+    // Copies a tree into arrays, numbering the nodes in document order, and
+    // lays the arrays out as a snapshot.
+    class FrozenDocument::Builder {
+    public:
+        Builder(const MemoryUsage& usage, Allocator* allocator) :
+            types_(usage.nodes, allocator), tagIds_(usage.nodes, allocator),
+            parents_(usage.nodes, allocator), firstChildren_(usage.nodes, allocator),
+            nextSiblings_(usage.nodes, allocator), attributeBegins_(usage.nodes + 1, allocator),
+            attributes_(usage.attributes + 1, allocator), texts_(usage.nodes, allocator),
+            chars_(4096, allocator) {
+        }
+
+        // Adds the nodes of the tree under root in document order, with a
+        // walk over the links rather than recursion, as trees can be deep.
+        void add(const Node* root) {
+            const Node* node = root;
+            uint32_t parent = kNone, previous = kNone;
+            while (node != NULL) {
+                const uint32_t index = addNode(node, parent);
+                if (previous != kNone) {
+                    *nextSiblings_.at(previous) = index;
+                } else if (parent != kNone) {
+                    *firstChildren_.at(parent) = index;
+                }
+
+                const Node* child = isElement(node) ? static_cast<const Element*>(node)->firstChild() : NULL;
+                if (child != NULL) {
+                    node = child;
+                    parent = index;
+                    previous = kNone;
+                    continue;
+                }
+
+                // on to the next sibling of the node or of its nearest
+                // ancestor that has one
+                previous = index;
+                while (node != root && node->nextSibling() == NULL) {
+                    node = node->parentNode();
+                    previous = parent;
+                    parent = *parents_.at(parent);
+                }
+                node = node == root ? NULL : node->nextSibling();
+            }
+        }
+
+        Range copy(const StringRef& str) {
+            Range r;
+            r.offset = static_cast<uint32_t>(chars_.size());
+            r.length = static_cast<uint32_t>(str.size());
+
+            chars_.reserve(chars_.size() + str.size());
+            for (size_t i = 0; i < str.size(); ++ i) {
+                chars_.push(str.data()[i]);
+            }
+            return r;
+        }
+
+        // The arrays as a snapshot, in memory from allocator, with the
+        // strings of info, which have to be copied before the tree is added.
+        Header* pack(const Header& info, Allocator* allocator) {
+            attributeBegins_.push(static_cast<uint32_t>(attributes_.size()));
+
+            const Layout layout(types_.size(), attributes_.size(), chars_.size());
+            char* image = static_cast<char*>(allocator->malloc(layout.size));
+            std::memset(image, 0, layout.size);
+
+            Header* header = reinterpret_cast<Header*>(image);
+            *header = info;
+            std::memcpy(header->magic, kMagic, sizeof(kMagic));
+            header->version = kSnapshotVersion;
+            header->byteOrder = kByteOrderMark;
+            header->tagTable = tagTableHash();
+            header->size = layout.size;
+            header->nodes = static_cast<uint32_t>(types_.size());
+            header->attributes = static_cast<uint32_t>(attributes_.size());
+            header->chars = static_cast<uint32_t>(chars_.size());
+
+            place(image + layout.types, types_);
+            place(image + layout.tagIds, tagIds_);
+            place(image + layout.parents, parents_);
+            place(image + layout.firstChildren, firstChildren_);
+            place(image + layout.nextSiblings, nextSiblings_);
+            place(image + layout.attributeBegins, attributeBegins_);
+            place(image + layout.attributes, attributes_);
+            place(image + layout.texts, texts_);
+            place(image + layout.chars, chars_);
+
+            header->checksum = checksum(header);
+            return header;
+        }
+
+    private:
+        static bool isElement(const Node* node) {
+            return node->type() == CSOUP_NODE_ELEMENT || node->type() == CSOUP_NODE_FORMELEMENT ||
+                node->type() == CSOUP_NODE_DOCUMENT;
+        }
+
+        // Adds node without its children, which add() links in.
+        uint32_t addNode(const Node* node, uint32_t parent) {
+            const uint32_t index = static_cast<uint32_t>(types_.size());
+
+            types_.push(static_cast<uint8_t>(node->type()));
+            parents_.push(parent);
+            firstChildren_.push(kNone);
+            nextSiblings_.push(kNone);
+            attributeBegins_.push(static_cast<uint32_t>(attributes_.size()));
+
+            Range* text = texts_.push();
+            text->offset = text->length = 0;
+
+            switch (node->type()) {
+                case CSOUP_NODE_TEXT:
+                    *text = copy(static_cast<const TextNode*>(node)->wholeText());
+                    break;
+                case CSOUP_NODE_COMMENT:
+                    *text = copy(static_cast<const CommentNode*>(node)->comment());
+                    break;
+                case CSOUP_NODE_CDATA:
+                    *text = copy(static_cast<const DataNode*>(node)->wholeData());
+                    break;
+                default:
+                    break;
+            }
+
+            if (!isElement(node)) {
+                tagIds_.push(CSOUP_TAG_UNKNOWN);
+                return index;
+            }
+
+            const Element* el = static_cast<const Element*>(node);
+            tagIds_.push(static_cast<uint16_t>(el->tagId()));
+            if (el->tagId() == CSOUP_TAG_UNKNOWN) {
+                *texts_.at(index) = copy(el->tagName());
+            }
+
+            const Attributes* attrs = el->attributes();
+            for (size_t i = 0; attrs != NULL && i < attrs->size(); ++ i) {
+                const Attribute* attr = attrs->get(i);
+                FrozenAttribute* frozenAttr = attributes_.push();
+                frozenAttr->key = copy(attr->key().ref());
+                frozenAttr->value = copy(attr->value().ref());
+                frozenAttr->space = attr->nameSpace();
+            }
+
+            return index;
+        }
+
+        template <typename T>
+        static void place(char* dst, const internal::Vector<T>& src) {
+            if (!src.empty()) std::memcpy(dst, src.base(), src.size() * sizeof(T));
+        }
+
+        internal::Vector<uint8_t> types_;
+        internal::Vector<uint16_t> tagIds_;
+        internal::Vector<uint32_t> parents_;
+        internal::Vector<uint32_t> firstChildren_;
+        internal::Vector<uint32_t> nextSiblings_;
+        internal::Vector<uint32_t> attributeBegins_;
+        internal::Vector<FrozenAttribute> attributes_;
+        internal::Vector<Range> texts_;
+        internal::Vector<CharType> chars_;
+    };
+
+    FrozenDocument::FrozenDocument(const Document* doc, Allocator* allocator) :
+        header_(NULL), mapped_(false), allocator_(allocator) {
+        MemoryUsage usage = doc->memoryUsage();
+        CSOUP_ASSERT(usage.nodes < kNone);
+
+        Builder builder(usage, allocator);
+        Header info;
+        std::memset(&info, 0, sizeof(info));
+        info.quirksMode = doc->quirksMode();
+        info.baseUri = builder.copy(doc->baseUri());
+        info.name = builder.copy(doc->name());
+        info.publicIdentifier = builder.copy(doc->publicIdentifier());
+        info.systemIdentifier = builder.copy(doc->systemIdentifier());
+
+        builder.add(doc);
+        attach(builder.pack(info, allocator));
+    }
+
+    FrozenDocument::FrozenDocument(Allocator* allocator) :
+        header_(NULL), mapped_(false), allocator_(allocator) {
+    }
+
+    FrozenDocument::~FrozenDocument() {
+        release();
+    }
+
+    void FrozenDocument::attach(const Header* image) {
+        const Layout layout(image->nodes, image->attributes, image->chars);
+        const char* base = reinterpret_cast<const char*>(image);
+
+        header_ = image;
+        types_ = reinterpret_cast<const uint8_t*>(base + layout.types);
+        tagIds_ = reinterpret_cast<const uint16_t*>(base + layout.tagIds);
+        parents_ = reinterpret_cast<const uint32_t*>(base + layout.parents);
+        firstChildren_ = reinterpret_cast<const uint32_t*>(base + layout.firstChildren);
+        nextSiblings_ = reinterpret_cast<const uint32_t*>(base + layout.nextSiblings);
+        attributeBegins_ = reinterpret_cast<const uint32_t*>(base + layout.attributeBegins);
+        attributes_ = reinterpret_cast<const FrozenAttribute*>(base + layout.attributes);
+        texts_ = reinterpret_cast<const Range*>(base + layout.texts);
+        chars_ = reinterpret_cast<const CharType*>(base + layout.chars);
+    }
+
+    void FrozenDocument::release() {
+        if (header_ == NULL) return;
+
+        if (mapped_) {
+            munmap(const_cast<Header*>(header_), static_cast<size_t>(header_->size));
+        } else {
+            allocator_->free(header_);
+        }
+        header_ = NULL;
+        mapped_ = false;
+    }
+
+    uint64_t FrozenDocument::checksum(const Header* image) {
+        // the header too, as its ranges point into the text
+        const char* base = reinterpret_cast<const char*>(image);
+        const size_t skipped = offsetof(Header, checksum) + sizeof(image->checksum);
+
+        uint64_t h = fnv(kFnvOffset, base, offsetof(Header, checksum));
+        h = fnv(h, base + skipped, static_cast<size_t>(image->size) - skipped);
+        return h ^ (h >> 32);
+    }
+
+    bool FrozenDocument::isWellFormed(const Header* image) {
+        const uint32_t nodes = image->nodes, chars = image->chars;
+        if (image->quirksMode > CSOUP_DOCTYPE_LIMITED_QUIRKS ||
+            !inBounds(image->baseUri.offset, image->baseUri.length, chars) ||
+            !inBounds(image->name.offset, image->name.length, chars) ||
+            !inBounds(image->publicIdentifier.offset, image->publicIdentifier.length, chars) ||
+            !inBounds(image->systemIdentifier.offset, image->systemIdentifier.length, chars)) {
+            return false;
+        }
+
+        const Layout layout(nodes, image->attributes, chars);
+        const char* base = reinterpret_cast<const char*>(image);
+        const uint8_t* types = reinterpret_cast<const uint8_t*>(base + layout.types);
+        const uint16_t* tagIds = reinterpret_cast<const uint16_t*>(base + layout.tagIds);
+        const uint32_t* parents = reinterpret_cast<const uint32_t*>(base + layout.parents);
+        const uint32_t* firstChildren = reinterpret_cast<const uint32_t*>(base + layout.firstChildren);
+        const uint32_t* nextSiblings = reinterpret_cast<const uint32_t*>(base + layout.nextSiblings);
+        const uint32_t* attributeBegins = reinterpret_cast<const uint32_t*>(base + layout.attributeBegins);
+        const FrozenAttribute* attributes = reinterpret_cast<const FrozenAttribute*>(base + layout.attributes);
+        const Range* texts = reinterpret_cast<const Range*>(base + layout.texts);
+
+        // Nodes are numbered in document order: a parent before its
+        // children, the first child right after it, a sibling after its
+        // previous one. Walks up and along the links then always end.
+        for (uint32_t i = 0; i < nodes; ++ i) {
+            if (types[i] > CSOUP_NODE_FORMELEMENT || tagIds[i] > CSOUP_TAG_UNKNOWN ||
+                (i == 0 ? parents[i] != kNone : parents[i] >= i) ||
+                (firstChildren[i] != kNone && firstChildren[i] != i + 1) ||
+                (nextSiblings[i] != kNone && (nextSiblings[i] <= i || nextSiblings[i] >= nodes)) ||
+                !inBounds(texts[i].offset, texts[i].length, chars)) {
+                return false;
+            }
+        }
+
+        if (attributeBegins[0] != 0 || attributeBegins[nodes] > image->attributes) return false;
+        for (uint32_t i = 0; i < nodes; ++ i) {
+            if (attributeBegins[i] > attributeBegins[i + 1]) return false;
+        }
+        for (uint32_t i = 0; i < image->attributes; ++ i) {
+            if (!inBounds(attributes[i].key.offset, attributes[i].key.length, chars) ||
+                !inBounds(attributes[i].value.offset, attributes[i].value.length, chars)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    SnapshotStatusEnum FrozenDocument::check(const Header* image, size_t size, bool verifyChecksum) {
+        // the tests and the format itself depend on this layout
+        CSOUP_STATIC_ASSERT(sizeof(Header) == 88);
+
+        if (size < sizeof(Header) || std::memcmp(image->magic, kMagic, sizeof(kMagic)) != 0 ||
+            image->byteOrder != kByteOrderMark) {
+            return CSOUP_SNAPSHOT_BAD_FORMAT;
+        }
+        if (image->version != kSnapshotVersion || image->tagTable != tagTableHash()) {
+            return CSOUP_SNAPSHOT_BAD_VERSION;
+        }
+        if (image->size != size || image->nodes == 0 ||
+            Layout(image->nodes, image->attributes, image->chars).size != size) {
+            return CSOUP_SNAPSHOT_BAD_FORMAT;
+        }
+        if (verifyChecksum && checksum(image) != image->checksum) {
+            return CSOUP_SNAPSHOT_BAD_CHECKSUM;
+        }
+        return isWellFormed(image) ? CSOUP_SNAPSHOT_OK : CSOUP_SNAPSHOT_BAD_FORMAT;
+    }
+
+    SnapshotStatusEnum FrozenDocument::save(const char* path) const {
+        CSOUP_ASSERT(header_ != NULL);
+
+        std::FILE* file = std::fopen(path, "wb");
+        if (file == NULL) return CSOUP_SNAPSHOT_IO_ERROR;
+
+        const size_t size = static_cast<size_t>(header_->size);
+        const bool written = std::fwrite(header_, 1, size, file) == size;
+        return std::fclose(file) == 0 && written ? CSOUP_SNAPSHOT_OK : CSOUP_SNAPSHOT_IO_ERROR;
+    }
+
+    SnapshotStatusEnum FrozenDocument::load(const char* path, bool verifyChecksum) {
+        release();
+
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return CSOUP_SNAPSHOT_IO_ERROR;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return CSOUP_SNAPSHOT_IO_ERROR;
+        }
+        const size_t size = static_cast<size_t>(st.st_size);
+        if (size < sizeof(Header)) {
+            close(fd);
+            return CSOUP_SNAPSHOT_BAD_FORMAT;
+        }
+
+        void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) return CSOUP_SNAPSHOT_IO_ERROR;
+
+        const Header* image = static_cast<const Header*>(data);
+        SnapshotStatusEnum status = check(image, size, verifyChecksum);
+        if (status != CSOUP_SNAPSHOT_OK) {
+            munmap(data, size);
+            return status;
+        }
+
+        attach(image);
+        mapped_ = true;
+        return CSOUP_SNAPSHOT_OK;
+    }
+
+    StringRef FrozenDocument::tagName(size_t node) const {
+        if (!isElement(node)) return StringRef("");
+
+        const TagIdEnum id = tagId(node);
+        return id == CSOUP_TAG_UNKNOWN ? range(texts_[node]) : Tag::valueOf(id)->tagName();
+    }
+
+    size_t FrozenDocument::childNodeSize(size_t node) const {
+        size_t count = 0;
+        for (size_t child = firstChild(node); child != kNoNode; child = nextSibling(child)) {
+            ++ count;
+        }
+        return count;
+    }
+
+    size_t FrozenDocument::subtreeEnd(size_t node) const {
+        for (size_t n = node; n != kNoNode; n = parentNode(n)) {
+            const size_t next = nextSibling(n);
+            if (next != kNoNode) return next;
+        }
+        return size();
+    }
+
+    const FrozenDocument::FrozenAttribute* FrozenDocument::findAttribute(size_t node, AttributeNamespaceEnum space, const StringRef& key) const {
+        if (!key.size()) return NULL;
+
+        const uint32_t end = attributeBegins_[node + 1];
+        for (uint32_t i = attributeBegins_[node]; i < end; ++ i) {
+            const FrozenAttribute* attr = attributes_ + i;
+            if (attr->space == static_cast<uint32_t>(space) && range(attr->key).equalsIgnoreCase(key)) {
+                return attr;
+            }
+        }
+        return NULL;
+    }
+
+    StringRef FrozenDocument::attr(size_t node, AttributeNamespaceEnum space, const StringRef& key) const {
+        const FrozenAttribute* attr = findAttribute(node, space, key);
+        return attr ? range(attr->value) : StringRef("");
+    }
+
+    void FrozenDocument::appendWholeText(size_t node, StringBuffer* out) const {
+        const size_t end = subtreeEnd(node);
+        for (size_t i = node; i < end; ++ i) {
+            if (type(i) == CSOUP_NODE_TEXT) {
+                out->appendString(range(texts_[i]));
+            }
+        }
+    }
+}
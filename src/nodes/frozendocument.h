@@ -0,0 +1,288 @@
+//
+//  frozendocument.h
+//  csoup
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#ifndef CSOUP_FROZENDOCUMENT_H_
+#define CSOUP_FROZENDOCUMENT_H_
+
+#include "../internal/nodedata.h"
+#include "../util/allocators.h"
+#include "../util/stringref.h"
+#include "attribute.h"
+#include "tag.h"
+
+namespace csoup {
+    class Document;
+    class StringBuffer;
+
+    typedef enum {
+        CSOUP_SNAPSHOT_OK,
+        // the file couldn't be opened, mapped or written
+        CSOUP_SNAPSHOT_IO_ERROR,
+        // not a snapshot, one written on a machine of the other byte order,
+        // or one whose node numbers or text ranges point outside it
+        CSOUP_SNAPSHOT_BAD_FORMAT,
+        // written by a version of csoup whose format or tag ids this one
+        // can't read
+        CSOUP_SNAPSHOT_BAD_VERSION,
+        // the contents don't match the checksum taken when it was written
+        CSOUP_SNAPSHOT_BAD_CHECKSUM
+    } SnapshotStatusEnum;
+
+    // A read-only copy of a document, for code that parses a page, looks
+    // things up and never changes the tree. The nodes are numbered in
+    // document order, the document itself being node 0, and each property
+    // of a node is an entry in an array of its own: types, tag ids, parent,
+    // first child and next sibling numbers, and ranges into a shared array
+    // of attributes and a single buffer of text. A walk reads a few dense
+    // arrays instead of chasing a pointer per node, and the descendants of
+    // a node are the nodes numbered from node + 1 up to subtreeEnd(node).
+    //
+    // The copy doesn't refer to the document, which can be destroyed once
+    // it is frozen. Node numbers play the part of Node pointers, with
+    // kNoNode for NULL.
+    //
+    // The arrays sit in one block laid out the way save() writes it to a
+    // file, so load() maps a snapshot into memory and answers queries from
+    // the mapping, without parsing or allocating anything per node.
+    class FrozenDocument {
+    public:
+        static const size_t kNoNode = static_cast<size_t>(-1);
+
+        // Snapshots of any other version don't load.
+        static const uint32_t kSnapshotVersion = 2;
+
+        FrozenDocument(const Document* doc, Allocator* allocator);
+
+        // An empty document, to load() a snapshot into.
+        explicit FrozenDocument(Allocator* allocator);
+
+        ~FrozenDocument();
+
+        size_t size() const {
+            return header_ ? header_->nodes : 0;
+        }
+
+        StringRef baseUri() const {
+            return range(header_->baseUri);
+        }
+
+        ////////////////////////////////////////////////
+        // What the document's doctype said
+
+        QuirksModeEnum quirksMode() const {
+            return static_cast<QuirksModeEnum>(header_->quirksMode);
+        }
+
+        StringRef name() const {
+            return range(header_->name);
+        }
+
+        StringRef publicIdentifier() const {
+            return range(header_->publicIdentifier);
+        }
+
+        StringRef systemIdentifier() const {
+            return range(header_->systemIdentifier);
+        }
+
+        ////////////////////////////////////////////////
+        // Methods about nodes
+
+        NodeTypeEnum type(size_t node) const {
+            CSOUP_ASSERT(node < size());
+            return static_cast<NodeTypeEnum>(types_[node]);
+        }
+
+        bool isElement(size_t node) const {
+            const NodeTypeEnum t = type(node);
+            return t == CSOUP_NODE_ELEMENT || t == CSOUP_NODE_FORMELEMENT || t == CSOUP_NODE_DOCUMENT;
+        }
+
+        // CSOUP_TAG_UNKNOWN for nodes that aren't elements
+        TagIdEnum tagId(size_t node) const {
+            CSOUP_ASSERT(node < size());
+            return static_cast<TagIdEnum>(tagIds_[node]);
+        }
+
+        StringRef tagName(size_t node) const;
+
+        size_t parentNode(size_t node) const {
+            CSOUP_ASSERT(node < size());
+            return index(parents_[node]);
+        }
+
+        size_t firstChild(size_t node) const {
+            CSOUP_ASSERT(node < size());
+            return index(firstChildren_[node]);
+        }
+
+        size_t nextSibling(size_t node) const {
+            CSOUP_ASSERT(node < size());
+            return index(nextSiblings_[node]);
+        }
+
+        size_t childNodeSize(size_t node) const;
+
+        // One past the last node below node.
+        size_t subtreeEnd(size_t node) const;
+
+        ////////////////////////////////////////////////
+        // Methods about attributes
+
+        size_t attributeSize(size_t node) const {
+            CSOUP_ASSERT(node < size());
+            return attributeBegins_[node + 1] - attributeBegins_[node];
+        }
+
+        StringRef attributeKey(size_t node, size_t i) const {
+            return range(attributeAt(node, i)->key);
+        }
+
+        StringRef attributeValue(size_t node, size_t i) const {
+            return range(attributeAt(node, i)->value);
+        }
+
+        StringRef attr(size_t node, const StringRef& key) const {
+            return attr(node, CSOUP_ATTR_NAMESPACE_NONE, key);
+        }
+
+        StringRef attr(size_t node, AttributeNamespaceEnum space, const StringRef& key) const;
+
+        bool hasAttribute(size_t node, const StringRef& key) const {
+            return hasAttribute(node, CSOUP_ATTR_NAMESPACE_NONE, key);
+        }
+
+        bool hasAttribute(size_t node, AttributeNamespaceEnum space, const StringRef& key) const {
+            return findAttribute(node, space, key) != NULL;
+        }
+
+        ////////////////////////////////////////////////
+        // Methods about text
+
+        // The text of a text node, the comment of a comment node and the data
+        // of a data node; empty for elements.
+        StringRef text(size_t node) const {
+            return isElement(node) ? StringRef("") : range(texts_[node]);
+        }
+
+        // Appends the text of every text node below node, in document order,
+        // as Element::appendWholeText() does.
+        void appendWholeText(size_t node, StringBuffer* out) const;
+
+        ////////////////////////////////////////////////
+        // Snapshots
+
+        // Writes the document to path.
+        SnapshotStatusEnum save(const char* path) const;
+
+        // Replaces the document with the snapshot at path, which is mapped
+        // into memory and stays mapped until the document is destroyed or
+        // loads another one. The node numbers and text ranges are always
+        // checked, so that no query reads out of bounds; the checksum, which
+        // also covers the text, reads the whole file, and without it a
+        // damaged file can give wrong answers. On failure the document is
+        // left empty.
+        SnapshotStatusEnum load(const char* path, bool verifyChecksum = true);
+
+        // The bytes the document takes, which is also the size of its
+        // snapshot.
+        size_t memorySize() const {
+            return header_ ? static_cast<size_t>(header_->size) : 0;
+        }
+
+    private:
+        FrozenDocument(const FrozenDocument&);
+        FrozenDocument& operator=(const FrozenDocument&);
+
+        static const uint32_t kNone = 0xffffffffu;
+
+        // characters [offset, offset + length) of chars_
+        struct Range {
+            uint32_t offset;
+            uint32_t length;
+        };
+
+        struct FrozenAttribute {
+            Range key;
+            Range value;
+            uint32_t space;
+        };
+
+        // The start of a snapshot, 88 bytes. The arrays follow it in the
+        // order of the members below, each starting at a multiple of 8 bytes.
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t byteOrder;
+            uint64_t size;          // of the whole snapshot, the header included
+            uint64_t checksum;      // of the whole snapshot but this field
+            uint64_t tagTable;      // hash of the tag names in id order
+            uint32_t nodes;
+            uint32_t attributes;
+            uint32_t chars;
+            uint32_t quirksMode;
+            Range baseUri;
+            Range name;
+            Range publicIdentifier;
+            Range systemIdentifier;
+        };
+
+        class Builder;
+        friend class Builder;
+
+        static size_t index(uint32_t i) {
+            return i == kNone ? kNoNode : i;
+        }
+
+        StringRef range(const Range& r) const {
+            return r.length ? StringRef(chars_ + r.offset, r.length) : StringRef("");
+        }
+
+        const FrozenAttribute* attributeAt(size_t node, size_t i) const {
+            CSOUP_ASSERT(i < attributeSize(node));
+            return attributes_ + attributeBegins_[node] + i;
+        }
+
+        const FrozenAttribute* findAttribute(size_t node, AttributeNamespaceEnum space, const StringRef& key) const;
+
+        // Points the arrays into the snapshot at image.
+        void attach(const Header* image);
+        void release();
+
+        struct Layout;
+        static uint64_t checksum(const Header* image);
+        static SnapshotStatusEnum check(const Header* image, size_t size, bool verifyChecksum);
+
+        // true when every node number and text range in the snapshot is in
+        // bounds and the numbers follow document order
+        static bool isWellFormed(const Header* image);
+
+        const Header* header_;
+        const uint8_t* types_;
+        const uint16_t* tagIds_;
+        const uint32_t* parents_;
+        const uint32_t* firstChildren_;
+        const uint32_t* nextSiblings_;
+
+        // the attributes of node i are attributes_[attributeBegins_[i]] up
+        // to attributes_[attributeBegins_[i + 1]]
+        const uint32_t* attributeBegins_;
+        const FrozenAttribute* attributes_;
+
+        // the text of text, comment and data nodes, and the tag name of
+        // elements whose tag isn't known
+        const Range* texts_;
+        const CharType* chars_;
+
+        // header_ points into a mapped file, or into memory from allocator_
+        bool mapped_;
+        Allocator* allocator_;
+    };
+}
+
+#endif // CSOUP_FROZENDOCUMENT_H_
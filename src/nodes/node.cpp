@@ -22,6 +22,11 @@ namespace csoup {
         }
     }
     
+    size_t Node::siblingIndex() const {
+        if (parent_) static_cast<const Element*>(parent_)->indexChildren();
+        return siblingIndex_;
+    }
+    
     Element* Node::parentNode() {
         if (!parent_) return NULL;
         CSOUP_ASSERT(Element::isElementNode(parent_));
@@ -39,11 +44,33 @@ namespace csoup {
         parent_ = parent;
     }
     
+    void Node::setBaseUri(const StringRef& baseUri) {
+        BaseUri* handle = BaseUri::create(baseUri, allocator_)->retain();
+        replaceBaseUri(baseUri_, handle);
+        handle->release();
+    }
+    
+    void Node::replaceBaseUri(BaseUri* old, BaseUri* baseUri) {
+        if (baseUri_ != old) return;
+        
+        baseUri->retain();
+        if (baseUri_) baseUri_->release();
+        baseUri_ = baseUri;
+        
+        if (!Element::isElementNode(this)) return;
+        Element* el = static_cast<Element*>(this);
+        for (Node* child = el->firstChild(); child != NULL; child = child->nextSibling()) {
+            child->replaceBaseUri(old, baseUri);
+        }
+    }
+    
     void Node::after(csoup::Node *node) {
-        parentNode()->insertNode(siblingIndex(), node);
+        CSOUP_ASSERT(node->parentNode() == NULL);
+        parentNode()->link(node, next_);
     }
     
     void Node::before(csoup::Node *node) {
-        parentNode()->insertNode(siblingIndex() + 1, node);
+        CSOUP_ASSERT(node->parentNode() == NULL);
+        parentNode()->link(node, this);
     }
 }
\ No newline at end of file
@@ -2,25 +2,68 @@
 #define CSOUP_NODE_H_
 
 #include "../internal/nodedata.h"
+#include "../util/allocators.h"
 #include "../util/stringref.h"
+#include "../util/csoup_string.h"
 
 namespace csoup {
     class Document;
     class Element;
     
+    // A base URI shared by the nodes it applies to. The nodes the parser
+    // creates, and the children Element's insert and append methods create,
+    // take the handle of the document or of their parent, so a document
+    // holds a single copy of its URI unless Node::setBaseUri() gives a
+    // subtree another one. Handles are reference counted and freed with the
+    // last node using them, if the allocator frees at all.
+    class BaseUri {
+    public:
+        BaseUri(const StringRef& uri, Allocator* allocator) :
+            uri_(uri, allocator), refs_(0), allocator_(allocator) {
+        }
+        
+        // a new handle no node refers to yet
+        static BaseUri* create(const StringRef& uri, Allocator* allocator) {
+            return CSOUP_NEW2(allocator, BaseUri, uri, allocator);
+        }
+        
+        StringRef ref() const {
+            return uri_.ref();
+        }
+        
+        BaseUri* retain() {
+            ++ refs_;
+            return this;
+        }
+        
+        void release() {
+            if (-- refs_ == 0 && allocator_->needFree()) {
+                CSOUP_DELETE(allocator_, this);
+            }
+        }
+        
+    private:
+        BaseUri(const BaseUri&);
+        BaseUri& operator=(const BaseUri&);
+        
+        String uri_;
+        size_t refs_;
+        Allocator* allocator_;
+    };
+    
     class Node {
     public:
-        Node(NodeTypeEnum type, Node* parent, size_t siblingIndex, const StringRef& baseUri, Allocator* allocator)
-        : type_(type), parent_(parent), siblingIndex_(siblingIndex), baseUri_(NULL), allocator_(allocator) {
+        Node(NodeTypeEnum type, Node* parent, size_t siblingIndex, BaseUri* baseUri, Allocator* allocator)
+        : type_(type), parent_(parent), prev_(NULL), next_(NULL), siblingIndex_(siblingIndex), baseUri_(baseUri ? baseUri->retain() : NULL), allocator_(allocator) {
             CSOUP_ASSERT(allocator != NULL);
-            baseUri_ = CSOUP_NEW2(allocator, String, baseUri, allocator);
         }
         
         virtual ~Node() = 0;
         
-        size_t siblingIndex() const {
-            return siblingIndex_;
-        }
+        // The node's position among its parent's children. Kept up to date
+        // by appends; after an insertion or removal in the middle, the first
+        // call renumbers the parent's children.
+        size_t siblingIndex() const;
         
         NodeTypeEnum type() const {
             return type_;
@@ -36,10 +79,34 @@ namespace csoup {
             return parent_;
         }
         
+        Node* previousSibling() {
+            return prev_;
+        }
+        
+        const Node* previousSibling() const {
+            return prev_;
+        }
+        
+        Node* nextSibling() {
+            return next_;
+        }
+        
+        const Node* nextSibling() const {
+            return next_;
+        }
+        
         StringRef baseUri() const {
             return baseUri_ ? baseUri_->ref() : StringRef("");
         }
         
+        // The handle behind baseUri(), for creating nodes that share it.
+        BaseUri* sharedBaseUri() const {
+            return baseUri_;
+        }
+        
+        // Gives this node and everything below it a new base URI.
+        void setBaseUri(const StringRef& baseUri);
+        
         void before(Node* node);
         void after(Node* node);
         
@@ -49,27 +116,38 @@ namespace csoup {
         void removeFromParent(bool del);
         
     protected:
-        void setSiblingIndex(size_t index) {
-            siblingIndex_ = index;
-        }
-        
         void setParentNode(Node* parent);
         
+        // Moves this node and the nodes below it that share old over to
+        // baseUri. Nodes with a base URI of their own keep it, and so do
+        // their subtrees.
+        void replaceBaseUri(BaseUri* old, BaseUri* baseUri);
+        
+        // False when the node lives in an allocator whose free() does nothing,
+        // such as the MemoryPoolAllocator a Document uses by default. The
+        // destructors then skip releasing what the node owns: the memory goes
+        // away with the allocator, so walking the tree to free it is wasted.
+        bool releasesMemory() const {
+            return allocator_->needFree();
+        }
+        
         friend class Element;
         
         NodeTypeEnum type_;
         
         // This is a weak reference to parent node; Don't try to release this node;
         Node* parent_;
+        Node* prev_;
+        Node* next_;
         size_t siblingIndex_;
         
-        String* baseUri_;
+        BaseUri* baseUri_;
         Allocator* allocator_;
     };
     
     inline Node::~Node() {
         if (baseUri_) {
-            CSOUP_DELETE(allocator(), baseUri_);
+            baseUri_->release();
         }
     }
 }
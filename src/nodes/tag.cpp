@@ -1,13 +1,57 @@
-#include <map>
-#include <string>
+#include <cstring>
 #include "tag.h"
 #include "../util/stringref.h"
+#include "../util/allocators.h"
 
 namespace {
     using namespace csoup;
     
-    typedef std::map<std::string, Tag*> TagMap;
-    TagMap globalTags_;
+    const StringRef tagNames[] = {
+#define CSOUP_TAG_NAME(name, NAME) #name,
+        CSOUP_TAGS(CSOUP_TAG_NAME)
+#undef CSOUP_TAG_NAME
+    };
+    
+    // Perfect hash of the tag names ("hash and displace"): a name goes to
+    // bucket fnv(name, 0) % 64, and then to slot fnv(name, d) % 256, where d is
+    // the bucket's displacement. No two known names share a slot, which holds
+    // the tag id + 1, or 0 for none. The tables were generated offline; the
+    // tag test checks every name against them.
+    const unsigned char tagHashDisplacements[64] = {
+        0, 1, 1, 1, 1, 1, 1, 1, 2, 3, 1, 3, 3, 1, 3, 1,
+        1, 1, 1, 1, 5, 2, 1, 1, 6, 1, 0, 1, 2, 0, 3, 1,
+        1, 1, 1, 0, 3, 2, 3, 1, 0, 3, 2, 2, 6, 4, 0, 5,
+        0, 1, 1, 3, 1, 1, 2, 2, 0, 1, 1, 3, 1, 4, 3, 3
+    };
+    
+    const unsigned char tagHashSlots[256] = {
+          0,   0,   0,   0,  99,   0,   1,   0,  49,  90,   0,  65,   0,   0,   0,   0,
+         91,  43,   0,   0,   0, 100,  25,  34, 115,   0, 114,  41,   0,   0,  79, 123,
+         19,   0,   0,   0,   8,   0,  50,   0,   0,   0,   0, 109,   0,  80, 108,   0,
+          0,  58, 122,   0, 119,   0, 106,   0,   0,   0, 113,   0,  60,   0,  64,   0,
+          0,  55,  76, 130,  97,  16, 125,  93,  57,  30,   0,   0, 112,   0,   0,   0,
+          0,   0,  35,   0,  53,   0,   0,  59, 118, 104,   0, 126,  66,   0,   0,   0,
+         18,   0,   0,  52,  36,   0,   0,   0,   0,   0,   0,   0, 127,   0,  75,  95,
+        124,  38,  42,  86,  28,   2,  26,   0,  32, 132,   0,  77,  87,  74,   0,  44,
+          0,  81,  96,   0,  85,  82,  72,   0,   0,  67,   0,  61,  71,   0,   7,   0,
+        133,  24,   0,   0,   0,   0,   0,  13,   3,  89,   0,   0, 117,  56, 131,   0,
+        102,   0,   0, 128,   0, 105,   0,   0,   5, 103,   0,   0,   0,  22,  11,  48,
+          0,   0,   0,   0,   0,   0,  54,   0,   0,   0,  62,   0, 107,   0,  70,  10,
+          0,   0,   0,  69,  83,  23,   0,   0,   0, 110,  33, 111,  29,  27,   0,  31,
+         51,   0,   0,   0, 120,   6,   0,  21,  63,  40,   0,   0,  78, 129,   9,   0,
+         17,  88,  45,   0,   4,  92,   0,   0, 121, 101,  73,  39,   0,  47,  84,  94,
+         20,   0,  15,   0,   0,   0,  14,  46,  98, 116,   0,  12,  37,   0,   0,  68
+    };
+    
+    inline unsigned int fnv(const StringRef& str, unsigned int seed) {
+        unsigned int h = 2166136261u ^ seed;
+        for (size_t i = 0; i < str.size(); ++ i) {
+            h ^= static_cast<unsigned char>(str.data()[i]);
+            h *= 16777619u;
+        }
+        
+        return h;
+    }
     
     // internal static initialisers:
     // prepped from http://www.w3.org/TR/REC-html40/sgml/dtd.html and other sources
@@ -16,7 +60,7 @@ namespace {
         "noframes", "section", "nav", "aside", "hgroup", "header", "footer", "p", "h1", "h2", "h3", "h4", "h5", "h6",
         "ul", "ol", "pre", "div", "blockquote", "hr", "address", "figure", "figcaption", "form", "fieldset", "ins",
         "del", "s", "dl", "dt", "dd", "li", "table", "caption", "thead", "tfoot", "tbody", "colgroup", "col", "tr", "th",
-        "td", "video", "audio", "canvas", "details", "menu", "plaintext"
+        "td", "video", "audio", "canvas", "details", "menu", "plaintext", "article", "main"
     };
     StringRef inlineTags[] = {
         "object", "base", "font", "tt", "i", "b", "u", "big", "small", "em", "strong", "dfn", "code", "samp", "kbd",
@@ -37,6 +81,11 @@ namespace {
         "pre", "plaintext", "title", "textarea"
         // script is not here as it is a data node, which always preserve whitespace
     };
+    // tags the tree builder refers to that get the defaults of an unknown tag
+    StringRef otherTags[] = {
+        "applet", "center", "dir", "isindex", "listing", "marquee", "math", "nobr", "noembed", "strike", "svg",
+        "template", "xmp"
+    };
     // todo: I think we just need submit tags, and can scrub listed
     StringRef formListedTags[] = {
         "button", "fieldset", "input", "keygen", "object", "output", "select", "textarea"
@@ -47,28 +96,65 @@ namespace {
 }
 
 namespace csoup {
-    void Tag::GlobalTagMap::registerTag(const csoup::StringRef &tagName, Tag* tag) {
-        std::string strTagName(tagName.data(), tagName.size());
-        if (globalTags_.count(strTagName)) {
-            delete globalTags_[strTagName];
+    TagIdEnum Tag::idOf(const StringRef& tagName) {
+        const unsigned int bucket = fnv(tagName, 0) % arrayLength(tagHashDisplacements);
+        const unsigned int slot = fnv(tagName, tagHashDisplacements[bucket]) % arrayLength(tagHashSlots);
+        const unsigned int id = tagHashSlots[slot];
+        
+        if (id == 0 || !internal::strEquals(tagNames[id - 1], tagName)) {
+            return CSOUP_TAG_UNKNOWN;
         }
         
-        globalTags_[strTagName] = tag;
+        return static_cast<TagIdEnum>(id - 1);
     }
     
-    Tag::GlobalTagMap::GlobalTagMap() {
+    Tag* Tag::newUnknown(const StringRef& tagName, Allocator* allocator) {
+        // the name is stored right behind the tag
+        void* memory = allocator->malloc(sizeof(Tag) + tagName.size());
+        CharType* name = reinterpret_cast<CharType*>(memory) + sizeof(Tag);
+        std::memcpy(name, tagName.data(), tagName.size());
+        
+        Tag* tag = new (memory) Tag(StringRef(name, tagName.size()), CSOUP_TAG_UNKNOWN);
+        tag->isBlock_ = false;
+        tag->canContainBlock_ = true;
+        
+        return tag;
+    }
+    
+    void Tag::deleteUnknown(Tag* tag, Allocator* allocator) {
+        CSOUP_ASSERT(tag->id_ == CSOUP_TAG_UNKNOWN);
+        tag->~Tag();
+        allocator->free(tag);
+    }
+    
+    void Tag::GlobalTagTable::registerTag(Tag* tag) {
+        CSOUP_ASSERT(tag->id_ != CSOUP_TAG_UNKNOWN);
+        delete tags_[tag->id_];
+        tags_[tag->id_] = tag;
+    }
+    
+    Tag::GlobalTagTable::GlobalTagTable() {
+        std::memset(tags_, 0, sizeof(tags_));
+        
         for (size_t i = 0; i < arrayLength(blockTags); ++ i) {
-            Tag* tag = new Tag(blockTags[i]);
-            registerTag(blockTags[i], tag);
+            Tag* tag = new Tag(blockTags[i], idOf(blockTags[i]));
+            registerTag(tag);
         }
         
         for (size_t i = 0; i < arrayLength(inlineTags); ++ i) {
-            Tag* tag = new Tag(inlineTags[i]);
+            Tag* tag = new Tag(inlineTags[i], idOf(inlineTags[i]));
             tag->isBlock_ = false;
             tag->canContainBlock_ = false;
             tag->formatAsBlock_ = false;
             
-            registerTag(inlineTags[i], tag);
+            registerTag(tag);
+        }
+        
+        for (size_t i = 0; i < arrayLength(otherTags); ++ i) {
+            Tag* tag = new Tag(otherTags[i], idOf(otherTags[i]));
+            tag->isBlock_ = false;
+            
+            registerTag(tag);
         }
         
         for (size_t i = 0; i < arrayLength(emptyTags); ++ i) {
@@ -103,25 +189,27 @@ namespace csoup {
             CSOUP_ASSERT(tag != NULL);
             tag->formSubmit_ = true;
         }
+        
+#ifndef NDEBUG
+        for (size_t i = 0; i < arrayLength(tags_); ++ i) {
+            CSOUP_ASSERT(tags_[i] != NULL);
+        }
+#endif
     }
     
-    Tag::GlobalTagMap::~GlobalTagMap() {
-        for (TagMap::iterator it = globalTags_.begin(); it != globalTags_.end(); ++ it) {
-            delete it->second;
+    Tag::GlobalTagTable::~GlobalTagTable() {
+        for (size_t i = 0; i < arrayLength(tags_); ++ i) {
+            delete tags_[i];
         }
     }
     
-    Tag* Tag::GlobalTagMap::query(const csoup::StringRef &tagName) {
-        std::string strTagName(tagName.data(), tagName.size());
-        if (globalTags_.count(strTagName)) {
-            return globalTags_[strTagName];
-        } else {
-            return NULL;
-        }
+    Tag* Tag::GlobalTagTable::query(const csoup::StringRef &tagName) {
+        TagIdEnum id = idOf(tagName);
+        return id == CSOUP_TAG_UNKNOWN ? NULL : tags_[id];
     }
     
-    Tag::Tag(const StringRef& tagName) :
-    tagName_(tagName), isBlock_(true), formatAsBlock_(true), canContainBlock_(true), canContainInline_(true),
+    Tag::Tag(const StringRef& tagName, TagIdEnum id) :
+    tagName_(tagName), id_(id), isBlock_(true), formatAsBlock_(true), canContainBlock_(true), canContainInline_(true),
     empty_(false), selfClosing_(false), preserveWhitespace_(false), formList_(false), formSubmit_(false)
     {
     }
@@ -6,6 +6,152 @@
 
 namespace csoup {
     class StringRef;
+    class Allocator;
+    
+// X(name, NAME) for every tag with a TagIdEnum, in alphabetical order
+#define CSOUP_TAGS(X) \
+    X(a,          A) \
+    X(abbr,       ABBR) \
+    X(acronym,    ACRONYM) \
+    X(address,    ADDRESS) \
+    X(applet,     APPLET) \
+    X(area,       AREA) \
+    X(article,    ARTICLE) \
+    X(aside,      ASIDE) \
+    X(audio,      AUDIO) \
+    X(b,          B) \
+    X(base,       BASE) \
+    X(basefont,   BASEFONT) \
+    X(bdo,        BDO) \
+    X(bgsound,    BGSOUND) \
+    X(big,        BIG) \
+    X(blockquote, BLOCKQUOTE) \
+    X(body,       BODY) \
+    X(br,         BR) \
+    X(button,     BUTTON) \
+    X(canvas,     CANVAS) \
+    X(caption,    CAPTION) \
+    X(center,     CENTER) \
+    X(cite,       CITE) \
+    X(code,       CODE) \
+    X(col,        COL) \
+    X(colgroup,   COLGROUP) \
+    X(command,    COMMAND) \
+    X(datalist,   DATALIST) \
+    X(dd,         DD) \
+    X(del,        DEL) \
+    X(details,    DETAILS) \
+    X(device,     DEVICE) \
+    X(dfn,        DFN) \
+    X(dir,        DIR) \
+    X(div,        DIV) \
+    X(dl,         DL) \
+    X(dt,         DT) \
+    X(em,         EM) \
+    X(embed,      EMBED) \
+    X(fieldset,   FIELDSET) \
+    X(figcaption, FIGCAPTION) \
+    X(figure,     FIGURE) \
+    X(font,       FONT) \
+    X(footer,     FOOTER) \
+    X(form,       FORM) \
+    X(frame,      FRAME) \
+    X(frameset,   FRAMESET) \
+    X(h1,         H1) \
+    X(h2,         H2) \
+    X(h3,         H3) \
+    X(h4,         H4) \
+    X(h5,         H5) \
+    X(h6,         H6) \
+    X(head,       HEAD) \
+    X(header,     HEADER) \
+    X(hgroup,     HGROUP) \
+    X(hr,         HR) \
+    X(html,       HTML) \
+    X(i,          I) \
+    X(iframe,     IFRAME) \
+    X(img,        IMG) \
+    X(input,      INPUT) \
+    X(ins,        INS) \
+    X(isindex,    ISINDEX) \
+    X(kbd,        KBD) \
+    X(keygen,     KEYGEN) \
+    X(label,      LABEL) \
+    X(legend,     LEGEND) \
+    X(li,         LI) \
+    X(link,       LINK) \
+    X(listing,    LISTING) \
+    X(main,       MAIN) \
+    X(map,        MAP) \
+    X(mark,       MARK) \
+    X(marquee,    MARQUEE) \
+    X(math,       MATH) \
+    X(menu,       MENU) \
+    X(menuitem,   MENUITEM) \
+    X(meta,       META) \
+    X(meter,      METER) \
+    X(nav,        NAV) \
+    X(nobr,       NOBR) \
+    X(noembed,    NOEMBED) \
+    X(noframes,   NOFRAMES) \
+    X(noscript,   NOSCRIPT) \
+    X(object,     OBJECT) \
+    X(ol,         OL) \
+    X(optgroup,   OPTGROUP) \
+    X(option,     OPTION) \
+    X(output,     OUTPUT) \
+    X(p,          P) \
+    X(param,      PARAM) \
+    X(plaintext,  PLAINTEXT) \
+    X(pre,        PRE) \
+    X(progress,   PROGRESS) \
+    X(q,          Q) \
+    X(rp,         RP) \
+    X(rt,         RT) \
+    X(ruby,       RUBY) \
+    X(s,          S) \
+    X(samp,       SAMP) \
+    X(script,     SCRIPT) \
+    X(section,    SECTION) \
+    X(select,     SELECT) \
+    X(small,      SMALL) \
+    X(source,     SOURCE) \
+    X(span,       SPAN) \
+    X(strike,     STRIKE) \
+    X(strong,     STRONG) \
+    X(style,      STYLE) \
+    X(sub,        SUB) \
+    X(summary,    SUMMARY) \
+    X(sup,        SUP) \
+    X(svg,        SVG) \
+    X(table,      TABLE) \
+    X(tbody,      TBODY) \
+    X(td,         TD) \
+    X(template,   TEMPLATE) \
+    X(textarea,   TEXTAREA) \
+    X(tfoot,      TFOOT) \
+    X(th,         TH) \
+    X(thead,      THEAD) \
+    X(time,       TIME) \
+    X(title,      TITLE) \
+    X(tr,         TR) \
+    X(track,      TRACK) \
+    X(tt,         TT) \
+    X(u,          U) \
+    X(ul,         UL) \
+    X(var,        VAR) \
+    X(video,      VIDEO) \
+    X(wbr,        WBR) \
+    X(xmp,        XMP)
+    
+    // Dense ids of the tags csoup knows. Any other tag name is
+    // CSOUP_TAG_UNKNOWN, which is also the number of known tags.
+    enum TagIdEnum {
+#define CSOUP_TAG_ENUM(name, NAME) CSOUP_TAG_##NAME,
+        CSOUP_TAGS(CSOUP_TAG_ENUM)
+#undef CSOUP_TAG_ENUM
+        CSOUP_TAG_UNKNOWN
+    };
     
     class Tag {
     public:
@@ -13,12 +159,31 @@ namespace csoup {
             return tagName_;
         }
         
-        static Tag* valueOf(const StringRef& tagName) {
-            static Tag::GlobalTagMap globalTagMap;
+        TagIdEnum id() const {
+            return id_;
+        }
+        
+        // Looks the (lowercase) name up in a perfect hash table, so it costs
+        // one hash and one compare.
+        static TagIdEnum idOf(const StringRef& tagName);
+        
+        // NULL for CSOUP_TAG_UNKNOWN
+        static Tag* valueOf(TagIdEnum id) {
+            static Tag::GlobalTagTable globalTagTable;
             
-            return globalTagMap.query(tagName);
+            return id == CSOUP_TAG_UNKNOWN ? NULL : globalTagTable.tags_[id];
+        }
+        
+        // NULL if the tag is not known
+        static Tag* valueOf(const StringRef& tagName) {
+            return valueOf(idOf(tagName));
         }
         
+        // Creates a tag for a name that is not known, with a copy of the name,
+        // the way jsoup makes up a tag for it. Free it with deleteUnknown().
+        static Tag* newUnknown(const StringRef& tagName, Allocator* allocator);
+        static void deleteUnknown(Tag* tag, Allocator* allocator);
+        
         bool block() const {
             return isBlock_;
         }
@@ -48,11 +213,11 @@ namespace csoup {
         }
         
         bool isKnownTag() const {
-            return valueOf(tagName()) != NULL;
+            return id_ != CSOUP_TAG_UNKNOWN;
         }
         
         static bool isKnownTag(const StringRef& tagName) {
-            return valueOf(tagName) != NULL;
+            return idOf(tagName) != CSOUP_TAG_UNKNOWN;
         }
         
         bool preserveWhitespace() const {
@@ -74,18 +239,21 @@ namespace csoup {
         bool operator == (const Tag& obj) const;
         
     private:
-        Tag(const StringRef& tagName);
+        Tag(const StringRef& tagName, TagIdEnum id);
         
-        struct GlobalTagMap {
-            GlobalTagMap();
-            ~GlobalTagMap();
+        struct GlobalTagTable {
+            GlobalTagTable();
+            ~GlobalTagTable();
             
             Tag* query(const StringRef& tagName);
+            
+            Tag* tags_[CSOUP_TAG_UNKNOWN];
         private:
-            void registerTag(const StringRef& tagName, Tag* tag);
+            void registerTag(Tag* tag);
         };
         
         StringRef tagName_;
+        TagIdEnum id_;
         
         // Use a bit to optimize this;
         bool isBlock_; // block or inline
@@ -0,0 +1,59 @@
+//
+//  tagset.h
+//  csoup
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#ifndef CSOUP_TAGSET_H_
+#define CSOUP_TAGSET_H_
+
+#include "../util/common.h"
+#include "tag.h"
+
+namespace csoup {
+    // A set of known tags, one bit per TagIdEnum. The groups the tree builder
+    // tests names against are built at compile time with makeTagSet(), so a
+    // membership test is a shift and a mask instead of a run of string
+    // compares. CSOUP_TAG_UNKNOWN has a bit too, which is never set.
+    class TagSet {
+    public:
+        constexpr TagSet() : words_{0, 0, 0} {}
+
+        constexpr bool contains(TagIdEnum id) const {
+            return ((words_[id / 64] >> (id % 64)) & 1) != 0;
+        }
+
+        // a copy of this set with id added
+        constexpr TagSet with(TagIdEnum id) const {
+            return TagSet(words_[0] | bit(id, 0), words_[1] | bit(id, 1), words_[2] | bit(id, 2));
+        }
+
+        constexpr TagSet operator | (const TagSet& other) const {
+            return TagSet(words_[0] | other.words_[0], words_[1] | other.words_[1], words_[2] | other.words_[2]);
+        }
+
+    private:
+        constexpr TagSet(uint64_t w0, uint64_t w1, uint64_t w2) : words_{w0, w1, w2} {}
+
+        static constexpr uint64_t bit(TagIdEnum id, size_t word) {
+            return static_cast<size_t>(id) / 64 == word ? static_cast<uint64_t>(1) << (id % 64) : 0;
+        }
+
+        uint64_t words_[3];
+    };
+
+    CSOUP_STATIC_ASSERT(CSOUP_TAG_UNKNOWN < 3 * 64);
+
+    inline constexpr TagSet makeTagSet() {
+        return TagSet();
+    }
+
+    template <typename... Ids>
+    inline constexpr TagSet makeTagSet(TagIdEnum id, Ids... ids) {
+        return makeTagSet(ids...).with(id);
+    }
+}
+
+#endif // CSOUP_TAGSET_H_
@@ -7,17 +7,18 @@
 namespace csoup {
     class TextNode : public Node {
     public:
-        TextNode(const StringRef& text, const StringRef& baseUri, Allocator* allocator) :
-            Node(CSOUP_NODE_TEXT, NULL, 0, baseUri, allocator) {
+        TextNode(const StringRef& text, BaseUri* baseUri, Allocator* allocator) :
+            Node(CSOUP_NODE_TEXT, NULL, 0, baseUri, allocator), text_(NULL), data_(""), length_(0) {
             setWholeText(text);
         }
         
+        TextNode(BaseUri* baseUri, Allocator* allocator) :
+            Node(CSOUP_NODE_TEXT, NULL, 0, baseUri, allocator), text_(NULL), data_(""), length_(0) {
+        }
+        
         ~TextNode() {
-            if (text_) {
-                text_->~String();
-                allocator()->free(text_);
-                text_ = NULL;
-            }
+            if (!releasesMemory()) return;
+            destroy(&text_, allocator());
         }
         
         void setWholeText(const StringRef& data) {
@@ -28,12 +29,27 @@ namespace csoup {
             }
             
             new (text_) String(data, allocator());
+            data_ = text_->data();
+            length_ = text_->size();
+        }
+        
+        // Uses data as the text without copying it. data has to stay alive as
+        // long as the node does; the parser passes slices of the document's
+        // source (see Document::source()).
+        void shareWholeText(const StringRef& data) {
+            destroy(&text_, allocator());
+            data_ = data.data();
+            length_ = data.size();
+        }
+        
+        bool sharesText() const {
+            return text_ == NULL && length_ > 0;
         }
         
         // you should return normaliseWhitespace text
         // Normalise the whitespace within this string; multiple spaces collapse to a single, and all whitespace characters
-        StringRef wholeText() {
-            return text_ ? text_->ref() : StringRef("");
+        StringRef wholeText() const {
+            return StringRef(data_, length_);
         }
         
         // Create a new DataNode from HTML encoded data.
@@ -46,7 +62,9 @@ namespace csoup {
         // isBlank Test if this text node is blank -- that is, empty or only whitespace (including newlines).
         // splitText
     private:
-        String* text_;
+        String* text_; // NULL when the text is shared
+        const CharType* data_;
+        size_t length_;
     };
     
     //CSOUP_STATIC_ASSERT(sizeof(TextNode) == sizeof(Node));
@@ -6,10 +6,9 @@
 //  Copyright (c) 2014 windpls. All rights reserved.
 //
 
-#include <iostream>
-
 #include "characterreader.h"
 #include "stringbuffer.h"
+#include "../internal/scan.h"
 
 namespace {
     const int kUtf8ReplacementChar = 0xFFFD;
@@ -60,7 +59,7 @@ namespace csoup {
     // we uuse
     CSOUP_STATIC_ASSERT(sizeof(CharType) == sizeof(char));
     
-    void CharacterReader::readChar() {
+    void CharacterReader::decodeChar() {
         if (cur_ >= end_) {
             // No input left to consume; emit an EOF and set width = 0.
             current_ = -1;
@@ -68,33 +67,54 @@ namespace csoup {
             return;
         }
         
+        const unsigned char lead = static_cast<unsigned char>(*cur_);
+        if (internal::isPlainAscii(lead)) {
+            // Validate the run of plain ascii ahead in one go, readChar() then
+            // serves it without coming back here.
+            const CharType* limit = static_cast<size_t>(end_ - cur_) > kAsciiWindow ? cur_ + kAsciiWindow : end_;
+            asciiBegin_ = cur_;
+            asciiEnd_ = internal::skipPlainAscii(cur_ + 1, limit);
+            current_ = lead;
+            width_ = 1;
+            return;
+        }
+        
+        if (lead < 0x80) {
+            int c = lead;
+            width_ = 1;
+            // This is the special handling for carriage returns that is mandated by the
+            // HTML5 spec.  Since we're looking for particular 7-bit literal characters,
+            // we operate in terms of chars and only need a check for iter overrun,
+            // instead of having to read in a full next code point.
+            // http://www.whatwg.org/specs/web-apps/current-work/multipage/parsing.html#preprocessing-the-input-stream
+            if (c == '\r') {
+                const char* next = cur_ + 1;
+                if (next < end_ && *next == '\n') {
+                    // Advance the iter, as if the carriage return didn't exist.
+                    ++cur_;
+                    // Preserve the true offset, since other tools that look at it may be
+                    // unaware of HTML5's rules for converting \r into \n.
+                    //++iter->_pos.offset;
+                }
+                c = '\n';
+            }
+            if (isInvalidUTF8CodePoint(c)) {
+                //add_error(iter, GUMBO_ERR_UTF8_INVALID);
+                c = kUtf8ReplacementChar;
+            }
+            current_ = c;
+            return;
+        }
+        
         uint32_t code_point = 0;
         uint32_t state = UTF8_ACCEPT;
         for (const CharType* c = cur_; c < end_; ++ c) {
             decode(&state, &code_point, (uint32_t) (unsigned char) (*c));
             if (state == UTF8_ACCEPT) {
                 width_ = c - cur_ + 1;
-                // This is the special handling for carriage returns that is mandated by the
-                // HTML5 spec.  Since we're looking for particular 7-bit literal characters,
-                // we operate in terms of chars and only need a check for iter overrun,
-                // instead of having to read in a full next code point.
-                // http://www.whatwg.org/specs/web-apps/current-work/multipage/parsing.html#preprocessing-the-input-stream
-                if (code_point == '\r') {
-                    CSOUP_ASSERT(width_ == 1);
-                    const char* next = c + 1;
-                    if (next < end_ && *next == '\n') {
-                        // Advance the iter, as if the carriage return didn't exist.
-                        ++cur_;
-                        // Preserve the true offset, since other tools that look at it may be
-                        // unaware of HTML5's rules for converting \r into \n.
-                        //++iter->_pos.offset;
-                    }
-                    code_point = '\n';
-                }
                 if (isInvalidUTF8CodePoint(code_point)) {
                     //add_error(iter, GUMBO_ERR_UTF8_INVALID);
                     //CSOUP_ASSERT()
-                    std::cout << "UTF8 decoding error" << std::endl;
                     code_point = kUtf8ReplacementChar;
                 }
                 current_ = code_point;
@@ -104,7 +124,6 @@ namespace csoup {
                 // run, but we do want to skip past an invalid first byte.
                 width_ = c - cur_ + (c == cur_);
                 current_ = kUtf8ReplacementChar;
-                std::cout << "UTF8 decoding error" << std::endl;
                 //add_error(iter, GUMBO_ERR_UTF8_INVALID);
                 return;
             }
@@ -114,64 +133,129 @@ namespace csoup {
         // iterator, and emit a replacement character.  The next time we enter this method,
         // it will detect that there's no input to consume and
         current_ = kUtf8ReplacementChar;
-        width_ = end_ - start_;
-        std::cout << "UTF8 decoding error: TRUNCATED" << std::endl;
+        width_ = end_ - cur_;
         //add_error(iter, GUMBO_ERR_UTF8_TRUNCATED);
     }
     
-    void CharacterReader::consumeTo(const csoup::StringRef &term, csoup::StringBuffer *output) {
-        size_t offset = nextIndexOf(term);
-        if (start_ + offset < end_) {
-            StringRef data(cur_, offset - pos());
-            output->appendString(data);
-            cur_ = start_ + offset;
+    void CharacterReader::consumeRun(const CharType* stop, StringBuffer* output) {
+        CSOUP_ASSERT(cur_ <= stop && stop <= end_);
+        
+        // prev_ follows the last character of the run, so unconsume() steps
+        // back over that one only
+        while (cur_ < stop) {
+            // plain ascii is appended as it is, a run at a time
+            const CharType* plain = internal::skipPlainAscii(cur_, stop);
+            if (plain != cur_) {
+                output->appendString(cur_, plain - cur_);
+                prev_ = plain - 1;
+                cur_ = plain;
+                continue;
+            }
             
-            readChar();
-        } else {
-            consumeToEnd(output);
+            // everything else goes through the decoder so that \r and invalid
+            // input come out the same as with next()
+            decodeChar();
+            output->append(current_);
+            prev_ = cur_;
+            cur_ += width_;
         }
+        
+        readChar();
     }
     
-    void CharacterReader::consumeToEnd(csoup::StringBuffer *output) {
-        while (!empty()) {
-            output->append(next());
-        }
+    void CharacterReader::consumeTo(const csoup::StringRef &term, csoup::StringBuffer *output) {
+        consumeRun(start_ + nextIndexOf(term), output);
     }
     
-    // need to be re-implemented
-    size_t CharacterReader::nextIndexOf(int c) {
-        CSOUP_ASSERT(c <= 127 && c >= 0);
+    const CharType* CharacterReader::findAnyOf(const CharType* terms, size_t n) const {
+        CSOUP_ASSERT(n > 0 && n < kMaxTerms);
         
-        const CharType* p = cur_;
-        
-        while (p < end_ && *p != c) {
-            p ++;
+        // \r reads as \n, so a \n term has to stop on \r as well, and a \r
+        // term never matches
+        CharType scanTerms[kMaxTerms];
+        size_t scanCount = 0;
+        bool newline = false;
+        for (size_t i = 0; i < n; ++ i) {
+            if (terms[i] == '\r') continue;
+            if (terms[i] == '\n') newline = true;
+            scanTerms[scanCount ++] = terms[i];
         }
+        if (newline) scanTerms[scanCount ++] = '\r';
         
-        return p - start_;
+        return scanCount == 0 ? end_ : internal::scanAnyOf(cur_, end_, scanTerms, scanCount);
     }
     
-    size_t CharacterReader::nextIndexOf(const csoup::StringRef &seq) {
-        CSOUP_ASSERT(seq.size() > 0);
+    size_t CharacterReader::consumeToAny(const CharType* terms, size_t n, StringBuffer* output) {
+        const CharType* begin = cur_;
+        const CharType* stop = findAnyOf(terms, n);
+        if (stop == begin) return 0;
         
-        if (seq.size() == 1) {
-            return nextIndexOf(seq.at(0));
-        }
+        consumeRun(stop, output);
+        return cur_ - begin;
+    }
+    
+    bool CharacterReader::consumeSliceToAny(const CharType* terms, size_t n, const CharType** slice, size_t* length) {
+        const CharType* begin = cur_;
+        const CharType* stop = findAnyOf(terms, n);
         
-        int startCode = seq.at(0);
-        for (const CharType* p = cur_; p < end_; ++ p) {
-            if (startCode != *p) {
-                while (p < end_ && startCode != *p) ++ p;
+        // Plain ascii and well formed utf-8 read back as the bytes they came
+        // from. \r and anything the decoder replaces do not.
+        while (cur_ < stop) {
+            const CharType* plain = internal::skipPlainAscii(cur_, stop);
+            if (plain != cur_) {
+                prev_ = plain - 1;
+                cur_ = plain;
+                continue;
             }
             
-            const CharType* p2 = p + 1;
-            const CharType* last = (p2 + seq.size()) - 1;
-            if (p2 < end_ && last <= end_) {
-                for (size_t i = 1; p2 < last && *p2 == seq.at(i); ++ p2, ++ i);
-                if (p2 == end_) return p - start_;
-            }
+            if (static_cast<unsigned char>(*cur_) < 0x80) break;
+            
+            decodeChar();
+            if (current_ == kUtf8ReplacementChar) break;
+            prev_ = cur_;
+            cur_ += width_;
         }
         
-        return end_ - start_;
+        *slice = begin;
+        *length = cur_ - begin;
+        readChar();
+        
+        return cur_ == stop;
+    }
+    
+    void CharacterReader::consumeToEnd(csoup::StringBuffer *output) {
+        consumeRun(end_, output);
+    }
+    
+    size_t CharacterReader::consumeLetters(StringBuffer* output) {
+        const CharType* p = cur_;
+        while (p < end_ && ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z'))) ++ p;
+        if (p == cur_) return 0;
+        
+        size_t read = p - cur_;
+        output->appendString(cur_, read);
+        prev_ = p - 1;
+        cur_ = p;
+        readChar();
+        
+        return read;
+    }
+    
+    size_t CharacterReader::nextIndexOf(int c) {
+        CSOUP_ASSERT(c <= 127 && c >= 0);
+        
+        return internal::scanByte(cur_, end_, static_cast<CharType>(c)) - start_;
     }
-}
\ No newline at end of file
+    
+    size_t CharacterReader::nextIndexOf(const csoup::StringRef &seq) {
+        CSOUP_ASSERT(seq.size() > 0);
+        
+        return internal::scanSequence(cur_, end_, seq.data(), seq.size()) - start_;
+    }
+    
+    size_t CharacterReader::nextIndexOfAny(const CharType* terms, size_t n) {
+        CSOUP_ASSERT(n > 0);
+        
+        return internal::scanAnyOf(cur_, end_, terms, n) - start_;
+    }
+}
@@ -20,12 +20,16 @@ namespace csoup {
     public:
         CharacterReader(const StringRef& input): start_(input.data()),
                                                  cur_(input.data()),
+                                                 prev_(input.data()),
                                                  mark_(input.data()),
                                                  end_(input.data() + input.size()),
+                                                 asciiBegin_(input.data()),
+                                                 asciiEnd_(input.data()),
                                                  current_(0),
                                                  width_(0)
         {
             CSOUP_ASSERT(start_ != NULL);
+            readChar();
         }
         
         size_t pos() const {
@@ -36,19 +40,21 @@ namespace csoup {
             return start_ >= end_;
         }
         
+        // steps back over the character consumed last
         void unconsume() {
-            CSOUP_ASSERT(width_ > 0);
-            cur_ -= width_;
-            width_ = 0;
+            CSOUP_ASSERT(prev_ <= cur_);
+            moveBackTo(prev_);
         }
         
         void advance() {
+            prev_ = cur_;
             cur_ += width_;
             readChar();
         }
         
         int next() {
             int ret = current_;
+            prev_ = cur_;
             cur_ += width_;
             readChar();
             
@@ -64,11 +70,12 @@ namespace csoup {
         }
         
         void rewindToMark() {
-            cur_ = mark_;
+            moveBackTo(mark_);
         }
         
         StringRef consumeAsStringRef() {
             StringRef ret(cur_, width_);
+            prev_ = cur_;
             cur_ += width_;
             readChar();
             return ret;
@@ -131,7 +138,7 @@ namespace csoup {
             int c = peek();
             
             for (size_t i = 0; i < cnt; ++ i) {
-                if (c == seq[cnt]) {
+                if (c == seq[i]) {
                     return true;
                 }
             }
@@ -204,18 +211,69 @@ namespace csoup {
         // the index is start_ based
         size_t nextIndexOf(int c);
         size_t nextIndexOf(const StringRef& seq);
+        size_t nextIndexOfAny(const CharType* terms, size_t n);
+        
+        // Appends everything before the first of the ASCII terms to output and
+        // stops on it. Returns the number of bytes consumed.
+        size_t consumeToAny(const CharType* terms, size_t n, StringBuffer* output);
+        
+        // Like consumeToAny, but hands back the consumed input as is instead of
+        // copying it. Stops early, and returns false, on the first character
+        // that reads differently from its bytes (\r, invalid utf-8, control
+        // characters) so the caller can take the rest through consumeToAny.
+        bool consumeSliceToAny(const CharType* terms, size_t n, const CharType** slice, size_t* length);
         
         void consumeToEnd(StringBuffer* output);
+        
+        // appends the run of ascii letters at the current position to output
+        size_t consumeLetters(StringBuffer* output);
   
         //static const int EOF = -1;
         static const int eof_ = -1;
     private:
-        void readChar();
+        // Bytes in [asciiBegin_, asciiEnd_) are known to be plain ascii (see
+        // internal::isPlainAscii), which decode to themselves, so most calls
+        // are a load and an increment. Everything else goes to decodeChar().
+        void readChar() {
+            if (cur_ < asciiEnd_) {
+                current_ = *cur_;
+                width_ = 1;
+                return;
+            }
+            
+            decodeChar();
+        }
+        
+        void decodeChar();
+        
+        // readChar() relies on cur_ never being below asciiBegin_
+        void moveBackTo(const CharType* pos) {
+            cur_ = pos;
+            if (pos < asciiBegin_) {
+                asciiBegin_ = asciiEnd_ = pos;
+            }
+            readChar();
+        }
+        
+        // the first of the ascii terms ahead, or end_
+        const CharType* findAnyOf(const CharType* terms, size_t n) const;
+        
+        // Consumes everything up to stop, which must be on a character boundary,
+        // and appends it to output. Plain ascii is copied in bulk.
+        void consumeRun(const CharType* stop, StringBuffer* output);
+        
+        static const size_t kMaxTerms = 16;
         
         const CharType* start_;
         const CharType* cur_;
+        const CharType* prev_;
         const CharType* mark_;
         const CharType* end_;
+        const CharType* asciiBegin_;
+        const CharType* asciiEnd_;
+        
+        // how far decodeChar() validates ahead at once
+        static const size_t kAsciiWindow = 4096;
         
         int current_;
         size_t width_;
@@ -0,0 +1,161 @@
+//
+//  elementstack.h
+//  csoup
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#ifndef CSOUP_ELEMENTSTACK_H_
+#define CSOUP_ELEMENTSTACK_H_
+
+#include <cstring>
+#include "../util/common.h"
+#include "../internal/vector.h"
+#include "../nodes/element.h"
+#include "../nodes/tag.h"
+#include "../nodes/tagset.h"
+
+namespace csoup {
+    // The stack of open elements. Next to the elements it keeps their tag ids
+    // in a parallel array, so the scope checks walk a dense array of ints
+    // without touching the elements, and a count of open elements per tag id,
+    // so "is there a p open at all" costs nothing.
+    //
+    // Elements can only be changed through the stack's methods, which keep
+    // the three in step.
+    class ElementStack {
+    public:
+        ElementStack(Allocator* allocator) :
+            elements_(16, allocator), tagIds_(16, allocator) {
+            std::memset(counts_, 0, sizeof(counts_));
+        }
+
+        void push(Element* el) {
+            const TagIdEnum id = el->tagId();
+            elements_.push(el);
+            tagIds_.push(id);
+            ++ counts_[id];
+        }
+
+        void pop() {
+            -- counts_[*tagIds_.back()];
+            elements_.pop();
+            tagIds_.pop();
+        }
+
+        void remove(size_t index) {
+            -- counts_[*tagIds_.at(index)];
+            elements_.remove(index);
+            tagIds_.remove(index);
+        }
+
+        void insert(size_t index, Element* el) {
+            const TagIdEnum id = el->tagId();
+            elements_.insert(index, el);
+            tagIds_.insert(index, id);
+            ++ counts_[id];
+        }
+
+        void replace(size_t index, Element* el) {
+            const TagIdEnum id = el->tagId();
+            -- counts_[*tagIds_.at(index)];
+            *elements_.at(index) = el;
+            *tagIds_.at(index) = id;
+            ++ counts_[id];
+        }
+
+        void clear() {
+            elements_.clear();
+            tagIds_.clear();
+            std::memset(counts_, 0, sizeof(counts_));
+        }
+
+        Element* const* at(size_t index) const {
+            return elements_.at(index);
+        }
+
+        Element* const* back() const {
+            return elements_.back();
+        }
+
+        Element* const* front() const {
+            return elements_.front();
+        }
+
+        TagIdEnum tagIdAt(size_t index) const {
+            return *tagIds_.at(index);
+        }
+
+        // how many elements with this tag id are open; every tag we don't
+        // know counts as CSOUP_TAG_UNKNOWN
+        size_t count(TagIdEnum id) const {
+            return counts_[id];
+        }
+
+        bool contains(const Element* el) const {
+            const TagIdEnum id = el->tagId();
+            if (counts_[id] == 0) return false;
+
+            for (size_t i = elements_.size(); i > 0; -- i) {
+                if (*elements_.at(i - 1) == el) return true;
+            }
+
+            return false;
+        }
+
+        // True if an element named targetName is open with no element from
+        // boundary above it. Unknown names are matched by name, and only
+        // against unknown elements.
+        bool inScope(const StringRef& targetName, const TagSet& boundary) const {
+            const TagIdEnum target = Tag::idOf(targetName);
+            // nothing to look for, which is the usual answer for p, li and the like
+            if (counts_[target] == 0) return false;
+
+            for (size_t i = tagIds_.size(); i > 0; -- i) {
+                const TagIdEnum id = *tagIds_.at(i - 1);
+
+                if (id == target && (target != CSOUP_TAG_UNKNOWN || (*elements_.at(i - 1))->tagName().equals(targetName))) {
+                    return true;
+                }
+
+                if (boundary.contains(id)) return false;
+            }
+
+            // html is in every boundary, so the walk never gets here while parsing
+            CSOUP_ASSERT(false);
+            return false;
+        }
+
+        bool inScope(const TagSet& targets, const TagSet& boundary) const {
+            for (size_t i = tagIds_.size(); i > 0; -- i) {
+                const TagIdEnum id = *tagIds_.at(i - 1);
+
+                if (targets.contains(id)) return true;
+                if (boundary.contains(id)) return false;
+            }
+
+            CSOUP_ASSERT(false);
+            return false;
+        }
+
+        size_t size() const {
+            return elements_.size();
+        }
+
+        bool empty() const {
+            return elements_.empty();
+        }
+
+    private:
+        // Prohibit copy constructor & assignment operator.
+        ElementStack(const ElementStack&);
+        ElementStack& operator=(const ElementStack&);
+
+        internal::Vector<Element*> elements_;
+        internal::Vector<TagIdEnum> tagIds_;
+        size_t counts_[CSOUP_TAG_UNKNOWN + 1];
+    };
+}
+
+#endif // CSOUP_ELEMENTSTACK_H_
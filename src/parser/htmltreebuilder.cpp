@@ -15,6 +15,7 @@
 #include "../nodes/document.h"
 #include "../internal/list.h"
 #include "htmltreebuilderstate.h"
+#include "elementstack.h"
 #include "formelement.h"
 #include "parseerrorlist.h"
 #include "parseerror.h"
@@ -22,35 +23,52 @@
 #include "../nodes/textnode.h"
 #include "../nodes/datanode.h"
 
+namespace {
+    using namespace csoup;
+    
+    constexpr TagSet defaultScope = makeTagSet(CSOUP_TAG_APPLET, CSOUP_TAG_CAPTION, CSOUP_TAG_HTML, CSOUP_TAG_TABLE,
+                                               CSOUP_TAG_TD, CSOUP_TAG_TH, CSOUP_TAG_MARQUEE, CSOUP_TAG_OBJECT);
+}
+
 namespace csoup {
     using namespace internal;
     
     const StringRef HtmlTreeBuilder::TagsScriptStyle[]      = {"script", "style"};
-    const StringRef HtmlTreeBuilder::TagsSearchInScope[]    = {"applet", "caption", "html", "table", "td", "th", "marquee", "object"};
-    const StringRef HtmlTreeBuilder::TagSearchList[]        = {"ol", "ul"};
-    const StringRef HtmlTreeBuilder::TagSearchButton[]      = {"button"};
-    const StringRef HtmlTreeBuilder::TagSearchTableScope[]  = {"html", "table"};
-    const StringRef HtmlTreeBuilder::TagSearchSelectScope[] = {"optgroup", "option"};
-    const StringRef HtmlTreeBuilder::TagSearchEndTags[]     = {"dd", "dt", "li", "option", "optgroup", "p", "rp", "rt"};
-    const StringRef HtmlTreeBuilder::TagSearchSpecial[]     = {"address", "applet", "area", "article", "aside", "base", "basefont", "bgsound",
-        "blockquote", "body", "br", "button", "caption", "center", "col", "colgroup", "command", "dd",
-        "details", "dir", "div", "dl", "dt", "embed", "fieldset", "figcaption", "figure", "footer", "form",
-        "frame", "frameset", "h1", "h2", "h3", "h4", "h5", "h6", "head", "header", "hgroup", "hr", "html",
-        "iframe", "img", "input", "isindex", "li", "link", "listing", "marquee", "menu", "meta", "nav",
-        "noembed", "noframes", "noscript", "object", "ol", "p", "param", "plaintext", "pre", "script",
-        "section", "select", "style", "summary", "table", "tbody", "td", "textarea", "tfoot", "th", "thead",
-        "title", "tr", "ul", "wbr", "xmp"};
+    const TagSet HtmlTreeBuilder::TagsSearchInScope      = defaultScope;
+    const TagSet HtmlTreeBuilder::TagSearchListItemScope = defaultScope | makeTagSet(CSOUP_TAG_OL, CSOUP_TAG_UL);
+    const TagSet HtmlTreeBuilder::TagSearchButtonScope   = defaultScope | makeTagSet(CSOUP_TAG_BUTTON);
+    const TagSet HtmlTreeBuilder::TagSearchTableScope    = makeTagSet(CSOUP_TAG_HTML, CSOUP_TAG_TABLE);
+    const TagSet HtmlTreeBuilder::TagSearchSelectScope   = makeTagSet(CSOUP_TAG_OPTGROUP, CSOUP_TAG_OPTION);
+    const TagSet HtmlTreeBuilder::TagSearchEndTags = makeTagSet(
+        CSOUP_TAG_DD, CSOUP_TAG_DT, CSOUP_TAG_LI, CSOUP_TAG_OPTION, CSOUP_TAG_OPTGROUP, CSOUP_TAG_P, CSOUP_TAG_RP,
+        CSOUP_TAG_RT);
+    const TagSet HtmlTreeBuilder::TagSearchSpecial = makeTagSet(
+        CSOUP_TAG_ADDRESS, CSOUP_TAG_APPLET, CSOUP_TAG_AREA, CSOUP_TAG_ARTICLE, CSOUP_TAG_ASIDE,
+        CSOUP_TAG_BASE, CSOUP_TAG_BASEFONT, CSOUP_TAG_BGSOUND, CSOUP_TAG_BLOCKQUOTE, CSOUP_TAG_BODY,
+        CSOUP_TAG_BR, CSOUP_TAG_BUTTON, CSOUP_TAG_CAPTION, CSOUP_TAG_CENTER, CSOUP_TAG_COL,
+        CSOUP_TAG_COLGROUP, CSOUP_TAG_COMMAND, CSOUP_TAG_DD, CSOUP_TAG_DETAILS, CSOUP_TAG_DIR,
+        CSOUP_TAG_DIV, CSOUP_TAG_DL, CSOUP_TAG_DT, CSOUP_TAG_EMBED, CSOUP_TAG_FIELDSET,
+        CSOUP_TAG_FIGCAPTION, CSOUP_TAG_FIGURE, CSOUP_TAG_FOOTER, CSOUP_TAG_FORM, CSOUP_TAG_FRAME,
+        CSOUP_TAG_FRAMESET, CSOUP_TAG_H1, CSOUP_TAG_H2, CSOUP_TAG_H3, CSOUP_TAG_H4, CSOUP_TAG_H5,
+        CSOUP_TAG_H6, CSOUP_TAG_HEAD, CSOUP_TAG_HEADER, CSOUP_TAG_HGROUP, CSOUP_TAG_HR, CSOUP_TAG_HTML,
+        CSOUP_TAG_IFRAME, CSOUP_TAG_IMG, CSOUP_TAG_INPUT, CSOUP_TAG_ISINDEX, CSOUP_TAG_LI, CSOUP_TAG_LINK,
+        CSOUP_TAG_LISTING, CSOUP_TAG_MARQUEE, CSOUP_TAG_MENU, CSOUP_TAG_META, CSOUP_TAG_NAV,
+        CSOUP_TAG_NOEMBED, CSOUP_TAG_NOFRAMES, CSOUP_TAG_NOSCRIPT, CSOUP_TAG_OBJECT, CSOUP_TAG_OL,
+        CSOUP_TAG_P, CSOUP_TAG_PARAM, CSOUP_TAG_PLAINTEXT, CSOUP_TAG_PRE, CSOUP_TAG_SCRIPT,
+        CSOUP_TAG_SECTION, CSOUP_TAG_SELECT, CSOUP_TAG_STYLE, CSOUP_TAG_SUMMARY, CSOUP_TAG_TABLE,
+        CSOUP_TAG_TBODY, CSOUP_TAG_TD, CSOUP_TAG_TEXTAREA, CSOUP_TAG_TFOOT, CSOUP_TAG_TH, CSOUP_TAG_THEAD,
+        CSOUP_TAG_TITLE, CSOUP_TAG_TR, CSOUP_TAG_UL, CSOUP_TAG_WBR, CSOUP_TAG_XMP);
     
     HtmlTreeBuilder::HtmlTreeBuilder(Allocator* allocator) :
     state_(NULL), originalState_(NULL), baseUriSetFromDoc_(false), headElement_(NULL),
     /*formElement(NULL),*/ contextElement_(NULL), formattingElements_(NULL), pendingTableCharacters_(NULL),
-    framesetOk_(true), fosterInserts_(false), fragmentParsing_(false), formElement_(NULL), allocator_(allocator) {
+    framesetOk_(true), fosterInserts_(false), fragmentParsing_(false), formElement_(NULL), builderAllocator_(allocator) {
         CSOUP_ASSERT(allocator != NULL);
         
         using internal::Vector;
         
         formattingElements_ = new (allocator->malloc_t< Vector<Element*> >()) Vector<Element*>(4, allocator);
-        pendingTableCharacters_ = new (allocator->malloc_t< Vector<CharacterToken*> >()) Vector<CharacterToken*>();
+        pendingTableCharacters_ = new (allocator->malloc_t< Vector<CharacterToken*> >()) Vector<CharacterToken*>(4, allocator);
     }
     
     HtmlTreeBuilder::~HtmlTreeBuilder() {
@@ -59,9 +77,17 @@ namespace csoup {
         
         //allocator_->deconstructAndFree(headElement_);
         //allocator_->deconstructAndFree(contextElement_);
-        allocator_->deconstructAndFree(formattingElements_);
+        freeResources();
+        builderAllocator_->deconstructAndFree(formattingElements_);
+        builderAllocator_->deconstructAndFree(pendingTableCharacters_);
+    }
+    
+    void HtmlTreeBuilder::freeResources() {
+        // the pending characters are copies in the scratch allocator, which
+        // the base class rewinds
         clearPendingTableCharacters();
-        allocator_->deconstructAndFree(pendingTableCharacters_);
+        formattingElements_->clear();
+        TreeBuilder::freeResources();
     }
     
     Element* HtmlTreeBuilder::insert(csoup::StartTagToken *startTag) {
@@ -69,18 +95,26 @@ namespace csoup {
             Element* el = insertEmpty(startTag);
             stack_->push(el);
             tokeniser_->transition(Data::instance());
-            tokeniser_->emit(CSOUP_NEW2(allocator(), EndTagToken, el->tagName(), allocator()));
+            tokeniser_->emitEndTag(el->tagName());
             return el;
         }
         
-        Element* el = new (allocator_->malloc_t<Element>())
-        Element(startTag->tagName(), *startTag->attributes(), baseUri_ ? baseUri_->ref() : "", allocator());
+        Element* el = new (mallocNode<Element>())
+        Element(startTag->tagName(), baseUri_, allocator());
+        copyAttributes(startTag, el);
         insert(el);
         return el;
     }
     
+    void HtmlTreeBuilder::copyAttributes(const TagToken* tag, Element* el) {
+        if (tag->attributeCount()) el->reserveAttributes(tag->attributeCount());
+        for (size_t i = 0; i < tag->attributeCount(); ++ i) {
+            el->addAttribute(tag->attributeKey(i), tag->attributeValue(i));
+        }
+    }
+    
     Element* HtmlTreeBuilder::insert(const csoup::StringRef &startTagName) {
-        Element* el = new (allocator()->malloc_t<Element>()) Element(startTagName, baseUri_ ? baseUri_->ref() : "", allocator());
+        Element* el = new (mallocNode<Element>()) Element(startTagName, baseUri_, allocator());
         insert(el);
         return el;
     }
@@ -91,11 +125,12 @@ namespace csoup {
     }
     
     Element* HtmlTreeBuilder::insertEmpty(csoup::StartTagToken *startTag) {
-        Element* el = new (allocator()->malloc_t<Element>())
-            Element(startTag->tagName(), *startTag->attributes(), baseUri_ ? baseUri_->ref() : "", allocator());
+        Element* el = new (mallocNode<Element>())
+            Element(startTag->tagName(), baseUri_, allocator());
+        copyAttributes(startTag, el);
         insertNode(el);
         if (startTag->selfClosing()) {
-            if (Tag::isKnownTag(startTag->tagName())) {
+            if (startTag->tagId() != CSOUP_TAG_UNKNOWN) {
                 if (el->tag()->selfClosing()) {
                     tokeniser()->setAcknowledgeSelfClosingFlag();
                 }
@@ -109,8 +144,9 @@ namespace csoup {
     }
     
     FormElement* HtmlTreeBuilder::insertForm(StartTagToken *startTag, bool onStack) {
-        FormElement* el = new (allocator()->malloc_t<FormElement>())
-            FormElement(startTag->tagName(), *startTag->attributes(), baseUri_ ? baseUri_->ref() : "", allocator());
+        FormElement* el = new (mallocNode<FormElement>())
+            FormElement(startTag->tagName(), baseUri_, allocator());
+        copyAttributes(startTag, el);
         setFormElement(el, false);
         insertNode(el);
         if (onStack) {
@@ -121,7 +157,7 @@ namespace csoup {
     }
     
     void HtmlTreeBuilder::insert(CommentToken* commentToken) {
-        CommentNode* comment = CSOUP_NEW3(allocator(), CommentNode,commentToken->data(), baseUri_ ? baseUri_->ref() : "", allocator());
+        CommentNode* comment = new (mallocNode<CommentNode>()) CommentNode(commentToken->data(), baseUri_, allocator());
         insertNode(comment);
     }
     
@@ -129,9 +165,14 @@ namespace csoup {
         Node* node;
         StringRef tagName = currentElement()->tagName();
         if (tagName.equals("script") || tagName.equals("style")) {
-            node = CSOUP_NEW3(allocator(), DataNode, characterToken->data(), baseUri_ ? baseUri_->ref() : "", allocator());
+            node = new (mallocNode<DataNode>()) DataNode(characterToken->data(), baseUri_, allocator());
+        } else if (characterToken->isSlice()) {
+            // the token points into doc_->source(), which lives as long as the node
+            TextNode* text = new (mallocNode<TextNode>()) TextNode(baseUri_, allocator());
+            text->shareWholeText(characterToken->data());
+            node = text;
         } else {
-            node = CSOUP_NEW3(allocator(), TextNode, characterToken->data(), baseUri_ ? baseUri_->ref() : "", allocator());
+            node = new (mallocNode<TextNode>()) TextNode(characterToken->data(), baseUri_, allocator());
         }
         
         currentElement()->appendNode(node);
@@ -143,7 +184,7 @@ namespace csoup {
         clearPendingTableCharacters();
         pendingTableCharacters_->clear();
         
-        //state_ = ; // set to INITIAL state
+        state_ = Initial::instance();
         originalState_ = NULL;
         contextElement_ = NULL;
         baseUriSetFromDoc_ = false;
@@ -201,7 +242,7 @@ namespace csoup {
             
             // setup form element to nearest form on context (up ancestor chain). ensures form controls are associated
             // with form correctly
-            ElementsRef contextChain(allocator);
+            ElementsRef contextChain(scratchAllocator());
             context->parents(&contextChain);
             contextChain.insert(0, context);
             
@@ -222,13 +263,14 @@ namespace csoup {
     }
     
     bool HtmlTreeBuilder::process(Token *token) {
-        CSOUP_DELETE(allocator(), currentToken_);
+        // runParser() owns the token
         currentToken_ = token;
         return state_->process(token, this);
     }
     
     bool HtmlTreeBuilder::process(Token* token, HtmlTreeBuilderState* state) {
-        return process(token);
+        currentToken_ = token;
+        return state->process(token, this);
     }
     
     void HtmlTreeBuilder::maybeSetBaseUri(csoup::Element *base) {
@@ -236,7 +278,16 @@ namespace csoup {
             return ;
         }
         
-        // Do nothing
+        // only the first <base href> counts. The href is taken as it is,
+        // there is no URL resolution to make a relative one absolute.
+        StringRef href = base->attr("href");
+        if (href.size() == 0) {
+            return ;
+        }
+        
+        baseUriSetFromDoc_ = true;
+        doc_->setBaseUri(href);
+        baseUri_ = doc_->sharedBaseUri();
     }
     
     
@@ -274,7 +325,7 @@ namespace csoup {
     }
     
     bool HtmlTreeBuilder::onStack(csoup::Element *el) {
-        return isElementInQueue(stack_, el);
+        return stack_->contains(el);
     }
     
     bool HtmlTreeBuilder::isElementInQueue(internal::Vector<Element*> *queue, csoup::Element *element) {
@@ -288,10 +339,11 @@ namespace csoup {
     }
     
     Element* HtmlTreeBuilder::getFromStack(const csoup::StringRef &elName) {
-        if (stack_->size() == 0) return NULL;
+        const TagIdEnum id = Tag::idOf(elName);
+        if (stack_->count(id) == 0) return NULL;
         
         for (size_t i = stack_->size(); i > 0; -- i) {
-            if ((*stack_->at(i - 1))->tagName().equals(elName)) {
+            if (stack_->tagIdAt(i - 1) == id && (*stack_->at(i - 1))->tagName().equals(elName)) {
                 return *stack_->at(i - 1);
             }
         }
@@ -390,11 +442,11 @@ namespace csoup {
         }
     }
     
-    void HtmlTreeBuilder::popStackToClose(bool del, const csoup::StringRef *elName, size_t cnt) {
+    void HtmlTreeBuilder::popStackToClose(bool del, const TagSet& tags) {
         if (stack_->size() == 0) return ;
         
         for (size_t i = stack_->size(); i > 0; -- i) {
-            if (StringUtil::in((*stack_->at(i - 1))->tagName(), elName, cnt)) {
+            if (tags.contains((*stack_->at(i - 1))->tagId())) {
                 if (del) CSOUP_DELETE(allocator(), (*stack_->at(i - 1)));
                 stack_->remove(i - 1);
                 break;
@@ -502,15 +554,21 @@ namespace csoup {
     }
     
     void HtmlTreeBuilder::replaceOnStack(csoup::Element *out, csoup::Element *in, bool del) {
-        replaceInQueue(stack_, out, in, del);
+        for (size_t i = stack_->size(); i > 0; -- i) {
+            Element* cur = *stack_->at(i - 1);
+            if (cur == out) {
+                if (del) CSOUP_DELETE(allocator(), cur);
+                stack_->replace(i - 1, in);
+            }
+        }
     }
     
     void HtmlTreeBuilder::replaceInQueue(internal::Vector<Element *> *queue, Element *out, Element *in, bool del) {
-        for (size_t i = stack_->size(); i > 0; -- i) {
-            Element* cur = *stack_->at(i - 1);
+        for (size_t i = queue->size(); i > 0; -- i) {
+            Element* cur = *queue->at(i - 1);
             if (cur == out) {
                 if (del) CSOUP_DELETE(allocator(), cur);
-                *stack_->at(i - 1) = in;
+                *queue->at(i - 1) = in;
             }
         }
     }
@@ -518,20 +576,17 @@ namespace csoup {
     void HtmlTreeBuilder::resetInsertionMode() {
         bool last = false;
         for (size_t i = stack_->size(); i > 0; -- i) {
-            Element* node = *stack_->at(i);
+            Element* node = *stack_->at(i - 1);
             if (i - 1 == 0) {
                 last = true;
-                node = contextElement_;
+                if (contextElement_ != NULL) node = contextElement_;
             }
             
             StringRef name(node->tagName());
             if (name.equals("select")) {
                 transition(InSelect::instance());
                 break;
-                
-                ////////////////////////
-                // There is a bug!
-            } else if (name.equals("td") || (name.equals("td") && !last)) {
+            } else if (name.equals("td") || (name.equals("th") && !last)) {
                 transition(InCell::instance());
                 break;
             } else if (name.equals("tr")) {
@@ -568,64 +623,39 @@ namespace csoup {
         }
     }
     
-    bool HtmlTreeBuilder::inSpecificScope(const csoup::StringRef &targetName, const csoup::StringRef *baseTypes, size_t baseTypeLen, const csoup::StringRef *extraTypes, size_t extraTypeLen) {
-        StringRef targetNames[] = {targetName};
-        return inSpecificScope(targetNames, 1, baseTypes, baseTypeLen, extraTypes, extraTypeLen);
-    }
-    
-    bool HtmlTreeBuilder::inSpecificScope(const StringRef* targetName, size_t targetNameLen, const StringRef *baseTypes, size_t baseTypeLen, const StringRef *extraTypes, size_t extraTypeLen) {
-        for (size_t i = stack_->size(); i > 0; -- i) {
-            Element* el = *stack_->at(i - 1);
-            StringRef elName = el->tagName();
-            
-            if (StringUtil::in(elName, targetName, targetNameLen)) {
-                return true;
-            }
-            
-            if (StringUtil::in(elName, baseTypes, baseTypeLen)) {
-                return false;
-            }
-            
-            if (extraTypes != NULL && extraTypeLen != 0 && StringUtil::in(elName, extraTypes, extraTypeLen)) {
-                return false;
-            }
-        }
-        
-        CSOUP_ASSERT(false);
-        return false;
-    }
-    
     bool HtmlTreeBuilder::inScope(const csoup::StringRef &targetName) {
-        return inScope(targetName, NULL, 0);
-    }
-    
-    bool HtmlTreeBuilder::inScope(const csoup::StringRef &targetName, const csoup::StringRef *extras, size_t len) {
-        return inSpecificScope(targetName, TagsSearchInScope, arrayLength(TagsSearchInScope), extras, len);
+        return stack_->inScope(targetName, TagsSearchInScope);
     }
     
-    bool HtmlTreeBuilder::inScope(const csoup::StringRef *targetNames, size_t len) {
-        return inSpecificScope(targetNames, len, TagsSearchInScope, arrayLength(TagsSearchInScope), NULL, 0);
+    bool HtmlTreeBuilder::inScope(const TagSet& targets) {
+        return stack_->inScope(targets, TagsSearchInScope);
     }
     
     bool HtmlTreeBuilder::inListItemScope(const csoup::StringRef &targetName) {
-        return inScope(targetName, TagSearchList, arrayLength(TagSearchList));
+        return stack_->inScope(targetName, TagSearchListItemScope);
     }
     
     bool HtmlTreeBuilder::inButtonScope(const csoup::StringRef &targetName) {
-        return inScope(targetName, TagSearchButton, arrayLength(TagSearchButton));
+        return stack_->inScope(targetName, TagSearchButtonScope);
     }
     
     bool HtmlTreeBuilder::inTableScope(const csoup::StringRef &targetName) {
-        return inSpecificScope(targetName, TagSearchTableScope, arrayLength(TagSearchTableScope), NULL, 0);
+        return stack_->inScope(targetName, TagSearchTableScope);
     }
     
     bool HtmlTreeBuilder::inSelectScope(const csoup::StringRef &targetName) {
+        const TagIdEnum target = Tag::idOf(targetName);
+        if (stack_->count(target) == 0) {
+            return false;
+        }
+        
         for (size_t i = stack_->size(); i > 0; -- i) {
-            Element* el = *stack_->at(i);
-            StringRef elName = el->tagName();
+            const TagIdEnum id = stack_->tagIdAt(i - 1);
             
-            if (elName.equals(targetName)) return true;
-            if (!StringUtil::in(elName, TagSearchSelectScope, arrayLength(TagSearchSelectScope))) {
+            if (id == target && (target != CSOUP_TAG_UNKNOWN || (*stack_->at(i - 1))->tagName().equals(targetName))) {
+                return true;
+            }
+            if (!TagSearchSelectScope.contains(id)) {
                 return false;
             }
         }
@@ -646,14 +676,15 @@ namespace csoup {
     void HtmlTreeBuilder::clearPendingTableCharacters() {
         if (!pendingTableCharacters_) return ;
         for (size_t i = 0; i < pendingTableCharacters_->size(); ++ i) {
-            CSOUP_DELETE(allocator(), *pendingTableCharacters_->at(i));
+            CSOUP_DELETE(scratchAllocator(), *pendingTableCharacters_->at(i));
         }
+        pendingTableCharacters_->clear();
     }
     
     void HtmlTreeBuilder::newPendingTableCharacters(bool del) {
+        // the list itself belongs to the builder, so it is kept and reused
         if (del) clearPendingTableCharacters();
-        if (pendingTableCharacters_) CSOUP_DELETE(allocator(), pendingTableCharacters_);
-        pendingTableCharacters_ = CSOUP_NEW2(allocator(), internal::Vector<CharacterToken*>, 4, allocator());
+        else pendingTableCharacters_->clear();
     }
     
     void HtmlTreeBuilder::setPendingTableCharacters(internal::Vector<CharacterToken*> *pendingTableCharacters, bool del) {
@@ -662,13 +693,13 @@ namespace csoup {
         }
         
         if (del) clearPendingTableCharacters();
-        if (pendingTableCharacters_) CSOUP_DELETE(allocator(), pendingTableCharacters_);
+        if (pendingTableCharacters_) CSOUP_DELETE(builderAllocator_, pendingTableCharacters_);
         pendingTableCharacters_ = pendingTableCharacters;
     }
     
     void HtmlTreeBuilder::generateImpliedEndTags(const csoup::StringRef &excludeTag, bool del) {
         while ((excludeTag.size() != 0 && !currentElement()->tagName().equals(excludeTag)) &&
-               StringUtil::in(currentElement()->tagName(), TagSearchEndTags, arrayLength(TagSearchEndTags))) {
+               TagSearchEndTags.contains(currentElement()->tagId())) {
             if (del) CSOUP_DELETE(allocator(), pop());
             else pop();
         }
@@ -679,7 +710,7 @@ namespace csoup {
     }
     
     bool HtmlTreeBuilder::isSpecial(const csoup::Element *el) {
-        return StringUtil::in(el->tagName(), TagSearchSpecial, arrayLength(TagSearchSpecial));
+        return TagSearchSpecial.contains(el->tagId());
     }
     
     void HtmlTreeBuilder::pushActiveFormattingElements(csoup::Element *in, bool del) {
@@ -736,7 +767,7 @@ namespace csoup {
             Element* newEl = insert(entry->tagName());
             
             const Attributes* attrs = entry->attributes();
-            for (size_t i = 0; i < attrs->size(); ++ i) {
+            for (size_t i = 0; attrs != NULL && i < attrs->size(); ++ i) {
                 newEl->addAttribute(attrs->get(i)->key(), attrs->get(i)->value());
             }
             
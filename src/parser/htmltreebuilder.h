@@ -11,6 +11,8 @@
 
 #include "treebuilder.h"
 #include "../util/stringref.h"
+#include "../internal/vector.h"
+#include "../nodes/tagset.h"
 
 // TODO:
 //      1. Methods about creating/inserting/removing nodes should be modified to be
@@ -37,9 +39,6 @@ namespace csoup {
     namespace internal {
         template <typename T>
         class List;
-        
-        template <typename T>
-        class Vector;
     };
     
     class HtmlTreeBuilder : public TreeBuilder {
@@ -128,7 +127,7 @@ namespace csoup {
                              const StringRef& s5);
         void popStackToClose(bool del, const StringRef& s1, const StringRef& s2, const StringRef& s3, const StringRef& s4,
                              const StringRef& s5, const StringRef& s6);
-        void popStackToClose(bool del, const StringRef* elName, size_t cnt);
+        void popStackToClose(bool del, const TagSet& tags);
         
         void popStackToBefore(bool del, const StringRef& elName);
         
@@ -148,12 +147,10 @@ namespace csoup {
         
         void resetInsertionMode();
         
-        bool inScope(const StringRef* targetNames, size_t len);
+        bool inScope(const TagSet& targets);
         
         bool inScope(const StringRef& targetName);
         
-        bool inScope(const StringRef& targetName, const StringRef* extras, size_t len);
-        
         bool inListItemScope(const StringRef& targetName);
         
         bool inButtonScope(const StringRef& targetName);
@@ -216,14 +213,28 @@ namespace csoup {
         
         void insertInFosterParent(Node* in);
         
+        // the document's allocator while parsing
         Allocator* allocator() {
             return allocator_;
         }
         
+        // Memory for a node from the document's allocator. The default
+        // document allocator is a MemoryPoolAllocator, and then the pool is
+        // called directly, so its bump-pointer malloc inlines here. The nodes
+        // keep an Allocator*: what they allocate later is still dispatched.
+        template <typename T>
+        T* mallocNode() {
+            return static_cast<T*>(pool_ ? pool_->malloc(sizeof(T)) : allocator_->malloc(sizeof(T)));
+        }
+        
+    protected:
+        void freeResources();
+        
     private:
         void clearPendingTableCharacters();
         
         void insertNode(Node* node);
+        void copyAttributes(const TagToken* tag, Element* el);
         bool isElementInQueue(internal::Vector<Element*>* queue, Element* element);
         void replaceInQueue(internal::Vector<Element>* queue, Element* out, Element* in);
         bool isSameFormattingElement(Element* a, Element* b);
@@ -236,24 +247,16 @@ namespace csoup {
                                  const StringRef& n5);
         void clearStackToContext(bool del, const StringRef* n1, size_t cnt);
         
-        bool inSpecificScope(const StringRef* targetName, size_t targetNameLen, const StringRef* baseTypes, size_t baseTypeLen,
-                            const StringRef* extraTypes, size_t extraTypeLen);
-        
-        bool inSpecificScope(const StringRef& targetName, const StringRef* baseTypes, size_t baseTypeLen,
-                             const StringRef* extraTypes, size_t extraTypeLen);
-
-        
-//        bool inSpecificScope(const StringRef& targetNames, StringRef* baseTypes, size_t baseTypeLen,
-//                             StringRef* extraTypes, size_t extraTypeLen);
-
         static const StringRef TagsScriptStyle[];
-        static const StringRef TagsSearchInScope[];
-        static const StringRef TagSearchList[];
-        static const StringRef TagSearchButton[];
-        static const StringRef TagSearchTableScope[];
-        static const StringRef TagSearchSelectScope[];
-        static const StringRef TagSearchEndTags[];
-        static const StringRef TagSearchSpecial[];
+        // the boundaries of each kind of scope
+        static const TagSet TagsSearchInScope;
+        static const TagSet TagSearchListItemScope;
+        static const TagSet TagSearchButtonScope;
+        static const TagSet TagSearchTableScope;
+        // select scope is the other way around: only these don't end it
+        static const TagSet TagSearchSelectScope;
+        static const TagSet TagSearchEndTags;
+        static const TagSet TagSearchSpecial;
         
         // Never try to release two guys below. They refered to
         // static members
@@ -273,7 +276,8 @@ namespace csoup {
         bool fosterInserts_;
         bool fragmentParsing_;
         
-        Allocator* allocator_;
+        // for the builder's own state, which outlives a single parse
+        Allocator* builderAllocator_;
     };
 }
 
@@ -8,6 +8,7 @@
 
 #include "htmltreebuilderstate.h"
 #include "htmltreebuilder.h"
+#include "elementstack.h"
 #include "token.h"
 #include "stringutil.h"
 #include "tokeniserstate.h"
@@ -17,45 +18,108 @@
 #include "../internal/list.h"
 
 namespace csoup {
-    const StringRef HtmlTreeBuilderState::Constants::InBodyStartToHead[]
-            = {"base", "basefont", "bgsound", "command", "link", "meta","noframes", "script", "style", "title"};
-    const StringRef HtmlTreeBuilderState::Constants::InBodyStartPClosers[]
-            = {"address", "article", "aside", "blockquote", "center", "details", "dir", "div", "dl","fieldset",
-                "figcaption", "figure", "footer", "header", "hgroup", "menu", "nav", "ol","p", "section",
-                "summary", "ul"};
-    const StringRef HtmlTreeBuilderState::Constants::Headings[]
-            = {"h1", "h2", "h3", "h4", "h5", "h6"};
-    const StringRef HtmlTreeBuilderState::Constants::InBodyStartPreListing[]
-            = {"pre", "listing"};
-    const StringRef HtmlTreeBuilderState::Constants::InBodyStartLiBreakers[]
-            = {"address", "div", "p"};
-    const StringRef HtmlTreeBuilderState::Constants::DdDt[]
-            = {"dd", "dt"};
-    const StringRef HtmlTreeBuilderState::Constants::Formatters[]
-            = {"b", "big", "code", "em", "font", "i", "s", "small", "strike", "strong", "tt", "u"};
-    const StringRef HtmlTreeBuilderState::Constants::InBodyStartApplets[]
-            = {"applet", "marquee", "object"};
-    const StringRef HtmlTreeBuilderState::Constants::InBodyStartEmptyFormatters[]
-            = {"area", "br", "embed", "img", "keygen", "wbr"};
-    const StringRef HtmlTreeBuilderState::Constants::InBodyStartMedia[]
-            = {"param", "source", "track"};
+    const TagSet HtmlTreeBuilderState::Constants::InBodyStartToHead
+            = makeTagSet(CSOUP_TAG_BASE, CSOUP_TAG_BASEFONT, CSOUP_TAG_BGSOUND, CSOUP_TAG_COMMAND, CSOUP_TAG_LINK,
+                CSOUP_TAG_META, CSOUP_TAG_NOFRAMES, CSOUP_TAG_SCRIPT, CSOUP_TAG_STYLE, CSOUP_TAG_TITLE);
+    const TagSet HtmlTreeBuilderState::Constants::InBodyStartPClosers
+            = makeTagSet(CSOUP_TAG_ADDRESS, CSOUP_TAG_ARTICLE, CSOUP_TAG_ASIDE, CSOUP_TAG_BLOCKQUOTE, CSOUP_TAG_CENTER,
+                CSOUP_TAG_DETAILS, CSOUP_TAG_DIR, CSOUP_TAG_DIV, CSOUP_TAG_DL, CSOUP_TAG_FIELDSET,
+                CSOUP_TAG_FIGCAPTION, CSOUP_TAG_FIGURE, CSOUP_TAG_FOOTER, CSOUP_TAG_HEADER, CSOUP_TAG_HGROUP,
+                CSOUP_TAG_MENU, CSOUP_TAG_NAV, CSOUP_TAG_OL, CSOUP_TAG_P, CSOUP_TAG_SECTION, CSOUP_TAG_SUMMARY,
+                CSOUP_TAG_UL);
+    const TagSet HtmlTreeBuilderState::Constants::Headings
+            = makeTagSet(CSOUP_TAG_H1, CSOUP_TAG_H2, CSOUP_TAG_H3, CSOUP_TAG_H4, CSOUP_TAG_H5, CSOUP_TAG_H6);
+    const TagSet HtmlTreeBuilderState::Constants::InBodyStartPreListing
+            = makeTagSet(CSOUP_TAG_PRE, CSOUP_TAG_LISTING);
+    const TagSet HtmlTreeBuilderState::Constants::InBodyStartLiBreakers
+            = makeTagSet(CSOUP_TAG_ADDRESS, CSOUP_TAG_DIV, CSOUP_TAG_P);
+    const TagSet HtmlTreeBuilderState::Constants::DdDt
+            = makeTagSet(CSOUP_TAG_DD, CSOUP_TAG_DT);
+    const TagSet HtmlTreeBuilderState::Constants::Formatters
+            = makeTagSet(CSOUP_TAG_B, CSOUP_TAG_BIG, CSOUP_TAG_CODE, CSOUP_TAG_EM, CSOUP_TAG_FONT, CSOUP_TAG_I, CSOUP_TAG_S,
+                CSOUP_TAG_SMALL, CSOUP_TAG_STRIKE, CSOUP_TAG_STRONG, CSOUP_TAG_TT, CSOUP_TAG_U);
+    const TagSet HtmlTreeBuilderState::Constants::InBodyStartApplets
+            = makeTagSet(CSOUP_TAG_APPLET, CSOUP_TAG_MARQUEE, CSOUP_TAG_OBJECT);
+    const TagSet HtmlTreeBuilderState::Constants::InBodyStartEmptyFormatters
+            = makeTagSet(CSOUP_TAG_AREA, CSOUP_TAG_BR, CSOUP_TAG_EMBED, CSOUP_TAG_IMG, CSOUP_TAG_KEYGEN, CSOUP_TAG_WBR);
+    const TagSet HtmlTreeBuilderState::Constants::InBodyStartMedia
+            = makeTagSet(CSOUP_TAG_PARAM, CSOUP_TAG_SOURCE, CSOUP_TAG_TRACK);
     const StringRef HtmlTreeBuilderState::Constants::InBodyStartInputAttribs[]
             = {"name", "action", "prompt"};
-    const StringRef HtmlTreeBuilderState::Constants::InBodyStartOptions[]
-            = {"optgroup", "option"};
-    const StringRef HtmlTreeBuilderState::Constants::InBodyStartRuby[]
-            = {"rp", "rt"};
-    const StringRef HtmlTreeBuilderState::Constants::InBodyStartDrop[]
-            = {"caption", "col", "colgroup", "frame", "head", "tbody", "td", "tfoot", "th", "thead", "tr"};
-    const StringRef HtmlTreeBuilderState::Constants::InBodyEndClosers[]
-            = {"address", "article", "aside", "blockquote", "button", "center", "details", "dir", "div",
-                "dl", "fieldset", "figcaption", "figure", "footer", "header", "hgroup", "listing", "menu",
-                "nav", "ol", "pre", "section", "summary", "ul"};
-    const StringRef HtmlTreeBuilderState::Constants::InBodyEndAdoptionFormatters[]
-            = {"a", "b", "big", "code", "em", "font", "i", "nobr", "s", "small", "strike", "strong", "tt", "u"};
-    const StringRef HtmlTreeBuilderState::Constants::InBodyEndTableFosters[]
-            = {"table", "tbody", "tfoot", "thead", "tr"};
-    
+    const TagSet HtmlTreeBuilderState::Constants::InBodyStartOptions
+            = makeTagSet(CSOUP_TAG_OPTGROUP, CSOUP_TAG_OPTION);
+    const TagSet HtmlTreeBuilderState::Constants::InBodyStartRuby
+            = makeTagSet(CSOUP_TAG_RP, CSOUP_TAG_RT);
+    const TagSet HtmlTreeBuilderState::Constants::InBodyStartDrop
+            = makeTagSet(CSOUP_TAG_CAPTION, CSOUP_TAG_COL, CSOUP_TAG_COLGROUP, CSOUP_TAG_FRAME, CSOUP_TAG_HEAD,
+                CSOUP_TAG_TBODY, CSOUP_TAG_TD, CSOUP_TAG_TFOOT, CSOUP_TAG_TH, CSOUP_TAG_THEAD, CSOUP_TAG_TR);
+    const TagSet HtmlTreeBuilderState::Constants::InBodyEndClosers
+            = makeTagSet(CSOUP_TAG_ADDRESS, CSOUP_TAG_ARTICLE, CSOUP_TAG_ASIDE, CSOUP_TAG_BLOCKQUOTE, CSOUP_TAG_BUTTON,
+                CSOUP_TAG_CENTER, CSOUP_TAG_DETAILS, CSOUP_TAG_DIR, CSOUP_TAG_DIV, CSOUP_TAG_DL,
+                CSOUP_TAG_FIELDSET, CSOUP_TAG_FIGCAPTION, CSOUP_TAG_FIGURE, CSOUP_TAG_FOOTER, CSOUP_TAG_HEADER,
+                CSOUP_TAG_HGROUP, CSOUP_TAG_LISTING, CSOUP_TAG_MENU, CSOUP_TAG_NAV, CSOUP_TAG_OL, CSOUP_TAG_PRE,
+                CSOUP_TAG_SECTION, CSOUP_TAG_SUMMARY, CSOUP_TAG_UL);
+    const TagSet HtmlTreeBuilderState::Constants::InBodyEndAdoptionFormatters
+            = makeTagSet(CSOUP_TAG_A, CSOUP_TAG_B, CSOUP_TAG_BIG, CSOUP_TAG_CODE, CSOUP_TAG_EM, CSOUP_TAG_FONT, CSOUP_TAG_I,
+                CSOUP_TAG_NOBR, CSOUP_TAG_S, CSOUP_TAG_SMALL, CSOUP_TAG_STRIKE, CSOUP_TAG_STRONG, CSOUP_TAG_TT,
+                CSOUP_TAG_U);
+    const TagSet HtmlTreeBuilderState::Constants::InBodyEndTableFosters
+            = makeTagSet(CSOUP_TAG_TABLE, CSOUP_TAG_TBODY, CSOUP_TAG_TFOOT, CSOUP_TAG_THEAD, CSOUP_TAG_TR);
+    const TagSet HtmlTreeBuilderState::Constants::HeadBodyHtmlBr
+            = makeTagSet(CSOUP_TAG_HEAD, CSOUP_TAG_BODY, CSOUP_TAG_HTML, CSOUP_TAG_BR);
+    const TagSet HtmlTreeBuilderState::Constants::BodyHtmlBr
+            = makeTagSet(CSOUP_TAG_BODY, CSOUP_TAG_HTML, CSOUP_TAG_BR);
+    const TagSet HtmlTreeBuilderState::Constants::BodyHtml
+            = makeTagSet(CSOUP_TAG_BODY, CSOUP_TAG_HTML);
+    const TagSet HtmlTreeBuilderState::Constants::InHeadEmpty
+            = makeTagSet(CSOUP_TAG_BASE, CSOUP_TAG_BASEFONT, CSOUP_TAG_BGSOUND, CSOUP_TAG_COMMAND, CSOUP_TAG_LINK);
+    const TagSet HtmlTreeBuilderState::Constants::InHeadRaw
+            = makeTagSet(CSOUP_TAG_NOFRAMES, CSOUP_TAG_STYLE);
+    const TagSet HtmlTreeBuilderState::Constants::InHeadNoscriptToHead
+            = makeTagSet(CSOUP_TAG_BASEFONT, CSOUP_TAG_BGSOUND, CSOUP_TAG_LINK, CSOUP_TAG_META, CSOUP_TAG_NOFRAMES,
+                CSOUP_TAG_STYLE);
+    const TagSet HtmlTreeBuilderState::Constants::InHeadNoscriptIgnored
+            = makeTagSet(CSOUP_TAG_HEAD, CSOUP_TAG_NOSCRIPT);
+    const TagSet HtmlTreeBuilderState::Constants::AfterHeadToHead
+            = makeTagSet(CSOUP_TAG_BASE, CSOUP_TAG_BASEFONT, CSOUP_TAG_BGSOUND, CSOUP_TAG_LINK, CSOUP_TAG_META,
+                CSOUP_TAG_NOFRAMES, CSOUP_TAG_SCRIPT, CSOUP_TAG_STYLE, CSOUP_TAG_TITLE);
+    const TagSet HtmlTreeBuilderState::Constants::TableSections
+            = makeTagSet(CSOUP_TAG_TBODY, CSOUP_TAG_TFOOT, CSOUP_TAG_THEAD);
+    const TagSet HtmlTreeBuilderState::Constants::TableRowsAndCells
+            = makeTagSet(CSOUP_TAG_TD, CSOUP_TAG_TH, CSOUP_TAG_TR);
+    const TagSet HtmlTreeBuilderState::Constants::TableCells
+            = makeTagSet(CSOUP_TAG_TD, CSOUP_TAG_TH);
+    const TagSet HtmlTreeBuilderState::Constants::InTableStartScripts
+            = makeTagSet(CSOUP_TAG_STYLE, CSOUP_TAG_SCRIPT);
+    const TagSet HtmlTreeBuilderState::Constants::InTableEndErrors
+            = makeTagSet(CSOUP_TAG_BODY, CSOUP_TAG_CAPTION, CSOUP_TAG_COL, CSOUP_TAG_COLGROUP, CSOUP_TAG_HTML,
+                CSOUP_TAG_TBODY, CSOUP_TAG_TD, CSOUP_TAG_TFOOT, CSOUP_TAG_TH, CSOUP_TAG_THEAD, CSOUP_TAG_TR);
+    const TagSet HtmlTreeBuilderState::Constants::TableStructure
+            = makeTagSet(CSOUP_TAG_CAPTION, CSOUP_TAG_COL, CSOUP_TAG_COLGROUP, CSOUP_TAG_TBODY, CSOUP_TAG_TD,
+                CSOUP_TAG_TFOOT, CSOUP_TAG_TH, CSOUP_TAG_THEAD, CSOUP_TAG_TR);
+    const TagSet HtmlTreeBuilderState::Constants::InCaptionEndErrors
+            = makeTagSet(CSOUP_TAG_BODY, CSOUP_TAG_COL, CSOUP_TAG_COLGROUP, CSOUP_TAG_HTML, CSOUP_TAG_TBODY,
+                CSOUP_TAG_TD, CSOUP_TAG_TFOOT, CSOUP_TAG_TH, CSOUP_TAG_THEAD, CSOUP_TAG_TR);
+    const TagSet HtmlTreeBuilderState::Constants::InTableBodyStartExits
+            = makeTagSet(CSOUP_TAG_CAPTION, CSOUP_TAG_COL, CSOUP_TAG_COLGROUP, CSOUP_TAG_TBODY, CSOUP_TAG_TFOOT,
+                CSOUP_TAG_THEAD);
+    const TagSet HtmlTreeBuilderState::Constants::InTableBodyEndErrors
+            = makeTagSet(CSOUP_TAG_BODY, CSOUP_TAG_CAPTION, CSOUP_TAG_COL, CSOUP_TAG_COLGROUP, CSOUP_TAG_HTML,
+                CSOUP_TAG_TD, CSOUP_TAG_TH, CSOUP_TAG_TR);
+    const TagSet HtmlTreeBuilderState::Constants::InRowStartExits
+            = makeTagSet(CSOUP_TAG_CAPTION, CSOUP_TAG_COL, CSOUP_TAG_COLGROUP, CSOUP_TAG_TBODY, CSOUP_TAG_TFOOT,
+                CSOUP_TAG_THEAD, CSOUP_TAG_TR);
+    const TagSet HtmlTreeBuilderState::Constants::InRowEndErrors
+            = makeTagSet(CSOUP_TAG_BODY, CSOUP_TAG_CAPTION, CSOUP_TAG_COL, CSOUP_TAG_COLGROUP, CSOUP_TAG_HTML,
+                CSOUP_TAG_TD, CSOUP_TAG_TH);
+    const TagSet HtmlTreeBuilderState::Constants::InCellEndErrors
+            = makeTagSet(CSOUP_TAG_BODY, CSOUP_TAG_CAPTION, CSOUP_TAG_COL, CSOUP_TAG_COLGROUP, CSOUP_TAG_HTML);
+    const TagSet HtmlTreeBuilderState::Constants::InSelectStartInputs
+            = makeTagSet(CSOUP_TAG_INPUT, CSOUP_TAG_KEYGEN, CSOUP_TAG_TEXTAREA);
+    const TagSet HtmlTreeBuilderState::Constants::InSelectInTableExits
+            = makeTagSet(CSOUP_TAG_CAPTION, CSOUP_TAG_TABLE, CSOUP_TAG_TBODY, CSOUP_TAG_TFOOT, CSOUP_TAG_THEAD,
+                CSOUP_TAG_TR, CSOUP_TAG_TD, CSOUP_TAG_TH);
+
     HtmlTreeBuilderState::TokenDeleter::~TokenDeleter() {
         CSOUP_DELETE(allocator_, token_);
     }
@@ -67,9 +131,6 @@ namespace csoup {
             StringRef data = ((CharacterToken*)t)->data();
             for (size_t i = 0; i < data.size(); ++ i) {
                 if (!StringUtil::isWhitespace(data.at(i))) {
-                    // In UTF-8, this should be only 1 byte;
-                    
-                    CSOUP_ASSERT(data.size() == 1);
                     return false;
                 }
             }
@@ -81,38 +142,44 @@ namespace csoup {
     
     void HtmlTreeBuilderState::handleRawtext(StartTagToken *startTag, HtmlTreeBuilder *tb) {
         tb->insert(startTag);
+        tb->setTokeniserState(internal::RawText::instance());
+        tb->markInsertionMode();
+        tb->transition(Text::instance());
     }
     
     void HtmlTreeBuilderState::handleRcData(csoup::StartTagToken *startTag, csoup::HtmlTreeBuilder *tb) {
-        
+        tb->insert(startTag);
+        tb->setTokeniserState(internal::Rcdata::instance());
+        tb->markInsertionMode();
+        tb->transition(Text::instance());
     }
     
     bool HtmlTreeBuilderState::processExtraToken(csoup::Token *token, csoup::HtmlTreeBuilder *tb) {
         bool ret = tb->process(token);
-        CSOUP_DELETE(tb->allocator(), token);
+        CSOUP_DELETE(tb->scratchAllocator(), token);
         return ret;
     }
     
     bool HtmlTreeBuilderState::processExtraEndTagToken(const StringRef &tagName, HtmlTreeBuilder *tb) {
-        EndTagToken* endToken = CSOUP_NEW2(tb->allocator(), EndTagToken, tagName, tb->allocator());
+        EndTagToken* endToken = CSOUP_NEW2(tb->scratchAllocator(), EndTagToken, tagName, tb->scratchAllocator());
         bool ret = tb->process(endToken);
-        CSOUP_DELETE(tb->allocator(), endToken);
+        CSOUP_DELETE(tb->scratchAllocator(), endToken);
         
         return ret;
     }
     
     bool HtmlTreeBuilderState::processExtraStartTagToken(const StringRef &tagName, HtmlTreeBuilder *tb) {
-        StartTagToken* startToken = CSOUP_NEW2(tb->allocator(), StartTagToken, tagName, tb->allocator());
+        StartTagToken* startToken = CSOUP_NEW2(tb->scratchAllocator(), StartTagToken, tagName, tb->scratchAllocator());
         bool ret = tb->process(startToken);
-        CSOUP_DELETE(tb->allocator(), startToken);
+        CSOUP_DELETE(tb->scratchAllocator(), startToken);
         
         return ret;
     }
     
     bool HtmlTreeBuilderState::processExtraCharToken(const StringRef& data, HtmlTreeBuilder* tb) {
-        CharacterToken* charToken = CSOUP_NEW2(tb->allocator(), CharacterToken, data, tb->allocator());
+        CharacterToken* charToken = CSOUP_NEW2(tb->scratchAllocator(), CharacterToken, data, tb->scratchAllocator());
         bool ret = tb->process(charToken);
-        CSOUP_DELETE(tb->allocator(), charToken);
+        CSOUP_DELETE(tb->scratchAllocator(), charToken);
         
         return ret;
     }
@@ -154,10 +221,10 @@ namespace csoup {
             tb->insert(t->asCommentToken());
         } else if (isWhitespace(t)) {
             return true; // ignore whitespace
-        } else if (t->isStartTagToken() && t->asStartTagToken()->tagName().equals("html")) {
+        } else if (t->isStartTagToken() && t->asStartTagToken()->tagId() == CSOUP_TAG_HTML) {
             tb->insert(t->asStartTagToken());
             tb->transition(BeforeHead::instance());
-        } else if (t->isEndTagToken() && (StringUtil::in(t->asEndTagToken()->tagName(), "head", "body", "html", "br"))) {
+        } else if (t->isEndTagToken() && Constants::HeadBodyHtmlBr.contains(t->asEndTagToken()->tagId())) {
             tb->insert("html");
             tb->transition(BeforeHead::instance());
             return tb->process(t);
@@ -183,13 +250,13 @@ namespace csoup {
         } else if (t->isDoctypeToken()) {
             tb->error(this);
             return false;
-        } else if (t->isStartTagToken() && t->asStartTagToken()->tagName().equals("html")) {
+        } else if (t->isStartTagToken() && t->asStartTagToken()->tagId() == CSOUP_TAG_HTML) {
             return InBody::instance()->process(t, tb); // does not transition
-        } else if (t->isStartTagToken() && t->asStartTagToken()->tagName().equals("head")) {
+        } else if (t->isStartTagToken() && t->asStartTagToken()->tagId() == CSOUP_TAG_HEAD) {
             Element* head = tb->insert(t->asStartTagToken());
             tb->setHeadElement(head, false);
             tb->transition(InHead::instance());
-        } else if (t->isEndTagToken() && (StringUtil::in(t->asEndTagToken()->tagName(), "head", "body", "html", "br"))) {
+        } else if (t->isEndTagToken() && Constants::HeadBodyHtmlBr.contains(t->asEndTagToken()->tagId())) {
             processExtraStartTagToken("head", tb);
             return tb->process(t);
         } else if (t->isEndTagToken()) {
@@ -204,7 +271,7 @@ namespace csoup {
     
 #define INHEAD_STATE_ANYTHINGELSE \
     do { \
-        processExtraStartTagToken("head", tb); \
+        processExtraEndTagToken("head", tb); \
         return tb->process(t); \
     } while(false)
 
@@ -224,33 +291,33 @@ namespace csoup {
                return false;
            case CSOUP_TOKEN_START_TAG: {
                StartTagToken* start = t->asStartTagToken();
-               StringRef name = start->tagName();
-               if (name.equals("html")) {
+               TagIdEnum id = start->tagId();
+               if (id == CSOUP_TAG_HTML) {
                    return InBody::instance()->process(t, tb);
-               } else if (StringUtil::in(name, "base", "basefont", "bgsound", "command", "link")) {
+               } else if (Constants::InHeadEmpty.contains(id)) {
                    Element* el = tb->insertEmpty(start);
                    // jsoup special: update base the frist time it is seen
-                   if (name.equals("base") && el->hasAttribute("href"))
+                   if (id == CSOUP_TAG_BASE && el->hasAttribute("href"))
                        tb->maybeSetBaseUri(el);
-               } else if (name.equals("meta")) {
+               } else if (id == CSOUP_TAG_META) {
                    //Element* meta = tb->insertEmpty(start);
                    // todo: charset switches
-               } else if (name.equals("title")) {
+               } else if (id == CSOUP_TAG_TITLE) {
                    handleRcData(start, tb);
-               } else if (StringUtil::in(name, "noframes", "style")) {
+               } else if (Constants::InHeadRaw.contains(id)) {
                    handleRawtext(start, tb);
-               } else if (name.equals("noscript")) {
+               } else if (id == CSOUP_TAG_NOSCRIPT) {
                    // else if noscript && scripting flag = true: rawtext (jsoup doesn't run script, to handle as noscript)
                    tb->insert(start);
                    tb->transition(InHeadNoscript::instance());
-               } else if (name.equals("script")) {
+               } else if (id == CSOUP_TAG_SCRIPT) {
                    // skips some script rules as won't execute them
                    
                    tb->setTokeniserState(internal::ScriptData::instance());
                    tb->markInsertionMode();
                    tb->transition(Text::instance());
                    tb->insert(start);
-               } else if (name.equals("head")) {
+               } else if (id == CSOUP_TAG_HEAD) {
                    tb->error(this);
                    return false;
                } else {
@@ -259,12 +326,11 @@ namespace csoup {
                break;
            }
            case CSOUP_TOKEN_END_TAG: {
-               EndTagToken* end = t->asEndTagToken();
-               StringRef name = end->tagName();
-               if (name.equals("head")) {
+               TagIdEnum id = t->asEndTagToken()->tagId();
+               if (id == CSOUP_TAG_HEAD) {
                    tb->pop();
                    tb->transition(AfterHead::instance());
-               } else if (StringUtil::in(name, "body", "html", "br")) {
+               } else if (Constants::BodyHtmlBr.contains(id)) {
                    INHEAD_STATE_ANYTHINGELSE;
                } else {
                    tb->error(this);
@@ -293,18 +359,17 @@ do { \
        
        if (t->isDoctypeToken()) {
            tb->error(this);
-       } else if (t->isStartTagToken() && internal::strEquals(t->asStartTagToken()->tagName(),"html")) {
+       } else if (t->isStartTagToken() && t->asStartTagToken()->tagId() == CSOUP_TAG_HTML) {
            return tb->process(t, InBody::instance());
-       } else if (t->isEndTagToken() && internal::strEquals(t->asEndTagToken()->tagName(),"noscript")) {
+       } else if (t->isEndTagToken() && t->asEndTagToken()->tagId() == CSOUP_TAG_NOSCRIPT) {
            tb->pop();
            tb->transition(InHead::instance());
        } else if (isWhitespace(t) || t->asCommentToken() ||
-                  (t->isStartTagToken() && StringUtil::in(t->asStartTagToken()->tagName(),
-                                                            "basefont", "bgsound", "link", "meta", "noframes", "style"))) {
+                  (t->isStartTagToken() && Constants::InHeadNoscriptToHead.contains(t->asStartTagToken()->tagId()))) {
            return tb->process(t, InHead::instance());
-       } else if (t->isEndTagToken() && internal::strEquals(t->asEndTagToken()->tagName(),"br")) {
+       } else if (t->isEndTagToken() && t->asEndTagToken()->tagId() == CSOUP_TAG_BR) {
            IHEADNOSCRIPT_ANYTHINGELSE;
-       } else if ((t->isStartTagToken() && StringUtil::in(t->asStartTagToken()->tagName(), "head", "noscript")) || t->isEndTagToken()) {
+       } else if ((t->isStartTagToken() && Constants::InHeadNoscriptIgnored.contains(t->asStartTagToken()->tagId())) || t->isEndTagToken()) {
            tb->error(this);
            return false;
        } else {
@@ -326,19 +391,18 @@ do { \
            tb->error(this);
        } else if (t->isStartTagToken()) {
            StartTagToken* startTag = t->asStartTagToken();
-           StringRef name = startTag->tagName();
-           static const StringRef tagsInHead[] = {"base", "basefont", "bgsound", "link", "meta", "noframes", "script", "style", "title"};
+           TagIdEnum id = startTag->tagId();
            
-           if (name.equals(StringRef("html"))) {
+           if (id == CSOUP_TAG_HTML) {
                return tb->process(t, InBody::instance());
-           } else if (name.equals("body")) {
+           } else if (id == CSOUP_TAG_BODY) {
                tb->insert(startTag);
                tb->setFramesetOk(false);
                tb->transition(InBody::instance());
-           } else if (name.equals("frameset")) {
+           } else if (id == CSOUP_TAG_FRAMESET) {
                tb->insert(startTag);
                tb->transition(InFrameset::instance());
-           } else if (StringUtil::in(name, tagsInHead, arrayLength(tagsInHead))) {
+           } else if (Constants::AfterHeadToHead.contains(id)) {
                tb->error(this);
                
                // temporarily add it to top of the stack and process, then remove it
@@ -346,7 +410,7 @@ do { \
                tb->push(head);
                tb->process(t, InHead::instance());
                tb->removeFromStack(head, false);
-           } else if (name.equals("head")) {
+           } else if (id == CSOUP_TAG_HEAD) {
                tb->error(this);
                return false;
            } else {
@@ -355,7 +419,7 @@ do { \
                return tb->process(t);
            }
        } else if (t->isEndTagToken()) {
-           if (StringUtil::in(t->asEndTagToken()->tagName(), "body", "html")) {
+           if (Constants::BodyHtml.contains(t->asEndTagToken()->tagId())) {
                processExtraStartTagToken("body", tb);
                tb->setFramesetOk(true);
                return tb->process(t);
@@ -374,12 +438,9 @@ do { \
     
     bool InBodyAnyOtherEndTag(HtmlTreeBuilderState* state, Token* t, HtmlTreeBuilder* tb) {
         StringRef name = t->asEndTagToken()->tagName();
-        internal::Vector<Element*>* stack = tb->stack();
-        internal::VectorIterator<Element*> it = stack->end();
-        while (it.hasPrevious()) {
-            it.previous();
-            
-            Element* node = *it.data();
+        ElementStack* stack = tb->stack();
+        for (size_t i = stack->size(); i > 0; -- i) {
+            Element* node = *stack->at(i - 1);
             if (node->tagName().equals(name)) {
                 tb->generateImpliedEndTags(name);
                 if (!name.equals(tb->currentElement()->tagName()))
@@ -427,34 +488,31 @@ do { \
            case CSOUP_TOKEN_START_TAG: {
                StartTagToken* startTag = t->asStartTagToken();
                StringRef name = startTag->tagName();
-               if (name.equals("html")) {
+               TagIdEnum id = startTag->tagId();
+               if (id == CSOUP_TAG_HTML) {
                    tb->error(this);
                    // merge attributes onto real html
                    Element* html = *tb->stack()->front();
-                   Attributes* attrsOfStartTag = startTag->attributes();
-                   for (size_t i = 0; i < attrsOfStartTag->size(); ++ i) {
-                       const Attribute* attr = attrsOfStartTag->get(i);
-                       if (!html->hasAttribute(attr->key())) {
-                           html->addAttribute(attr->key(), attr->value());
+                   for (size_t i = 0; i < startTag->attributeCount(); ++ i) {
+                       if (!html->hasAttribute(startTag->attributeKey(i))) {
+                           html->addAttribute(startTag->attributeKey(i), startTag->attributeValue(i));
                        }
                    }
-               } else if (StringUtil::in(name, Constants::InBodyStartToHead, arrayLength(Constants::InBodyStartToHead))) {
+               } else if (Constants::InBodyStartToHead.contains(id)) {
                    return tb->process(t, InHead::instance());
-               } else if (name.equals("body")) {
+               } else if (id == CSOUP_TAG_BODY) {
                    tb->error(this);
-                   internal::Vector<Element*>* stack = tb->stack();
-                   if (stack->size() == 1 || (stack->size() > 2 && !(*stack->at(1))->tagName().equals("body"))) {
+                   ElementStack* stack = tb->stack();
+                   if (stack->size() == 1 || (stack->size() > 2 && (*stack->at(1))->tagId() != CSOUP_TAG_BODY)) {
                        // only in fragment case
                        return false; // ignore
                    } else {
                        tb->setFramesetOk(false);
                        Element* body = *stack->at(1);
                        
-                       Attributes* attrsOfStartTag = startTag->attributes();
-                       for (size_t i = 0; i < attrsOfStartTag->size(); ++ i) {
-                           const Attribute* attr = attrsOfStartTag->get(i);
-                           if (!body->hasAttribute(attr->key())) {
-                               body->addAttribute(attr->key(), attr->value());
+                       for (size_t i = 0; i < startTag->attributeCount(); ++ i) {
+                           if (!body->hasAttribute(startTag->attributeKey(i))) {
+                               body->addAttribute(startTag->attributeKey(i), startTag->attributeValue(i));
                            }
                        }
                        
@@ -463,10 +521,10 @@ do { \
 //                               body.attributes().put(attribute);
 //                       }
                    }
-               } else if (name.equals("frameset")) {
+               } else if (id == CSOUP_TAG_FRAMESET) {
                    tb->error(this);
-                   internal::Vector<Element*>* stack = tb->stack();
-                   if (stack->size() == 1 || (stack->size() > 2 && !(*stack->at(1))->tagName().equals("body"))) {
+                   ElementStack* stack = tb->stack();
+                   if (stack->size() == 1 || (stack->size() > 2 && (*stack->at(1))->tagId() != CSOUP_TAG_BODY)) {
                        // only in fragment case
                        return false; // ignore
                    } else if (!tb->framesetOk()) {
@@ -482,28 +540,28 @@ do { \
                        tb->insert(startTag);
                        tb->transition(InFrameset::instance());
                    }
-               } else if (StringUtil::in(name, Constants::InBodyStartPClosers, arrayLength(Constants::InBodyEndAdoptionFormatters))) {
+               } else if (Constants::InBodyStartPClosers.contains(id)) {
                    if (tb->inButtonScope("p")) {
                        processExtraEndTagToken("p", tb);
                    }
                    tb->insert(startTag);
-               } else if (StringUtil::in(name, Constants::Headings, arrayLength(Constants::Headings))) {
+               } else if (Constants::Headings.contains(id)) {
                    if (tb->inButtonScope("p")) {
                        processExtraEndTagToken("p", tb);
                    }
-                   if (StringUtil::in(tb->currentElement()->tagName(), Constants::Headings, arrayLength(Constants::Headings))) {
+                   if (Constants::Headings.contains(tb->currentElement()->tagId())) {
                        tb->error(this);
                        tb->pop();
                    }
                    tb->insert(startTag);
-               } else if (StringUtil::in(name, Constants::InBodyStartPreListing, arrayLength(Constants::InBodyStartPreListing))) {
+               } else if (Constants::InBodyStartPreListing.contains(id)) {
                    if (tb->inButtonScope("p")) {
                        processExtraEndTagToken("p", tb);
                    }
                    tb->insert(startTag);
                    // todo: ignore LF if next token
                    tb->setFramesetOk(false);
-               } else if (name.equals("form")) {
+               } else if (id == CSOUP_TAG_FORM) {
                    if (tb->formElement() != NULL) {
                        tb->error(this);
                        return false;
@@ -513,50 +571,47 @@ do { \
                        processExtraEndTagToken("p", tb);
                    }
                    
-                   tb->insert(startTag);
                    tb->insertForm(startTag, true);
-               } else if (name.equals("li")) {
+               } else if (id == CSOUP_TAG_LI) {
                    tb->setFramesetOk(false);
-                   internal::Vector<Element*>* stack = tb->stack();
+                   ElementStack* stack = tb->stack();
                    for (size_t i = stack->size(); i > 1; i--) {
                        Element* el = *stack->at(i - 1);
-                       if (el->tagName().equals("li")) {
+                       if (el->tagId() == CSOUP_TAG_LI) {
                            processExtraEndTagToken("li", tb);
                            break;
                        }
-                       if (tb->isSpecial(el) && !StringUtil::in(el->tagName(), Constants::InBodyStartLiBreakers,
-                                                                arrayLength(Constants::InBodyStartLiBreakers)))
+                       if (tb->isSpecial(el) && !Constants::InBodyStartLiBreakers.contains(el->tagId()))
                            break;
                    }
                    if (tb->inButtonScope("p")) {
                        processExtraEndTagToken("p", tb);
                    }
                    tb->insert(startTag);
-               } else if (StringUtil::in(name, Constants::DdDt, arrayLength(Constants::DdDt))) {
+               } else if (Constants::DdDt.contains(id)) {
                    tb->setFramesetOk(false);
-                   internal::Vector<Element*>* stack = tb->stack();
+                   ElementStack* stack = tb->stack();
                    for (size_t i = stack->size(); i > 1; i--) {
                        Element* el = *stack->at(i - 1);
-                       if (StringUtil::in(el->tagName(), Constants::DdDt, arrayLength(Constants::DdDt))) {
+                       if (Constants::DdDt.contains(el->tagId())) {
                            processExtraEndTagToken(el->tagName(), tb);
                            
                            break;
                        }
-                       if (tb->isSpecial(el) && !StringUtil::in(el->tagName(), Constants::InBodyStartLiBreakers,
-                                                                arrayLength(Constants::InBodyStartLiBreakers)))
+                       if (tb->isSpecial(el) && !Constants::InBodyStartLiBreakers.contains(el->tagId()))
                            break;
                    }
                    if (tb->inButtonScope("p")) {
                        processExtraEndTagToken("p", tb);
                    }
                    tb->insert(startTag);
-               } else if (name.equals("plaintext")) {
+               } else if (id == CSOUP_TAG_PLAINTEXT) {
                    if (tb->inButtonScope("p")) {
                        processExtraEndTagToken("p", tb);
                    }
                    tb->insert(startTag);
                    tb->setTokeniserState(internal::PlainText::instance()); // once in, never gets out
-               } else if (name.equals("button")) {
+               } else if (id == CSOUP_TAG_BUTTON) {
                    if (tb->inButtonScope("button")) {
                        // close and reprocess
                        tb->error(this);
@@ -568,7 +623,7 @@ do { \
                        tb->insert(startTag);
                        tb->setFramesetOk(false);
                    }
-               } else if (name.equals("a")) {
+               } else if (id == CSOUP_TAG_A) {
                    if (tb->getActiveFormattingElement("a") != NULL) {
                        tb->error(this);
                        
@@ -584,11 +639,11 @@ do { \
                    tb->reconstructFormattingElements(false);
                    Element* a = tb->insert(startTag);
                    tb->pushActiveFormattingElements(a, false);
-               } else if (StringUtil::in(name, Constants::Formatters, arrayLength(Constants::Formatters))) {
+               } else if (Constants::Formatters.contains(id)) {
                    tb->reconstructFormattingElements(false);
                    Element* el = tb->insert(startTag);
                    tb->pushActiveFormattingElements(el, false);
-               } else if (name.equals("nobr")) {
+               } else if (id == CSOUP_TAG_NOBR) {
                    tb->reconstructFormattingElements(false);
                    if (tb->inScope("nobr")) {
                        tb->error(this);
@@ -599,31 +654,30 @@ do { \
                    }
                    Element* el = tb->insert(startTag);
                    tb->pushActiveFormattingElements(el, false);
-               } else if (StringUtil::in(name, Constants::InBodyStartApplets,arrayLength(Constants::InBodyStartApplets))) {
+               } else if (Constants::InBodyStartApplets.contains(id)) {
                    tb->reconstructFormattingElements(false);
                    tb->insert(startTag);
                    tb->insertMarkerToFormattingElements();
                    tb->setFramesetOk(false);
-               } else if (name.equals("table")) {
+               } else if (id == CSOUP_TAG_TABLE) {
                    if (tb->document()->quirksMode() != CSOUP_DOCTYPE_QUIRKS && tb->inButtonScope("p")) {
                        processExtraEndTagToken("p", tb);
                    }
                    tb->insert(startTag);
                    tb->setFramesetOk(false);
                    tb->transition(InTable::instance());
-               } else if (StringUtil::in(name, Constants::InBodyStartEmptyFormatters,
-                                         arrayLength(Constants::InBodyStartEmptyFormatters))) {
+               } else if (Constants::InBodyStartEmptyFormatters.contains(id)) {
                    tb->reconstructFormattingElements(false);
                    tb->insertEmpty(startTag);
                    tb->setFramesetOk(false);
-               } else if (name.equals("input")) {
+               } else if (id == CSOUP_TAG_INPUT) {
                    tb->reconstructFormattingElements(false);
                    Element* el = tb->insertEmpty(startTag);
                    if (!el->attr("type").equalsIgnoreCase("hidden"))
                        tb->setFramesetOk(false);
-               } else if (StringUtil::in(name, Constants::InBodyStartMedia, arrayLength(Constants::InBodyStartMedia))) {
+               } else if (Constants::InBodyStartMedia.contains(id)) {
                    tb->insertEmpty(startTag);
-               } else if (name.equals("hr")) {
+               } else if (id == CSOUP_TAG_HR) {
                    if (tb->inButtonScope("p")) {
                        processExtraEndTagToken("p", tb);
                    }
@@ -635,7 +689,7 @@ do { \
                        return tb->process(startTag); // change <image> to <img>, unless in svg
                    } else
                        tb->insert(startTag);
-               } else if (name.equals("isindex")) {
+               } else if (id == CSOUP_TAG_ISINDEX) {
                    // how much do we care about the early 90s?
                    tb->error(this);
                    if (tb->formElement() != NULL)
@@ -643,7 +697,7 @@ do { \
                    
                    tb->tokeniser()->setAcknowledgeSelfClosingFlag();
                    processExtraStartTagToken("form", tb);
-                   if (startTag->attributes()->hasAttribute("action")) {
+                   if (startTag->hasAttribute("action")) {
                        Element* form = tb->formElement();
                        form->addAttribute("action", startTag->attribute("action"));
                    }
@@ -651,50 +705,48 @@ do { \
                    processExtraStartTagToken("hr", tb);
                    processExtraStartTagToken("label", tb);
                    // hope you like english.
-                   StringRef prompt = startTag->attributes()->hasAttribute("prompt") ?
-                                    startTag->attributes()->get("prompt") :
+                   StringRef prompt = startTag->hasAttribute("prompt") ?
+                                    startTag->attribute("prompt") :
                                     "This is a searchable index. Enter search keywords: ";
                    
                    processExtraCharToken(prompt, tb);
                    
                    // input
-                   Attributes inputAttribs(tb->allocator());
-                   Attributes* attrsOfStartTag = startTag->attributes();
-                   for (size_t i = 0; i < attrsOfStartTag->size(); ++ i) {
-                       const Attribute* attr = attrsOfStartTag->get(i);
-                       if (!StringUtil::in(attr->key(), Constants::InBodyStartInputAttribs,
+                   StartTagToken* input = CSOUP_NEW2(tb->scratchAllocator(), StartTagToken, "input", tb->scratchAllocator());
+                   for (size_t i = 0; i < startTag->attributeCount(); ++ i) {
+                       if (!StringUtil::in(startTag->attributeKey(i), Constants::InBodyStartInputAttribs,
                                            arrayLength(Constants::InBodyStartInputAttribs))) {
-                           inputAttribs.addAttribute(attr->key(), attr->value());
+                           input->addAttribute(startTag->attributeKey(i), startTag->attributeValue(i));
                        }
                    }
                  
-                   inputAttribs.addAttribute("name", "isindex");
+                   input->addAttribute("name", "isindex");
                    
-                   processExtraToken(CSOUP_NEW3(tb->allocator(), StartTagToken, "input", inputAttribs, tb->allocator()), tb);
+                   processExtraToken(input, tb);
                    processExtraEndTagToken("label", tb);
                    processExtraStartTagToken("hr", tb);
                    processExtraEndTagToken("form", tb);
-               } else if (name.equals("textarea")) {
+               } else if (id == CSOUP_TAG_TEXTAREA) {
                    tb->insert(startTag);
                    // todo: If the next token is a U+000A LINE FEED (LF) character token, then ignore that token and move on to the next one. (Newlines at the start of textarea elements are ignored as an authoring convenience.)
                    tb->setTokeniserState(internal::Rcdata::instance());
                    tb->markInsertionMode();
                    tb->setFramesetOk(false);
                    tb->transition(Text::instance());
-               } else if (name.equals("xmp")) {
+               } else if (id == CSOUP_TAG_XMP) {
                    if (tb->inButtonScope("p")) {
                        processExtraEndTagToken("p", tb);
                    }
                    tb->reconstructFormattingElements(false);
                    tb->setFramesetOk(false);
                    handleRawtext(startTag, tb);
-               } else if (name.equals("iframe")) {
+               } else if (id == CSOUP_TAG_IFRAME) {
                    tb->setFramesetOk(false);
                    handleRawtext(startTag, tb);
-               } else if (name.equals("noembed")) {
+               } else if (id == CSOUP_TAG_NOEMBED) {
                    // also handle noscript if script enabled
                    handleRawtext(startTag, tb);
-               } else if (name.equals("select")) {
+               } else if (id == CSOUP_TAG_SELECT) {
                    tb->reconstructFormattingElements(false);
                    tb->insert(startTag);
                    tb->setFramesetOk(false);
@@ -704,31 +756,31 @@ do { \
                        tb->transition(InSelectInTable::instance());
                    else
                        tb->transition(InSelect::instance());
-               } else if (StringUtil::in(name, Constants::InBodyStartOptions, arrayLength(Constants::InBodyStartOptions))) {
-                   if (tb->currentElement()->tagName().equals("option"))
+               } else if (Constants::InBodyStartOptions.contains(id)) {
+                   if (tb->currentElement()->tagId() == CSOUP_TAG_OPTION)
                        processExtraEndTagToken("option", tb);
                    tb->reconstructFormattingElements(false);
                    tb->insert(startTag);
-               } else if (StringUtil::in(name, Constants::InBodyStartRuby, arrayLength(Constants::InBodyStartRuby))) {
+               } else if (Constants::InBodyStartRuby.contains(id)) {
                    if (tb->inScope("ruby")) {
                        tb->generateImpliedEndTags(false);
-                       if (!tb->currentElement()->tagName().equals("ruby")) {
+                       if (tb->currentElement()->tagId() != CSOUP_TAG_RUBY) {
                            tb->error(this);
                            tb->popStackToBefore(false, "ruby"); // i.e. close up to but not include name
                        }
                        tb->insert(startTag);
                    }
-               } else if (name.equals("math")) {
+               } else if (id == CSOUP_TAG_MATH) {
                    tb->reconstructFormattingElements(false);
                    // todo: handle A start tag whose tag name is "math" (i.e. foreign, mathml)
                    tb->insert(startTag);
                    tb->tokeniser()->setAcknowledgeSelfClosingFlag();
-               } else if (name.equals("svg")) {
+               } else if (id == CSOUP_TAG_SVG) {
                    tb->reconstructFormattingElements(false);
                    // todo: handle A start tag whose tag name is "svg" (xlink, svg)
                    tb->insert(startTag);
                    tb->tokeniser()->setAcknowledgeSelfClosingFlag();
-               } else if (StringUtil::in(name, Constants::InBodyStartDrop, arrayLength(Constants::InBodyStartDrop))) {
+               } else if (Constants::InBodyStartDrop.contains(id)) {
                    tb->error(this);
                    return false;
                } else {
@@ -740,7 +792,8 @@ do { \
            case CSOUP_TOKEN_END_TAG: {
                EndTagToken* endTag = t->asEndTagToken();
                StringRef name = endTag->tagName();
-               if (name.equals("body")) {
+               TagIdEnum id = endTag->tagId();
+               if (id == CSOUP_TAG_BODY) {
                    if (!tb->inScope("body")) {
                        tb->error(this);
                        return false;
@@ -748,11 +801,11 @@ do { \
                        // todo: error if stack contains something not dd, dt, li, optgroup, option, p, rp, rt, tbody, td, tfoot, th, thead, tr, body, html
                        tb->transition(AfterBody::instance());
                    }
-               } else if (name.equals("html")) {
+               } else if (id == CSOUP_TAG_HTML) {
                    bool notIgnored = processExtraEndTagToken("body", tb);
                    if (notIgnored)
                        return tb->process(endTag);
-               } else if (StringUtil::in(name, Constants::InBodyEndClosers, arrayLength(Constants::InBodyEndClosers))) {
+               } else if (Constants::InBodyEndClosers.contains(id)) {
                    if (!tb->inScope(name)) {
                        // nothing to close
                        tb->error(this);
@@ -763,7 +816,7 @@ do { \
                            tb->error(this);
                        tb->popStackToClose(false, name);
                    }
-               } else if (name.equals("form")) {
+               } else if (id == CSOUP_TAG_FORM) {
                    Element* currentForm = tb->formElement();
                    tb->setFormElement(NULL, false);
                    if (currentForm == NULL || !tb->inScope(name)) {
@@ -776,7 +829,7 @@ do { \
                        // remove currentForm from stack-> will shift anything under up.
                        tb->removeFromStack(currentForm, false);
                    }
-               } else if (name.equals("p")) {
+               } else if (id == CSOUP_TAG_P) {
                    if (!tb->inButtonScope(name)) {
                        tb->error(this);
                        processExtraStartTagToken(name, tb); // if no p to close, creates an empty <p></p>
@@ -787,7 +840,7 @@ do { \
                            tb->error(this);
                        tb->popStackToClose(false, name);
                    }
-               } else if (name.equals("li")) {
+               } else if (id == CSOUP_TAG_LI) {
                    if (!tb->inListItemScope(name)) {
                        tb->error(this);
                        return false;
@@ -797,7 +850,7 @@ do { \
                            tb->error(this);
                        tb->popStackToClose(false, name);
                    }
-               } else if (StringUtil::in(name, Constants::DdDt, arrayLength(Constants::DdDt))) {
+               } else if (Constants::DdDt.contains(id)) {
                    if (!tb->inScope(name)) {
                        tb->error(this);
                        return false;
@@ -807,20 +860,20 @@ do { \
                            tb->error(this);
                        tb->popStackToClose(false, name);
                    }
-               } else if (StringUtil::in(name, Constants::Headings, arrayLength(Constants::Headings))) {
-                   if (!tb->inScope(Constants::Headings, arrayLength(Constants::Headings))) {
+               } else if (Constants::Headings.contains(id)) {
+                   if (!tb->inScope(Constants::Headings)) {
                        tb->error(this);
                        return false;
                    } else {
                        tb->generateImpliedEndTags(name);
                        if (!tb->currentElement()->tagName().equals(name))
                            tb->error(this);
-                       tb->popStackToClose(false, Constants::Headings, arrayLength(Constants::Headings));
+                       tb->popStackToClose(false, Constants::Headings);
                    }
                } else if (name.equals("sarcasm")) {
                    // *sigh*
                    return InBodyAnyOtherEndTag(this, t, tb);
-               } else if (StringUtil::in(name, Constants::InBodyEndAdoptionFormatters, arrayLength(Constants::InBodyEndAdoptionFormatters))) {
+               } else if (Constants::InBodyEndAdoptionFormatters.contains(id)) {
                    // Adoption Agency Algorithm.
                OUTER:
                    for (int i = 0; i < 8; i++) {
@@ -840,7 +893,7 @@ do { \
                        Element* furthestBlock = NULL;
                        Element* commonAncestor = NULL;
                        bool seenFormattingElement = false;
-                       internal::Vector<Element*>* stack = tb->stack();
+                       ElementStack* stack = tb->stack();
                        // the spec doesn't limit to < 64, but in degenerate cases (9000+ stack depth) this prevents
                        // run-aways
                        const size_t stackSize = stack->size();
@@ -874,7 +927,7 @@ do { \
                            } else if (node == formatEl)
                                break;
   
-                           Element* replacement = CSOUP_NEW3(tb->allocator(), Element, node->tagName(), tb->baseUri(), tb->allocator());
+                           Element* replacement = new (tb->mallocNode<Element>()) Element(node->tagName(), tb->sharedBaseUri(), tb->allocator());
                            tb->replaceActiveFormattingElement(node, replacement, false);
                            tb->replaceOnStack(node, replacement, false);
                            node = replacement;
@@ -891,8 +944,7 @@ do { \
                            lastNode = node;
                        }
                        
-                       if (StringUtil::in(commonAncestor->tagName(), Constants::InBodyEndTableFosters,
-                                          arrayLength(Constants::InBodyEndTableFosters))) {
+                       if (Constants::InBodyEndTableFosters.contains(commonAncestor->tagId())) {
                            if (lastNode->parentNode() != NULL)
                                lastNode->removeFromParent(false);
                            tb->insertInFosterParent(lastNode);
@@ -903,14 +955,13 @@ do { \
                            commonAncestor->appendNode(lastNode);
                        }
                        
-                       Element* adopter = CSOUP_NEW3(tb->allocator(), Element, formatEl->tagName(), tb->baseUri(), tb->allocator());
-                       adopter->addAttributes(*formatEl->attributes());
+                       Element* adopter = new (tb->mallocNode<Element>()) Element(formatEl->tagName(), tb->sharedBaseUri(), tb->allocator());
+                       if (formatEl->attributes() != NULL)
+                           adopter->addAttributes(*formatEl->attributes());
                        
-                       for (size_t i = formatEl->childNodeSize(); i > 0; -- i) {
-                           Node* c = formatEl->childNode(i - 1);
+                       while (Node* c = furthestBlock->firstChild()) {
                            c->removeFromParent(false);
-                           // This is very slow
-                           adopter->insertNode(0, c);
+                           adopter->appendNode(c);
                        }
                        
                        furthestBlock->appendNode(adopter);
@@ -920,7 +971,7 @@ do { \
                        tb->insertOnStackAfter(furthestBlock, adopter);
                    }
                //AFTER_OUTER:
-               } else if (StringUtil::in(name, Constants::InBodyStartApplets, arrayLength(Constants::InBodyStartApplets))) {
+               } else if (Constants::InBodyStartApplets.contains(id)) {
                    if (!tb->inScope("name")) {
                        if (!tb->inScope(name)) {
                            tb->error(this);
@@ -932,7 +983,7 @@ do { \
                        tb->popStackToClose(false, name);
                        tb->clearFormattingElementsToLastMarker(false);
                    }
-               } else if (name.equals("br")) {
+               } else if (id == CSOUP_TAG_BR) {
                    tb->error(this);
                    processExtraStartTagToken("br", tb);
                    return false;
@@ -971,8 +1022,9 @@ do { \
     
         bool InTableAnythingElse(HtmlTreeBuilderState* state, Token* t, HtmlTreeBuilder* tb) {
             tb->error(state);
+            static const TagSet fosters = makeTagSet(CSOUP_TAG_TABLE, CSOUP_TAG_TBODY, CSOUP_TAG_TFOOT, CSOUP_TAG_THEAD, CSOUP_TAG_TR);
             bool processed = true;
-            if (StringUtil::in(tb->currentElement()->tagName(), "table", "tbody", "tfoot", "thead", "tr")) {
+            if (fosters.contains(tb->currentElement()->tagId())) {
                 tb->setFosterInserts(true);
                 processed = tb->process(t, InBody::instance());
                 tb->setFosterInserts(false);
@@ -998,40 +1050,40 @@ do { \
                return false;
            } else if (t->isStartTagToken()) {
                StartTagToken* startTag = t->asStartTagToken();
-               StringRef name = startTag->tagName();
-               if (name.equals("caption")) {
+               TagIdEnum id = startTag->tagId();
+               if (id == CSOUP_TAG_CAPTION) {
                    tb->clearStackToTableContext(false);
                    tb->insertMarkerToFormattingElements();
                    tb->insert(startTag);
                    tb->transition(InCaption::instance());
-               } else if (name.equals("colgroup")) {
+               } else if (id == CSOUP_TAG_COLGROUP) {
                    tb->clearStackToTableContext(false);
                    tb->insert(startTag);
                    tb->transition(InColumnGroup::instance());
-               } else if (name.equals("col")) {
+               } else if (id == CSOUP_TAG_COL) {
                    processExtraStartTagToken("colgroup", tb);
                    return tb->process(t);
-               } else if (StringUtil::in(name, "tbody", "tfoot", "thead")) {
+               } else if (Constants::TableSections.contains(id)) {
                    tb->clearStackToTableContext(false);
                    tb->insert(startTag);
                    tb->transition(InTableBody::instance());
-               } else if (StringUtil::in(name, "td", "th", "tr")) {
+               } else if (Constants::TableRowsAndCells.contains(id)) {
                    processExtraStartTagToken("tbody", tb);
                    return tb->process(t);
-               } else if (name.equals("table")) {
+               } else if (id == CSOUP_TAG_TABLE) {
                    tb->error(this);
                    bool processed = processExtraEndTagToken("table", tb);
                    if (processed) // only ignored if in fragment
                        return tb->process(t);
-               } else if (StringUtil::in(name, "style", "script")) {
+               } else if (Constants::InTableStartScripts.contains(id)) {
                    return tb->process(t, InHead::instance());
-               } else if (name.equals("input")) {
+               } else if (id == CSOUP_TAG_INPUT) {
                    if (!startTag->attribute("type").equalsIgnoreCase("hidden")) {
                        return InTableAnythingElse(this, t, tb);
                    } else {
                        tb->insertEmpty(startTag);
                    }
-               } else if (name.equals("form")) {
+               } else if (id == CSOUP_TAG_FORM) {
                    tb->error(this);
                    if (tb->formElement() != NULL)
                        return false;
@@ -1044,18 +1096,17 @@ do { \
                return true; // todo: check if should return processed http://www.whatwg.org/specs/web-apps/current-work/multipage/tree-construction.html#parsing-main-intable
            } else if (t->isEndTagToken()) {
                EndTagToken* endTag = t->asEndTagToken();
-               StringRef name = endTag->tagName();
-               static const StringRef errTags[] = {"body", "caption", "col", "colgroup", "html", "tbody", "td", "tfoot", "th", "thead", "tr"};
+               TagIdEnum id = endTag->tagId();
                
-               if (name.equals("table")) {
-                   if (!tb->inTableScope(name)) {
+               if (id == CSOUP_TAG_TABLE) {
+                   if (!tb->inTableScope(endTag->tagName())) {
                        tb->error(this);
                        return false;
                    } else {
                        tb->popStackToClose(false, "table");
                    }
                    tb->resetInsertionMode();
-               } else if (StringUtil::in(name, errTags, arrayLength(errTags))) {
+               } else if (Constants::InTableEndErrors.contains(id)) {
                    tb->error(this);
                    return false;
                } else {
@@ -1063,7 +1114,7 @@ do { \
                }
                return true; // todo: as above todo
            } else if (t->isEOFToken()) {
-               if (tb->currentElement()->tagName().equals("html"))
+               if (tb->currentElement()->tagId() == CSOUP_TAG_HTML)
                    tb->error(this);
                return true; // stops parsing
            }
@@ -1080,7 +1131,7 @@ do { \
                        tb->error(this);
                        return false;
                    } else {
-                       CharacterToken* copy_c = CSOUP_NEW2(tb->allocator(), CharacterToken, c->data(), tb->allocator());
+                       CharacterToken* copy_c = CSOUP_NEW2(tb->scratchAllocator(), CharacterToken, c->data(), tb->scratchAllocator());
                        tb->pendingTableCharacters()->push(copy_c);
                    }
                    break;
@@ -1094,7 +1145,7 @@ do { \
                            if (!isWhitespace(character)) {
                                // InTable anything else section:
                                tb->error(this);
-                               if (StringUtil::in(tb->currentElement()->tagName(), "table", "tbody", "tfoot", "thead", "tr")) {
+                               if (Constants::InBodyEndTableFosters.contains(tb->currentElement()->tagId())) {
                                    tb->setFosterInserts(true);
                                    tb->process(character, InBody::instance());
                                    tb->setFosterInserts(false);
@@ -1115,10 +1166,8 @@ do { \
        
        bool InCaption::process(Token* t, HtmlTreeBuilder* tb) {
            //TokenDeleter tokenDeleter(t, tb->allocator());
-           static const StringRef errStartTags[] = {"caption", "col", "colgroup", "tbody", "td", "tfoot", "th", "thead", "tr"};
-           static const StringRef errEndTags[] = {"body", "col", "colgroup", "html", "tbody", "td", "tfoot", "th", "thead", "tr"};
            
-           if (t->isEndTagToken() && t->asEndTagToken()->tagName().equals("caption")) {
+           if (t->isEndTagToken() && t->asEndTagToken()->tagId() == CSOUP_TAG_CAPTION) {
                EndTagToken* endTag = t->asEndTagToken();
                StringRef name = endTag->tagName();
                if (!tb->inTableScope(name)) {
@@ -1126,19 +1175,19 @@ do { \
                    return false;
                } else {
                    tb->generateImpliedEndTags(false);
-                   if (!tb->currentElement()->tagName().equals("caption"))
+                   if (tb->currentElement()->tagId() != CSOUP_TAG_CAPTION)
                        tb->error(this);
                    tb->popStackToClose(false, "caption");
                    tb->clearFormattingElementsToLastMarker(false);
                    tb->transition(InTable::instance());
                }
-           } else if ( (t->isStartTagToken() && StringUtil::in(t->asStartTagToken()->tagName(), errStartTags, arrayLength(errStartTags))) ||
-                       (t->isEndTagToken() && t->asEndTagToken()->tagName().equals("table"))) {
+           } else if ( (t->isStartTagToken() && Constants::TableStructure.contains(t->asStartTagToken()->tagId())) ||
+                       (t->isEndTagToken() && t->asEndTagToken()->tagId() == CSOUP_TAG_TABLE)) {
                tb->error(this);
                bool processed = processExtraEndTagToken("caption", tb);
                if (processed)
                    return tb->process(t);
-           } else if (t->isEndTagToken() && StringUtil::in(t->asEndTagToken()->tagName(), errEndTags, arrayLength(errEndTags))) {
+           } else if (t->isEndTagToken() && Constants::InCaptionEndErrors.contains(t->asEndTagToken()->tagId())) {
                tb->error(this);
                return false;
            } else {
@@ -1171,20 +1220,18 @@ do { \
                    break;
                case CSOUP_TOKEN_START_TAG: {
                    StartTagToken* startTag = t->asStartTagToken();
-                   StringRef name = startTag->tagName();
-                   if (name.equals("html"))
+                   TagIdEnum id = startTag->tagId();
+                   if (id == CSOUP_TAG_HTML)
                        return tb->process(t, InBody::instance());
-                   else if (name.equals("col"))
+                   else if (id == CSOUP_TAG_COL)
                        tb->insertEmpty(startTag);
                    else
                        InColumnGroupAnythingElse; //return anythingElse(t, tb);
                    break;
                }
                case CSOUP_TOKEN_END_TAG: {
-                   EndTagToken* endTag = t->asEndTagToken();
-                   StringRef name = endTag->tagName();
-                   if (name.equals("colgroup")) {
-                       if (tb->currentElement()->tagName().equals("html")) { // frag case
+                   if (t->asEndTagToken()->tagId() == CSOUP_TAG_COLGROUP) {
+                       if (tb->currentElement()->tagId() == CSOUP_TAG_HTML) { // frag case
                            tb->error(this);
                            return false;
                        } else {
@@ -1196,7 +1243,7 @@ do { \
                    break;
                }
                case CSOUP_TOKEN_EOF: {
-                   if (tb->currentElement()->tagName().equals("html"))
+                   if (tb->currentElement()->tagId() == CSOUP_TAG_HTML)
                        return true; // stop parsing; frag case
                    else
                        InColumnGroupAnythingElse;//return anythingElse(t, tb);
@@ -1214,16 +1261,16 @@ do { \
            switch (t->tokenType()) {
                case CSOUP_TOKEN_START_TAG: {
                    StartTagToken* startTag = t->asStartTagToken();
-                   StringRef name = startTag->tagName();
-                   if (name.equals("tr")) {
+                   TagIdEnum id = startTag->tagId();
+                   if (id == CSOUP_TAG_TR) {
                        tb->clearStackToTableBodyContext(false);
                        tb->insert(startTag);
                        tb->transition(InRow::instance());
-                   } else if (StringUtil::in(name, "th", "td")) {
+                   } else if (Constants::TableCells.contains(id)) {
                        tb->error(this);
                        processExtraStartTagToken("tr", tb);
                        return tb->process(startTag);
-                   } else if (StringUtil::in(name, "caption", "col", "colgroup", "tbody", "tfoot", "thead")) {
+                   } else if (Constants::InTableBodyStartExits.contains(id)) {
                        return exitTableBody(t, tb);
                    } else
                        return anythingElse(t, tb);
@@ -1231,11 +1278,10 @@ do { \
                }
                case CSOUP_TOKEN_END_TAG: {
                    EndTagToken* endTag = t->asEndTagToken();
-                   StringRef name = endTag->tagName();
-                   static const StringRef errTags[] = {"body", "caption", "col", "colgroup", "html", "td", "th", "tr"};
+                   TagIdEnum id = endTag->tagId();
                    
-                   if (StringUtil::in(name, "tbody", "tfoot", "thead")) {
-                       if (!tb->inTableScope(name)) {
+                   if (Constants::TableSections.contains(id)) {
+                       if (!tb->inTableScope(endTag->tagName())) {
                            tb->error(this);
                            return false;
                        } else {
@@ -1243,9 +1289,9 @@ do { \
                            tb->pop();
                            tb->transition(InTable::instance());
                        }
-                   } else if (name.equals("table")) {
+                   } else if (id == CSOUP_TAG_TABLE) {
                        return exitTableBody(t, tb);
-                   } else if (StringUtil::in(name, errTags, arrayLength(errTags))) {
+                   } else if (Constants::InTableBodyEndErrors.contains(id)) {
                        tb->error(this);
                        return false;
                    } else
@@ -1278,14 +1324,14 @@ do { \
            
            if (t->isStartTagToken()) {
                StartTagToken* startTag = t->asStartTagToken();
-               StringRef name = startTag->tagName();
+               TagIdEnum id = startTag->tagId();
                
-               if (StringUtil::in(name, "th", "td")) {
+               if (Constants::TableCells.contains(id)) {
                    tb->clearStackToTableRowContext(false);
                    tb->insert(startTag);
                    tb->transition(InCell::instance());
                    tb->insertMarkerToFormattingElements();
-               } else if (StringUtil::in(name, "caption", "col", "colgroup", "tbody", "tfoot", "thead", "tr")) {
+               } else if (Constants::InRowStartExits.contains(id)) {
                    return handleMissingTr(t, tb);
                } else {
                    return anythingElse(t, tb);
@@ -1293,8 +1339,9 @@ do { \
            } else if (t->isEndTagToken()) {
                EndTagToken* endTag = t->asEndTagToken();
                StringRef name = endTag->tagName();
+               TagIdEnum id = endTag->tagId();
                
-               if (name.equals("tr")) {
+               if (id == CSOUP_TAG_TR) {
                    if (!tb->inTableScope(name)) {
                        tb->error(this); // frag
                        return false;
@@ -1302,16 +1349,16 @@ do { \
                    tb->clearStackToTableRowContext(false);
                    tb->pop(); // tr
                    tb->transition(InTableBody::instance());
-               } else if (name.equals("table")) {
+               } else if (id == CSOUP_TAG_TABLE) {
                    return handleMissingTr(t, tb);
-               } else if (StringUtil::in(name, "tbody", "tfoot", "thead")) {
+               } else if (Constants::TableSections.contains(id)) {
                    if (!tb->inTableScope(name)) {
                        tb->error(this);
                        return false;
                    }
                    processExtraEndTagToken("tr", tb);
                    return tb->process(t);
-               } else if (StringUtil::in(name, "body", "caption", "col", "colgroup", "html", "td", "th")) {
+               } else if (Constants::InRowEndErrors.contains(id)) {
                    tb->error(this);
                    return false;
                } else {
@@ -1341,23 +1388,24 @@ do { \
            if (t->isEndTagToken()) {
                EndTagToken* endTag = t->asEndTagToken();
                StringRef name = endTag->tagName();
+               TagIdEnum id = endTag->tagId();
                
-               if (StringUtil::in(name, "td", "th")) {
+               if (Constants::TableCells.contains(id)) {
                    if (!tb->inTableScope(name)) {
                        tb->error(this);
                        tb->transition(InRow::instance()); // might not be in scope if empty: <td /> and processing fake end tag
                        return false;
                    }
                    tb->generateImpliedEndTags(false);
-                   if (!tb->currentElement()->tagName().equals(name))
+                   if (tb->currentElement()->tagId() != id)
                        tb->error(this);
                    tb->popStackToClose(false, name);
                    tb->clearFormattingElementsToLastMarker(false);
                    tb->transition(InRow::instance());
-               } else if (StringUtil::in(name, "body", "caption", "col", "colgroup", "html")) {
+               } else if (Constants::InCellEndErrors.contains(id)) {
                    tb->error(this);
                    return false;
-               } else if (StringUtil::in(name, "table", "tbody", "tfoot", "thead", "tr")) {
+               } else if (Constants::InBodyEndTableFosters.contains(id)) {
                    if (!tb->inTableScope(name)) {
                        tb->error(this);
                        return false;
@@ -1367,9 +1415,7 @@ do { \
                } else {
                    return anythingElse(t, tb);
                }
-           } else if (t->isStartTagToken() &&
-                      StringUtil::in(t->asStartTagToken()->tagName(),"caption", "col", "colgroup", "tbody") &&
-                      StringUtil::in(t->asStartTagToken()->tagName(), "td", "tfoot", "th", "thead", "tr")) {
+           } else if (t->isStartTagToken() && Constants::TableStructure.contains(t->asStartTagToken()->tagId())) {
                           if (!(tb->inTableScope("td") || tb->inTableScope("th"))) {
                               tb->error(this);
                               return false;
@@ -1417,28 +1463,28 @@ do { \
                }
                case CSOUP_TOKEN_START_TAG: {
                    StartTagToken* start = t->asStartTagToken();
-                   StringRef name = start->tagName();
-                   if (name.equals("html"))
+                   TagIdEnum id = start->tagId();
+                   if (id == CSOUP_TAG_HTML)
                        return tb->process(start, InBody::instance());
-                   else if (name.equals("option")) {
+                   else if (id == CSOUP_TAG_OPTION) {
                        processExtraEndTagToken("option", tb);
                        tb->insert(start);
-                   } else if (name.equals("optgroup")) {
-                       if (tb->currentElement()->tagName().equals("option"))
+                   } else if (id == CSOUP_TAG_OPTGROUP) {
+                       if (tb->currentElement()->tagId() == CSOUP_TAG_OPTION)
                            processExtraEndTagToken("option", tb);
-                       else if (tb->currentElement()->tagName().equals("optgroup"))
+                       else if (tb->currentElement()->tagId() == CSOUP_TAG_OPTGROUP)
                            processExtraEndTagToken("optgroup", tb);
                        tb->insert(start);
-                   } else if (name.equals("select")) {
+                   } else if (id == CSOUP_TAG_SELECT) {
                        tb->error(this);
                        return processExtraEndTagToken("select", tb);
-                   } else if (StringUtil::in(name, "input", "keygen", "textarea")) {
+                   } else if (Constants::InSelectStartInputs.contains(id)) {
                        tb->error(this);
                        if (!tb->inSelectScope("select"))
                            return false; // frag
                        processExtraEndTagToken("select", tb);
                        return tb->process(start);
-                   } else if (name.equals("script")) {
+                   } else if (id == CSOUP_TAG_SCRIPT) {
                        return tb->process(t, InHead::instance());
                    } else {
                        return anythingElse(t, tb);
@@ -1448,19 +1494,20 @@ do { \
                case CSOUP_TOKEN_END_TAG: {
                    EndTagToken* end = t->asEndTagToken();
                    StringRef name = end->tagName();
-                   if (name.equals("optgroup")) {
-                       if (tb->currentElement()->tagName().equals("option") && tb->aboveOnStack(tb->currentElement()) != NULL && tb->aboveOnStack(tb->currentElement())->tagName().equals("optgroup"))
+                   TagIdEnum id = end->tagId();
+                   if (id == CSOUP_TAG_OPTGROUP) {
+                       if (tb->currentElement()->tagId() == CSOUP_TAG_OPTION && tb->aboveOnStack(tb->currentElement()) != NULL && tb->aboveOnStack(tb->currentElement())->tagId() == CSOUP_TAG_OPTGROUP)
                            processExtraEndTagToken("option", tb);
-                       if (tb->currentElement()->tagName().equals("optgroup"))
+                       if (tb->currentElement()->tagId() == CSOUP_TAG_OPTGROUP)
                            tb->pop();
                        else
                            tb->error(this);
-                   } else if (name.equals("option")) {
-                       if (tb->currentElement()->tagName().equals("option"))
+                   } else if (id == CSOUP_TAG_OPTION) {
+                       if (tb->currentElement()->tagId() == CSOUP_TAG_OPTION)
                            tb->pop();
                        else
                            tb->error(this);
-                   } else if (name.equals("select")) {
+                   } else if (id == CSOUP_TAG_SELECT) {
                        if (!tb->inSelectScope(name)) {
                            tb->error(this);
                            return false;
@@ -1473,7 +1520,7 @@ do { \
                    break;
                }
                case CSOUP_TOKEN_EOF:
-                   if (!tb->currentElement()->tagName().equals("html"))
+                   if (tb->currentElement()->tagId() != CSOUP_TAG_HTML)
                        tb->error(this);
                    break;
                default:
@@ -1490,12 +1537,11 @@ do { \
        bool InSelectInTable::process(Token* t, HtmlTreeBuilder* tb) {
            //TokenDeleter tokenDeleter(t, tb->allocator());
            
-           if (t->isStartTagToken() && StringUtil::in(t->asStartTagToken()->tagName(), "caption", "table", "tbody", "tfoot") &&
-               StringUtil::in(t->asStartTagToken()->tagName(), "thead", "tr", "td", "th")) {
+           if (t->isStartTagToken() && Constants::InSelectInTableExits.contains(t->asStartTagToken()->tagId())) {
                tb->error(this);
                processExtraEndTagToken("select", tb);
                return tb->process(t);
-           } else if (t->isEndTagToken() && StringUtil::in(t->asEndTagToken()->tagName(), "caption", "table", "tbody", "tfoot") && StringUtil::in(t->asEndTagToken()->tagName(), "thead", "tr", "td", "th")) {
+           } else if (t->isEndTagToken() && Constants::InSelectInTableExits.contains(t->asEndTagToken()->tagId())) {
                tb->error(this);
                if (tb->inTableScope(t->asEndTagToken()->tagName())) {
                    processExtraEndTagToken("select", tb);
@@ -1517,9 +1563,9 @@ do { \
            } else if (t->isDoctypeToken()) {
                tb->error(this);
                return false;
-           } else if (t->isStartTagToken() && t->asStartTagToken()->tagName().equals("html")) {
+           } else if (t->isStartTagToken() && t->asStartTagToken()->tagId() == CSOUP_TAG_HTML) {
                return tb->process(t, InBody::instance());
-           } else if (t->isEndTagToken() && t->asEndTagToken()->tagName().equals("html")) {
+           } else if (t->isEndTagToken() && t->asEndTagToken()->tagId() == CSOUP_TAG_HTML) {
                if (tb->isFragmentParsing()) {
                    tb->error(this);
                    return false;
@@ -1548,31 +1594,31 @@ do { \
                return false;
            } else if (t->isStartTagToken()) {
                StartTagToken* start = t->asStartTagToken();
-               StringRef name = start->tagName();
-               if (name.equals("html")) {
+               TagIdEnum id = start->tagId();
+               if (id == CSOUP_TAG_HTML) {
                    return tb->process(start, InBody::instance());
-               } else if (name.equals("frameset")) {
+               } else if (id == CSOUP_TAG_FRAMESET) {
                    tb->insert(start);
-               } else if (name.equals("frame")) {
+               } else if (id == CSOUP_TAG_FRAME) {
                    tb->insertEmpty(start);
-               } else if (name.equals("noframes")) {
+               } else if (id == CSOUP_TAG_NOFRAMES) {
                    return tb->process(start, InHead::instance());
                } else {
                    tb->error(this);
                    return false;
                }
-           } else if (t->isEndTagToken() && t->asEndTagToken()->tagName().equals("frameset")) {
-               if (tb->currentElement()->tagName().equals("html")) { // frag
+           } else if (t->isEndTagToken() && t->asEndTagToken()->tagId() == CSOUP_TAG_FRAMESET) {
+               if (tb->currentElement()->tagId() == CSOUP_TAG_HTML) { // frag
                    tb->error(this);
                    return false;
                } else {
                    tb->pop();
-                   if (!tb->isFragmentParsing() && !tb->currentElement()->tagName().equals("frameset")) {
+                   if (!tb->isFragmentParsing() && tb->currentElement()->tagId() != CSOUP_TAG_FRAMESET) {
                        tb->transition(AfterFrameset::instance());
                    }
                }
            } else if (t->isEOFToken()) {
-               if (!tb->currentElement()->tagName().equals("html")) {
+               if (tb->currentElement()->tagId() != CSOUP_TAG_HTML) {
                    tb->error(this);
                    return true;
                }
@@ -1593,11 +1639,11 @@ do { \
            } else if (t->isDoctypeToken()) {
                tb->error(this);
                return false;
-           } else if (t->isStartTagToken() && t->asStartTagToken()->tagName().equals("html")) {
+           } else if (t->isStartTagToken() && t->asStartTagToken()->tagId() == CSOUP_TAG_HTML) {
                return tb->process(t, InBody::instance());
-           } else if (t->isEndTagToken() && t->asEndTagToken()->tagName().equals("html")) {
+           } else if (t->isEndTagToken() && t->asEndTagToken()->tagId() == CSOUP_TAG_HTML) {
                tb->transition(AfterAfterFrameset::instance());
-           } else if (t->isStartTagToken() && t->asStartTagToken()->tagName().equals("noframes")) {
+           } else if (t->isStartTagToken() && t->asStartTagToken()->tagId() == CSOUP_TAG_NOFRAMES) {
                return tb->process(t, InHead::instance());
            } else if (t->isEOFToken()) {
                // cool your heels, we're complete
@@ -1613,7 +1659,7 @@ do { \
            
            if (t->isCommentToken()) {
                tb->insert(t->asCommentToken());
-           } else if (t->isDoctypeToken() || isWhitespace(t) || (t->isStartTagToken() && t->asStartTagToken()->tagName().equals("html"))) {
+           } else if (t->isDoctypeToken() || isWhitespace(t) || (t->isStartTagToken() && t->asStartTagToken()->tagId() == CSOUP_TAG_HTML)) {
                return tb->process(t, InBody::instance());
            } else if (t->isEOFToken()) {
                // nice work chuck
@@ -1630,11 +1676,11 @@ do { \
            
            if (t->isCommentToken()) {
                tb->insert(t->asCommentToken());
-           } else if (t->isDoctypeToken() || isWhitespace(t) || (t->isStartTagToken() && t->asStartTagToken()->tagName().equals("html"))) {
+           } else if (t->isDoctypeToken() || isWhitespace(t) || (t->isStartTagToken() && t->asStartTagToken()->tagId() == CSOUP_TAG_HTML)) {
                return tb->process(t, InBody::instance());
            } else if (t->isEOFToken()) {
                // nice work chuck
-           } else if (t->isStartTagToken() && t->asStartTagToken()->tagName().equals("noframes")) {
+           } else if (t->isStartTagToken() && t->asStartTagToken()->tagId() == CSOUP_TAG_NOFRAMES) {
                return tb->process(t, InHead::instance());
            } else {
                tb->error(this);
@@ -11,6 +11,7 @@
 
 #include "treebuilder.h"
 #include "../util/stringref.h"
+#include "../nodes/tagset.h"
 
 namespace csoup {
     class StartTagToken;
@@ -48,23 +49,45 @@ namespace csoup {
         
         class Constants {
         public:
-            static const StringRef InBodyStartToHead[];
-            static const StringRef InBodyStartPClosers[];
-            static const StringRef Headings[];
-            static const StringRef InBodyStartPreListing[];
-            static const StringRef InBodyStartLiBreakers[];
-            static const StringRef DdDt[];
-            static const StringRef Formatters[];
-            static const StringRef InBodyStartApplets[];
-            static const StringRef InBodyStartEmptyFormatters[];
-            static const StringRef InBodyStartMedia[];
+            static const TagSet InBodyStartToHead;
+            static const TagSet InBodyStartPClosers;
+            static const TagSet Headings;
+            static const TagSet InBodyStartPreListing;
+            static const TagSet InBodyStartLiBreakers;
+            static const TagSet DdDt;
+            static const TagSet Formatters;
+            static const TagSet InBodyStartApplets;
+            static const TagSet InBodyStartEmptyFormatters;
+            static const TagSet InBodyStartMedia;
             static const StringRef InBodyStartInputAttribs[];
-            static const StringRef InBodyStartOptions[];
-            static const StringRef InBodyStartRuby[];
-            static const StringRef InBodyStartDrop[];
-            static const StringRef InBodyEndClosers[];
-            static const StringRef InBodyEndAdoptionFormatters[];
-            static const StringRef InBodyEndTableFosters[];
+            static const TagSet InBodyStartOptions;
+            static const TagSet InBodyStartRuby;
+            static const TagSet InBodyStartDrop;
+            static const TagSet InBodyEndClosers;
+            static const TagSet InBodyEndAdoptionFormatters;
+            static const TagSet InBodyEndTableFosters;
+            static const TagSet HeadBodyHtmlBr;
+            static const TagSet BodyHtmlBr;
+            static const TagSet BodyHtml;
+            static const TagSet InHeadEmpty;
+            static const TagSet InHeadRaw;
+            static const TagSet InHeadNoscriptToHead;
+            static const TagSet InHeadNoscriptIgnored;
+            static const TagSet AfterHeadToHead;
+            static const TagSet TableSections;
+            static const TagSet TableRowsAndCells;
+            static const TagSet TableCells;
+            static const TagSet InTableStartScripts;
+            static const TagSet InTableEndErrors;
+            static const TagSet TableStructure;
+            static const TagSet InCaptionEndErrors;
+            static const TagSet InTableBodyStartExits;
+            static const TagSet InTableBodyEndErrors;
+            static const TagSet InRowStartExits;
+            static const TagSet InRowEndErrors;
+            static const TagSet InCellEndErrors;
+            static const TagSet InSelectStartInputs;
+            static const TagSet InSelectInTableExits;
         };
     };
     
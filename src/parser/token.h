@@ -120,6 +120,14 @@ namespace csoup {
             destroy(&systemIdentifier_);
         }
         
+        // empties the token for reuse; the buffers keep their memory
+        void reset() {
+            name_->clear();
+            publicIdentifier_->clear();
+            systemIdentifier_->clear();
+            forceQuirks_ = false;
+        }
+        
         StringRef name() const {
             return name_->ref();
         }
@@ -177,14 +185,29 @@ namespace csoup {
                                             tagName_(NULL),
                                             pendingAttributeName_(NULL),
                                             pendingAttributeValue_(NULL),
-                                            attributes_(NULL),
+                                            attributeData_(NULL),
+                                            attributeSpans_(NULL),
                                             selfClosing_(false),
+                                            tagId_(CSOUP_TAG_UNKNOWN),
                                             allocator_(allocator) {
             
         }
         
         virtual ~TagToken() = 0;
         
+        // Empties the token so the tokeniser can use it for the next tag. All
+        // buffers are kept, so a reused token only allocates when a tag is
+        // bigger than any seen before.
+        void reset() {
+            if (tagName_) tagName_->clear();
+            if (pendingAttributeName_) pendingAttributeName_->clear();
+            if (pendingAttributeValue_) pendingAttributeValue_->clear();
+            if (attributeData_) attributeData_->clear();
+            if (attributeSpans_) attributeSpans_->clear();
+            selfClosing_ = false;
+            tagId_ = CSOUP_TAG_UNKNOWN;
+        }
+        
         void setTagName(const StringRef& name) {
             if(!tagName_) {
                 tagName_ = new (allocator_->malloc_t<StringBuffer>()) StringBuffer(allocator_);
@@ -192,16 +215,17 @@ namespace csoup {
             
             tagName_->clear();
             tagName_->appendString(name);
+            tagId_ = Tag::idOf(name);
         }
         
+        // The name is appended a piece at a time, so its id is looked up here,
+        // when the tag is complete.
         void finaliseTag() {
             if (pendingAttributeName_ != NULL && pendingAttributeName_->size() > 0) {
                 newAttribute();
             }
-        }
-        
-        StringRef attribute(const StringRef& key) const {
-            return attributes_ ? attributes_->get(key) : StringRef("");
+            
+            tagId_ = tagName_ ? Tag::idOf(tagName_->ref()) : CSOUP_TAG_UNKNOWN;
         }
         
         StringRef tagName() const {
@@ -209,9 +233,13 @@ namespace csoup {
             return tagName_->ref();
         }
         
+        TagIdEnum tagId() const {
+            return tagId_;
+        }
+        
+        // NULL for a tag that is not known
         Tag* tag() const {
-            CSOUP_ASSERT(tagName_ != NULL);
-            return Tag::valueOf(tagName());
+            return Tag::valueOf(tagId_);
         }
         
         bool selfClosing() const {
@@ -222,30 +250,68 @@ namespace csoup {
             selfClosing_ = true;
         }
         
-        Attributes* attributes() {
-            return attributes_;
+        // Attributes are kept in one flat buffer rather than an Attributes
+        // object, so that a reused token does not allocate a String for every
+        // long value. The tree builder copies them into the element.
+        size_t attributeCount() const {
+            return attributeSpans_ == NULL ? 0 : attributeSpans_->size();
+        }
+        
+        StringRef attributeKey(size_t index) const {
+            CSOUP_ASSERT(index < attributeCount());
+            const AttributeSpan* span = attributeSpans_->at(index);
+            return StringRef(attributeData_->data() + span->keyBegin, span->keyLength);
+        }
+        
+        StringRef attributeValue(size_t index) const {
+            CSOUP_ASSERT(index < attributeCount());
+            const AttributeSpan* span = attributeSpans_->at(index);
+            return StringRef(attributeData_->data() + span->valueBegin, span->valueLength);
+        }
+        
+        bool hasAttribute(const StringRef& key) const {
+            return findAttribute(key) < attributeCount();
+        }
+        
+        StringRef attribute(const StringRef& key) const {
+            size_t index = findAttribute(key);
+            return index < attributeCount() ? attributeValue(index) : StringRef("");
+        }
+        
+        // a key the tag already has is dropped, as the spec says
+        void addAttribute(const StringRef& key, const StringRef& value) {
+            if (!key.size()) return ;
+            
+            const uint32_t keyHash = internal::strHashIgnoreCase(key);
+            if (findAttribute(key, keyHash) < attributeCount()) return ;
+            
+            ensureStringBuffer(&attributeData_);
+            if (attributeSpans_ == NULL) {
+                attributeSpans_ = new (allocator_->malloc_t< internal::Vector<AttributeSpan> >())
+                                    internal::Vector<AttributeSpan>(4, allocator_);
+            }
+            
+            AttributeSpan* span = attributeSpans_->push();
+            span->keyHash = keyHash;
+            span->keyBegin = attributeData_->size();
+            span->keyLength = key.size();
+            attributeData_->appendString(key);
+            span->valueBegin = attributeData_->size();
+            span->valueLength = value.size();
+            attributeData_->appendString(value);
         }
         
     //protected:
         void newAttribute() {
-            ensureAttributes();
-            
-            if (pendingAttributeName_ != NULL) {
-                CSOUP_ASSERT(pendingAttributeName_->size() > 0);
-                
-                if (pendingAttributeValue_ != NULL) {
-                    attributes_->addAttribute(CSOUP_ATTR_NAMESPACE_NONE,
-                                              pendingAttributeName_->ref(),
-                                              pendingAttributeValue_->ref());
-                    pendingAttributeValue_->clear();
-                } else {
-                    attributes_->addAttribute(CSOUP_ATTR_NAMESPACE_NONE,
-                                              pendingAttributeName_->ref(),
-                                              StringRef(""));
-                }
-                
+            if (pendingAttributeName_ != NULL && pendingAttributeName_->size() > 0) {
+                addAttribute(pendingAttributeName_->ref(),
+                             pendingAttributeValue_ ? pendingAttributeValue_->ref() : StringRef(""));
                 pendingAttributeName_->clear();
             }
+            
+            if (pendingAttributeValue_ != NULL) {
+                pendingAttributeValue_->clear();
+            }
         }
         
         void appendTagName(int codePoint) {
@@ -283,19 +349,39 @@ namespace csoup {
                 *buffer = new (allocator_->malloc_t<StringBuffer>()) StringBuffer(allocator_);
             }
         }
-        
-        inline void ensureAttributes() {
-            if (attributes_ == NULL) {
-                attributes_ = new (allocator_->malloc_t<Attributes>()) Attributes(allocator_);
-            }
-        }
     
     private:
+        // where an attribute's key and value are in attributeData_
+        struct AttributeSpan {
+            uint32_t keyHash;
+            size_t keyBegin;
+            size_t keyLength;
+            size_t valueBegin;
+            size_t valueLength;
+        };
+        
+        size_t findAttribute(const StringRef& key) const {
+            return findAttribute(key, internal::strHashIgnoreCase(key));
+        }
+        
+        // the hash lets most keys be passed over without comparing them
+        size_t findAttribute(const StringRef& key, uint32_t keyHash) const {
+            const size_t count = attributeCount();
+            for (size_t i = 0; i < count; ++ i) {
+                if (attributeSpans_->at(i)->keyHash == keyHash && internal::strEqualsIgnoreCase(attributeKey(i), key))
+                    return i;
+            }
+            
+            return count;
+        }
+        
         StringBuffer* tagName_;
         StringBuffer* pendingAttributeName_;
         StringBuffer* pendingAttributeValue_;
-        Attributes* attributes_;
+        StringBuffer* attributeData_;
+        internal::Vector<AttributeSpan>* attributeSpans_;
         bool selfClosing_;
+        TagIdEnum tagId_;
         
         Allocator* allocator_;
     };
@@ -304,7 +390,8 @@ namespace csoup {
         destroy(&tagName_);
         destroy(&pendingAttributeName_);
         destroy(&pendingAttributeValue_);
-        destroy(&attributes_, attributes_->allocator());
+        destroy(&attributeData_);
+        destroy(&attributeSpans_, allocator_);
     }
     
     class StartTagToken : public TagToken {
@@ -318,7 +405,7 @@ namespace csoup {
             CSOUP_ASSERT(allocator != NULL);
             for (size_t i = 0; i < attrs.size(); ++ i) {
                 const Attribute* attr = attrs.get(i);
-                attributes()->addAttribute(attr->key(), attr->value());
+                addAttribute(attr->key().ref(), attr->value().ref());
             }
             
             setTagName(name);
@@ -336,7 +423,7 @@ namespace csoup {
             CSOUP_ASSERT(allocator != NULL);
         }
         
-        EndTagToken(const StringRef& name, Allocator* allocator) : TagToken(CSOUP_TOKEN_START_TAG, allocator) {
+        EndTagToken(const StringRef& name, Allocator* allocator) : TagToken(CSOUP_TOKEN_END_TAG, allocator) {
             CSOUP_ASSERT(allocator != NULL);
             setTagName(name);
         }
@@ -355,6 +442,12 @@ namespace csoup {
             destroy(&content_);
         }
         
+        // empties the token for reuse; the buffer keeps its memory
+        void reset() {
+            content_->clear();
+            bogus_ = false;
+        }
+        
         void append(int c) {
             content_->append(c);
         }
@@ -381,21 +474,55 @@ namespace csoup {
     
     class CharacterToken : public Token {
     public:
-        CharacterToken(const StringRef& str, Allocator* allocator) : Token(CSOUP_TOKEN_CHARACTER) {
+        CharacterToken(const StringRef& str, Allocator* allocator) : Token(CSOUP_TOKEN_CHARACTER),
+                                                                     text_(NULL),
+                                                                     allocator_(allocator),
+                                                                     slice_(false) {
             CSOUP_ASSERT(allocator != NULL);
-            data_ = new (allocator->malloc_t<String>()) String(str, allocator);
+            text_ = new (allocator->malloc_t<String>()) String(str, allocator);
+            data_ = text_->data();
+            length_ = text_->size();
+        }
+        
+        // Refers to slice without copying it. The tokeniser uses this for text
+        // that is the same as the input, which outlives the token.
+        explicit CharacterToken(const StringRef& slice) : Token(CSOUP_TOKEN_CHARACTER),
+                                                          text_(NULL),
+                                                          allocator_(NULL),
+                                                          data_(slice.data()),
+                                                          length_(slice.size()),
+                                                          slice_(true) {
+            
         }
         
         ~CharacterToken() {
-            destroy(&data_);
+            destroy(&text_, allocator_);
         }
         
         StringRef data() const {
-            return data_->ref();
+            return StringRef(data_, length_);
+        }
+        
+        // whether data() points into the parser input rather than a copy
+        bool isSlice() const {
+            return slice_;
+        }
+        
+        // Points a token that owns no copy at data, which the caller keeps
+        // alive. The tokeniser hands out one such token for every run of text.
+        void setData(const StringRef& data, bool slice) {
+            CSOUP_ASSERT(text_ == NULL);
+            data_ = data.data();
+            length_ = data.size();
+            slice_ = slice;
         }
         
     private:
-        String* data_;
+        String* text_;
+        Allocator* allocator_;
+        const CharType* data_;
+        size_t length_;
+        bool slice_;
     };
     
     class EOFToken : public Token {
@@ -24,7 +24,10 @@ namespace csoup {
     Tokeniser::Tokeniser(CharacterReader* reader, ParseErrorList* errorList, Allocator* allocator) :
         allocator_(allocator), reader_(reader), errors_(errorList),
         state_(internal::Data::instance()), emitPending_(NULL), isEmitPending_(false),
-        charBuffer_(NULL), dataBuffer_(NULL), tagPending_(NULL), doctypePending_(NULL),
+        charBuffer_(NULL), characterData_(NULL), dataBuffer_(NULL), scratchBuffer_(NULL), referenceBuffer_(NULL),
+        pendingSlice_(NULL), pendingSliceLength_(0),
+        startTag_(NULL), endTag_(NULL), comment_(NULL), doctype_(NULL), character_(NULL), eof_(NULL),
+        tagPending_(NULL), doctypePending_(NULL),
         commentPending_(NULL), lastStartTag_(NULL), selfClosingFlagAcknowledged(true) {
         
         CSOUP_ASSERT(allocator != NULL);
@@ -32,11 +35,35 @@ namespace csoup {
         CSOUP_ASSERT(errorList != NULL);
             
         charBuffer_ = new (allocator->malloc_t<StringBuffer>()) StringBuffer(allocator);
+        characterData_ = new (allocator->malloc_t<StringBuffer>()) StringBuffer(allocator);
+        dataBuffer_ = new (allocator->malloc_t<StringBuffer>()) StringBuffer(allocator);
+        scratchBuffer_ = new (allocator->malloc_t<StringBuffer>()) StringBuffer(allocator);
+        referenceBuffer_ = new (allocator->malloc_t<StringBuffer>()) StringBuffer(allocator);
+        lastStartTag_ = new (allocator->malloc_t<StringBuffer>()) StringBuffer(allocator);
+            
+        startTag_ = new (allocator->malloc_t<StartTagToken>()) StartTagToken(allocator);
+        endTag_ = new (allocator->malloc_t<EndTagToken>()) EndTagToken(allocator);
+        comment_ = new (allocator->malloc_t<CommentToken>()) CommentToken(allocator);
+        doctype_ = new (allocator->malloc_t<DoctypeToken>()) DoctypeToken(allocator);
+        character_ = new (allocator->malloc_t<CharacterToken>()) CharacterToken(StringRef(""));
+        eof_ = new (allocator->malloc_t<EOFToken>()) EOFToken();
     }
     
     Tokeniser::~Tokeniser() {
         destroy(&charBuffer_);
-        // you must destroying other memebers
+        destroy(&characterData_);
+        destroy(&dataBuffer_);
+        destroy(&scratchBuffer_);
+        destroy(&referenceBuffer_);
+        destroy(&lastStartTag_);
+        
+        // the pending pointers all point into the pool
+        destroy(&startTag_, allocator_);
+        destroy(&endTag_, allocator_);
+        destroy(&comment_, allocator_);
+        destroy(&doctype_, allocator_);
+        destroy(&character_, allocator_);
+        destroy(&eof_, allocator_);
     }
     
     Token* Tokeniser::read() {
@@ -45,14 +72,24 @@ namespace csoup {
             selfClosingFlagAcknowledged = true;
         }
         
-        while (isEmitPending_) {
+        while (!isEmitPending_) {
             state_->read(this, reader_);
         }
         
         Token* ret;
-        if (charBuffer_->size() > 0) {
-            ret = new (allocator_->malloc_t<CharacterToken>()) CharacterToken(charBuffer_->ref(), allocator_);
+        if (pendingSliceLength_ > 0) {
+            character_->setData(StringRef(pendingSlice_, pendingSliceLength_), true);
+            pendingSliceLength_ = 0;
+            ret = character_;
+        } else if (charBuffer_->size() > 0) {
+            // hand the filled buffer to the token and collect the next text in the other one
+            StringBuffer* filled = charBuffer_;
+            charBuffer_ = characterData_;
+            characterData_ = filled;
             charBuffer_->clear();
+            
+            character_->setData(characterData_->ref(), false);
+            ret = character_;
         } else {
             isEmitPending_ = false;
             ret = emitPending_;
@@ -77,19 +114,57 @@ namespace csoup {
         
         CSOUP_ASSERT(emitPending_ == NULL);
         emitPending_ = token;
+        isEmitPending_ = true;
+        
+        if (token->isStartTagToken()) {
+            StartTagToken* startTag = token->asStartTagToken();
+            lastStartTag_->clear();
+            lastStartTag_->appendString(startTag->tagName());
+            
+            if (startTag->selfClosing()) {
+                selfClosingFlagAcknowledged = false;
+            }
+        }
     }
     
     void Tokeniser::emit(const StringRef& str) {
+        flushPendingSlice();
         charBuffer_->appendString(str);
     }
     
     void Tokeniser::emit(int c) {
+        flushPendingSlice();
         charBuffer_->append(c);
     }
     
+    size_t Tokeniser::emitUntilAny(const CharType* terms, size_t n) {
+        size_t read = 0;
+        if (pendingSliceLength_ == 0 && charBuffer_->size() == 0) {
+            if (reader_->consumeSliceToAny(terms, n, &pendingSlice_, &pendingSliceLength_)) {
+                return pendingSliceLength_;
+            }
+            read = pendingSliceLength_;
+        }
+        
+        flushPendingSlice();
+        return read + reader_->consumeToAny(terms, n, charBuffer_);
+    }
+    
+    void Tokeniser::flushPendingSlice() {
+        if (pendingSliceLength_ > 0) {
+            charBuffer_->appendString(pendingSlice_, pendingSliceLength_);
+            pendingSliceLength_ = 0;
+        }
+    }
+    
     void Tokeniser::emitEOF() {
-        EOFToken* eof = new (allocator_->malloc_t<EOFToken>()) EOFToken();
-        emit(eof);
+        emit(eof_);
+    }
+    
+    void Tokeniser::emitEndTag(const StringRef& name) {
+        endTag_->reset();
+        endTag_->setTagName(name);
+        emit(endTag_);
     }
     
     void Tokeniser::transition(internal::TokeniserState* state) {
@@ -97,13 +172,12 @@ namespace csoup {
     }
     
     StringRef Tokeniser::bufferedData() {
-        return dataBuffer_ == NULL ? StringRef("") : dataBuffer_->ref();
+        return dataBuffer_->ref();
     }
     
     void Tokeniser::appendBufferedDataToEmitPendingString() {
-        if (dataBuffer_ != NULL) {
-            charBuffer_->appendString(dataBuffer_->ref());
-        }
+        flushPendingSlice();
+        charBuffer_->appendString(dataBuffer_->ref());
     }
     
     void Tokeniser::appendTagName(const csoup::StringRef &append) {
@@ -117,12 +191,10 @@ namespace csoup {
     }
     
     void Tokeniser::appendDataBuffer(const csoup::StringRef &append) {
-        CSOUP_ASSERT(dataBuffer_ != NULL);
         dataBuffer_->appendString(append);
     }
     
     void Tokeniser::appendDataBuffer(const int c) {
-        CSOUP_ASSERT(dataBuffer_ != NULL);
         dataBuffer_->append(c);
     }
     
@@ -147,7 +219,8 @@ namespace csoup {
             return false;
         }
         
-        StringBuffer buffer(allocator_);
+        StringBuffer& buffer = *referenceBuffer_;
+        buffer.clear();
         reader_->mark();
         
         if (reader_->matchConsume('#')) {
@@ -168,13 +241,15 @@ namespace csoup {
                 characterReferenceError(StringRef("missing semicolon"));
             }
             
-            int64_t charval = -1;
+            int64_t charval = 0;
             
             int base = isHexMode ? 16 : 10;
             for (size_t i = 0; i < buffer.size(); ++ i) {
-                charval = charval * base + (buffer.data()[i] - '0');
+                int digit = buffer.data()[i];
+                digit = std::isdigit(digit) ? digit - '0' : std::tolower(digit) - 'a' + 10;
+                charval = charval * base + digit;
                 
-                if (charval > (unsigned int)0xFFFFFFFF) {
+                if (charval > 0x10FFFF) {
                     characterReferenceError(StringRef("value is overflow"));
                     charval = -1;
                     break;
@@ -190,13 +265,19 @@ namespace csoup {
             }
         } else {
             readReferenceName(&buffer);
-            buffer.append('\0');
             
+            // a whole name followed by ';' is taken as it is; otherwise the
+            // longest entity that may go without ';' is, e.g. "&notit;" is "¬it;"
+            int codePoint = -1;
+            size_t length = 0;
             bool looksLegit = reader_->matches(';');
-            bool found = (Entities::isBaseNamedEntity(buffer.data()) ||
-                          (Entities::isNamedEntity(buffer.data()) && looksLegit));
+            if (looksLegit && Entities::isNamedEntity(buffer.ref())) {
+                length = Entities::matchNamedEntity(buffer.ref(), false, &codePoint);
+            } else {
+                length = Entities::matchNamedEntity(buffer.ref(), true, &codePoint);
+            }
             
-            if (!found) {
+            if (length == 0) {
                 reader_->rewindToMark();
                 if (looksLegit) {
                     characterReferenceError("invalid named referenece");
@@ -205,8 +286,16 @@ namespace csoup {
                 return false;
             }
             
+            if (length < buffer.size()) {
+                // the name is ascii, so every character is one byte
+                reader_->rewindToMark();
+                for (size_t i = 0; i < length; ++ i) {
+                    reader_->advance();
+                }
+            }
+            
             int c = reader_->peek();
-            if (inAttribute && (std::isalpha(c) || std::isdigit(c) || c == '-' || c == '-' || c == '_')) {
+            if (inAttribute && (std::isalpha(c) || std::isdigit(c) || c == '=' || c == '-' || c == '_')) {
                 reader_->rewindToMark();
                 return false;
             }
@@ -214,24 +303,24 @@ namespace csoup {
             if (!reader_->matchConsume(';')) {
                 characterReferenceError("missing semicolon"); // missing semi
             }
-            output->append(Entities::getCharacterByName(buffer.data()));
+            output->append(codePoint);
         }
         
         return true;
     }
     
     TagToken* Tokeniser::createTagPending(bool start) {
-        CSOUP_ASSERT(tagPending_ == NULL);
+        // a tag abandoned by the raw text end tag states is simply overwritten
         if (start) {
-            tagPending_ = new (allocator_->malloc_t<StartTagToken>()) StartTagToken(allocator_);
+            tagPending_ = startTag_;
         } else {
-            tagPending_ = new (allocator_->malloc_t<EndTagToken>()) EndTagToken(allocator_);
+            tagPending_ = endTag_;
         }
+        tagPending_->reset();
             
         return tagPending_;
     }
     
-    // You may have to set tagPending_ to be NULL
     void Tokeniser::emitTagPending() {
         tagPending_->finaliseTag();
         emit(tagPending_);
@@ -239,7 +328,8 @@ namespace csoup {
     }
     
     void Tokeniser::createCommentPending() {
-        commentPending_ = new (allocator_->malloc_t<CommentToken>()) CommentToken(allocator_);
+        commentPending_ = comment_;
+        commentPending_->reset();
     }
     
     void Tokeniser::emitCommentPending() {
@@ -248,7 +338,8 @@ namespace csoup {
     }
     
     void Tokeniser::createDoctypePending() {
-        doctypePending_ = new (allocator_->malloc_t<DoctypeToken>()) DoctypeToken(allocator_);
+        doctypePending_ = doctype_;
+        doctypePending_->reset();
     }
     
     void Tokeniser::emitDoctypePending() {
@@ -257,25 +348,21 @@ namespace csoup {
     }
     
     void Tokeniser::createTempBuffer() {
-        if (dataBuffer_) {
-            dataBuffer_->~StringBuffer();
-        } else {
-            dataBuffer_ = allocator_->malloc_t<StringBuffer>();
-        }
-        
-        new (dataBuffer_) StringBuffer(allocator_);
+        dataBuffer_->clear();
+    }
+    
+    StringBuffer* Tokeniser::scratchBuffer() {
+        scratchBuffer_->clear();
+        return scratchBuffer_;
     }
+    
     bool Tokeniser::isAppropriateEndTagToken() {
-        if (lastStartTag_ == NULL) return false;
-        return internal::strEqualsIgnoreCase(tagPending_->tagName(), lastStartTag_->tagName());
+        if (lastStartTag_->size() == 0) return false;
+        return internal::strEqualsIgnoreCase(tagPending_->tagName(), lastStartTag_->ref());
     }
     
     StringRef Tokeniser::appropriateEndTagName() {
-        if (lastStartTag_ == NULL) {
-            return StringRef("");
-        }
-        
-        return lastStartTag_->tagName();
+        return lastStartTag_->ref();
     }
     
     void Tokeniser::error(internal::TokeniserState* state) {
@@ -296,7 +383,8 @@ namespace csoup {
         int c = reader_->peek();
         while (std::isxdigit(c)) {
             buffer->append(c);
-            c = reader_->next();
+            reader_->advance();
+            c = reader_->peek();
         }
     }
     
@@ -304,7 +392,8 @@ namespace csoup {
         int c = reader_->peek();
         while (std::isdigit(c)) {
             buffer->append(c);
-            c = reader_->next();
+            reader_->advance();
+            c = reader_->peek();
         }
     }
     
@@ -312,12 +401,14 @@ namespace csoup {
         int c = reader_->peek();
         while (std::isalpha(c)) {
             output->append(c);
-            c = reader_->next();
+            reader_->advance();
+            c = reader_->peek();
         }
         
         while (std::isdigit(c)) {
             output->append(c);
-            c = reader_->next();
+            reader_->advance();
+            c = reader_->peek();
         }
     }
 }
\ No newline at end of file
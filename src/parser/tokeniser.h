@@ -10,6 +10,8 @@
 #ifndef CSOUP_TOKENISER_H_
 #define CSOUP_TOKENISER_H_
 
+#include "../util/common.h"
+
 namespace csoup {
     // Some class declarations
     namespace internal {
@@ -24,8 +26,11 @@ namespace csoup {
     class Tag;
     class TagToken;
     class StartTagToken;
+    class EndTagToken;
     class DoctypeToken;
     class CommentToken;
+    class CharacterToken;
+    class EOFToken;
     class StringRef;
     
     class Tokeniser {
@@ -33,7 +38,8 @@ namespace csoup {
         Tokeniser(CharacterReader* reader, ParseErrorList* errorList, Allocator* allocator);
         ~Tokeniser();
         
-        // The invoker must destroy the returned token!!
+        // The returned token belongs to the tokeniser and is only valid until
+        // the next call; there is one instance per token type, reused each time.
         Token* read();
         
         
@@ -44,8 +50,14 @@ namespace csoup {
         void emit(const StringRef& str);
         void emit(int c);
         
+        // emits the input up to (not including) the first of the ASCII terms in one go
+        size_t emitUntilAny(const CharType* terms, size_t n);
+        
         void emitEOF();
         
+        // emits an end tag from the pool, for the tree builder to close a self closing tag
+        void emitEndTag(const StringRef& name);
+        
         // user can't deconstruct state!
         internal::TokeniserState& state() {
             return *state_;
@@ -75,6 +87,11 @@ namespace csoup {
         }
         
         void createTempBuffer();
+        
+        // an empty buffer for a state to collect input in before passing it on;
+        // it is reused, so anything in it is gone on the next call
+        StringBuffer* scratchBuffer();
+        
         bool isAppropriateEndTagToken();
         
         StringRef appropriateEndTagName();
@@ -115,6 +132,9 @@ namespace csoup {
         void readHexSequence(StringBuffer* output);
         void readDigitSequence(StringBuffer* output);
         void readReferenceName(StringBuffer* output);
+        
+        // moves a pending input slice into charBuffer_ before more text is added
+        void flushPendingSlice();
 
         Allocator* allocator_;
         CharacterReader* reader_;
@@ -123,12 +143,30 @@ namespace csoup {
         Token* emitPending_;
         bool isEmitPending_;
         StringBuffer* charBuffer_;
+        StringBuffer* characterData_; // the text of the last character token read
         StringBuffer* dataBuffer_;
+        StringBuffer* scratchBuffer_;
+        StringBuffer* referenceBuffer_;
+        
+        // Text that is still byte for byte the same as the input is kept as a
+        // slice of it; it only gets copied into charBuffer_ if more text
+        // follows before the next token.
+        const CharType* pendingSlice_;
+        size_t pendingSliceLength_;
+        
+        // Token pool: read() always hands out one of these, so tokenizing
+        // does not allocate once their buffers have grown big enough.
+        StartTagToken* startTag_;
+        EndTagToken* endTag_;
+        CommentToken* comment_;
+        DoctypeToken* doctype_;
+        CharacterToken* character_;
+        EOFToken* eof_;
         
         TagToken* tagPending_;
         DoctypeToken* doctypePending_;
         CommentToken* commentPending_;
-        StartTagToken* lastStartTag_;
+        StringBuffer* lastStartTag_; // name of the last start tag emitted
         
         bool selfClosingFlagAcknowledged;
     };
@@ -25,7 +25,7 @@ namespace csoup {
     
     void TokeniserState::handleDataEndTag(csoup::Tokeniser *t, csoup::CharacterReader *r, csoup::internal::TokeniserState *elseTransition) {
         if (isalpha(r->peek())) {
-            StringBuffer name(t->allocator());
+            StringBuffer& name = *t->scratchBuffer();
             appendUntilNotLetter(t, r, &name);
             t->appendDataBuffer(name.ref());
         
@@ -69,7 +69,7 @@ namespace csoup {
     
     void TokeniserState::handleDataDoubleEscapeTag(csoup::Tokeniser *t, csoup::CharacterReader *r, csoup::internal::TokeniserState *primary, csoup::internal::TokeniserState *fallback) {
         if (std::isalpha(r->peek())) {
-            StringBuffer name(t->allocator());
+            StringBuffer& name = *t->scratchBuffer();
             appendUntilNotLetter(t, r, &name);
             
             t->emit(name.ref());
@@ -103,89 +103,32 @@ namespace csoup {
     }
     
     size_t TokeniserState::emitUntil(Tokeniser* t, CharacterReader* reader, CharType* endTerms, const size_t arrSize) {
-        int c = reader->peek();
-        size_t read = 0;
-        
-        while (c != CharacterReader::eof_) {
-            for (size_t i = 0; i < arrSize; ++ i) {
-                if (c == endTerms[i]) {
-                    goto EMIT_UNTIL_OUTER;
-                }
-            }
-            
-            read ++;
-            t->emit(c);
-            c = reader->next();
-        }
-    EMIT_UNTIL_OUTER:
-        return read;
+        return t->emitUntilAny(endTerms, arrSize);
     }
     
     size_t TokeniserState::lowercasedAppendUntil(Tokeniser* t, CharacterReader* reader,
                                                  StringBuffer* buffer, CharType* endTerms, const size_t arrSize) {
-        int c = reader->peek();
-        size_t read = 0;
-        
-        while (c != CharacterReader::eof_) {
-            for (size_t i = 0; i < arrSize; ++ i) {
-                if (c == endTerms[i]) {
-                    goto LOWERCASED_APPEND_UNTIL;
-                }
-            }
-            
-            read ++;
-            buffer->append(std::tolower(c));
-            c = reader->next();
-        }
+        size_t begin = buffer->size();
+        size_t read = reader->consumeToAny(endTerms, arrSize, buffer);
+        buffer->tolower(begin);
         
-    LOWERCASED_APPEND_UNTIL:
         return read;
     }
     
     size_t TokeniserState::lowercasedAppendUntilNotLetter(Tokeniser *t, CharacterReader *reader, StringBuffer *buffer) {
-        int c = reader->peek();
-        size_t read = 0;
-        
-        while (std::isalpha(c)) {
-            read ++;
-            buffer->append(std::tolower(c));
-            c = reader->next();
-        }
+        size_t begin = buffer->size();
+        size_t read = reader->consumeLetters(buffer);
+        buffer->tolower(begin);
         
         return read;
     }
     
     size_t TokeniserState::appendUntilNotLetter(Tokeniser *t, CharacterReader *reader, StringBuffer *buffer) {
-        int c = reader->peek();
-        size_t read = 0;
-        
-        while (std::isalpha(c)) {
-            read ++;
-            buffer->append(c);
-            c = reader->next();
-        }
-        
-        return read;
+        return reader->consumeLetters(buffer);
     }
     
     size_t TokeniserState::appendUntil(csoup::Tokeniser *t, csoup::CharacterReader *reader, csoup::StringBuffer *buffer, CharType* endTerms, const size_t arrSize) {
-        int c = reader->peek();
-        size_t read = 0;
-        
-        while (c != CharacterReader::eof_) {
-            for (size_t i = 0; i < arrSize; ++ i) {
-                if (c == endTerms[i]) {
-                    goto APPEND_UNTIL_OUTER;
-                }
-            }
-            
-            read ++;
-            buffer->append(c);
-            c = reader->next();
-        }
-        
-    APPEND_UNTIL_OUTER:
-        return read;
+        return reader->consumeToAny(endTerms, arrSize, buffer);
     }
     
      // in data state, gather characters until a character reference or tag is found
@@ -213,7 +156,7 @@ namespace csoup {
     
     // from & in data
     void CharacterReferenceInData::read(csoup::Tokeniser *t, csoup::CharacterReader *reader) {
-        StringBuffer buffer(t->allocator());
+        StringBuffer& buffer = *t->scratchBuffer();
         bool ret = t->consumeCharacterReference(NULL, false, &buffer);
         
         if (!ret) {
@@ -250,7 +193,7 @@ namespace csoup {
     }
     
     void CharacterReferenceInRcdata::read(csoup::Tokeniser *t, csoup::CharacterReader *reader) {
-        StringBuffer buffer(t->allocator());
+        StringBuffer& buffer = *t->scratchBuffer();
         bool ret = t->consumeCharacterReference(NULL, false, &buffer);
         
         if (!ret) {
@@ -365,7 +308,7 @@ namespace csoup {
     // from < or </ in data, will have start or end tag pending
     void TagName::read(csoup::Tokeniser *t, csoup::CharacterReader *reader) {
         // previous TagOpen state did NOT consume, will have a letter char in current
-        StringBuffer tagName(t->allocator());
+        StringBuffer& tagName = *t->scratchBuffer();
         CharType terms[] = {'\t', '\n', '\r', '\f', ' ', '/', '>', nullChar_};
         lowercasedAppendUntil(t, reader, &tagName, terms, arrayLength(terms));
     
@@ -423,7 +366,7 @@ namespace csoup {
     
     void RCDATAEndTagName::read(csoup::Tokeniser *t, csoup::CharacterReader *reader) {
         if (std::isalpha(reader->peek())) {
-            StringBuffer name(t->allocator());
+            StringBuffer& name = *t->scratchBuffer();
             appendUntilNotLetter(t, reader, &name);
         
             t->appendDataBuffer(name.ref());
@@ -834,7 +777,7 @@ namespace csoup {
     }
     // from before attribute name
     void AttributeName::read(csoup::Tokeniser *t, csoup::CharacterReader *reader) {
-        StringBuffer name(t->allocator());
+        StringBuffer& name = *t->scratchBuffer();
         CharType terms[] = {'\t', '\n', '\r', '\f', ' ', '/', '=', '>', nullChar_, '"', '\'', '<'};
         lowercasedAppendUntil(t, reader, &name, terms, arrayLength(terms));
         
@@ -985,7 +928,7 @@ namespace csoup {
         }
     }
     void AttributeValue_doubleQuoted::read(csoup::Tokeniser *t, csoup::CharacterReader *reader) {
-        StringBuffer value(t->allocator());
+        StringBuffer& value = *t->scratchBuffer();
         CharType terms[] = {'"', '&', nullChar_};
         appendUntil(t, reader, &value, terms, arrayLength(terms));
         
@@ -1000,7 +943,7 @@ namespace csoup {
                 break;
             case '&': {
                 int additionalAllowed = '"';
-                StringBuffer buffer(t->allocator());
+                StringBuffer& buffer = *t->scratchBuffer();
                 bool ret = t->consumeCharacterReference(&additionalAllowed, true, &buffer);
                 
                 if (ret) {
@@ -1023,7 +966,7 @@ namespace csoup {
         }
     }
     void AttributeValue_singleQuoted::read(csoup::Tokeniser *t, csoup::CharacterReader *reader) {
-        StringBuffer value(t->allocator());
+        StringBuffer& value = *t->scratchBuffer();
         CharType terms[] = {'\'', '&', nullChar_};
         appendUntil(t, reader, &value, terms, arrayLength(terms));
         
@@ -1038,7 +981,7 @@ namespace csoup {
                 break;
             case '&': {
                 int additionalAllowed = '\'';
-                StringBuffer buffer(t->allocator());
+                StringBuffer& buffer = *t->scratchBuffer();
                 bool ret = t->consumeCharacterReference(&additionalAllowed, true, &buffer);
                 
                 if (ret)
@@ -1060,7 +1003,7 @@ namespace csoup {
         }
     }
     void AttributeValue_unquoted::read(csoup::Tokeniser *t, csoup::CharacterReader *reader) {
-        StringBuffer value(t->allocator());
+        StringBuffer& value = *t->scratchBuffer();
         CharType terms[] = {'\t', '\n', '\r', '\f', ' ', '&', '>', nullChar_, '"', '\'', '<', '=', '`'};
         appendUntil(t, reader, &value, terms, arrayLength(terms));
         
@@ -1079,7 +1022,7 @@ namespace csoup {
                 break;
             case '&': {
                 int additionalAllowed = '>';
-                StringBuffer buffer(t->allocator());
+                StringBuffer& buffer = *t->scratchBuffer();
                 bool ret = t->consumeCharacterReference(&additionalAllowed, true, &buffer);
                 
                 if (ret)
@@ -1173,16 +1116,16 @@ namespace csoup {
         // todo: handle bogus comment starting from eof_. when does that trigger?
         // rewind to capture character that lead us here
         reader->unconsume();
-        CommentToken* comment = new (t->allocator()->malloc_t<CommentToken>()) CommentToken(t->allocator());
-        comment->setBogus(true);
+        t->createCommentPending();
+        t->commentPending()->setBogus(true);
         
-        StringBuffer value(t->allocator());
+        StringBuffer& value = *t->scratchBuffer();
         CharType terms[] = {'>'};
         appendUntil(t, reader, &value, terms, arrayLength(terms));
 
-        comment->append(value.ref());
+        t->commentPending()->append(value.ref());
         // todo: replace nullChar_ with replaceChar
-        t->emit(comment);
+        t->emitCommentPending();
         t->advanceTransition(Data::instance());
         
     }
@@ -1287,7 +1230,7 @@ namespace csoup {
                 
                 break;
             default: {
-                StringBuffer data(t->allocator());
+                StringBuffer& data = *t->scratchBuffer();
                 CharType term[] = {'-', nullChar_};
                 appendUntil(t, reader, &data, term, arrayLength(term));
                 t->commentPending()->append(data.ref());
@@ -1459,7 +1402,7 @@ namespace csoup {
     }
     void DoctypeName::read(csoup::Tokeniser *t, csoup::CharacterReader *reader) {
         if (std::isalpha(reader->peek())) {
-            StringBuffer name(t->allocator());
+            StringBuffer& name = *t->scratchBuffer();
             lowercasedAppendUntilNotLetter(t, reader, &name);
             
             t->doctypePending()->appendName(name.ref());
@@ -1937,11 +1880,17 @@ namespace csoup {
         }
     }
     void CdataSection::read(csoup::Tokeniser *t, csoup::CharacterReader *reader) {
-        StringBuffer data(t->allocator());
+        StringBuffer& data = *t->scratchBuffer();
         reader->consumeTo("]]>", &data);
         t->emit(data.ref());
         reader->matchConsume("]]>");
         t->transition(Data::instance());
     }
+    
+    /////////////////////////////////////////////////
+    // state instances
+    
+#define CSOUP_TOKENISER_STATE_INSTANCE(StateName, STATE_ID) StateName StateName::globalInstance_;
+    CSOUP_TOKENISER_STATES(CSOUP_TOKENISER_STATE_INSTANCE)
+#undef CSOUP_TOKENISER_STATE_INSTANCE
 }
-
@@ -16,16 +16,101 @@ namespace csoup {
     class StringBuffer;
     
     namespace internal {
+        
+// X(StateName, STATE_ID) for every state of the tokeniser
+#define CSOUP_TOKENISER_STATES(X) \
+    X(Data,                                     DATA) \
+    X(CharacterReferenceInData,                 CHARACTER_REFERENCE_IN_DATA) \
+    X(Rcdata,                                   RCDATA) \
+    X(CharacterReferenceInRcdata,               CHARACTER_REFERENCE_IN_RCDATA) \
+    X(RawText,                                  RAW_TEXT) \
+    X(ScriptData,                               SCRIPT_DATA) \
+    X(PlainText,                                PLAIN_TEXT) \
+    X(TagOpen,                                  TAG_OPEN) \
+    X(EndTagOpen,                               END_TAG_OPEN) \
+    X(TagName,                                  TAG_NAME) \
+    X(RcdataLessthanSign,                       RCDATA_LESSTHAN_SIGN) \
+    X(RCDATAEndTagOpen,                         RCDATA_END_TAG_OPEN) \
+    X(RCDATAEndTagName,                         RCDATA_END_TAG_NAME) \
+    X(RawtextLessthanSign,                      RAWTEXT_LESSTHAN_SIGN) \
+    X(RawtextEndTagOpen,                        RAWTEXT_END_TAG_OPEN) \
+    X(RawtextEndTagName,                        RAWTEXT_END_TAG_NAME) \
+    X(ScriptDataLessthanSign,                   SCRIPT_DATA_LESSTHAN_SIGN) \
+    X(ScriptDataEndTagOpen,                     SCRIPT_DATA_END_TAG_OPEN) \
+    X(ScriptDataEndTagName,                     SCRIPT_DATA_END_TAG_NAME) \
+    X(ScriptDataEscapeStart,                    SCRIPT_DATA_ESCAPE_START) \
+    X(ScriptDataEscapeStartDash,                SCRIPT_DATA_ESCAPE_START_DASH) \
+    X(ScriptDataEscaped,                        SCRIPT_DATA_ESCAPED) \
+    X(ScriptDataEscapedDash,                    SCRIPT_DATA_ESCAPED_DASH) \
+    X(ScriptDataEscapedDashDash,                SCRIPT_DATA_ESCAPED_DASH_DASH) \
+    X(ScriptDataEscapedLessthanSign,            SCRIPT_DATA_ESCAPED_LESSTHAN_SIGN) \
+    X(ScriptDataEscapedEndTagOpen,              SCRIPT_DATA_ESCAPED_END_TAG_OPEN) \
+    X(ScriptDataEscapedEndTagName,              SCRIPT_DATA_ESCAPED_END_TAG_NAME) \
+    X(ScriptDataDoubleEscapeStart,              SCRIPT_DATA_DOUBLE_ESCAPE_START) \
+    X(ScriptDataDoubleEscaped,                  SCRIPT_DATA_DOUBLE_ESCAPED) \
+    X(ScriptDataDoubleEscapedDash,              SCRIPT_DATA_DOUBLE_ESCAPED_DASH) \
+    X(ScriptDataDoubleEscapedDashDash,          SCRIPT_DATA_DOUBLE_ESCAPED_DASH_DASH) \
+    X(ScriptDataDoubleEscapedLessthanSign,      SCRIPT_DATA_DOUBLE_ESCAPED_LESSTHAN_SIGN) \
+    X(ScriptDataDoubleEscapeEnd,                SCRIPT_DATA_DOUBLE_ESCAPE_END) \
+    X(BeforeAttributeName,                      BEFORE_ATTRIBUTE_NAME) \
+    X(AttributeName,                            ATTRIBUTE_NAME) \
+    X(AfterAttributeName,                       AFTER_ATTRIBUTE_NAME) \
+    X(BeforeAttributeValue,                     BEFORE_ATTRIBUTE_VALUE) \
+    X(AttributeValue_doubleQuoted,              ATTRIBUTE_VALUE_DOUBLE_QUOTED) \
+    X(AttributeValue_singleQuoted,              ATTRIBUTE_VALUE_SINGLE_QUOTED) \
+    X(AttributeValue_unquoted,                  ATTRIBUTE_VALUE_UNQUOTED) \
+    X(AfterAttributeValue_quoted,               AFTER_ATTRIBUTE_VALUE_QUOTED) \
+    X(SelfClosingStartTag,                      SELF_CLOSING_START_TAG) \
+    X(BogusComment,                             BOGUS_COMMENT) \
+    X(MarkupDeclarationOpen,                    MARKUP_DECLARATION_OPEN) \
+    X(CommentStart,                             COMMENT_START) \
+    X(CommentStartDash,                         COMMENT_START_DASH) \
+    X(Comment,                                  COMMENT) \
+    X(CommentEndDash,                           COMMENT_END_DASH) \
+    X(CommentEnd,                               COMMENT_END) \
+    X(CommentEndBang,                           COMMENT_END_BANG) \
+    X(Doctype,                                  DOCTYPE) \
+    X(BeforeDoctypeName,                        BEFORE_DOCTYPE_NAME) \
+    X(DoctypeName,                              DOCTYPE_NAME) \
+    X(AfterDoctypeName,                         AFTER_DOCTYPE_NAME) \
+    X(AfterDoctypePublicKeyword,                AFTER_DOCTYPE_PUBLIC_KEYWORD) \
+    X(BeforeDoctypePublicIdentifier,            BEFORE_DOCTYPE_PUBLIC_IDENTIFIER) \
+    X(DoctypePublicIdentifier_doubleQuoted,     DOCTYPE_PUBLIC_IDENTIFIER_DOUBLE_QUOTED) \
+    X(DoctypePublicIdentifier_singleQuoted,     DOCTYPE_PUBLIC_IDENTIFIER_SINGLE_QUOTED) \
+    X(AfterDoctypePublicIdentifier,             AFTER_DOCTYPE_PUBLIC_IDENTIFIER) \
+    X(BetweenDoctypePublicAndSystemIdentifiers, BETWEEN_DOCTYPE_PUBLIC_AND_SYSTEM_IDENTIFIERS) \
+    X(AfterDoctypeSystemKeyword,                AFTER_DOCTYPE_SYSTEM_KEYWORD) \
+    X(BeforeDoctypeSystemIdentifier,            BEFORE_DOCTYPE_SYSTEM_IDENTIFIER) \
+    X(DoctypeSystemIdentifier_doubleQuoted,     DOCTYPE_SYSTEM_IDENTIFIER_DOUBLE_QUOTED) \
+    X(DoctypeSystemIdentifier_singleQuoted,     DOCTYPE_SYSTEM_IDENTIFIER_SINGLE_QUOTED) \
+    X(AfterDoctypeSystemIdentifier,             AFTER_DOCTYPE_SYSTEM_IDENTIFIER) \
+    X(BogusDoctype,                             BOGUS_DOCTYPE) \
+    X(CdataSection,                             CDATA_SECTION)
+        
+        enum TokeniserStateId {
+#define CSOUP_TOKENISER_STATE_ENUM(StateName, STATE_ID) CSOUP_TOKENISER_STATE_##STATE_ID,
+            CSOUP_TOKENISER_STATES(CSOUP_TOKENISER_STATE_ENUM)
+#undef CSOUP_TOKENISER_STATE_ENUM
+            CSOUP_TOKENISER_STATE_COUNT
+        };
     
         class TokeniserState {
         public:
+            TokeniserState(TokeniserStateId id) : id_(id) {}
+            
             virtual void read(Tokeniser* t, CharacterReader* reader) = 0;
             
+            TokeniserStateId id() const {
+                return id_;
+            }
+            
         protected:
             static void handleDataEndTag(Tokeniser* t, CharacterReader* r, TokeniserState* elseTransition);
             
             static void handleDataDoubleEscapeTag(Tokeniser* t, CharacterReader* r, TokeniserState* primary, TokeniserState* fallback);
             
+            // The *Until helpers stop in front of the first of the (ascii) terms and
+            // return the number of bytes consumed.
             static size_t emitUntil(Tokeniser* t, CharacterReader* reader, CharType* arr,  const size_t n);
             
             static size_t lowercasedAppendUntil(Tokeniser* t, CharacterReader* reader, StringBuffer* buffer, CharType* terms, const size_t n);
@@ -40,85 +125,24 @@ namespace csoup {
             static const int replacementChar_;
             static const CharType* replacementStr_;
             static const int eof_;
+            
+        private:
+            TokeniserStateId id_;
         };
         
-#define CSOUP_REGISTER_TOKENISER_STATE(StateName) \
+#define CSOUP_REGISTER_TOKENISER_STATE(StateName, STATE_ID) \
     class StateName : public TokeniserState { \
     public: \
+        StateName() : TokeniserState(CSOUP_TOKENISER_STATE_##STATE_ID) {} \
         void read(Tokeniser* t, CharacterReader* reader); \
         static StateName* instance() { \
-            static StateName globalInstance; \
-            return &globalInstance; \
+            return &globalInstance_; \
         }\
+    private: \
+        static StateName globalInstance_; \
     };
         
-        CSOUP_REGISTER_TOKENISER_STATE(Data)
-        CSOUP_REGISTER_TOKENISER_STATE(CharacterReferenceInData)
-        CSOUP_REGISTER_TOKENISER_STATE(Rcdata)
-        CSOUP_REGISTER_TOKENISER_STATE(CharacterReferenceInRcdata)
-        CSOUP_REGISTER_TOKENISER_STATE(RawText)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptData)
-        CSOUP_REGISTER_TOKENISER_STATE(PlainText);
-        CSOUP_REGISTER_TOKENISER_STATE(TagOpen)
-        CSOUP_REGISTER_TOKENISER_STATE(EndTagOpen)
-        CSOUP_REGISTER_TOKENISER_STATE(TagName)
-        CSOUP_REGISTER_TOKENISER_STATE(RcdataLessthanSign)
-        CSOUP_REGISTER_TOKENISER_STATE(RCDATAEndTagOpen)
-        CSOUP_REGISTER_TOKENISER_STATE(RCDATAEndTagName)
-        CSOUP_REGISTER_TOKENISER_STATE(RawtextLessthanSign)
-        CSOUP_REGISTER_TOKENISER_STATE(RawtextEndTagOpen)
-        CSOUP_REGISTER_TOKENISER_STATE(RawtextEndTagName)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataLessthanSign)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataEndTagOpen)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataEndTagName)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataEscapeStart)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataEscapeStartDash)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataEscaped)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataEscapedDash)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataEscapedDashDash)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataEscapedLessthanSign)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataEscapedEndTagOpen)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataEscapedEndTagName)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataDoubleEscapeStart)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataDoubleEscaped)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataDoubleEscapedDash)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataDoubleEscapedDashDash)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataDoubleEscapedLessthanSign)
-        CSOUP_REGISTER_TOKENISER_STATE(ScriptDataDoubleEscapeEnd)
-        CSOUP_REGISTER_TOKENISER_STATE(BeforeAttributeName)
-        CSOUP_REGISTER_TOKENISER_STATE(AttributeName)
-        CSOUP_REGISTER_TOKENISER_STATE(AfterAttributeName)
-        CSOUP_REGISTER_TOKENISER_STATE(BeforeAttributeValue)
-        CSOUP_REGISTER_TOKENISER_STATE(AttributeValue_doubleQuoted)
-        CSOUP_REGISTER_TOKENISER_STATE(AttributeValue_singleQuoted)
-        CSOUP_REGISTER_TOKENISER_STATE(AttributeValue_unquoted)
-        CSOUP_REGISTER_TOKENISER_STATE(AfterAttributeValue_quoted)
-        CSOUP_REGISTER_TOKENISER_STATE(SelfClosingStartTag)
-        CSOUP_REGISTER_TOKENISER_STATE(BogusComment)
-        CSOUP_REGISTER_TOKENISER_STATE(MarkupDeclarationOpen)
-        CSOUP_REGISTER_TOKENISER_STATE(CommentStart)
-        CSOUP_REGISTER_TOKENISER_STATE(CommentStartDash)
-        CSOUP_REGISTER_TOKENISER_STATE(Comment)
-        CSOUP_REGISTER_TOKENISER_STATE(CommentEndDash)
-        CSOUP_REGISTER_TOKENISER_STATE(CommentEnd)
-        CSOUP_REGISTER_TOKENISER_STATE(CommentEndBang)
-        CSOUP_REGISTER_TOKENISER_STATE(Doctype)
-        CSOUP_REGISTER_TOKENISER_STATE(BeforeDoctypeName)
-        CSOUP_REGISTER_TOKENISER_STATE(DoctypeName)
-        CSOUP_REGISTER_TOKENISER_STATE(AfterDoctypeName)
-        CSOUP_REGISTER_TOKENISER_STATE(AfterDoctypePublicKeyword)
-        CSOUP_REGISTER_TOKENISER_STATE(BeforeDoctypePublicIdentifier)
-        CSOUP_REGISTER_TOKENISER_STATE(DoctypePublicIdentifier_doubleQuoted)
-        CSOUP_REGISTER_TOKENISER_STATE(DoctypePublicIdentifier_singleQuoted)
-        CSOUP_REGISTER_TOKENISER_STATE(AfterDoctypePublicIdentifier)
-        CSOUP_REGISTER_TOKENISER_STATE(BetweenDoctypePublicAndSystemIdentifiers)
-        CSOUP_REGISTER_TOKENISER_STATE(AfterDoctypeSystemKeyword)
-        CSOUP_REGISTER_TOKENISER_STATE(BeforeDoctypeSystemIdentifier)
-        CSOUP_REGISTER_TOKENISER_STATE(DoctypeSystemIdentifier_doubleQuoted)
-        CSOUP_REGISTER_TOKENISER_STATE(DoctypeSystemIdentifier_singleQuoted)
-        CSOUP_REGISTER_TOKENISER_STATE(AfterDoctypeSystemIdentifier)
-        CSOUP_REGISTER_TOKENISER_STATE(BogusDoctype)
-        CSOUP_REGISTER_TOKENISER_STATE(CdataSection)
+        CSOUP_TOKENISER_STATES(CSOUP_REGISTER_TOKENISER_STATE)
 
 #undef CSOUP_REGISTER_TOKENISER_STATE
     }
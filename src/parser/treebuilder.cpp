@@ -7,6 +7,7 @@
 //
 
 #include "../util/common.h"
+#include "../util/allocators.h"
 #include "../util/stringref.h"
 #include "../util/stringbuffer.h"
 #include "../util/csoup_string.h"
@@ -18,11 +19,12 @@
 #include "token.h"
 #include "tokeniser.h"
 #include "treebuilder.h"
+#include "elementstack.h"
 
 namespace csoup {
     TreeBuilder::TreeBuilder() :
-    allocator_(NULL), reader_(NULL), tokeniser_(NULL), stack_(NULL), currentToken_(NULL),
-    doc_(NULL), errors_(NULL) {
+    allocator_(NULL), pool_(NULL), scratch_(new MemoryPoolAllocator()), scratchAllocator_(NULL), reader_(NULL), tokeniser_(NULL), stack_(NULL), currentToken_(NULL),
+    doc_(NULL), errors_(NULL), baseUri_(NULL), indexDocuments_(false) {
         
     }
     
@@ -48,46 +50,63 @@ namespace csoup {
             doc_ = new (allocator->malloc_t<Document>()) Document(baseUri, allocator);
         }
         
-        reader_ = new (allocator->malloc_t<CharacterReader>()) CharacterReader(input);
-        tokeniser_ = new (allocator->malloc_t<Tokeniser>()) Tokeniser(reader_, errors, allocator);
-        stack_ = new (allocator->malloc_t< internal::Vector<Element*> >()) internal::Vector<Element*>(4, allocator);
-        baseUri_ = new (allocator->malloc_t< String>()) String(baseUri, allocator);
+        if (indexDocuments_) doc_->indexIdsAndClasses();
+        
+        // read from the document's copy so text tokens can stay slices of it
+        StringRef source = doc_->setSource(input);
+        Allocator* scratch = scratchAllocator();
+        reader_ = new (scratch->malloc_t<CharacterReader>()) CharacterReader(source);
+        {
+            AllocationScope scope(CSOUP_ALLOCATION_TOKENS);
+            tokeniser_ = new (scratch->malloc_t<Tokeniser>()) Tokeniser(reader_, errors, scratch);
+        }
+        stack_ = new (scratch->malloc_t<ElementStack>()) ElementStack(scratch);
+        baseUri_ = doc_->sharedBaseUri();
         allocator_ = allocator;
+        pool_ = allocator->memoryPool();
         currentToken_ = NULL;
     }
     
     TreeBuilder::~TreeBuilder() {
         freeResources();
+        delete scratch_;
     }
     
     void TreeBuilder::freeResources() {
         if (allocator_ == NULL) return ;
         
-        allocator_->deconstructAndFree(reader_);            reader_         = NULL;
-        allocator_->deconstructAndFree(tokeniser_);         tokeniser_      = NULL;
-        allocator_->deconstructAndFree(stack_);             stack_          = NULL;
-        allocator_->deconstructAndFree(baseUri_);            baseUri_        = NULL;
+        Allocator* scratch = scratchAllocator();
+        scratch->deconstructAndFree(reader_);               reader_         = NULL;
+        scratch->deconstructAndFree(tokeniser_);            tokeniser_      = NULL;
+        scratch->deconstructAndFree(stack_);                stack_          = NULL;
         if (currentToken_) {
-            allocator_->deconstructAndFree(currentToken_);  currentToken_   = NULL;
+            scratch->deconstructAndFree(currentToken_);     currentToken_   = NULL;
         }
         
+        // keeps the largest chunk for the next parse
+        scratch_->reset();
+        
         // Don't destroy errors_! It's allocator outside treebuilder.
         
         allocator_  = NULL;
+        pool_       = NULL;
         doc_        = NULL;
         errors_     = NULL;
+        baseUri_    = NULL;
     }
     
     void TreeBuilder::runParser() {
         while (true) {
-            Token* token = tokeniser_->read();
+            // the token is the tokeniser's, it stays valid until the next read
+            Token* token;
+            {
+                AllocationScope scope(CSOUP_ALLOCATION_TOKENS);
+                token = tokeniser_->read();
+            }
             process(token);
+            currentToken_ = NULL;
             
-            bool isEnd = token->tokenType() == CSOUP_TOKEN_EOF;
-            token->~Token();
-            tokeniser_->allocator()->free(token);
-            
-            if (isEnd)
+            if (token->isEOFToken())
                 break;
         }
     }
@@ -101,7 +120,20 @@ namespace csoup {
         return *stack_->back();
     }
     
+    Allocator* TreeBuilder::scratchAllocator() {
+        return scratchAllocator_ ? scratchAllocator_ : scratch_;
+    }
+    
+    void TreeBuilder::setScratchAllocator(Allocator* allocator) {
+        CSOUP_ASSERT(allocator_ == NULL);
+        scratchAllocator_ = allocator;
+    }
+    
     StringRef TreeBuilder::baseUri() const {
         return baseUri_ ? baseUri_->ref() : StringRef("");
     }
+    
+    BaseUri* TreeBuilder::sharedBaseUri() {
+        return baseUri_;
+    }
 }
@@ -12,19 +12,18 @@
 
 namespace csoup {
     class String;
+    class BaseUri;
     class Allocator;
+    class MemoryPoolAllocator;
     class Element;
     class CharacterReader;
     class Document;
     class Tokeniser;
     class ParseErrorList;
     class Token;
-
+    class ElementStack;
     
     namespace internal {
-        template <class T>
-        class Vector;
-        
         class TokeniserState;
     }
     
@@ -38,12 +37,14 @@ namespace csoup {
             initialiseParse(input, baseUri, errors, allocator);
             runParser();
             
-            return doc_;
+            Document* doc = doc_;
+            freeResources();
+            return doc;
         }
         
         void setTokeniserState(internal::TokeniserState* state);
         
-        internal::Vector<Element*>* stack() {
+        ElementStack* stack() {
             return stack_;
         }
 
@@ -54,6 +55,31 @@ namespace csoup {
         }
         
         StringRef baseUri() const;
+        
+        // The handle the nodes being created share; see BaseUri.
+        BaseUri* sharedBaseUri();
+        
+        // For data that is only needed while parsing: the reader, the
+        // tokeniser with its tokens and buffers, the stack of open elements
+        // and tokens the tree builder makes up. It is rewound after every
+        // parse, so the document's allocator ends up holding the DOM alone.
+        Allocator* scratchAllocator();
+        
+        MemoryPoolAllocator* scratchPool() {
+            return scratch_;
+        }
+        
+        // Makes scratchAllocator() return allocator instead of the pool, e.g.
+        // an InstrumentingAllocator wrapping scratchPool() to see what a parse
+        // needs on the side; NULL goes back to the pool. Only call it when no
+        // parse is under way.
+        void setScratchAllocator(Allocator* allocator);
+        
+        // Makes the documents parse() builds keep an index of their elements
+        // by id and class from the start, see Document::indexIdsAndClasses().
+        void setIndexDocuments(bool indexDocuments) {
+            indexDocuments_ = indexDocuments;
+        }
 
     protected:
         virtual bool process(Token* token) = 0;
@@ -63,21 +89,25 @@ namespace csoup {
         // of encapsulation in OOP
         
         Allocator* allocator_;
+        MemoryPoolAllocator* pool_;     // allocator_, if it is a pool
+        MemoryPoolAllocator* scratch_;
+        Allocator* scratchAllocator_;   // replaces scratch_ if not NULL
         
         // these are resources needed to be destroied
         CharacterReader* reader_;
         Tokeniser* tokeniser_;
-        internal::Vector<Element*>* stack_; // the stack of open elements
+        ElementStack* stack_; // the stack of open elements
         Token* currentToken_; // currentToken is used only for error tracking.
         
         // don't destroy these two guy!
         Document* doc_; // current doc we are building into
         ParseErrorList* errors_; // null when not tracking errors
-        String* baseUri_;
+        BaseUri* baseUri_;      // the document's, not owned
+        bool indexDocuments_;
         
         void initialiseParse(const StringRef& input, const StringRef& baseUri, ParseErrorList* errors, Allocator* allocator);
         
-        void freeResources();
+        virtual void freeResources();
         
         void runParser();
     };
@@ -32,5 +32,13 @@ namespace csoup {
         return false;
     }
     
-    
+    bool ElementsRef::hasClass(const csoup::StringRef &className) const {
+        for (size_t i = 0; i < contents_.size(); ++ i) {
+            if ((*contents_.at(i))->hasClass(className)) {
+                return true;
+            }
+        }
+        
+        return false;
+    }
 }
\ No newline at end of file
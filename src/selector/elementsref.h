@@ -54,7 +54,7 @@ namespace csoup {
         
         void toggleClass(const StringRef& className);
         
-        bool hasClass(const StringRef& className);
+        bool hasClass(const StringRef& className) const;
         
         StringRef val() const;
         
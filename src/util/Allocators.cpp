@@ -2,11 +2,61 @@
 
 namespace csoup {
     void MemoryPoolAllocator::clear() {
+        peakSize_ = peakSize();
+        
         while(chunkHead_ != 0 && chunkHead_ != userBuffer_) {
             ChunkHeader* next = chunkHead_->next;
             baseAllocator_->free(chunkHead_);
             chunkHead_ = next;
         }
+        
+        if (chunkHead_ != 0)
+            chunkHead_->size = 0;
+        
+        baseAllocator_->free(spare_);
+        spare_ = 0;
+    }
+    
+    void MemoryPoolAllocator::reset(size_t retainedCapacity) {
+        lastSize_ = size();
+        if (lastSize_ > peakSize_)
+            peakSize_ = lastSize_;
+        
+        ChunkHeader* largest = spare_;
+        for (ChunkHeader* c = chunkHead_; c != 0 && c != userBuffer_; c = c->next) {
+            if (largest == 0 || c->capacity > largest->capacity)
+                largest = c;
+        }
+        
+        if (largest != 0 && largest->capacity < retainedCapacity)
+            largest = 0;
+        
+        while (chunkHead_ != 0 && chunkHead_ != userBuffer_) {
+            ChunkHeader* next = chunkHead_->next;
+            if (chunkHead_ != largest)
+                baseAllocator_->free(chunkHead_);
+            chunkHead_ = next;
+        }
+        
+        if (spare_ != largest)
+            baseAllocator_->free(spare_);
+        spare_ = 0;
+        
+        if (largest == 0 && retainedCapacity > 0) {
+            largest = reinterpret_cast<ChunkHeader*>(baseAllocator_->malloc(CSOUP_ALIGN(sizeof(ChunkHeader)) + retainedCapacity));
+            largest->capacity = retainedCapacity;
+            ++ chunkCount_;
+        }
+        
+        if (chunkHead_ != 0) {
+            // the user buffer serves first, as in a new pool
+            chunkHead_->size = 0;
+            spare_ = largest;
+        } else if (largest != 0) {
+            largest->size = 0;
+            largest->next = 0;
+            chunkHead_ = largest;
+        }
     }
     
     size_t MemoryPoolAllocator::size() const {
@@ -16,10 +66,17 @@ namespace csoup {
         return size;
     }
     
+    size_t MemoryPoolAllocator::peakSize() const {
+        size_t current = size();
+        return current > peakSize_ ? current : peakSize_;
+    }
+    
     size_t MemoryPoolAllocator::capacity() const {
         size_t capacity = 0;
         for (ChunkHeader* c = chunkHead_; c != 0; c = c->next)
             capacity += c->capacity;
+        if (spare_ != 0)
+            capacity += spare_->capacity;
         return capacity;
     }
     
@@ -32,9 +89,8 @@ namespace csoup {
             return originalPtr;
         
         // Simply expand it if it is the last allocation and there is sufficient space
-        if (originalPtr == (char *)(chunkHead_ + 1) + chunkHead_->size - originalSize) {
-            size_t increment = static_cast<size_t>(newSize - originalSize);
-            increment = CSOUP_ALIGN(increment);
+        if (originalPtr == chunkData(chunkHead_) + chunkHead_->size - CSOUP_ALIGN(originalSize)) {
+            size_t increment = CSOUP_ALIGN(newSize) - CSOUP_ALIGN(originalSize);
             if (chunkHead_->size + increment <= chunkHead_->capacity) {
                 chunkHead_->size += increment;
                 return originalPtr;
@@ -46,4 +102,317 @@ namespace csoup {
         CSOUP_ASSERT(newBuffer != 0);   // Do not handle out-of-memory explicitly.
         return std::memcpy(newBuffer, originalPtr, originalSize);
     }
-}
\ No newline at end of file
+    
+    void* MemoryPoolAllocator::mallocAligned(size_t size, size_t alignment) {
+        CSOUP_ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+        if (alignment <= CSOUP_MAX_ALIGN)
+            return malloc(size);
+        
+        size = CSOUP_ALIGN(size);
+        size_t padding = 0;
+        if (chunkHead_ != 0)
+            padding = static_cast<size_t>(-reinterpret_cast<uintptr_t>(chunkData(chunkHead_) + chunkHead_->size)) & (alignment - 1);
+        
+        if (chunkHead_ == 0 || chunkHead_->size + padding + size > chunkHead_->capacity) {
+            // a new chunk starts CSOUP_MAX_ALIGN aligned, so this covers any padding
+            const size_t needed = size + alignment - CSOUP_MAX_ALIGN;
+            addChunk(chunk_capacity_ > needed ? chunk_capacity_ : needed);
+            padding = static_cast<size_t>(-reinterpret_cast<uintptr_t>(chunkData(chunkHead_))) & (alignment - 1);
+        }
+        
+        char* buffer = chunkData(chunkHead_) + chunkHead_->size + padding;
+        chunkHead_->size += padding + size;
+        return buffer;
+    }
+    
+    SizeClassAllocator::SizeClassAllocator(size_t slabSize, Allocator* baseAllocator) :
+        Allocator(kNeedFree), slabHead_(0), largeHead_(0), slabCapacity_(slabSize), size_(0),
+        baseAllocator_(baseAllocator), ownBaseAllocator_(0) {
+        CSOUP_ASSERT(slabSize >= sizeof(size_t) + kMaxSmallSize);
+        if (!baseAllocator_)
+            ownBaseAllocator_ = baseAllocator_ = new CrtAllocator();
+        std::memset(freeLists_, 0, sizeof(freeLists_));
+    }
+    
+    SizeClassAllocator::~SizeClassAllocator() {
+        while (slabHead_ != 0) {
+            SlabHeader* next = slabHead_->next;
+            baseAllocator_->free(slabHead_);
+            slabHead_ = next;
+        }
+        
+        while (largeHead_ != 0) {
+            LargeHeader* next = largeHead_->next;
+            baseAllocator_->free(largeHead_);
+            largeHead_ = next;
+        }
+        
+        delete ownBaseAllocator_;
+    }
+    
+    size_t* SizeClassAllocator::carve(size_t sizeClass) {
+        const size_t blockSize = sizeof(size_t) + sizeClass * kGranularity;
+        if (slabHead_ == 0 || slabHead_->size + blockSize > slabHead_->capacity) {
+            SlabHeader* slab = reinterpret_cast<SlabHeader*>(baseAllocator_->malloc(sizeof(SlabHeader) + slabCapacity_));
+            slab->capacity = slabCapacity_;
+            slab->size = 0;
+            slab->next = slabHead_;
+            slabHead_ = slab;
+        }
+        
+        size_t* header = reinterpret_cast<size_t*>(reinterpret_cast<char*>(slabHead_ + 1) + slabHead_->size);
+        slabHead_->size += blockSize;
+        return header;
+    }
+    
+    void* SizeClassAllocator::mallocLarge(size_t size) {
+        LargeHeader* large = reinterpret_cast<LargeHeader*>(baseAllocator_->malloc(sizeof(LargeHeader) + size));
+        large->prev = 0;
+        large->next = largeHead_;
+        large->sizeClass = kLargeClass;
+        if (largeHead_ != 0)
+            largeHead_->prev = large;
+        largeHead_ = large;
+        return large + 1;
+    }
+    
+    void SizeClassAllocator::freeLarge(size_t* header) {
+        LargeHeader* large = reinterpret_cast<LargeHeader*>(reinterpret_cast<char*>(header + 1) - sizeof(LargeHeader));
+        if (large->prev != 0)
+            large->prev->next = large->next;
+        else
+            largeHead_ = large->next;
+        if (large->next != 0)
+            large->next->prev = large->prev;
+        baseAllocator_->free(large);
+    }
+    
+    void* SizeClassAllocator::realloc(void* originalPtr, size_t originalSize, size_t newSize) {
+        if (originalPtr == 0)
+            return malloc(newSize);
+        
+        const size_t sizeClass = *(reinterpret_cast<size_t*>(originalPtr) - 1);
+        if (sizeClass != kLargeClass && newSize <= sizeClass * kGranularity)
+            return originalPtr;
+        
+        void* newBuffer = malloc(newSize);
+        std::memcpy(newBuffer, originalPtr, originalSize < newSize ? originalSize : newSize);
+        free(originalPtr);
+        return newBuffer;
+    }
+    
+    size_t SizeClassAllocator::capacity() const {
+        size_t capacity = 0;
+        for (SlabHeader* s = slabHead_; s != 0; s = s->next)
+            capacity += s->capacity;
+        return capacity;
+    }
+    
+    //! One thread's cached blocks, one list per block size.
+    struct ThreadCacheAllocator::Cache {
+        static const size_t kBucketCount = 8;
+        
+        struct Block {
+            Block* next;
+        };
+        
+        struct Bucket {
+            size_t size;        //!< Size of the blocks in the list, header included.
+            Block* head;
+        };
+        
+        Bucket buckets[kBucketCount];
+        size_t bytes;           //!< Bytes in all lists.
+        bool closed;            //!< Set once the thread is exiting; frees bypass the cache.
+        
+        Cache() : bytes(0), closed(false) {
+            std::memset(buckets, 0, sizeof(buckets));
+        }
+        
+        ~Cache() {
+            release();
+            closed = true;
+        }
+        
+        void release() {
+            for (size_t i = 0; i < kBucketCount; ++ i) {
+                while (buckets[i].head != 0) {
+                    Block* next = buckets[i].head->next;
+                    std::free(buckets[i].head);
+                    buckets[i].head = next;
+                }
+            }
+            bytes = 0;
+        }
+    };
+    
+    thread_local ThreadCacheAllocator::Cache ThreadCacheAllocator::cache_;
+    
+    namespace {
+        // every block starts with its size, header included
+        const size_t kBlockHeaderSize = CSOUP_ALIGN(sizeof(size_t));
+        
+        size_t blockSize(const void* ptr) {
+            return *reinterpret_cast<const size_t*>(reinterpret_cast<const char*>(ptr) - kBlockHeaderSize);
+        }
+    }
+    
+    void* ThreadCacheAllocator::malloc(size_t size) {
+        const size_t total = (size + kBlockHeaderSize + kGranularity - 1) & ~(kGranularity - 1);
+        
+        char* block = 0;
+        if (total <= kMaxCachedSize) {
+            Cache& cache = cache_;
+            for (size_t i = 0; i < Cache::kBucketCount; ++ i) {
+                Cache::Bucket& bucket = cache.buckets[i];
+                if (bucket.size == total && bucket.head != 0) {
+                    block = reinterpret_cast<char*>(bucket.head);
+                    bucket.head = bucket.head->next;
+                    cache.bytes -= total;
+                    break;
+                }
+            }
+        }
+        
+        if (block == 0)
+            block = static_cast<char*>(std::malloc(total));
+        *reinterpret_cast<size_t*>(block) = total;
+        return block + kBlockHeaderSize;
+    }
+    
+    void ThreadCacheAllocator::free(const void* ptr) {
+        if (ptr == 0)
+            return;
+        
+        const size_t total = blockSize(ptr);
+        Cache::Block* block = reinterpret_cast<Cache::Block*>(const_cast<char*>(reinterpret_cast<const char*>(ptr)) - kBlockHeaderSize);
+        Cache& cache = cache_;
+        
+        if (total <= kMaxCachedSize && !cache.closed && cache.bytes + total <= kMaxCachedBytes) {
+            // the list of this size, or an empty one to take over
+            Cache::Bucket* target = 0;
+            for (size_t i = 0; i < Cache::kBucketCount; ++ i) {
+                Cache::Bucket& bucket = cache.buckets[i];
+                if (bucket.size == total) {
+                    target = &bucket;
+                    break;
+                }
+                if (bucket.head == 0 && target == 0)
+                    target = &bucket;
+            }
+            
+            if (target != 0) {
+                target->size = total;
+                block->next = target->head;
+                target->head = block;
+                cache.bytes += total;
+                return;
+            }
+        }
+        
+        std::free(block);
+    }
+    
+    void* ThreadCacheAllocator::realloc(void* originalPtr, size_t originalSize, size_t newSize) {
+        if (originalPtr == 0)
+            return malloc(newSize);
+        
+        if (newSize + kBlockHeaderSize <= blockSize(originalPtr))
+            return originalPtr;
+        
+        void* newBuffer = malloc(newSize);
+        std::memcpy(newBuffer, originalPtr, originalSize < newSize ? originalSize : newSize);
+        free(originalPtr);
+        return newBuffer;
+    }
+    
+    size_t ThreadCacheAllocator::cachedBytes() {
+        return cache_.bytes;
+    }
+    
+    void ThreadCacheAllocator::trim() {
+        cache_.release();
+    }
+    
+    thread_local AllocationCategoryEnum AllocationScope::current_ = CSOUP_ALLOCATION_CATEGORY_COUNT;
+    
+    InstrumentingAllocator::InstrumentingAllocator(Allocator* baseAllocator, AllocationCategoryEnum defaultCategory) :
+        Allocator(baseAllocator->needFree()), baseAllocator_(baseAllocator), defaultCategory_(defaultCategory),
+        liveBytes_(0), peakBytes_(0) {
+        CSOUP_ASSERT(defaultCategory < CSOUP_ALLOCATION_CATEGORY_COUNT);
+        std::memset(stats_, 0, sizeof(stats_));
+    }
+    
+    void InstrumentingAllocator::addLive(AllocationStats* stats, size_t bytes) {
+        stats->liveBytes += bytes;
+        if (stats->liveBytes > stats->peakBytes)
+            stats->peakBytes = stats->liveBytes;
+        liveBytes_ += bytes;
+        if (liveBytes_ > peakBytes_)
+            peakBytes_ = liveBytes_;
+    }
+    
+    void* InstrumentingAllocator::malloc(size_t size) {
+        const AllocationCategoryEnum current = AllocationScope::current();
+        const AllocationCategoryEnum category = current == CSOUP_ALLOCATION_CATEGORY_COUNT ? defaultCategory_ : current;
+        
+        BlockHeader* header = static_cast<BlockHeader*>(baseAllocator_->malloc(CSOUP_ALIGN(sizeof(BlockHeader)) + size));
+        header->size = size;
+        header->category = category;
+        
+        ++ stats_[category].allocations;
+        addLive(&stats_[category], size);
+        return reinterpret_cast<char*>(header) + CSOUP_ALIGN(sizeof(BlockHeader));
+    }
+    
+    void* InstrumentingAllocator::realloc(void* originalPtr, size_t originalSize, size_t newSize) {
+        if (originalPtr == 0)
+            return malloc(newSize);
+        
+        BlockHeader* header = reinterpret_cast<BlockHeader*>(static_cast<char*>(originalPtr) - CSOUP_ALIGN(sizeof(BlockHeader)));
+        const size_t oldSize = header->size;
+        header = static_cast<BlockHeader*>(baseAllocator_->realloc(header, CSOUP_ALIGN(sizeof(BlockHeader)) + originalSize,
+                                                                   CSOUP_ALIGN(sizeof(BlockHeader)) + newSize));
+        header->size = newSize;
+        
+        AllocationStats& stats = stats_[header->category];
+        ++ stats.reallocs;
+        stats.liveBytes -= oldSize;
+        liveBytes_ -= oldSize;
+        addLive(&stats, newSize);
+        return reinterpret_cast<char*>(header) + CSOUP_ALIGN(sizeof(BlockHeader));
+    }
+    
+    void InstrumentingAllocator::free(const void* ptr) {
+        if (ptr == 0)
+            return;
+        
+        const BlockHeader* header = reinterpret_cast<const BlockHeader*>(static_cast<const char*>(ptr) - CSOUP_ALIGN(sizeof(BlockHeader)));
+        AllocationStats& stats = stats_[header->category];
+        ++ stats.frees;
+        stats.liveBytes -= header->size;
+        liveBytes_ -= header->size;
+        baseAllocator_->free(header);
+    }
+    
+    AllocationStats InstrumentingAllocator::total() const {
+        AllocationStats total;
+        std::memset(&total, 0, sizeof(total));
+        for (size_t i = 0; i < CSOUP_ALLOCATION_CATEGORY_COUNT; ++ i) {
+            total.allocations += stats_[i].allocations;
+            total.frees += stats_[i].frees;
+            total.reallocs += stats_[i].reallocs;
+        }
+        total.liveBytes = liveBytes_;
+        total.peakBytes = peakBytes_;
+        return total;
+    }
+    
+    const char* InstrumentingAllocator::categoryName(AllocationCategoryEnum category) {
+        static const char* const kNames[CSOUP_ALLOCATION_CATEGORY_COUNT] = {
+            "nodes", "attributes", "strings", "tokens", "scratch"
+        };
+        CSOUP_ASSERT(category < CSOUP_ALLOCATION_CATEGORY_COUNT);
+        return kNames[category];
+    }
+}
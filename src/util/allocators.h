@@ -24,6 +24,8 @@
 #include "common.h"
 
 namespace csoup {
+    class InstrumentingAllocator;
+    class MemoryPoolAllocator;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Allocator
@@ -72,6 +74,19 @@ concept Allocator {
         virtual void free(const void* ptr) = 0;
         virtual void* realloc(void* ptr, size_t oriSize, size_t newSize) = 0;
         
+        //! The allocation counts, if this is an InstrumentingAllocator.
+        virtual const InstrumentingAllocator* instrumentation() const {
+            return NULL;
+        }
+        
+        //! This, if this is a MemoryPoolAllocator, so that a caller can
+        //! look once and then allocate from the pool without dispatch.
+        virtual MemoryPoolAllocator* memoryPool() {
+            return NULL;
+        }
+        
+        //! Memory for a T. It always goes through the virtual malloc();
+        //! CSOUP_NEW calls the allocator by its own type instead.
         template <typename T>
         T* malloc_t() {
             return static_cast<T*>(malloc(sizeof(T)));
@@ -124,6 +139,44 @@ concept Allocator {
         return &GlobalDumbAllocator;
     }
     
+    //! What an allocation is for, as counted by InstrumentingAllocator.
+    typedef enum {
+        CSOUP_ALLOCATION_NODES,         //!< Node objects, child lists and anything else not below.
+        CSOUP_ALLOCATION_ATTRIBUTES,    //!< Attributes objects and their arrays.
+        CSOUP_ALLOCATION_STRINGS,       //!< Characters of String copies and of the document source.
+        CSOUP_ALLOCATION_TOKENS,        //!< Tokens and their buffers.
+        CSOUP_ALLOCATION_SCRATCH,       //!< Other parser temporaries.
+        CSOUP_ALLOCATION_CATEGORY_COUNT
+    } AllocationCategoryEnum;
+    
+    //! Tags the allocations the calling thread makes while it is alive.
+    /*! Scopes nest; the innermost one wins. Allocations made outside any
+        scope go to the InstrumentingAllocator's default category. Setting a
+        scope costs a thread-local store, whatever the allocator.
+     */
+    class AllocationScope {
+    public:
+        explicit AllocationScope(AllocationCategoryEnum category) : saved_(current_) {
+            current_ = category;
+        }
+        
+        ~AllocationScope() {
+            current_ = saved_;
+        }
+        
+        //! The innermost category, or CSOUP_ALLOCATION_CATEGORY_COUNT outside any scope.
+        static AllocationCategoryEnum current() {
+            return current_;
+        }
+        
+    private:
+        AllocationScope(const AllocationScope&);
+        AllocationScope& operator=(const AllocationScope&);
+        
+        AllocationCategoryEnum saved_;
+        static thread_local AllocationCategoryEnum current_;
+    };
+    
 ///////////////////////////////////////////////////////////////////////////////
 // CrtAllocator
 
@@ -164,10 +217,14 @@ concept Allocator {
 
         The user-buffer is not deallocated by this allocator.
 
+        Every block starts at a multiple of CSOUP_MAX_ALIGN, so any node,
+        vector or string can be placed in it. mallocAligned() serves blocks
+        with a larger alignment, such as cache-line aligned buffers.
+
         \tparam BaseAllocator the allocator type for allocating memory chunks. Default is   CrtAllocator.
         \note implements Allocator concept
      */
-    class MemoryPoolAllocator : public Allocator {
+    class MemoryPoolAllocator CSOUP_FINAL : public Allocator {
     public:
         static const bool kNeedFree = false;    //!< Tell users that no need to call Free() with this allocator. (concept Allocator)
 
@@ -176,7 +233,8 @@ concept Allocator {
             \param baseAllocator The allocator for allocating memory chunks.
          */
         MemoryPoolAllocator(size_t chunkSize = kDefaultChunkCapacity, Allocator* baseAllocator = 0) :
-            Allocator(kNeedFree), chunkHead_(0), chunk_capacity_(chunkSize), userBuffer_(0), baseAllocator_(baseAllocator), ownBaseAllocator_(0)
+            Allocator(kNeedFree), chunkHead_(0), chunk_capacity_(chunkSize), userBuffer_(0), baseAllocator_(baseAllocator), ownBaseAllocator_(0),
+            spare_(0), chunkCount_(0), lastSize_(0), peakSize_(0)
         {
             if (!baseAllocator_)
                 ownBaseAllocator_ = baseAllocator_ = new CrtAllocator();
@@ -190,16 +248,23 @@ concept Allocator {
 
             \param buffer User supplied buffer.
             \param size Size of the buffer in bytes. It must at least larger than sizeof(ChunkHeader).
+                The bytes before the first CSOUP_MAX_ALIGN boundary in the buffer are skipped.
             \param chunkSize The size of memory chunk. The default is kDefaultChunkSize.
             \param baseAllocator The allocator for allocating memory chunks.
          */
         MemoryPoolAllocator(void *buffer, size_t size, size_t chunkSize = kDefaultChunkCapacity, Allocator* baseAllocator = 0) :
-            Allocator(kNeedFree), chunkHead_(0), chunk_capacity_(chunkSize), userBuffer_(buffer), baseAllocator_(baseAllocator), ownBaseAllocator_(0)
+            Allocator(kNeedFree), chunkHead_(0), chunk_capacity_(chunkSize), userBuffer_(buffer), baseAllocator_(baseAllocator), ownBaseAllocator_(0),
+            spare_(0), chunkCount_(0), lastSize_(0), peakSize_(0)
         {
             CSOUP_ASSERT(buffer != 0);
-            CSOUP_ASSERT(size > sizeof(ChunkHeader));
-            chunkHead_ = reinterpret_cast<ChunkHeader*>(buffer);
-            chunkHead_->capacity = size - sizeof(ChunkHeader);
+            if (!baseAllocator_)
+                ownBaseAllocator_ = baseAllocator_ = new CrtAllocator();
+            
+            const size_t skipped = CSOUP_ALIGN(reinterpret_cast<uintptr_t>(buffer)) - reinterpret_cast<uintptr_t>(buffer);
+            CSOUP_ASSERT(size > skipped + CSOUP_ALIGN(sizeof(ChunkHeader)));
+            userBuffer_ = reinterpret_cast<char*>(buffer) + skipped;
+            chunkHead_ = reinterpret_cast<ChunkHeader*>(userBuffer_);
+            chunkHead_->capacity = size - skipped - CSOUP_ALIGN(sizeof(ChunkHeader));
             chunkHead_->size = 0;
             chunkHead_->next = 0;
         }
@@ -215,6 +280,21 @@ concept Allocator {
         //! Deallocates all memory chunks, excluding the user-supplied buffer.
         void clear();
 
+        //! Rewinds the pool to empty but keeps memory for the next use.
+        /*! Everything allocated so far is released at once. The largest chunk
+            and the user-supplied buffer are kept and the other chunks are
+            returned to the base allocator; with a user buffer, allocation
+            starts in it again and the kept chunk is taken up when it is full.
+            If the largest chunk is smaller
+            than retainedCapacity, one chunk of retainedCapacity bytes is kept
+            instead, so that a loop parsing one document after another into
+            the same pool stops calling the base allocator once the retained
+            capacity covers a typical document (see lastSize()).
+
+            \param retainedCapacity Minimum capacity in bytes of the chunk kept.
+         */
+        void reset(size_t retainedCapacity = 0);
+
         //! Computes the total capacity of allocated memory chunks.
         /*! \return total capacity in bytes.
          */
@@ -225,17 +305,43 @@ concept Allocator {
          */
         size_t size() const;
 
+        //! Bytes that were in use when reset() was last called.
+        size_t lastSize() const {
+            return lastSize_;
+        }
+
+        //! Most bytes in use at any time since the pool was created.
+        size_t peakSize() const;
+
+        //! Number of chunks requested from the base allocator so far.
+        size_t chunkCount() const {
+            return chunkCount_;
+        }
+
+        MemoryPoolAllocator* memoryPool() {
+            return this;
+        }
+
         //! Allocates a memory block. (concept Allocator)
         void* malloc(size_t size) {
             size = CSOUP_ALIGN(size);
             if (chunkHead_ == 0 || chunkHead_->size + size > chunkHead_->capacity)
                 addChunk(chunk_capacity_ > size ? chunk_capacity_ : size);
 
-            void *buffer = reinterpret_cast<char *>(chunkHead_ + 1) + chunkHead_->size;
+            void *buffer = chunkData(chunkHead_) + chunkHead_->size;
             chunkHead_->size += size;
             return buffer;
         }
 
+        //! Allocates a memory block starting at a multiple of alignment.
+        /*! The bytes skipped to reach the boundary stay unused. Alignments up
+            to CSOUP_MAX_ALIGN cost nothing over malloc().
+
+            \param size Size of the block in bytes.
+            \param alignment A power of two, e.g. 64 for a cache line.
+         */
+        void* mallocAligned(size_t size, size_t alignment);
+
         //! Resizes a memory block (concept Allocator)
         void* realloc(void* originalPtr, size_t originalSize, size_t newSize);
         
@@ -254,8 +360,15 @@ concept Allocator {
         /*! \param capacity Capacity of the chunk in bytes.
          */
         void addChunk(size_t capacity) {
-            ChunkHeader* chunk = reinterpret_cast<ChunkHeader*>(baseAllocator_->malloc(sizeof(ChunkHeader) + capacity));
-            chunk->capacity = capacity;
+            ChunkHeader* chunk;
+            if (spare_ != 0 && spare_->capacity >= capacity) {
+                chunk = spare_;
+                spare_ = 0;
+            } else {
+                chunk = reinterpret_cast<ChunkHeader*>(baseAllocator_->malloc(CSOUP_ALIGN(sizeof(ChunkHeader)) + capacity));
+                chunk->capacity = capacity;
+                ++ chunkCount_;
+            }
             chunk->size = 0;
             chunk->next = chunkHead_;
             chunkHead_ =  chunk;
@@ -272,11 +385,286 @@ concept Allocator {
             ChunkHeader *next;  //!< Next chunk in the linked list.
         };
 
+        //! First byte a chunk serves; the header is padded to CSOUP_MAX_ALIGN.
+        static char* chunkData(ChunkHeader* chunk) {
+            return reinterpret_cast<char*>(chunk) + CSOUP_ALIGN(sizeof(ChunkHeader));
+        }
+
         ChunkHeader *chunkHead_;    //!< Head of the chunk linked-list. Only the head chunk serves allocation.
         size_t chunk_capacity_;     //!< The minimum capacity of chunk when they are allocated.
         void *userBuffer_;          //!< User supplied buffer.
         Allocator* baseAllocator_;  //!< base allocator for allocating memory chunks.
         Allocator* ownBaseAllocator_;   //!< base allocator created by this object.
+        ChunkHeader* spare_;        //!< Chunk kept by reset() behind the user buffer, used by the next addChunk().
+        size_t chunkCount_;         //!< Chunks requested from baseAllocator_.
+        size_t lastSize_;           //!< size() when reset() was last called.
+        size_t peakSize_;           //!< Largest size() seen by reset() or clear().
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // SizeClassAllocator
+
+    //! Allocator that recycles freed blocks, for documents that get edited.
+    /*! Requests of up to kMaxSmallSize bytes are rounded up to a multiple of
+        kGranularity and served from one free list per size. The lists are
+        refilled from slabs taken from the base allocator. Nodes, attributes,
+        strings and vector headers are all that small, so removing children,
+        removing attributes or setting new values reuses memory that a
+        MemoryPoolAllocator would keep until the document dies, without
+        paying for malloc() per object as CrtAllocator does.
+
+        Every block is preceded by a size_t holding its size class. Larger
+        requests go to the base allocator, and are linked in a list so that
+        the destructor can release the ones still alive. Slabs are only
+        returned to the base allocator by the destructor.
+
+        \note implements Allocator concept
+     */
+    class SizeClassAllocator CSOUP_FINAL : public Allocator {
+    public:
+        static const bool kNeedFree = true;
+
+        //! Constructor with slabSize.
+        /*! \param slabSize The size of the slabs small blocks are cut from.
+            \param baseAllocator The allocator for allocating slabs and large blocks.
+         */
+        SizeClassAllocator(size_t slabSize = kDefaultSlabCapacity, Allocator* baseAllocator = 0);
+
+        //! Destructor.
+        /*! This deallocates all slabs and the large blocks not freed yet.
+         */
+        ~SizeClassAllocator();
+
+        //! Allocates a memory block. (concept Allocator)
+        void* malloc(size_t size) {
+            if (size > kMaxSmallSize)
+                return mallocLarge(size);
+
+            size_t sizeClass = size == 0 ? 1 : (size + kGranularity - 1) / kGranularity;
+            size_t* header = reinterpret_cast<size_t*>(freeLists_[sizeClass]);
+            if (header != 0)
+                freeLists_[sizeClass] = freeLists_[sizeClass]->next;
+            else
+                header = carve(sizeClass);
+
+            *header = sizeClass;
+            size_ += sizeClass * kGranularity;
+            return header + 1;
+        }
+
+        //! Resizes a memory block. (concept Allocator)
+        /*! Stays in place while newSize fits in the block's size class.
+         */
+        void* realloc(void* originalPtr, size_t originalSize, size_t newSize);
+
+        //! Returns a memory block for reuse. (concept Allocator)
+        void free(const void* ptr) {
+            if (ptr == 0)
+                return;
+
+            size_t* header = const_cast<size_t*>(reinterpret_cast<const size_t*>(ptr)) - 1;
+            size_t sizeClass = *header;
+            if (sizeClass == kLargeClass) {
+                freeLarge(header);
+                return;
+            }
+
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(header);
+            block->next = freeLists_[sizeClass];
+            freeLists_[sizeClass] = block;
+            size_ -= sizeClass * kGranularity;
+        }
+
+        //! Computes the total capacity of the slabs.
+        /*! \return total capacity in bytes.
+         */
+        size_t capacity() const;
+
+        //! Bytes in small blocks handed out and not freed yet.
+        size_t size() const {
+            return size_;
+        }
+
+    private:
+        //! Copy constructor is not permitted.
+        SizeClassAllocator(const SizeClassAllocator& rhs) /* = delete */;
+        //! Copy assignment operator is not permitted.
+        SizeClassAllocator& operator=(const SizeClassAllocator& rhs) /* = delete */;
+
+        //! Takes a block of sizeClass from the head slab, adding a slab if needed.
+        size_t* carve(size_t sizeClass);
+
+        void* mallocLarge(size_t size);
+        void freeLarge(size_t* header);
+
+        static const size_t kGranularity = 8;
+        static const size_t kMaxSmallSize = 256;
+        static const size_t kClassCount = kMaxSmallSize / kGranularity + 1;
+        static const size_t kLargeClass = 0;    //!< Size class in the header of a large block.
+        static const size_t kDefaultSlabCapacity = 64 * 1024;
+
+        //! A free block, linked through the space of its header.
+        struct FreeBlock {
+            FreeBlock* next;
+        };
+
+        //! Header of a slab. Slabs are stored as a singly linked list.
+        struct SlabHeader {
+            size_t capacity;    //!< Capacity of the slab in bytes (excluding the header itself).
+            size_t size;        //!< Bytes cut from the slab so far.
+            SlabHeader* next;   //!< Next slab in the linked list.
+        };
+
+        //! Header of a large block; sizeClass is right in front of the block.
+        struct LargeHeader {
+            LargeHeader* prev;
+            LargeHeader* next;
+            size_t sizeClass;   //!< Always kLargeClass.
+        };
+
+        FreeBlock* freeLists_[kClassCount]; //!< Free blocks per size class; 0 is unused.
+        SlabHeader* slabHead_;      //!< Head of the slab list. Only the head slab is cut from.
+        LargeHeader* largeHead_;    //!< Large blocks not freed yet.
+        size_t slabCapacity_;       //!< The capacity of new slabs.
+        size_t size_;               //!< Bytes in small blocks in use.
+        Allocator* baseAllocator_;  //!< base allocator for allocating slabs and large blocks.
+        Allocator* ownBaseAllocator_;   //!< base allocator created by this object.
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // ThreadCacheAllocator
+
+    //! Base allocator that recycles memory chunks per thread.
+    /*! Blocks freed by a thread go to that thread's cache, a few lists of
+        equally sized blocks, and the thread's next malloc() of the same size
+        takes them back without going through std::malloc() and its locks.
+        Use it as the baseAllocator of MemoryPoolAllocator or
+        SizeClassAllocator when many threads parse at once: a worker parsing
+        one document after another keeps getting its own chunks back.
+
+        Sizes are rounded up to kGranularity. Blocks larger than
+        kMaxCachedSize, and blocks freed while the thread already caches
+        kMaxCachedBytes, go straight back to std::free(). A thread's cache is
+        released when the thread exits, or by trim().
+
+        The allocator itself holds no state, so all threads can share one.
+
+        \note implements Allocator concept
+     */
+    class ThreadCacheAllocator CSOUP_FINAL : public Allocator {
+    public:
+        static const bool kNeedFree = true;
+
+        ThreadCacheAllocator() : Allocator(kNeedFree) {}
+
+        //! Allocates a memory block. (concept Allocator)
+        void* malloc(size_t size);
+
+        //! Resizes a memory block. (concept Allocator)
+        /*! Stays in place while newSize fits in the rounded-up block.
+         */
+        void* realloc(void* originalPtr, size_t originalSize, size_t newSize);
+
+        //! Returns a memory block to the calling thread's cache. (concept Allocator)
+        void free(const void* ptr);
+
+        //! Bytes held in the calling thread's cache.
+        static size_t cachedBytes();
+
+        //! Releases the calling thread's cache to std::free().
+        static void trim();
+
+        static const size_t kGranularity = 4096;
+        static const size_t kMaxCachedSize = 4 * 1024 * 1024;
+        static const size_t kMaxCachedBytes = 16 * 1024 * 1024;
+
+    private:
+        struct Cache;
+
+        //! Copy constructor is not permitted.
+        ThreadCacheAllocator(const ThreadCacheAllocator& rhs) /* = delete */;
+        //! Copy assignment operator is not permitted.
+        ThreadCacheAllocator& operator=(const ThreadCacheAllocator& rhs) /* = delete */;
+
+        static thread_local Cache cache_;   //!< The calling thread's cache.
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // InstrumentingAllocator
+
+    //! Counts of one category of allocations.
+    struct AllocationStats {
+        size_t allocations;     //!< Calls to malloc(), and to realloc() with a NULL pointer.
+        size_t frees;
+        size_t reallocs;
+        size_t liveBytes;       //!< Bytes asked for and not freed yet.
+        size_t peakBytes;       //!< Most liveBytes at any time.
+    };
+
+    //! Decorator that counts what goes through another allocator.
+    /*! Every block is preceded by a small header holding its size and
+        category, so live bytes can be counted on free(). The category is
+        the one of the innermost AllocationScope when the block was
+        allocated, or defaultCategory outside any scope; realloc() keeps it.
+
+        Frees are counted whether or not the base allocator frees, so over a
+        MemoryPoolAllocator liveBytes counts what is still in use, not what
+        the pool holds. needFree() is the base allocator's, so a document on
+        an InstrumentingAllocator is torn down the same way as on its base.
+
+        \note implements Allocator concept
+     */
+    class InstrumentingAllocator CSOUP_FINAL : public Allocator {
+    public:
+        //! Constructor.
+        /*! \param baseAllocator The allocator the blocks come from.
+            \param defaultCategory Category of allocations made outside any AllocationScope.
+         */
+        InstrumentingAllocator(Allocator* baseAllocator, AllocationCategoryEnum defaultCategory = CSOUP_ALLOCATION_NODES);
+
+        //! Allocates a memory block. (concept Allocator)
+        void* malloc(size_t size);
+
+        //! Resizes a memory block. (concept Allocator)
+        void* realloc(void* originalPtr, size_t originalSize, size_t newSize);
+
+        //! Frees a memory block. (concept Allocator)
+        void free(const void* ptr);
+
+        const InstrumentingAllocator* instrumentation() const {
+            return this;
+        }
+
+        //! Counts of one category.
+        const AllocationStats& stats(AllocationCategoryEnum category) const {
+            CSOUP_ASSERT(category < CSOUP_ALLOCATION_CATEGORY_COUNT);
+            return stats_[category];
+        }
+
+        //! Counts of all categories; peakBytes is the peak of their sum.
+        AllocationStats total() const;
+
+        //! Name of a category, for reports.
+        static const char* categoryName(AllocationCategoryEnum category);
+
+    private:
+        //! Copy constructor is not permitted.
+        InstrumentingAllocator(const InstrumentingAllocator& rhs) /* = delete */;
+        //! Copy assignment operator is not permitted.
+        InstrumentingAllocator& operator=(const InstrumentingAllocator& rhs) /* = delete */;
+
+        struct BlockHeader {
+            size_t size;
+            size_t category;
+        };
+
+        void addLive(AllocationStats* stats, size_t bytes);
+
+        Allocator* baseAllocator_;
+        AllocationCategoryEnum defaultCategory_;
+        AllocationStats stats_[CSOUP_ALLOCATION_CATEGORY_COUNT];
+        size_t liveBytes_;          //!< liveBytes of all categories.
+        size_t peakBytes_;          //!< Most liveBytes_ at any time.
     };
 
 } // namespace csoup
@@ -46,6 +46,7 @@
  */
 
 #include <cstdlib>  // malloc(), realloc(), free(), size_t
+#include <cstddef>  // std::max_align_t
 #include <cstring>  // memset(), memcpy(), memmove(), memcmp()
 #include <new>
 
@@ -163,15 +164,25 @@
 ///////////////////////////////////////////////////////////////////////////////
 // CSOUP_ALIGN
 
+//! Alignment of every block MemoryPoolAllocator hands out.
+/*! \ingroup CSOUP_CONFIG
+
+    Defaults to the alignment of std::max_align_t (16 bytes on x86-64), which
+    suits any node, vector or string. Must be a power of two.
+*/
+#ifndef CSOUP_MAX_ALIGN
+#define CSOUP_MAX_ALIGN alignof(std::max_align_t)
+#endif
+
 //! Data alignment of the machine.
 /*! \ingroup CSOUP_CONFIG
-    \param x pointer to align
+    \param x size or address to align
 
-    Some machines require strict data alignment. Currently the default uses 4 bytes
-    alignment. User can customize by defining the CSOUP_ALIGN function macro.,
+    Rounds x up to a multiple of CSOUP_MAX_ALIGN. User can customize by defining
+    the CSOUP_ALIGN function macro.
 */
 #ifndef CSOUP_ALIGN
-#define CSOUP_ALIGN(x) ((x + 3u) & ~3u)
+#define CSOUP_ALIGN(x) (((x) + static_cast<size_t>(CSOUP_MAX_ALIGN - 1)) & ~static_cast<size_t>(CSOUP_MAX_ALIGN - 1))
 #endif
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -188,11 +199,11 @@
 #endif
 
 ///////////////////////////////////////////////////////////////////////////////
-// CSOUP_SSE2/CSOUP_SSE42/CSOUP_SIMD
+// CSOUP_SSE2/CSOUP_SSE42/CSOUP_AVX2/CSOUP_SIMD
 
 /*! \def CSOUP_SIMD
     \ingroup CSOUP_CONFIG
-    \brief Enable SSE2/SSE4.2 optimization.
+    \brief Enable SSE2/SSE4.2/AVX2 optimization.
 
     RapidJSON supports optimized implementations for some parsing operations
     based on the SSE2 or SSE4.2 SIMD extensions on modern Intel-compatible
@@ -209,10 +220,14 @@
 
     \c CSOUP_SSE42 takes precedence, if both are defined.
 
+    Additionally defining \c CSOUP_AVX2 compiles AVX2 variants of the text
+    scanning kernels. They are only used when the running CPU supports AVX2,
+    so the binary still runs on older machines.
+
     If any of these symbols is defined, RapidJSON defines the macro
     \c CSOUP_SIMD to indicate the availability of the optimized code.
 */
-#if defined(CSOUP_SSE2) || defined(CSOUP_SSE42) \
+#if defined(CSOUP_SSE2) || defined(CSOUP_SSE42) || defined(CSOUP_AVX2) \
     || defined(CSOUP_DOXYGEN_RUNNING)
 #define CSOUP_SIMD
 #endif
@@ -398,31 +413,51 @@ template<int x> struct StaticAssertTest {};
 #define CSOUP_NOEXCEPT /* noexcept */
 #endif // CSOUP_HAS_CXX11_NOEXCEPT
 
+#ifndef CSOUP_HAS_CXX11_FINAL
+#if defined(__clang__)
+#define CSOUP_HAS_CXX11_FINAL __has_feature(cxx_override_control)
+#elif (defined(CSOUP_GNUC) && (CSOUP_GNUC >= CSOUP_VERSION_CODE(4,7,0)) && defined(__GXX_EXPERIMENTAL_CXX0X__)) || \
+      (defined(_MSC_VER) && _MSC_VER >= 1700)
+#define CSOUP_HAS_CXX11_FINAL 1
+#else
+#define CSOUP_HAS_CXX11_FINAL 0
+#endif
+#endif
+//! Marks the allocators with an inline fast path final, so that calls through
+//! a pointer of their own type are direct and can be inlined.
+#if CSOUP_HAS_CXX11_FINAL
+#define CSOUP_FINAL final
+#else
+#define CSOUP_FINAL /* final */
+#endif // CSOUP_HAS_CXX11_FINAL
+
 // no automatic detection, yet
 #ifndef CSOUP_HAS_CXX11_TYPETRAITS
 #define CSOUP_HAS_CXX11_TYPETRAITS 0
 #endif
 
+// The allocator is called by the type of AllocatorVar, so with a pointer to a
+// final allocator such as MemoryPoolAllocator the calls are direct and inline.
 #define CSOUP_NEW(AllocatorVar, TypeName) \
-    (new ((AllocatorVar)->malloc_t< TypeName >()) TypeName())
+    (new (::csoup::internal::mallocFor< TypeName >(AllocatorVar)) TypeName())
 
 #define CSOUP_NEW1(AllocatorVar, TypeName, Arg1) \
-    (new ((AllocatorVar)->malloc_t< TypeName >()) TypeName(Arg1))
+    (new (::csoup::internal::mallocFor< TypeName >(AllocatorVar)) TypeName(Arg1))
 
 #define CSOUP_NEW2(AllocatorVar, TypeName, Arg1, Arg2) \
-    (new ((AllocatorVar)->malloc_t< TypeName >()) TypeName(Arg1, Arg2))
+    (new (::csoup::internal::mallocFor< TypeName >(AllocatorVar)) TypeName(Arg1, Arg2))
 
 #define CSOUP_NEW3(AllocatorVar, TypeName, Arg1, Arg2, Arg3) \
-    (new ((AllocatorVar)->malloc_t< TypeName >()) TypeName(Arg1, Arg2, Arg3))
+    (new (::csoup::internal::mallocFor< TypeName >(AllocatorVar)) TypeName(Arg1, Arg2, Arg3))
 
 #define CSOUP_NEW4(AllocatorVar, TypeName, Arg1, Arg2, Arg3, Arg4) \
-    (new ((AllocatorVar)->malloc_t< TypeName >()) TypeName(Arg1, Arg2, Arg3, Arg4))
+    (new (::csoup::internal::mallocFor< TypeName >(AllocatorVar)) TypeName(Arg1, Arg2, Arg3, Arg4))
 
 #define CSOUP_NEW5(AllocatorVar, TypeName, Arg1, Arg2, Arg3, Arg4, Arg5) \
-    (new ((AllocatorVar)->malloc_t< TypeName >()) TypeName(Arg1, Arg2, Arg3, Arg4, Arg5))
+    (new (::csoup::internal::mallocFor< TypeName >(AllocatorVar)) TypeName(Arg1, Arg2, Arg3, Arg4, Arg5))
 
 #define CSOUP_DELETE(AllocatorVar, VarToBeFree) \
-    ((AllocatorVar)->deconstructAndFree(VarToBeFree))
+    (::csoup::internal::deleteWith(AllocatorVar, VarToBeFree))
 
 
 //#define CSOUP_ARRAY_LENGTH(ArrayName) (sizeof(ArrayName) / sizeof(*ArrayName))
@@ -453,6 +488,21 @@ namespace csoup {
     size_t arrayLength(T (&arr)[N]) {
         return N;
     }
+    
+    namespace internal {
+        // CSOUP_NEW and CSOUP_DELETE; AllocatorT is whatever the caller holds.
+        template <typename T, typename AllocatorT>
+        T* mallocFor(AllocatorT* allocator) {
+            return static_cast<T*>(allocator->malloc(sizeof(T)));
+        }
+        
+        template <typename AllocatorT, typename T>
+        void deleteWith(AllocatorT* allocator, T* ptr) {
+            if (ptr == NULL) return;
+            ptr->~T();
+            allocator->free(ptr);
+        }
+    }
 }
 
 
@@ -28,9 +28,13 @@ public:
         copyString(str, N - 1, allocator);
     }
     
-    String(const StringRef& str, Allocator* allocator)
+    // The copying constructors take any allocator type, so that one of the
+    // final allocators (MemoryPoolAllocator, SizeClassAllocator) is called
+    // directly. The string keeps it as an Allocator* for the destructor.
+    template <typename AllocatorT>
+    String(const StringRef& str, AllocatorT* allocator)
     : type_(CSOUP_UNDEFINED_STRING) {
-        copyString(str, str.size(), allocator);
+        copyString(str.data(), str.size(), allocator);
     }
 
     explicit String(const CharType* str, Allocator* allocator)
@@ -38,12 +42,14 @@ public:
         copyString(str, internal::strLen(str), allocator);
     }
 
-    String(const CharType* str, const size_t len, Allocator* allocator)
+    template <typename AllocatorT>
+    String(const CharType* str, const size_t len, AllocatorT* allocator)
     : type_(CSOUP_UNDEFINED_STRING) {
         copyString(str, len, allocator);
     }
     
-    String(const String& str, Allocator* allocator) :
+    template <typename AllocatorT>
+    String(const String& str, AllocatorT* allocator) :
         type_(CSOUP_UNDEFINED_STRING) {
         copyString(str.data(), str.size(), allocator);
     }
@@ -92,7 +98,8 @@ private:
 //    static size_t InvertedCopyBitMask;
 //    static size_t MaxStringLength;
     
-    void copyString(const CharType* str, size_t len, Allocator* allocator) {
+    template <typename AllocatorT>
+    void copyString(const CharType* str, size_t len, AllocatorT* allocator) {
         CSOUP_ASSERT(str        != NULL);
         CSOUP_ASSERT(allocator  != NULL);
         
@@ -107,7 +114,8 @@ private:
         data_.ss_.setLength(len);
     }
     
-    void copyLongString(const CharType* str, size_t len, Allocator* allocator) {
+    template <typename AllocatorT>
+    void copyLongString(const CharType* str, size_t len, AllocatorT* allocator) {
         type_                   = CSOUP_LONG_STRING;
         data_.ls_.length_       = len;
         data_.ls_.allocator_    = allocator;
@@ -116,6 +124,7 @@ private:
         if (buffSize == 0) {
             data_.ls_.str_ = "";
         } else {
+            AllocationScope scope(CSOUP_ALLOCATION_STRINGS);
             CharType* buffer = static_cast<CharType*>(allocator->malloc(buffSize));
             std::memcpy(buffer, str, buffSize);
             data_.ls_.str_ = buffer;
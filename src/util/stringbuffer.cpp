@@ -8,28 +8,27 @@
 
 #include "stringbuffer.h"
 
+namespace {
+    const size_t kInitialCapacity = 16;
+}
+
 namespace csoup {
-    void StringBuffer::ensureExtraSize(size_t extraSize) {
-        size_t newLength = length_ + extraSize;
-        size_t newCapacity = capacity_;
+    template <typename AllocatorT>
+    void GenericStringBuffer<AllocatorT>::grow(size_t newLength) {
+        size_t newCapacity = capacity_ == 0 ? kInitialCapacity : capacity_;
         
         while (newCapacity < newLength) {
             newCapacity *= 2;
         }
         
         if (newCapacity != capacity_) {
-            str_ = allocator_->realloc_t<CharType>(str_, capacity_, newCapacity);
+            str_ = static_cast<CharType*>(allocator_->realloc(str_, capacity_ * sizeof(CharType), newCapacity * sizeof(CharType)));
             capacity_ = newCapacity;
         }
     }
     
-    void StringBuffer::appendString(const CharType* src, size_t len) {
-        ensureExtraSize(len);
-        std::memcpy(str_ + length_, src, sizeof(CharType) * len);
-        length_ += len;
-    }
-    
-    void StringBuffer::append(int c) {
+    template <typename AllocatorT>
+    void GenericStringBuffer<AllocatorT>::appendCodePoint(int c) {
         int numBytes, prefix;
         if (c <= 0x7f) {
             numBytes = 0;
@@ -51,15 +50,28 @@ namespace csoup {
         }
     }
     
-    void StringBuffer::tolower() {
-        for (size_t i = 0; i < length_; ++ i) {
-            str_[i] = std::tolower(str_[i]);
+    template <typename AllocatorT>
+    void GenericStringBuffer<AllocatorT>::tolower(size_t begin) {
+        CSOUP_ASSERT(begin <= length_);
+        
+        for (size_t i = begin; i < length_; ++ i) {
+            if (str_[i] >= 'A' && str_[i] <= 'Z') {
+                str_[i] += 'a' - 'A';
+            }
         }
     }
     
-    void StringBuffer::toupper() {
+    template <typename AllocatorT>
+    void GenericStringBuffer<AllocatorT>::toupper() {
         for (size_t i = 0; i < length_; ++ i) {
             str_[i] = std::toupper(str_[i]);
         }
     }
-}
\ No newline at end of file
+    
+    template class GenericStringBuffer<Allocator>;
+    template class GenericStringBuffer<CrtAllocator>;
+    template class GenericStringBuffer<MemoryPoolAllocator>;
+    template class GenericStringBuffer<SizeClassAllocator>;
+    template class GenericStringBuffer<ThreadCacheAllocator>;
+    template class GenericStringBuffer<InstrumentingAllocator>;
+}
@@ -15,16 +15,26 @@
 #include "csoup_string.h"
 
 namespace csoup {
-    class StringBuffer {
+    //! A growable buffer of UTF-8 text.
+    /*! \tparam AllocatorT Allocator for the buffer. StringBuffer uses the
+            virtual Allocator interface; GenericStringBuffer<MemoryPoolAllocator>
+            calls the pool directly. The slow paths are instantiated for the
+            allocators in allocators.h in stringbuffer.cpp. The tokeniser's
+            buffers are StringBuffers: they are cleared and reused, so a parse
+            grows them a few dozen times, and what keeps appending cheap is
+            that append() and appendString() check the capacity inline.
+     */
+    template <typename AllocatorT>
+    class GenericStringBuffer {
     public:
-        typedef Allocator AllocatorType;
+        typedef AllocatorT AllocatorType;
         
-        StringBuffer(Allocator* allocator)
+        GenericStringBuffer(AllocatorT* allocator)
         : str_(NULL), allocator_(allocator), capacity_(0), length_(0) {
             CSOUP_ASSERT(allocator != NULL);
         }
         
-        ~StringBuffer() {
+        ~GenericStringBuffer() {
             if (str_ != NULL) {
                 allocator_->free(str_);
                 str_ = NULL;
@@ -41,7 +51,7 @@ namespace csoup {
         }
         
         StringRef ref() const {
-            return StringRef(str_, length_);
+            return StringRef(data(), length_);
         }
         
         size_t size() const {
@@ -58,9 +68,19 @@ namespace csoup {
             }
         }
         
-        void append(int codePoint);
+        void append(int codePoint) {
+            if (codePoint <= 0x7f && length_ < capacity_) {
+                str_[length_++] = static_cast<CharType>(codePoint);
+            } else {
+                appendCodePoint(codePoint);
+            }
+        }
         
-        void appendString(const CharType* src, size_t len);
+        void appendString(const CharType* src, size_t len) {
+            ensureExtraSize(len);
+            std::memcpy(str_ + length_, src, sizeof(CharType) * len);
+            length_ += len;
+        }
         
         void appendString(const StringRef& str) {
             appendString(str.data(), str.size());
@@ -70,20 +90,32 @@ namespace csoup {
             appendString(str.data(), str.size());
         }
         
-        void tolower();
+        // lowercases ascii letters from position begin on
+        void tolower(size_t begin = 0);
         void toupper();
         
-        Allocator* allocator() {
+        AllocatorT* allocator() {
             return allocator_;
         }
     private:
-        void ensureExtraSize(size_t extraSize);
+        void ensureExtraSize(size_t extraSize) {
+            if (length_ + extraSize > capacity_) grow(length_ + extraSize);
+        }
+        
+        void grow(size_t newLength);
+        void appendCodePoint(int codePoint);
         
         CharType* str_;
-        Allocator* allocator_;
+        AllocatorT* allocator_;
         size_t capacity_;
         size_t length_;
     };
+    
+    class StringBuffer : public GenericStringBuffer<Allocator> {
+    public:
+        StringBuffer(Allocator* allocator) : GenericStringBuffer<Allocator>(allocator) {
+        }
+    };
 }
 
 #endif // CSOUP_STRINGBUFFER_H_
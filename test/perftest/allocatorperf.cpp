@@ -0,0 +1,67 @@
+//
+//  allocatorperf.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include "perftest.h"
+
+#ifdef CSOUP_PERFTEST
+
+#include "util/allocators.h"
+#include "util/csoup_string.h"
+#include "internal/vector.h"
+
+using namespace csoup;
+
+namespace {
+    const size_t kObjectCount = 1000000;
+    
+    // the pools are reset to one chunk this big between runs, so the
+    // runs after the first don't pay for page faults
+    const size_t kRetained = 256 * 1024 * 1024;
+
+    // Hides the allocator's type the way a node's allocator() does, so the
+    // compiler can't devirtualize the calls on its own.
+    Allocator* volatile opaqueAllocator;
+
+    // many short vectors and strings, like the child lists and attribute
+    // values of a document
+    template <typename AllocatorT>
+    size_t buildObjects(AllocatorT* allocator) {
+        size_t total = 0;
+        for (size_t i = 0; i < kObjectCount; ++ i) {
+            internal::Vector<size_t, AllocatorT>* children =
+                new (allocator->malloc(sizeof(internal::Vector<size_t, AllocatorT>))) internal::Vector<size_t, AllocatorT>(1, allocator);
+            for (size_t j = 0; j < 4; ++ j) children->push(j);
+
+            String* value = new (allocator->malloc(sizeof(String))) String(StringRef("an attribute value that is not short"), allocator);
+            total += children->size() + value->size();
+        }
+        return total;
+    }
+}
+
+TEST_F(PerfTest, AllocatorPolicyObjects) {
+    size_t total = 0;
+    MemoryPoolAllocator pool;
+
+    double virtualTime = perftest::bestOf(perftest::kTrialCount, [&]() {
+        pool.reset(kRetained);
+        opaqueAllocator = &pool;
+        total += buildObjects<Allocator>(opaqueAllocator);
+    });
+
+    double poolTime = perftest::bestOf(perftest::kTrialCount, [&]() {
+        pool.reset(kRetained);
+        total += buildObjects(&pool);
+    });
+
+    std::printf("%-40s %10.3f ms\n", "vectors + strings (Allocator)", virtualTime * 1e3);
+    std::printf("%-40s %10.3f ms\n", "vectors + strings (MemoryPoolAllocator)", poolTime * 1e3);
+    EXPECT_GT(total, 0u);
+}
+
+#endif // CSOUP_PERFTEST
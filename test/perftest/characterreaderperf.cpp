@@ -0,0 +1,146 @@
+//
+//  characterreaderperf.cpp
+//  test
+//
+//  Created by mac on 10/17/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include "perftest.h"
+
+#ifdef CSOUP_PERFTEST
+
+#include <vector>
+#include "internal/scan.h"
+#include "parser/characterreader.h"
+#include "util/stringbuffer.h"
+#include "util/allocators.h"
+
+using namespace csoup;
+using namespace csoup::internal;
+
+namespace {
+    const size_t kInputSize = 64 * 1024 * 1024;
+    
+    std::vector<const ScanKernels*> availableKernels() {
+        std::vector<const ScanKernels*> ret;
+        ret.push_back(scalarScanKernels());
+        if (sse2ScanKernels() != NULL) ret.push_back(sse2ScanKernels());
+        if (avx2ScanKernels() != NULL) ret.push_back(avx2ScanKernels());
+        return ret;
+    }
+    
+    // counts the matches by restarting the scan right after every hit
+    template <typename Find>
+    size_t countMatches(const std::string& text, Find find) {
+        const CharType* p = text.data();
+        const CharType* end = p + text.size();
+        size_t count = 0;
+        
+        while ((p = find(p, end)) < end) {
+            ++ count;
+            ++ p;
+        }
+        
+        return count;
+    }
+    
+    void runKernels(const char* what, const std::string& text,
+                    const CharType* needle, size_t needleSize, bool sequence) {
+        std::vector<const ScanKernels*> kernels = availableKernels();
+        size_t expected = 0;
+        
+        for (size_t k = 0; k < kernels.size(); ++ k) {
+            const ScanKernels* kernel = kernels[k];
+            size_t count = 0;
+            double t = perftest::bestOf(perftest::kTrialCount, [&]() {
+                count = countMatches(text, [&](const CharType* b, const CharType* e) {
+                    if (sequence) return kernel->findSequence(b, e, needle, needleSize);
+                    if (needleSize == 1) return kernel->findByte(b, e, needle[0]);
+                    return kernel->findAnyOf(b, e, needle, needleSize);
+                });
+            });
+            
+            if (k == 0) expected = count;
+            EXPECT_EQ(expected, count);
+            
+            std::string name = std::string(what) + " " + kernel->name;
+            perftest::report(name.c_str(), text.size(), t);
+        }
+    }
+}
+
+TEST_F(PerfTest, ScanFindByte) {
+    std::string text = perftest::makeText(kInputSize, 4096, '<');
+    runKernels("findByte '<' (run 4096)", text, "<", 1, false);
+    
+    text = perftest::makeText(kInputSize, 64, '<');
+    runKernels("findByte '<' (run 64)", text, "<", 1, false);
+}
+
+TEST_F(PerfTest, ScanFindAnyOf) {
+    std::string text = perftest::makeText(kInputSize, 4096, '-');
+    const CharType scriptTerms[] = {'-', '<', '\0'};
+    runKernels("findAnyOf {- < \\0}", text, scriptTerms, arrayLength(scriptTerms), false);
+    
+    const CharType valueTerms[] = {'\t', '\n', '\r', '\f', ' ', '&', '>', '\0', '"', '\'', '<', '=', '`'};
+    runKernels("findAnyOf (13 terms)", text, valueTerms, arrayLength(valueTerms), false);
+}
+
+TEST_F(PerfTest, ScanFindSequence) {
+    std::string text = perftest::makeText(kInputSize, 4096, ']');
+    runKernels("findSequence \"]]>\"", text, "]]>", 3, true);
+}
+
+TEST_F(PerfTest, CharacterReaderConsumeTo) {
+    std::string text = perftest::makeText(kInputSize, 0, ' ');
+    text += "]]>";
+    CrtAllocator allocator;
+    StringBuffer output(&allocator);
+    output.reserve(kInputSize);
+    
+    double t = perftest::bestOf(perftest::kTrialCount, [&]() {
+        output.clear();
+        CharacterReader reader(StringRef(text.data(), text.size()));
+        reader.consumeTo(StringRef("]]>"), &output);
+    });
+    EXPECT_EQ(kInputSize, output.size());
+    perftest::report("CharacterReader::consumeTo", text.size(), t);
+    
+    t = perftest::bestOf(perftest::kTrialCount, [&]() {
+        output.clear();
+        CharacterReader reader(StringRef(text.data(), text.size()));
+        reader.consumeToEnd(&output);
+    });
+    EXPECT_EQ(text.size(), output.size());
+    perftest::report("CharacterReader::consumeToEnd", text.size(), t);
+}
+
+namespace {
+    // walks the input one character at a time, the way the tokeniser does
+    void readAll(const char* what, const std::string& text) {
+        size_t chars = 0;
+        double t = perftest::bestOf(perftest::kTrialCount, [&]() {
+            CharacterReader reader(StringRef(text.data(), text.size()));
+            chars = 0;
+            while (reader.peek() != -1) {
+                reader.advance();
+                ++ chars;
+            }
+        });
+        
+        EXPECT_GT(chars, 0u);
+        perftest::report(what, text.size(), t);
+    }
+}
+
+TEST_F(PerfTest, CharacterReaderReadAscii) {
+    readAll("CharacterReader::advance ascii text", perftest::makeText(kInputSize / 4, 0, ' '));
+    readAll("CharacterReader::advance ascii html", perftest::makeHtml(kInputSize / 4));
+}
+
+TEST_F(PerfTest, CharacterReaderReadCjk) {
+    readAll("CharacterReader::advance cjk text", perftest::makeCjkText(kInputSize / 4));
+}
+
+#endif // CSOUP_PERFTEST
@@ -0,0 +1,235 @@
+//
+//  domperf.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include "perftest.h"
+
+#ifdef CSOUP_PERFTEST
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "parser/htmltreebuilder.h"
+#include "parser/parseerrorlist.h"
+#include "nodes/document.h"
+#include "selector/elementsref.h"
+#include "util/allocators.h"
+
+using namespace csoup;
+
+namespace {
+    const size_t kInputSize = 1024 * 1024;
+    const size_t kEditRounds = 20;
+
+    Document* parse(const std::string& html, Allocator* allocator) {
+        CrtAllocator crt;
+        ParseErrorList errors(16, &crt);
+        HtmlTreeBuilder builder(&crt);
+        return builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, allocator);
+    }
+
+    // Rewrites every div under body kEditRounds times: replaces its class,
+    // drops and re-adds its id, removes its first child and appends a new
+    // one. The number of nodes stays the same. Returns the number of edits.
+    size_t edit(Document* doc) {
+        Element* body = static_cast<Element*>(static_cast<Element*>(doc->childNode(0))->childNode(1));
+        size_t edits = 0;
+
+        for (size_t round = 0; round < kEditRounds; ++ round) {
+            for (Node* child = body->firstChild(); child != NULL; child = child->nextSibling()) {
+                if (child->type() != CSOUP_NODE_ELEMENT) continue;
+                Element* div = static_cast<Element*>(child);
+
+                div->addAttribute("class", StringRef(round % 2 ? "item row edited" : "item row"));
+                div->removeAttribute("id");
+                div->addAttribute("id", "edited");
+                if (div->childNodeSize() > 0) {
+                    div->removeChild(static_cast<size_t>(0), true);
+                }
+                div->appendElement("span")->addAttribute("title", "appended by the benchmark");
+                edits += 5;
+            }
+        }
+
+        return edits;
+    }
+
+    // kEditRounds times: gives every 50th div under body its class again,
+    // which takes it out of the middle of the class's elements and puts it
+    // at the end, then looks the class up. Returns the elements found.
+    size_t editAndQuery(Document* doc, Allocator* allocator) {
+        Element* body = static_cast<Element*>(static_cast<Element*>(doc->childNode(0))->childNode(1));
+        size_t found = 0;
+
+        for (size_t round = 0; round < kEditRounds; ++ round) {
+            size_t i = round;
+            for (Node* child = body->firstChild(); child != NULL; child = child->nextSibling()) {
+                if (child->type() != CSOUP_NODE_ELEMENT || ++ i % 50 != 0) continue;
+                static_cast<Element*>(child)->addAttribute("class", "item row");
+            }
+
+            ElementsRef rows(allocator);
+            doc->getElementsByClass("row", &rows);
+            found += rows.size();
+        }
+
+        return found;
+    }
+
+    // visits every node below node, depth first, and adds up their sibling
+    // indexes so the walk can't be optimized away
+    size_t walk(const Node* node) {
+        size_t sum = node->siblingIndex();
+        if (node->type() == CSOUP_NODE_ELEMENT || node->type() == CSOUP_NODE_DOCUMENT) {
+            const Element* el = static_cast<const Element*>(node);
+            for (const Node* child = el->firstChild(); child != NULL; child = child->nextSibling()) {
+                sum += walk(child);
+            }
+        }
+        return sum;
+    }
+
+    // best time of edit() on a freshly parsed document, whose memory comes
+    // from the allocator newAllocator() returns; footprint() of 0 means the
+    // allocator can't tell how much memory it holds
+    template <typename NewAllocator, typename Footprint>
+    void benchmark(const char* name, const std::string& html, NewAllocator newAllocator, Footprint footprint) {
+        double best = 1e30;
+        size_t edits = 0, before = 0, after = 0;
+
+        for (size_t i = 0; i < perftest::kTrialCount; ++ i) {
+            Allocator* allocator = newAllocator();
+            Document* doc = parse(html, allocator);
+            before = footprint(allocator);
+
+            perftest::Timer timer;
+            edits = edit(doc);
+            best = std::min(best, timer.elapsed());
+            after = footprint(allocator);
+
+            CSOUP_DELETE(allocator, doc);
+            delete allocator;
+        }
+
+        std::printf("%-40s %10.3f ms %8.1f ns/edit", name, best * 1e3, best * 1e9 / edits);
+        if (after > 0) {
+            std::printf(", %.2f MB -> %.2f MB", before / 1048576.0, after / 1048576.0);
+        }
+        std::printf("\n");
+    }
+}
+
+TEST_F(PerfTest, DomEdits) {
+    std::string html = perftest::makeHtml(kInputSize);
+
+    benchmark("edit (MemoryPoolAllocator)", html,
+              []() -> Allocator* { return new MemoryPoolAllocator(); },
+              [](Allocator* a) { return static_cast<MemoryPoolAllocator*>(a)->size(); });
+    benchmark("edit (CrtAllocator)", html,
+              []() -> Allocator* { return new CrtAllocator(); },
+              [](Allocator*) { return static_cast<size_t>(0); });
+    benchmark("edit (SizeClassAllocator)", html,
+              []() -> Allocator* { return new SizeClassAllocator(); },
+              [](Allocator* a) { return static_cast<SizeClassAllocator*>(a)->capacity(); });
+}
+
+TEST_F(PerfTest, DomTraversal) {
+    std::string html = perftest::makeHtml(8 * kInputSize);
+    MemoryPoolAllocator pool;
+    Document* doc = parse(html, &pool);
+    MemoryUsage usage = doc->memoryUsage();
+    size_t sum = 0;
+
+    double t = perftest::bestOf(perftest::kTrialCount, [&]() {
+        sum += walk(doc);
+    });
+
+    std::printf("%-40s %10.3f ms %8.2f ns/node\n", "walk", t * 1e3, t * 1e9 / usage.nodes);
+    std::printf("%-40s %10.1f bytes/node (%u nodes)\n", "document memory",
+                static_cast<double>(pool.size()) / usage.nodes, static_cast<unsigned>(usage.nodes));
+    EXPECT_GT(sum, 0u);
+    doc->~Document();
+}
+
+// inserting at and removing from the front of an element with many children
+TEST_F(PerfTest, DomWideEdits) {
+    const size_t kChildren = 100000;
+    CrtAllocator allocator;
+    Element root("div", NULL, &allocator);
+    for (size_t i = 0; i < kChildren; ++ i) root.appendElement("p");
+
+    double t = perftest::bestOf(perftest::kTrialCount, [&]() {
+        for (size_t i = 0; i < kChildren; ++ i) {
+            root.insertElement(0, "span");
+            root.removeChild(static_cast<size_t>(0), true);
+        }
+    });
+
+    std::printf("%-40s %10.3f ms %8.1f ns/edit\n", "insert + remove at front", t * 1e3, t * 1e9 / (2 * kChildren));
+    EXPECT_EQ(kChildren, root.childNodeSize());
+}
+
+// #id and .class lookups with and without the document's index, and what
+// keeping the index costs the parser and edits
+TEST_F(PerfTest, DomIdAndClassLookup) {
+    const size_t kLookups = 1000;
+    std::string html = perftest::makeHtml(kInputSize);
+    CrtAllocator crt;
+    ParseErrorList errors(16, &crt);
+    HtmlTreeBuilder builder(&crt);
+    double parseTime[2], idTime[2], classTime[2], editQueryTime[2], editTime[2];
+    size_t found[2];
+
+    for (int indexed = 0; indexed < 2; ++ indexed) {
+        builder.setIndexDocuments(indexed != 0);
+        parseTime[indexed] = perftest::bestOf(perftest::kTrialCount, [&]() {
+            MemoryPoolAllocator pool;
+            builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &pool)->~Document();
+        });
+
+        MemoryPoolAllocator pool;
+        Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &pool);
+        found[indexed] = 0;
+        idTime[indexed] = perftest::bestOf(perftest::kTrialCount, [&]() {
+            for (size_t i = 0; i < kLookups; ++ i) {
+                char id[32];
+                std::sprintf(id, "d%u", static_cast<unsigned>(i * 7));
+                found[indexed] += doc->getElementById(StringRef(id, std::strlen(id))) != NULL;
+            }
+        });
+        classTime[indexed] = perftest::bestOf(perftest::kTrialCount, [&]() {
+            ElementsRef items(&crt);
+            doc->getElementsByClass("row", &items);
+            found[indexed] += items.size();
+        });
+        perftest::Timer timer;
+        found[indexed] += editAndQuery(doc, &crt);
+        editQueryTime[indexed] = timer.elapsed();
+        timer.start();
+        edit(doc);
+        editTime[indexed] = timer.elapsed();
+        doc->~Document();
+    }
+
+    const char* names[] = { "tree walk", "index" };
+    for (int i = 0; i < 2; ++ i) {
+        char name[64];
+        std::sprintf(name, "parse (%s)", names[i]);
+        perftest::report(name, html.size(), parseTime[i]);
+        std::sprintf(name, "#id (%s)", names[i]);
+        std::printf("%-40s %10.3f ms %8.2f us/lookup\n", name, idTime[i] * 1e3, idTime[i] * 1e6 / kLookups);
+        std::sprintf(name, ".class (%s)", names[i]);
+        std::printf("%-40s %10.3f ms\n", name, classTime[i] * 1e3);
+        std::sprintf(name, "edit + .class (%s)", names[i]);
+        std::printf("%-40s %10.3f ms\n", name, editQueryTime[i] * 1e3);
+        std::sprintf(name, "edit (%s)", names[i]);
+        std::printf("%-40s %10.3f ms\n", name, editTime[i] * 1e3);
+    }
+    EXPECT_EQ(found[0], found[1]);
+}
+
+#endif // CSOUP_PERFTEST
@@ -0,0 +1,146 @@
+//
+//  frozenperf.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include "perftest.h"
+
+#ifdef CSOUP_PERFTEST
+
+#include <cstdio>
+#include "parser/htmltreebuilder.h"
+#include "parser/parseerrorlist.h"
+#include "nodes/document.h"
+#include "nodes/frozendocument.h"
+#include "util/allocators.h"
+#include "util/stringbuffer.h"
+
+using namespace csoup;
+
+namespace {
+    const size_t kInputSize = 8 * 1024 * 1024;
+
+    Document* parse(const std::string& html, Allocator* allocator) {
+        CrtAllocator crt;
+        ParseErrorList errors(16, &crt);
+        HtmlTreeBuilder builder(&crt);
+        return builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, allocator);
+    }
+
+    // a[href] on the object tree: the bytes of the hrefs of all links
+    size_t linkBytes(const Node* node) {
+        if (node->type() != CSOUP_NODE_ELEMENT && node->type() != CSOUP_NODE_DOCUMENT) return 0;
+
+        const Element* el = static_cast<const Element*>(node);
+        size_t bytes = el->tagId() == CSOUP_TAG_A ? el->attr("href").size() : 0;
+        for (const Node* child = el->firstChild(); child != NULL; child = child->nextSibling()) {
+            bytes += linkBytes(child);
+        }
+        return bytes;
+    }
+
+    // the same on the frozen copy, which numbers the nodes in document
+    // order, so a query over the whole document is a scan of the tag ids
+    size_t linkBytes(const FrozenDocument& frozen) {
+        size_t bytes = 0;
+        for (size_t i = 0; i < frozen.size(); ++ i) {
+            if (frozen.tagId(i) == CSOUP_TAG_A) bytes += frozen.attr(i, "href").size();
+        }
+        return bytes;
+    }
+}
+
+TEST_F(PerfTest, FrozenDocumentQueries) {
+    std::string html = perftest::makeHtml(kInputSize);
+    MemoryPoolAllocator pool;
+    Document* doc = parse(html, &pool);
+    CrtAllocator crt;
+    size_t objectBytes = 0, frozenBytes = 0, objectText = 0, frozenText = 0;
+
+    FrozenDocument* frozen = NULL;
+    double freeze = perftest::bestOf(perftest::kTrialCount, [&]() {
+        delete frozen;
+        frozen = new FrozenDocument(doc, &crt);
+    });
+
+    double objectLinks = perftest::bestOf(perftest::kTrialCount, [&]() {
+        objectBytes = linkBytes(doc);
+    });
+    double frozenLinks = perftest::bestOf(perftest::kTrialCount, [&]() {
+        frozenBytes = linkBytes(*frozen);
+    });
+
+    StringBuffer text(&crt);
+    double objectTextTime = perftest::bestOf(perftest::kTrialCount, [&]() {
+        text.clear();
+        doc->appendWholeText(&text);
+        objectText = text.size();
+    });
+    double frozenTextTime = perftest::bestOf(perftest::kTrialCount, [&]() {
+        text.clear();
+        frozen->appendWholeText(0, &text);
+        frozenText = text.size();
+    });
+
+    perftest::report("freeze", html.size(), freeze);
+    perftest::report("a[href] (Document)", html.size(), objectLinks);
+    perftest::report("a[href] (FrozenDocument)", html.size(), frozenLinks);
+    perftest::report("whole text (Document)", html.size(), objectTextTime);
+    perftest::report("whole text (FrozenDocument)", html.size(), frozenTextTime);
+    std::printf("%-40s %10.2f MB (Document) %.2f MB (FrozenDocument)\n", "memory",
+                pool.size() / 1048576.0, frozen->memorySize() / 1048576.0);
+
+    EXPECT_EQ(objectBytes, frozenBytes);
+    EXPECT_EQ(objectText, frozenText);
+    delete frozen;
+    doc->~Document();
+}
+
+// what a later stage of a pipeline pays to get at a page again: parsing it
+// a second time, or loading the snapshot the first stage saved
+TEST_F(PerfTest, FrozenDocumentSnapshotLoad) {
+    const char* kPath = "frozenperf.snapshot";
+    std::string html = perftest::makeHtml(kInputSize);
+    CrtAllocator crt;
+    size_t expected = 0, bytes = 0;
+    {
+        MemoryPoolAllocator pool;
+        Document* doc = parse(html, &pool);
+        FrozenDocument frozen(doc, &crt);
+        ASSERT_EQ(CSOUP_SNAPSHOT_OK, frozen.save(kPath));
+        expected = linkBytes(frozen);
+        doc->~Document();
+    }
+
+    double reparse = perftest::bestOf(perftest::kTrialCount, [&]() {
+        MemoryPoolAllocator pool;
+        Document* doc = parse(html, &pool);
+        bytes = linkBytes(doc);
+        doc->~Document();
+    });
+    EXPECT_EQ(expected, bytes);
+
+    double load = perftest::bestOf(perftest::kTrialCount, [&]() {
+        FrozenDocument frozen(&crt);
+        ASSERT_EQ(CSOUP_SNAPSHOT_OK, frozen.load(kPath));
+        bytes = linkBytes(frozen);
+    });
+    EXPECT_EQ(expected, bytes);
+
+    double loadUnchecked = perftest::bestOf(perftest::kTrialCount, [&]() {
+        FrozenDocument frozen(&crt);
+        ASSERT_EQ(CSOUP_SNAPSHOT_OK, frozen.load(kPath, false));
+        bytes = linkBytes(frozen);
+    });
+    EXPECT_EQ(expected, bytes);
+
+    perftest::report("reparse + a[href]", html.size(), reparse);
+    perftest::report("load snapshot + a[href]", html.size(), load);
+    perftest::report("load unchecked + a[href]", html.size(), loadUnchecked);
+    std::remove(kPath);
+}
+
+#endif // CSOUP_PERFTEST
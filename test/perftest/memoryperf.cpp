@@ -0,0 +1,112 @@
+//
+//  memoryperf.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include "perftest.h"
+
+#ifdef CSOUP_PERFTEST
+
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include "parser/htmltreebuilder.h"
+#include "parser/parseerrorlist.h"
+#include "nodes/document.h"
+#include "util/allocators.h"
+
+using namespace csoup;
+
+namespace {
+    struct Page {
+        std::string name;
+        std::string html;
+    };
+
+    // the synthetic pages, plus every file in the directory named by
+    // CSOUP_PERF_CORPUS, if set
+    std::vector<Page> corpus() {
+        const size_t kSize = 256 * 1024;
+        std::vector<Page> pages;
+        pages.push_back(Page{ "makeHtml", perftest::makeHtml(kSize) });
+        pages.push_back(Page{ "makeTableHtml", perftest::makeTableHtml(kSize) });
+        pages.push_back(Page{ "makeFormattingHtml", perftest::makeFormattingHtml(kSize) });
+        pages.push_back(Page{ "makeNestedHtml", perftest::makeNestedHtml(kSize, 200) });
+
+        const char* dir = std::getenv("CSOUP_PERF_CORPUS");
+        DIR* d = dir ? opendir(dir) : NULL;
+        while (d) {
+            dirent* entry = readdir(d);
+            if (!entry) break;
+            if (entry->d_name[0] == '.') continue;
+
+            std::ifstream in((std::string(dir) + "/" + entry->d_name).c_str(), std::ios::binary);
+            std::stringstream content;
+            content << in.rdbuf();
+            if (content.str().empty()) continue;
+            pages.push_back(Page{ entry->d_name, content.str() });
+        }
+        if (d) closedir(d);
+
+        return pages;
+    }
+
+    void printLine(const char* name, size_t input, const size_t* bytes, size_t pool, size_t scratch) {
+        std::printf("%-24.24s", name);
+        for (size_t i = 0; i <= CSOUP_ALLOCATION_STRINGS; ++ i) {
+            std::printf(" %7.2f", static_cast<double>(bytes[i]) / input);
+        }
+        std::printf(" %7.2f %7.2f %7.2f\n", static_cast<double>(bytes[CSOUP_ALLOCATION_CATEGORY_COUNT]) / input,
+                    static_cast<double>(pool) / input, static_cast<double>(scratch) / input);
+    }
+}
+
+// Bytes of document per byte of input, by category, for each page of the
+// corpus: what the nodes, attributes and strings asked for, what a
+// MemoryPoolAllocator holds for the same document, and the parser's peak
+// scratch use. Not a timing.
+TEST_F(PerfTest, MemoryPerInputByte) {
+    std::vector<Page> pages = corpus();
+    CrtAllocator crt;
+    ParseErrorList errors(16, &crt);
+    HtmlTreeBuilder builder(&crt);
+
+    std::printf("%-24s %7s %7s %7s %7s %7s %7s\n", "bytes per input byte", "nodes", "attrs", "strings", "total", "pool", "scratch");
+    size_t sum[CSOUP_ALLOCATION_CATEGORY_COUNT + 1] = { 0 };
+    size_t inputSum = 0, poolSum = 0, scratchSum = 0;
+
+    for (size_t i = 0; i < pages.size(); ++ i) {
+        const std::string& html = pages[i].html;
+        size_t bytes[CSOUP_ALLOCATION_CATEGORY_COUNT + 1];
+
+        InstrumentingAllocator scratch(builder.scratchPool(), CSOUP_ALLOCATION_SCRATCH);
+        builder.setScratchAllocator(&scratch);
+        InstrumentingAllocator allocator(&crt);
+        Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &allocator);
+        for (size_t c = 0; c < CSOUP_ALLOCATION_CATEGORY_COUNT; ++ c) {
+            bytes[c] = allocator.stats(static_cast<AllocationCategoryEnum>(c)).liveBytes;
+        }
+        bytes[CSOUP_ALLOCATION_CATEGORY_COUNT] = allocator.total().liveBytes;
+        CSOUP_DELETE(&allocator, doc);
+        builder.setScratchAllocator(NULL);
+
+        MemoryPoolAllocator pool;
+        doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &pool);
+        const size_t poolBytes = pool.size();
+        CSOUP_DELETE(&pool, doc);
+
+        printLine(pages[i].name.c_str(), html.size(), bytes, poolBytes, scratch.total().peakBytes);
+        for (size_t c = 0; c <= CSOUP_ALLOCATION_CATEGORY_COUNT; ++ c) sum[c] += bytes[c];
+        inputSum += html.size();
+        poolSum += poolBytes;
+        scratchSum += scratch.total().peakBytes;
+    }
+
+    printLine("corpus", inputSum, sum, poolSum, scratchSum);
+}
+
+#endif // CSOUP_PERFTEST
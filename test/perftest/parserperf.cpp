@@ -0,0 +1,208 @@
+//
+//  parserperf.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include "perftest.h"
+
+#ifdef CSOUP_PERFTEST
+
+#include <algorithm>
+#include <cstdio>
+#include "parser/htmltreebuilder.h"
+#include "parser/parseerrorlist.h"
+#include "nodes/document.h"
+#include "util/allocators.h"
+
+using namespace csoup;
+
+namespace {
+    const size_t kInputSize = 1024 * 1024;
+
+    // parses html into a document in pool and returns the bytes it took
+    size_t parse(const std::string& html, MemoryPoolAllocator* pool) {
+        CrtAllocator allocator;
+        ParseErrorList errors(16, &allocator);
+        HtmlTreeBuilder builder(&allocator);
+
+        Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, pool);
+        size_t used = pool->size();
+        doc->~Document();
+
+        return used;
+    }
+    
+    // best times to parse html and tear the document down again, and of
+    // the teardown alone. A NULL allocator parses into a Document that owns
+    // its MemoryPoolAllocator.
+    void parseThenFree(const std::string& html, Allocator* allocator, double* totalTime, double* freeTime) {
+        CrtAllocator crt;
+        *totalTime = *freeTime = 1e30;
+        
+        for (size_t i = 0; i < perftest::kTrialCount; ++ i) {
+            ParseErrorList errors(16, &crt);
+            HtmlTreeBuilder builder(&crt);
+            
+            perftest::Timer timer;
+            Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, allocator);
+            perftest::Timer freeTimer;
+            if (allocator) {
+                CSOUP_DELETE(allocator, doc);
+            } else {
+                delete doc;
+            }
+            *freeTime = std::min(*freeTime, freeTimer.elapsed());
+            *totalTime = std::min(*totalTime, timer.elapsed());
+        }
+    }
+}
+
+TEST_F(PerfTest, HtmlTreeBuilderParse) {
+    std::string html = perftest::makeHtml(kInputSize);
+    size_t used = 0;
+
+    double t = perftest::bestOf(perftest::kTrialCount, [&]() {
+        MemoryPoolAllocator pool;
+        used = parse(html, &pool);
+    });
+
+    perftest::report("HtmlTreeBuilder::parse", html.size(), t);
+    std::printf("%-40s %10.2f MB for %.2f MB of input\n", "document memory",
+                used / 1048576.0, html.size() / 1048576.0);
+}
+
+TEST_F(PerfTest, HtmlTreeBuilderParseTables) {
+    std::string html = perftest::makeTableHtml(kInputSize);
+
+    double t = perftest::bestOf(perftest::kTrialCount, [&]() {
+        MemoryPoolAllocator pool;
+        parse(html, &pool);
+    });
+
+    perftest::report("HtmlTreeBuilder::parse (tables)", html.size(), t);
+}
+
+TEST_F(PerfTest, HtmlTreeBuilderParseFormatting) {
+    std::string html = perftest::makeFormattingHtml(kInputSize);
+
+    double t = perftest::bestOf(perftest::kTrialCount, [&]() {
+        MemoryPoolAllocator pool;
+        parse(html, &pool);
+    });
+
+    perftest::report("HtmlTreeBuilder::parse (formatting)", html.size(), t);
+}
+
+TEST_F(PerfTest, HtmlTreeBuilderParseNested) {
+    std::string html = perftest::makeNestedHtml(kInputSize, 200);
+
+    double t = perftest::bestOf(perftest::kTrialCount, [&]() {
+        MemoryPoolAllocator pool;
+        parse(html, &pool);
+    });
+
+    perftest::report("HtmlTreeBuilder::parse (nested)", html.size(), t);
+}
+
+// a worker parsing one page after another, with a new pool per page or one
+// pool reset between pages
+TEST_F(PerfTest, HtmlTreeBuilderParseLoop) {
+    const size_t kPages = 200;
+    std::string html = perftest::makeHtml(64 * 1024);
+
+    double fresh = perftest::bestOf(perftest::kTrialCount, [&]() {
+        for (size_t i = 0; i < kPages; ++ i) {
+            MemoryPoolAllocator pool;
+            parse(html, &pool);
+        }
+    });
+
+    MemoryPoolAllocator pool;
+    parse(html, &pool);
+    pool.reset();
+    size_t retained = pool.lastSize();
+    size_t chunks = 0;
+    double reused = perftest::bestOf(perftest::kTrialCount, [&]() {
+        size_t before = pool.chunkCount();
+        for (size_t i = 0; i < kPages; ++ i) {
+            parse(html, &pool);
+            pool.reset(retained);
+        }
+        chunks = pool.chunkCount() - before;
+    });
+
+    perftest::report("parse loop (new pool per page)", kPages * html.size(), fresh);
+    perftest::report("parse loop (pool reset per page)", kPages * html.size(), reused);
+    std::printf("%-40s %10u chunks after warm-up, peak %.2f KB per page\n", "pool reset",
+                static_cast<unsigned>(chunks), pool.peakSize() / 1024.0);
+}
+
+namespace {
+    // looks up every attribute of the elements below el by its key, and one
+    // each doesn't have; returns how many were found
+    size_t lookUpAttributes(const Element* el) {
+        size_t found = 0;
+        const Attributes* attrs = el->attributes();
+        for (size_t i = 0; attrs && i < attrs->size(); ++ i) {
+            found += el->hasAttribute(attrs->get(i)->key().ref());
+        }
+        found += el->hasAttribute("data-missing");
+        
+        for (const Node* child = el->firstChild(); child != NULL; child = child->nextSibling()) {
+            if (child->type() == CSOUP_NODE_ELEMENT) found += lookUpAttributes(static_cast<const Element*>(child));
+        }
+        return found;
+    }
+}
+
+// elements with many attributes, whose building and lookups used to take
+// time quadratic in the number of attributes
+TEST_F(PerfTest, HtmlTreeBuilderParseAttributes) {
+    const size_t counts[] = { 2, 8, 16, 32, 64 };
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++ c) {
+        std::string html = perftest::makeAttributeHtml(kInputSize, counts[c]);
+        
+        double parseTime = perftest::bestOf(perftest::kTrialCount, [&]() {
+            MemoryPoolAllocator pool;
+            parse(html, &pool);
+        });
+        
+        CrtAllocator crt;
+        ParseErrorList errors(16, &crt);
+        HtmlTreeBuilder builder(&crt);
+        Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, NULL);
+        size_t found = 0;
+        double lookUpTime = perftest::bestOf(perftest::kTrialCount, [&]() {
+            found = lookUpAttributes(doc);
+        });
+        
+        char name[64];
+        std::sprintf(name, "parse (%u attributes)", static_cast<unsigned>(counts[c]));
+        perftest::report(name, html.size(), parseTime);
+        std::sprintf(name, "look up (%u attributes)", static_cast<unsigned>(counts[c]));
+        perftest::report(name, html.size(), lookUpTime);
+        EXPECT_LT(0u, found);
+        delete doc;
+    }
+}
+
+TEST_F(PerfTest, HtmlTreeBuilderParseThenFree) {
+    std::string html = perftest::makeHtml(8 * kInputSize);
+    double total, teardown;
+    
+    CrtAllocator crt;
+    parseThenFree(html, &crt, &total, &teardown);
+    perftest::report("parse + free (CrtAllocator)", html.size(), total);
+    perftest::report("free (CrtAllocator)", html.size(), teardown);
+    
+    // the pool's free() does nothing, so the destructors skip the tree walk
+    // and teardown is handing the chunks back
+    parseThenFree(html, NULL, &total, &teardown);
+    perftest::report("parse + free (document pool)", html.size(), total);
+    perftest::report("free (document pool)", html.size(), teardown);
+}
+
+#endif // CSOUP_PERFTEST
@@ -0,0 +1,176 @@
+//
+//  perftest.h
+//  test
+//
+//  Created by mac on 10/17/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#ifndef CSOUP_PERFTEST_H_
+#define CSOUP_PERFTEST_H_
+
+// Performance tests are only compiled when CSOUP_PERFTEST is defined, so the
+// normal unit test run stays fast. Build with -DCSOUP_PERFTEST (and usually
+// -O2 -DNDEBUG) and run with --gtest_filter='*Perf*'.
+#ifdef CSOUP_PERFTEST
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <chrono>
+#include "gtest/gtest/gtest.h"
+
+namespace csoup {
+    namespace perftest {
+        const size_t kTrialCount = 10;
+        
+        // Wall clock timer in seconds.
+        class Timer {
+        public:
+            Timer() { start(); }
+            
+            void start() {
+                start_ = std::chrono::steady_clock::now();
+            }
+            
+            double elapsed() const {
+                return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+            }
+        private:
+            std::chrono::steady_clock::time_point start_;
+        };
+        
+        // Runs func repeatedly and returns the best time of one run in seconds.
+        template <typename Func>
+        double bestOf(size_t trialCount, Func func) {
+            double best = 1e30;
+            for (size_t i = 0; i < trialCount; ++ i) {
+                Timer timer;
+                func();
+                double t = timer.elapsed();
+                if (t < best) best = t;
+            }
+            return best;
+        }
+        
+        inline void report(const char* name, size_t bytes, double seconds) {
+            std::printf("%-40s %10.3f ms %8.3f GB/s\n", name, seconds * 1e3,
+                        static_cast<double>(bytes) / seconds / 1e9);
+        }
+        
+        // Synthetic html: nested paragraphs and links with a few attributes,
+        // plain ASCII text, a script block and a comment every so often.
+        inline std::string makeHtml(size_t minSize) {
+            std::string html("<!DOCTYPE html><html><head><title>perf</title></head><body>\n");
+            for (size_t i = 0; html.size() < minSize; ++ i) {
+                char buf[64];
+                std::sprintf(buf, "%u", static_cast<unsigned>(i));
+                html += "<div id=\"d";
+                html += buf;
+                html += "\" class=\"item row\"><p>Lorem ipsum dolor sit amet, consectetur adipiscing elit, "
+                        "sed do eiusmod tempor <a href=\"/page/";
+                html += buf;
+                html += "\">incididunt</a> ut labore et dolore magna aliqua.</p>\n";
+                if (i % 8 == 0) {
+                    html += "<script>var x = 1; if (x < 2) { x = x + 1; }</script>\n";
+                }
+                if (i % 16 == 0) {
+                    html += "<!-- a comment that goes on for a little while -->\n";
+                }
+                html += "</div>\n";
+            }
+            html += "</body></html>\n";
+            return html;
+        }
+        
+        // A page of tables: rows of cells with a little text, which keeps the
+        // tree builder in its table states.
+        inline std::string makeTableHtml(size_t minSize) {
+            std::string html("<!DOCTYPE html><html><head><title>tables</title></head><body>\n");
+            for (size_t i = 0; html.size() < minSize; ++ i) {
+                html += "<table class=\"grid\"><thead><tr><th>name</th><th>value</th><th>note</th></tr></thead><tbody>\n";
+                for (size_t row = 0; row < 16; ++ row) {
+                    html += "<tr><td>item</td><td>42</td><td><a href=\"/x\">more</a></td></tr>\n";
+                }
+                html += "</tbody></table>\n";
+            }
+            html += "</body></html>\n";
+            return html;
+        }
+        
+        // Prose that is mostly inline formatting, including misnested tags
+        // that need the formatting element reconstruction and the adoption
+        // agency.
+        inline std::string makeFormattingHtml(size_t minSize) {
+            std::string html("<!DOCTYPE html><html><head><title>formatting</title></head><body>\n");
+            while (html.size() < minSize) {
+                html += "<p>Some <b>bold</b>, <i>italic</i> and <em>emphasised <strong>strong</strong></em> text, "
+                        "<code>code</code>, <small>small</small> and <b>misnested <i>tags</b> here</i>.\n"
+                        "<p><font>formatting <u>that <s>spans</s> lines</u>\n</font>"
+                        "<h2>A <span>heading</span></h2><ul><li>one<li>two<li><tt>three</tt></ul>\n";
+            }
+            html += "</body></html>\n";
+            return html;
+        }
+        
+        // Forum threads where every reply quotes the one before it, so the
+        // open element stack gets depth levels deep.
+        inline std::string makeNestedHtml(size_t minSize, size_t depth) {
+            std::string html("<!DOCTYPE html><html><head><title>thread</title></head><body>\n");
+            while (html.size() < minSize) {
+                for (size_t i = 0; i < depth; ++ i) {
+                    html += "<div class=\"post\"><div class=\"quote\"><span class=\"author\">someone</span> wrote:"
+                            "<p>I <em>really</em> think so.</p>\n";
+                }
+                for (size_t i = 0; i < depth; ++ i) {
+                    html += "</div></div>\n";
+                }
+            }
+            html += "</body></html>\n";
+            return html;
+        }
+        
+        // Tracking pixels and svg shapes with attributeCount attributes each,
+        // data-* keys that mostly differ only near the end, as analytics tags
+        // write them.
+        inline std::string makeAttributeHtml(size_t minSize, size_t attributeCount) {
+            std::string html("<!DOCTYPE html><html><head><title>attributes</title></head><body>\n");
+            for (size_t i = 0; html.size() < minSize; ++ i) {
+                html += i % 2 ? "<img src=\"/pixel.gif\"" : "<svg><path d=\"M0 0L10 10\"";
+                for (size_t j = 1; j < attributeCount; ++ j) {
+                    char buf[64];
+                    std::sprintf(buf, " data-track-%u=\"%u\"", static_cast<unsigned>(j), static_cast<unsigned>(i));
+                    html += buf;
+                }
+                html += i % 2 ? ">\n" : "/></svg>\n";
+            }
+            html += "</body></html>\n";
+            return html;
+        }
+        
+        // size bytes of text without any markup; every run of runLength bytes
+        // ends with stop, which is what the scanners look for.
+        inline std::string makeText(size_t size, size_t runLength, char stop) {
+            std::string text(size, 'x');
+            for (size_t i = 0; i < size; ++ i) {
+                text[i] = "abcdefghij klmnopqrstuvwxyz"[i % 27];
+                if (runLength != 0 && i % runLength == runLength - 1) text[i] = stop;
+            }
+            return text;
+        }
+        
+        // Repeats a short CJK sentence (3 byte utf-8 sequences) up to size bytes.
+        inline std::string makeCjkText(size_t size) {
+            const char sentence[] = "\xe4\xbd\xa0\xe5\xa5\xbd\xef\xbc\x8c\xe4\xb8\x96\xe7\x95\x8c\xe3\x80\x82";
+            std::string text;
+            while (text.size() + sizeof(sentence) - 1 <= size) text += sentence;
+            return text;
+        }
+    }
+}
+
+class PerfTest : public ::testing::Test {
+};
+
+#endif // CSOUP_PERFTEST
+#endif // CSOUP_PERFTEST_H_
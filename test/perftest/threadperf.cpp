@@ -0,0 +1,80 @@
+//
+//  threadperf.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include "perftest.h"
+
+#ifdef CSOUP_PERFTEST
+
+#include <thread>
+#include <vector>
+#include "parser/htmltreebuilder.h"
+#include "parser/parseerrorlist.h"
+#include "nodes/document.h"
+#include "util/allocators.h"
+
+using namespace csoup;
+
+namespace {
+    const size_t kPagesPerThread = 100;
+
+    // one worker of a parse farm: parses html kPagesPerThread times, each
+    // page into a new pool whose chunks come from base; a NULL base puts the
+    // nodes straight on a CrtAllocator instead
+    void parsePages(const std::string& html, Allocator* base) {
+        CrtAllocator crt;
+        HtmlTreeBuilder builder(&crt);
+
+        for (size_t i = 0; i < kPagesPerThread; ++ i) {
+            ParseErrorList errors(16, &crt);
+            if (base) {
+                MemoryPoolAllocator pool(64 * 1024, base);
+                Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &pool);
+                CSOUP_DELETE(&pool, doc);
+            } else {
+                Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &crt);
+                CSOUP_DELETE(&crt, doc);
+            }
+        }
+    }
+
+    double farm(const std::string& html, Allocator* base, size_t threadCount) {
+        return perftest::bestOf(3, [&]() {
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < threadCount; ++ i)
+                threads.push_back(std::thread(parsePages, std::cref(html), base));
+            for (size_t i = 0; i < threadCount; ++ i)
+                threads[i].join();
+        });
+    }
+}
+
+// throughput of 1 to hardware_concurrency() threads parsing at once
+TEST_F(PerfTest, ParseFarmScaling) {
+    std::string html = perftest::makeHtml(64 * 1024);
+    size_t maxThreads = std::thread::hardware_concurrency();
+    if (maxThreads < 2) maxThreads = 2;
+
+    CrtAllocator crt;
+    ThreadCacheAllocator cache;
+
+    for (size_t threads = 1; ; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads) {
+        const size_t bytes = threads * kPagesPerThread * html.size();
+        char name[64];
+
+        std::sprintf(name, "%2u threads, CrtAllocator nodes", static_cast<unsigned>(threads));
+        perftest::report(name, bytes, farm(html, NULL, threads));
+        std::sprintf(name, "%2u threads, pool on CrtAllocator", static_cast<unsigned>(threads));
+        perftest::report(name, bytes, farm(html, &crt, threads));
+        std::sprintf(name, "%2u threads, pool on ThreadCacheAllocator", static_cast<unsigned>(threads));
+        perftest::report(name, bytes, farm(html, &cache, threads));
+
+        if (threads == maxThreads) break;
+    }
+}
+
+#endif // CSOUP_PERFTEST
@@ -0,0 +1,55 @@
+//
+//  tokeniserperf.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include "perftest.h"
+
+#ifdef CSOUP_PERFTEST
+
+#include "parser/characterreader.h"
+#include "parser/tokeniser.h"
+#include "parser/token.h"
+#include "parser/parseerrorlist.h"
+#include "util/allocators.h"
+
+using namespace csoup;
+
+namespace {
+    const size_t kInputSize = 16 * 1024 * 1024;
+    
+    // returns the number of tokens
+    size_t tokenise(const std::string& html) {
+        CrtAllocator allocator;
+        CharacterReader reader(StringRef(html.data(), html.size()));
+        ParseErrorList errors(16, &allocator);
+        Tokeniser tokeniser(&reader, &errors, &allocator);
+        
+        size_t count = 0;
+        while (true) {
+            Token* token = tokeniser.read();
+            ++ count;
+            
+            if (token->isEOFToken()) break;
+        }
+        
+        return count;
+    }
+}
+
+TEST_F(PerfTest, Tokeniser) {
+    std::string html = perftest::makeHtml(kInputSize);
+    size_t count = 0;
+    
+    double t = perftest::bestOf(perftest::kTrialCount, [&]() {
+        count = tokenise(html);
+    });
+    
+    EXPECT_GT(count, 0u);
+    perftest::report("Tokeniser::read", html.size(), t);
+}
+
+#endif // CSOUP_PERFTEST
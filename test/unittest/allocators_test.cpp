@@ -0,0 +1,434 @@
+//
+//  allocators_test.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include <cstring>
+#include <thread>
+#include "gtest/gtest/gtest.h"
+#include "util/allocators.h"
+#include "util/stringbuffer.h"
+#include "util/csoup_string.h"
+#include "internal/vector.h"
+#include "nodes/document.h"
+#include "parser/htmltreebuilder.h"
+#include "parser/parseerrorlist.h"
+
+using namespace csoup;
+
+namespace {
+    // allocates bytes in blocks of at most 1000 bytes, touching all of them
+    void fill(MemoryPoolAllocator* pool, size_t bytes) {
+        while (bytes > 0) {
+            size_t n = bytes < 1000 ? bytes : 1000;
+            std::memset(pool->malloc(n), 0xab, n);
+            bytes -= n;
+        }
+    }
+    
+    bool aligned(const void* p, size_t alignment) {
+        return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+    }
+    
+    // checks node and everything below it, and records which node types it met
+    void expectAligned(const Node* node, bool* seen) {
+        seen[node->type()] = true;
+        EXPECT_TRUE(aligned(node, CSOUP_MAX_ALIGN)) << "node type " << node->type();
+        
+        if (node->type() != CSOUP_NODE_ELEMENT && node->type() != CSOUP_NODE_FORMELEMENT &&
+            node->type() != CSOUP_NODE_DOCUMENT) return;
+        
+        const Element* el = static_cast<const Element*>(node);
+        if (el->attributes()) {
+            EXPECT_TRUE(aligned(el->attributes(), CSOUP_MAX_ALIGN));
+        }
+        for (size_t i = 0; i < el->childNodeSize(); ++ i) {
+            expectAligned(el->childNode(i), seen);
+        }
+    }
+    
+    // parses a page with every node type into pool and checks their alignment
+    void expectNodesAligned(MemoryPoolAllocator* pool) {
+        const char* html = "<html><head><script>var x = 1;</script></head><body><!-- c -->"
+                           "<form id=f><input name=a></form><p class=x>text</p></body></html>";
+        CrtAllocator crt;
+        ParseErrorList errors(16, &crt);
+        HtmlTreeBuilder builder(&crt);
+        
+        // an odd-sized block first, so nothing lines up by accident
+        pool->malloc(3);
+        Document* doc = builder.parse(StringRef(html), StringRef("http://example.com/"), &errors, pool);
+        
+        bool seen[CSOUP_NODE_FORMELEMENT + 1] = { false };
+        expectAligned(doc, seen);
+        EXPECT_TRUE(seen[CSOUP_NODE_DOCUMENT]);
+        EXPECT_TRUE(seen[CSOUP_NODE_ELEMENT]);
+        EXPECT_TRUE(seen[CSOUP_NODE_FORMELEMENT]);
+        EXPECT_TRUE(seen[CSOUP_NODE_TEXT]);
+        EXPECT_TRUE(seen[CSOUP_NODE_COMMENT]);
+        EXPECT_TRUE(seen[CSOUP_NODE_CDATA]);
+        
+        CSOUP_DELETE(pool, doc);
+    }
+}
+
+TEST(MemoryPoolAllocatorTest, ResetKeepsLargestChunk) {
+    MemoryPoolAllocator pool(4096);
+    fill(&pool, 3000);
+    pool.malloc(10000);
+    fill(&pool, 3000);
+
+    EXPECT_EQ(3u, pool.chunkCount());
+    EXPECT_EQ(6 * CSOUP_ALIGN(1000) + 10000, pool.size());
+
+    pool.reset();
+    EXPECT_EQ(0u, pool.size());
+    EXPECT_EQ(10000u, pool.capacity());
+    EXPECT_EQ(6 * CSOUP_ALIGN(1000) + 10000, pool.lastSize());
+
+    // fits in the chunk that was kept
+    fill(&pool, 9000);
+    EXPECT_EQ(3u, pool.chunkCount());
+}
+
+TEST(MemoryPoolAllocatorTest, ResetWithRetainedCapacityStopsAllocating) {
+    MemoryPoolAllocator pool(4096);
+    fill(&pool, 50000);
+    pool.reset(64 * 1024);
+    EXPECT_EQ(64u * 1024, pool.capacity());
+
+    size_t chunks = pool.chunkCount();
+    for (int i = 0; i < 10; ++ i) {
+        fill(&pool, 50000);
+        pool.reset(64 * 1024);
+    }
+
+    EXPECT_EQ(chunks, pool.chunkCount());
+    EXPECT_EQ(64u * 1024, pool.capacity());
+}
+
+TEST(MemoryPoolAllocatorTest, PeakSizeSurvivesReset) {
+    MemoryPoolAllocator pool(4096);
+    fill(&pool, 20000);
+    size_t big = pool.size();
+    pool.reset();
+
+    fill(&pool, 100);
+    EXPECT_EQ(big, pool.lastSize());
+    EXPECT_EQ(big, pool.peakSize());
+
+    pool.reset();
+    EXPECT_EQ(CSOUP_ALIGN(100), pool.lastSize());
+    EXPECT_EQ(big, pool.peakSize());
+}
+
+TEST(MemoryPoolAllocatorTest, ResetRewindsUserBuffer) {
+    char buffer[1024];
+    MemoryPoolAllocator pool(buffer, sizeof(buffer), 4096);
+
+    void* first = pool.malloc(100);
+    fill(&pool, 10000);
+    size_t chunks = pool.chunkCount();
+    pool.reset();
+
+    // the user buffer serves first again, then the chunk that was kept
+    EXPECT_EQ(0u, pool.size());
+    EXPECT_EQ(first, pool.malloc(100));
+    fill(&pool, 4000);
+    EXPECT_EQ(chunks, pool.chunkCount());
+
+    pool.clear();
+    EXPECT_EQ(0u, pool.size());
+    EXPECT_EQ(first, pool.malloc(100));
+}
+
+TEST(MemoryPoolAllocatorTest, BlocksAreMaxAligned) {
+    MemoryPoolAllocator pool(4096);
+    for (size_t size = 1; size < 300; size += 7) {
+        EXPECT_TRUE(aligned(pool.malloc(size), CSOUP_MAX_ALIGN)) << size;
+    }
+    
+    char* p = static_cast<char*>(pool.malloc(5));
+    EXPECT_EQ(p, pool.realloc(p, 5, 9));
+    EXPECT_TRUE(aligned(pool.malloc(1), CSOUP_MAX_ALIGN));
+}
+
+TEST(MemoryPoolAllocatorTest, NodesAreMaxAligned) {
+    MemoryPoolAllocator pool(1024);
+    expectNodesAligned(&pool);
+    
+    // a user buffer that doesn't start on a boundary
+    char buffer[8192];
+    MemoryPoolAllocator userPool(buffer + 1, sizeof(buffer) - 1, 1024);
+    EXPECT_TRUE(aligned(userPool.malloc(1), CSOUP_MAX_ALIGN));
+    EXPECT_LE(userPool.capacity(), sizeof(buffer) - 1);
+    expectNodesAligned(&userPool);
+}
+
+TEST(MemoryPoolAllocatorTest, MallocAligned) {
+    MemoryPoolAllocator pool(4096);
+    for (size_t i = 0; i < 100; ++ i) {
+        pool.malloc(i % 5 + 1);
+        void* line = pool.mallocAligned(i + 1, 64);
+        EXPECT_TRUE(aligned(line, 64));
+        std::memset(line, 0xcd, i + 1);
+    }
+    
+    // bigger than a chunk, and more than the chunk's own alignment
+    EXPECT_TRUE(aligned(pool.mallocAligned(10000, 64), 64));
+    EXPECT_TRUE(aligned(pool.mallocAligned(100, 4096), 4096));
+    EXPECT_TRUE(aligned(pool.mallocAligned(3, 1), CSOUP_MAX_ALIGN));
+    
+    char buffer[1024];
+    MemoryPoolAllocator userPool(buffer + 3, sizeof(buffer) - 3, 4096);
+    userPool.malloc(1);
+    char* line = static_cast<char*>(userPool.mallocAligned(64, 64));
+    EXPECT_TRUE(aligned(line, 64));
+    EXPECT_TRUE(line >= buffer && line + 64 <= buffer + sizeof(buffer));
+}
+
+TEST(SizeClassAllocatorTest, FreedBlocksAreReused) {
+    SizeClassAllocator allocator;
+    void* a = allocator.malloc(40);
+    void* b = allocator.malloc(40);
+    void* c = allocator.malloc(100);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(184u, allocator.size());
+
+    allocator.free(a);
+    allocator.free(c);
+    EXPECT_EQ(40u, allocator.size());
+
+    // same size class, last freed first
+    EXPECT_EQ(a, allocator.malloc(33));
+    EXPECT_EQ(c, allocator.malloc(100));
+    EXPECT_NE(b, allocator.malloc(8));
+
+    allocator.free(b);
+    EXPECT_EQ(64 * 1024u, allocator.capacity());
+}
+
+TEST(SizeClassAllocatorTest, ReallocStaysInSizeClass) {
+    SizeClassAllocator allocator;
+    char* p = static_cast<char*>(allocator.malloc(10));
+    std::memcpy(p, "abcdefghij", 10);
+
+    EXPECT_EQ(p, allocator.realloc(p, 10, 16));
+
+    char* q = static_cast<char*>(allocator.realloc(p, 16, 1000));
+    EXPECT_NE(p, q);
+    EXPECT_EQ(0, std::memcmp(q, "abcdefghij", 10));
+
+    // back to small, and the block p had is free again
+    char* r = static_cast<char*>(allocator.realloc(q, 1000, 12));
+    EXPECT_EQ(p, r);
+    EXPECT_EQ(0, std::memcmp(r, "abcdefghij", 10));
+    allocator.free(r);
+    EXPECT_EQ(0u, allocator.size());
+}
+
+TEST(SizeClassAllocatorTest, DestructorReleasesLargeBlocks) {
+    SizeClassAllocator allocator(4096);
+    void* large = allocator.malloc(10000);
+    std::memset(large, 0, 10000);
+    allocator.malloc(20000);
+    allocator.free(large);
+
+    for (int i = 0; i < 200; ++ i)
+        allocator.malloc(200);
+    EXPECT_GE(allocator.capacity(), 200u * 208);
+}
+
+TEST(ThreadCacheAllocatorTest, FreedBlocksAreReused) {
+    ThreadCacheAllocator allocator;
+    ThreadCacheAllocator::trim();
+    
+    void* chunk = allocator.malloc(50000);
+    std::memset(chunk, 0, 50000);
+    allocator.free(chunk);
+    size_t cached = ThreadCacheAllocator::cachedBytes();
+    EXPECT_GE(cached, 50000u);
+    
+    // rounded up to the same block size
+    EXPECT_EQ(chunk, allocator.malloc(52000));
+    EXPECT_EQ(0u, ThreadCacheAllocator::cachedBytes());
+    EXPECT_EQ(chunk, allocator.realloc(chunk, 52000, 53000));
+    allocator.free(chunk);
+    
+    // too big to keep
+    allocator.free(allocator.malloc(ThreadCacheAllocator::kMaxCachedSize + 1));
+    EXPECT_EQ(cached, ThreadCacheAllocator::cachedBytes());
+    
+    ThreadCacheAllocator::trim();
+    EXPECT_EQ(0u, ThreadCacheAllocator::cachedBytes());
+}
+
+TEST(ThreadCacheAllocatorTest, PoolsReuseChunksOfTheThread) {
+    ThreadCacheAllocator base;
+    ThreadCacheAllocator::trim();
+    
+    {
+        MemoryPoolAllocator pool(4096, &base);
+        fill(&pool, 100000);
+    }
+    size_t cached = ThreadCacheAllocator::cachedBytes();
+    EXPECT_GT(cached, 100000u);
+    
+    for (int i = 0; i < 10; ++ i) {
+        MemoryPoolAllocator pool(4096, &base);
+        fill(&pool, 100000);
+    }
+    EXPECT_EQ(cached, ThreadCacheAllocator::cachedBytes());
+    ThreadCacheAllocator::trim();
+}
+
+TEST(ThreadCacheAllocatorTest, ThreadsHaveTheirOwnCache) {
+    ThreadCacheAllocator allocator;
+    ThreadCacheAllocator::trim();
+    void* mine = allocator.malloc(10000);
+    
+    size_t seen = 1;
+    std::thread worker([&]() {
+        seen = ThreadCacheAllocator::cachedBytes();
+        void* theirs = allocator.malloc(10000);
+        allocator.free(theirs);
+        
+        // a block from another thread is cached by the thread freeing it
+        allocator.free(mine);
+        EXPECT_EQ(2 * 12288u, ThreadCacheAllocator::cachedBytes());
+    });
+    worker.join();
+    
+    EXPECT_EQ(0u, seen);
+    EXPECT_EQ(0u, ThreadCacheAllocator::cachedBytes());
+}
+
+TEST(InstrumentingAllocatorTest, CountsByCategory) {
+    CrtAllocator crt;
+    InstrumentingAllocator allocator(&crt);
+    EXPECT_TRUE(allocator.needFree());
+    EXPECT_EQ(&allocator, allocator.instrumentation());
+    EXPECT_EQ(NULL, crt.instrumentation());
+    
+    void* node = allocator.malloc(100);
+    void* text;
+    {
+        AllocationScope strings(CSOUP_ALLOCATION_STRINGS);
+        text = allocator.malloc(10);
+        {
+            AllocationScope tokens(CSOUP_ALLOCATION_TOKENS);
+            allocator.free(allocator.malloc(1000));
+        }
+        // realloc keeps the category the block was allocated in
+        AllocationScope attributes(CSOUP_ALLOCATION_ATTRIBUTES);
+        text = allocator.realloc(text, 10, 50);
+    }
+    EXPECT_EQ(CSOUP_ALLOCATION_CATEGORY_COUNT, AllocationScope::current());
+    
+    const AllocationStats& nodes = allocator.stats(CSOUP_ALLOCATION_NODES);
+    EXPECT_EQ(1u, nodes.allocations);
+    EXPECT_EQ(100u, nodes.liveBytes);
+    
+    const AllocationStats& strings = allocator.stats(CSOUP_ALLOCATION_STRINGS);
+    EXPECT_EQ(1u, strings.allocations);
+    EXPECT_EQ(1u, strings.reallocs);
+    EXPECT_EQ(50u, strings.liveBytes);
+    EXPECT_EQ(0u, allocator.stats(CSOUP_ALLOCATION_ATTRIBUTES).allocations);
+    
+    const AllocationStats& tokens = allocator.stats(CSOUP_ALLOCATION_TOKENS);
+    EXPECT_EQ(1u, tokens.frees);
+    EXPECT_EQ(0u, tokens.liveBytes);
+    EXPECT_EQ(1000u, tokens.peakBytes);
+    
+    allocator.free(node);
+    allocator.free(text);
+    AllocationStats total = allocator.total();
+    EXPECT_EQ(3u, total.allocations);
+    EXPECT_EQ(3u, total.frees);
+    EXPECT_EQ(0u, total.liveBytes);
+    EXPECT_EQ(1110u, total.peakBytes);
+}
+
+TEST(InstrumentingAllocatorTest, WrapsAPool) {
+    MemoryPoolAllocator pool;
+    InstrumentingAllocator allocator(&pool, CSOUP_ALLOCATION_SCRATCH);
+    EXPECT_FALSE(allocator.needFree());
+    
+    char* p = static_cast<char*>(allocator.malloc(10));
+    std::memcpy(p, "abcdefghij", 10);
+    p = static_cast<char*>(allocator.realloc(p, 10, 5000));
+    EXPECT_EQ(0, std::memcmp(p, "abcdefghij", 10));
+    EXPECT_TRUE(aligned(p, CSOUP_MAX_ALIGN));
+    EXPECT_EQ(5000u, allocator.stats(CSOUP_ALLOCATION_SCRATCH).liveBytes);
+    EXPECT_GE(pool.size(), 5000u);
+}
+
+TEST(AllocatorPolicyTest, ContainersTakeConcreteAllocators) {
+    MemoryPoolAllocator pool;
+
+    internal::Vector<int, MemoryPoolAllocator> numbers(1, &pool);
+    for (int i = 0; i < 1000; ++ i) numbers.push(i);
+    EXPECT_EQ(1000u, numbers.size());
+    EXPECT_EQ(999, *numbers.back());
+    EXPECT_EQ(&pool, numbers.allocator());
+
+    GenericStringBuffer<MemoryPoolAllocator> buffer(&pool);
+    for (int i = 0; i < 100; ++ i) buffer.append('a' + i % 26);
+    buffer.append(0x4e2d);
+    buffer.appendString(StringRef("XYZ"));
+    buffer.tolower(100);
+    EXPECT_EQ(106u, buffer.size());
+    EXPECT_TRUE(StringRef(buffer.data() + 100, 6).equals("\xe4\xb8\xadxyz"));
+
+    // the string frees through the Allocator interface later
+    String copy(buffer.ref(), &pool);
+    EXPECT_EQ(106u, copy.size());
+    EXPECT_EQ(static_cast<Allocator*>(&pool), copy.allocator());
+
+    SizeClassAllocator small;
+    {
+        String value(StringRef("a value long enough not to be a short string"), &small);
+        EXPECT_GT(small.size(), 0u);
+    }
+    EXPECT_EQ(0u, small.size());
+}
+
+TEST(AllocatorPolicyTest, EveryAllocatorBuffers) {
+    ThreadCacheAllocator cache;
+    GenericStringBuffer<ThreadCacheAllocator> cached(&cache);
+    for (int i = 0; i < 100; ++ i) cached.append('a' + i % 26);
+    cached.append(0x4e2d);
+    EXPECT_EQ(103u, cached.size());
+
+    CrtAllocator crt;
+    InstrumentingAllocator counted(&crt);
+    {
+        GenericStringBuffer<InstrumentingAllocator> buffer(&counted);
+        for (int i = 0; i < 100; ++ i) buffer.append('A' + i % 26);
+        buffer.tolower(0);
+        EXPECT_EQ('a', buffer.data()[0]);
+        EXPECT_GT(counted.total().allocations, 0u);
+    }
+    EXPECT_EQ(0u, counted.total().liveBytes);
+}
+
+TEST(AllocatorPolicyTest, NewCallsTheAllocatorItIsGiven) {
+    MemoryPoolAllocator pool;
+    CrtAllocator crt;
+    EXPECT_EQ(&pool, static_cast<Allocator*>(&pool)->memoryPool());
+    EXPECT_TRUE(crt.memoryPool() == NULL);
+
+    internal::Vector<int>* numbers = CSOUP_NEW2(&pool, internal::Vector<int>, 4, &pool);
+    numbers->push(1);
+    EXPECT_EQ(1u, numbers->size());
+    EXPECT_LE(sizeof(internal::Vector<int>), pool.size());
+    CSOUP_DELETE(&pool, numbers);
+
+    InstrumentingAllocator counted(&crt);
+    String* str = CSOUP_NEW2(&counted, String, StringRef("a value long enough not to be a short string"), &counted);
+    CSOUP_DELETE(&counted, str);
+    EXPECT_EQ(0u, counted.total().liveBytes);
+}
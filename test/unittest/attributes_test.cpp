@@ -2,7 +2,151 @@
 #include <vector>
 #include <cstring>
 #include <cctype>
+#include <cstdio>
 #include "gtest/gtest/gtest.h"
 #include "nodes/attributes.h"
 #include "util/allocators.h"
 
+
+using namespace csoup;
+
+TEST(AttributesTest, InlineUntilFull) {
+    CrtAllocator allocator;
+    Attributes* attrs = Attributes::create(&allocator, 3);
+    
+    attrs->addAttribute("id", "main");
+    attrs->addAttribute("class", "a long class list that does not fit in a short string");
+    attrs->addAttribute("title", "t");
+    EXPECT_TRUE(attrs->isInline());
+    EXPECT_EQ(3u, attrs->size());
+    
+    // replacing an attribute doesn't take more room
+    attrs->addAttribute("ID", "other");
+    EXPECT_TRUE(attrs->isInline());
+    EXPECT_TRUE(attrs->get("id").equals("other"));
+    
+    attrs->addAttribute("href", "/x");
+    EXPECT_FALSE(attrs->isInline());
+    EXPECT_EQ(4u, attrs->size());
+    EXPECT_TRUE(attrs->get("class").equals("a long class list that does not fit in a short string"));
+    EXPECT_TRUE(attrs->get("title").equals("t"));
+    EXPECT_TRUE(attrs->get("href").equals("/x"));
+    CSOUP_DELETE(&allocator, attrs);
+    
+    Attributes* empty = Attributes::create(&allocator, 0);
+    empty->addAttribute("id", "x");
+    EXPECT_FALSE(empty->isInline());
+    EXPECT_TRUE(empty->get("id").equals("x"));
+    CSOUP_DELETE(&allocator, empty);
+}
+
+TEST(AttributesTest, RemoveKeepsOrder) {
+    CrtAllocator allocator;
+    Attributes attrs(&allocator);
+    const char* keys[] = { "a", "b", "c", "d", "e" };
+    for (size_t i = 0; i < 5; ++ i) {
+        attrs.addAttribute(StringRef(keys[i]), StringRef("a value long enough to live on the heap"));
+    }
+    
+    attrs.removeAttribute("b");
+    attrs.removeAttribute("e");
+    attrs.removeAttribute("missing");
+    ASSERT_EQ(3u, attrs.size());
+    EXPECT_TRUE(attrs.get(static_cast<size_t>(0))->key().ref().equals("a"));
+    EXPECT_TRUE(attrs.get(1)->key().ref().equals("c"));
+    EXPECT_TRUE(attrs.get(2)->key().ref().equals("d"));
+    EXPECT_FALSE(attrs.hasAttribute("b"));
+    
+    Attributes copy(attrs, &allocator);
+    EXPECT_EQ(3u, copy.size());
+    EXPECT_TRUE(copy.get("d").equals("a value long enough to live on the heap"));
+}
+
+TEST(AttributesTest, ManyAttributesAreIndexed) {
+    CrtAllocator allocator;
+    Attributes attrs(&allocator);
+    char key[32], value[32];
+    for (int i = 0; i < 40; ++ i) {
+        std::snprintf(key, sizeof(key), "data-k%d", i);
+        std::snprintf(value, sizeof(value), "v%d", i);
+        attrs.addAttribute(StringRef(key, std::strlen(key)), StringRef(value, std::strlen(value)));
+        EXPECT_EQ(static_cast<size_t>(i) >= Attributes::kIndexThreshold, attrs.isIndexed());
+    }
+    
+    for (int i = 0; i < 40; ++ i) {
+        std::snprintf(key, sizeof(key), "DATA-K%d", i);
+        std::snprintf(value, sizeof(value), "v%d", i);
+        EXPECT_TRUE(attrs.get(StringRef(key, std::strlen(key))).equals(StringRef(value, std::strlen(value))));
+    }
+    EXPECT_FALSE(attrs.hasAttribute("data-k40"));
+    EXPECT_FALSE(attrs.hasAttribute(CSOUP_ATTR_NAMESPACE_XLINK, "data-k1"));
+    
+    // a value that is already there is replaced in its place
+    attrs.addAttribute("data-k3", "new");
+    EXPECT_EQ(40u, attrs.size());
+    EXPECT_TRUE(attrs.get(3)->value().ref().equals("new"));
+    EXPECT_TRUE(attrs.get("data-k3").equals("new"));
+    
+    // removing renumbers the rest, which stay where the index says
+    for (int i = 0; i < 35; ++ i) {
+        std::snprintf(key, sizeof(key), "data-k%d", i);
+        attrs.removeAttribute(StringRef(key, std::strlen(key)));
+    }
+    EXPECT_EQ(5u, attrs.size());
+    EXPECT_FALSE(attrs.isIndexed());
+    EXPECT_TRUE(attrs.get("data-k39").equals("v39"));
+    EXPECT_FALSE(attrs.hasAttribute("data-k3"));
+    
+    Attributes copy(attrs, &allocator);
+    for (int i = 0; i < 10; ++ i) {
+        std::snprintf(key, sizeof(key), "x%d", i);
+        copy.addAttribute(StringRef(key, std::strlen(key)), "");
+    }
+    EXPECT_TRUE(copy.isIndexed());
+    EXPECT_TRUE(copy.get("data-k36").equals("v36"));
+    EXPECT_TRUE(copy.hasAttribute("x9"));
+}
+
+// removing keeps the table and edits it in place
+TEST(AttributesTest, RemovingFromTheIndexDoesNotAllocate) {
+    CrtAllocator crt;
+    InstrumentingAllocator allocator(&crt);
+    Attributes attrs(&allocator);
+    char key[32];
+    for (int i = 0; i < 40; ++ i) {
+        std::snprintf(key, sizeof(key), "data-k%d", i);
+        attrs.addAttribute(StringRef(key, std::strlen(key)), StringRef(key, std::strlen(key)));
+    }
+    ASSERT_TRUE(attrs.isIndexed());
+    
+    const size_t allocations = allocator.total().allocations;
+    // from the middle, the end and the front, so probe runs get broken up
+    const int order[] = {20, 39, 0, 7, 21, 22, 38, 1, 19, 30, 31, 2, 13, 26, 5, 33, 10, 17, 28, 3, 36, 11, 24, 8, 35, 15};
+    bool removed[40] = {false};
+    for (size_t n = 0; n < arrayLength(order); ++ n) {
+        std::snprintf(key, sizeof(key), "data-k%d", order[n]);
+        attrs.removeAttribute(StringRef(key, std::strlen(key)));
+        removed[order[n]] = true;
+        
+        for (int i = 0; i < 40; ++ i) {
+            std::snprintf(key, sizeof(key), "data-k%d", i);
+            const StringRef name(key, std::strlen(key));
+            EXPECT_EQ(!removed[i], attrs.hasAttribute(name)) << key;
+            if (!removed[i]) {
+                EXPECT_TRUE(attrs.get(name).equals(name)) << key;
+            }
+        }
+    }
+    EXPECT_EQ(allocations, allocator.total().allocations);
+    
+    EXPECT_EQ(40 - arrayLength(order), attrs.size());
+    const char* last[] = {"data-k4", "data-k6", "data-k9", "data-k12", "data-k14", "data-k16"};
+    for (size_t n = 0; n < arrayLength(last); ++ n) {
+        EXPECT_TRUE(attrs.isIndexed());
+        attrs.removeAttribute(StringRef(last[n], std::strlen(last[n])));
+    }
+    EXPECT_EQ(size_t(Attributes::kIndexThreshold), attrs.size());
+    EXPECT_FALSE(attrs.isIndexed());
+    EXPECT_TRUE(attrs.get("data-k18").equals("data-k18"));
+    EXPECT_EQ(allocations, allocator.total().allocations);
+}
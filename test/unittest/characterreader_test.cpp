@@ -0,0 +1,136 @@
+//
+//  characterreader_test.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include <vector>
+#include "gtest/gtest/gtest.h"
+#include "parser/characterreader.h"
+#include "util/allocators.h"
+#include "util/stringbuffer.h"
+
+using namespace csoup;
+
+namespace {
+    std::vector<int> readAll(CharacterReader* reader) {
+        std::vector<int> ret;
+        while (reader->peek() != -1) {
+            ret.push_back(reader->next());
+        }
+        return ret;
+    }
+}
+
+TEST(CharacterReaderTest, Ascii) {
+    CharacterReader reader(StringRef("<p>\tab\nc</p>"));
+    std::vector<int> chars = readAll(&reader);
+    const char expected[] = "<p>\tab\nc</p>";
+    
+    ASSERT_EQ(arrayLength(expected) - 1, chars.size());
+    for (size_t i = 0; i < chars.size(); ++ i) {
+        EXPECT_EQ(expected[i], chars[i]);
+    }
+    EXPECT_EQ(-1, reader.peek());
+}
+
+TEST(CharacterReaderTest, MixedAsciiAndMultiByte) {
+    // a, U+4F60, b, U+00E9, U+1F600, c
+    CharacterReader reader(StringRef("a\xe4\xbd\xa0" "b\xc3\xa9\xf0\x9f\x98\x80" "c"));
+    std::vector<int> chars = readAll(&reader);
+    
+    ASSERT_EQ(6u, chars.size());
+    EXPECT_EQ('a', chars[0]);
+    EXPECT_EQ(0x4F60, chars[1]);
+    EXPECT_EQ('b', chars[2]);
+    EXPECT_EQ(0xE9, chars[3]);
+    EXPECT_EQ(0x1F600, chars[4]);
+    EXPECT_EQ('c', chars[5]);
+}
+
+TEST(CharacterReaderTest, CarriageReturns) {
+    CharacterReader reader(StringRef("a\r\nb\rc\r"));
+    std::vector<int> chars = readAll(&reader);
+    
+    ASSERT_EQ(6u, chars.size());
+    EXPECT_EQ('a', chars[0]);
+    EXPECT_EQ('\n', chars[1]);
+    EXPECT_EQ('b', chars[2]);
+    EXPECT_EQ('\n', chars[3]);
+    EXPECT_EQ('c', chars[4]);
+    EXPECT_EQ('\n', chars[5]);
+}
+
+TEST(CharacterReaderTest, ControlCharacters) {
+    CharacterReader reader(StringRef("a\x01\x7f\fb"));
+    std::vector<int> chars = readAll(&reader);
+    
+    ASSERT_EQ(5u, chars.size());
+    EXPECT_EQ('a', chars[0]);
+    EXPECT_EQ(0xFFFD, chars[1]);
+    EXPECT_EQ(0xFFFD, chars[2]);
+    EXPECT_EQ('\f', chars[3]);
+    EXPECT_EQ('b', chars[4]);
+}
+
+TEST(CharacterReaderTest, Unconsume) {
+    CharacterReader reader(StringRef("x\xe4\xbd\xa0y"));
+    EXPECT_EQ('x', reader.next());
+    EXPECT_EQ(0x4F60, reader.next());
+    reader.unconsume();
+    EXPECT_EQ(0x4F60, reader.peek());
+    EXPECT_EQ(0x4F60, reader.next());
+    EXPECT_EQ('y', reader.next());
+    reader.unconsume();
+    EXPECT_EQ('y', reader.peek());
+}
+
+// after the bulk consumers unconsume() steps back over one character, not the run
+TEST(CharacterReaderTest, UnconsumeAfterRuns) {
+    CrtAllocator allocator;
+    StringBuffer out(&allocator);
+    const CharType terms[] = {'<'};
+    
+    CharacterReader letters(StringRef("abc1"));
+    EXPECT_EQ(3u, letters.consumeLetters(&out));
+    letters.unconsume();
+    EXPECT_EQ('c', letters.next());
+    
+    CharacterReader run(StringRef("ab\xc3\xa9<"));
+    EXPECT_EQ(4u, run.consumeToAny(terms, 1, &out));
+    run.unconsume();
+    EXPECT_EQ(0xE9, run.next());
+    EXPECT_EQ('<', run.next());
+    
+    CharacterReader newline(StringRef("ab\r\n<"));
+    newline.consumeToAny(terms, 1, &out);
+    newline.unconsume();
+    EXPECT_EQ('\n', newline.next());
+    EXPECT_EQ('<', newline.next());
+    
+    CharacterReader slice(StringRef("xyz<"));
+    const CharType* data;
+    size_t length;
+    EXPECT_TRUE(slice.consumeSliceToAny(terms, 1, &data, &length));
+    EXPECT_EQ(3u, length);
+    slice.unconsume();
+    EXPECT_EQ('z', slice.next());
+}
+
+TEST(CharacterReaderTest, RewindToMark) {
+    CharacterReader reader(StringRef("ab\rcd"));
+    reader.advance();
+    reader.mark();
+    EXPECT_EQ('b', reader.next());
+    EXPECT_EQ('\n', reader.next());
+    EXPECT_EQ('c', reader.next());
+    
+    reader.rewindToMark();
+    EXPECT_EQ('b', reader.peek());
+    EXPECT_EQ(1u, reader.pos());
+    std::vector<int> chars = readAll(&reader);
+    ASSERT_EQ(4u, chars.size());
+    EXPECT_EQ('\n', chars[1]);
+}
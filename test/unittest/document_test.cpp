@@ -8,7 +8,415 @@
 
 #include <iostream>
 #include <vector>
+#include <cstdio>
 #include <cstring>
 #include <cctype>
 #include "gtest/gtest/gtest.h"
+#include <string>
 #include "nodes/document.h"
+#include "parser/htmltreebuilder.h"
+#include "parser/parseerrorlist.h"
+#include "selector/elementsref.h"
+#include "util/stringbuffer.h"
+
+using namespace csoup;
+
+TEST(DocumentTest, SetSourceCopiesInput) {
+    std::string html("<p>x</p>");
+    Document doc(StringRef("http://example.com/"));
+    StringRef source = doc.setSource(StringRef(html.data(), html.size()));
+    
+    html[1] = 'b';
+    EXPECT_NE(html.data(), source.data());
+    EXPECT_TRUE(doc.source().equals("<p>x</p>"));
+}
+
+TEST(DocumentTest, ParsedTextRefersToSource) {
+    std::string html("<html><head></head><body><p>hello world</p></body></html>");
+    CrtAllocator allocator;
+    ParseErrorList errors(16, &allocator);
+    HtmlTreeBuilder builder(&allocator);
+    Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, NULL);
+    
+    // the caller's buffer can go away once parsing is done
+    html.assign(html.size(), 'x');
+    
+    Element* body = static_cast<Element*>(static_cast<Element*>(doc->childNode(0))->childNode(1));
+    Element* p = static_cast<Element*>(body->childNode(0));
+    TextNode* text = static_cast<TextNode*>(p->childNode(0));
+    
+    EXPECT_TRUE(text->sharesText());
+    EXPECT_TRUE(text->wholeText().equals("hello world"));
+    EXPECT_EQ(doc->source().data() + 28, text->wholeText().data());
+    
+    delete doc;
+}
+
+namespace {
+    void recordCleanup(void* data) {
+        std::vector<int>* calls = static_cast<std::vector<int>*>(data);
+        calls->push_back(static_cast<int>(calls->size()));
+    }
+    
+    void freeWithCrt(void* data) {
+        CrtAllocator().free(data);
+    }
+}
+
+TEST(DocumentTest, CleanupsRunLastFirst) {
+    std::vector<int> calls;
+    std::vector<int> later;
+    {
+        Document doc(StringRef("http://example.com/"));
+        doc.addCleanup(recordCleanup, &later);
+        doc.addCleanup(recordCleanup, &calls);
+        doc.addCleanup(recordCleanup, &calls);
+        EXPECT_TRUE(calls.empty());
+        
+        // by the time the first one registered runs, the others have
+        later.push_back(-1);
+        doc.addCleanup(recordCleanup, &later);
+    }
+    
+    EXPECT_EQ(2u, calls.size());
+    ASSERT_EQ(3u, later.size());
+    EXPECT_EQ(1, later[1]);
+    EXPECT_EQ(2, later[2]);
+}
+
+TEST(DocumentTest, PoolDocumentTeardownRunsCleanups) {
+    std::string html("<html><head><title>t</title></head><body><p class=a>one<p>two<!-- c --></body></html>");
+    CrtAllocator allocator;
+    ParseErrorList errors(16, &allocator);
+    HtmlTreeBuilder builder(&allocator);
+    std::vector<int> calls;
+    
+    {
+        MemoryPoolAllocator pool;
+        Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &pool);
+        EXPECT_FALSE(doc->allocator()->needFree());
+        
+        // memory from outside the pool is only released through a cleanup
+        doc->addCleanup(freeWithCrt, allocator.malloc(64));
+        doc->addCleanup(recordCleanup, &calls);
+        
+        size_t used = pool.size();
+        doc->~Document();
+        
+        // nothing was walked or freed: the pool is dropped as a whole
+        EXPECT_EQ(used, pool.size());
+        EXPECT_EQ(1u, calls.size());
+    }
+}
+
+TEST(DocumentTest, CrtDocumentTeardownFreesNodes) {
+    std::string html("<p id=x>one<b>two</b><!-- c --><script>var a;</script><form><input></form>");
+    CrtAllocator allocator;
+    ParseErrorList errors(16, &allocator);
+    HtmlTreeBuilder builder(&allocator);
+    std::vector<int> calls;
+    
+    Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &allocator);
+    EXPECT_TRUE(doc->allocator()->needFree());
+    doc->addCleanup(recordCleanup, &calls);
+    
+    CSOUP_DELETE(&allocator, doc);
+    EXPECT_EQ(1u, calls.size());
+}
+
+TEST(DocumentTest, ParserScratchStaysOutOfDocumentPool) {
+    // the tokeniser grows its buffers to hold the long value and comment
+    std::string html("<p title=\"");
+    html.append(100000, 'v');
+    html += "\"><!--";
+    html.append(100000, 'c');
+    html += "--><table>x</table>";
+    
+    CrtAllocator allocator;
+    ParseErrorList errors(16, &allocator);
+    HtmlTreeBuilder builder(&allocator);
+    MemoryPoolAllocator pool;
+    Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &pool);
+    
+    // the source, one copy each of the value and the comment, and the nodes
+    EXPECT_LT(pool.size(), 2 * html.size() + 4096);
+    doc->~Document();
+}
+
+TEST(DocumentTest, SizeClassDocumentGivesMemoryBack) {
+    std::string html("<div id=a class=b><p>one<i>two</i></p><custom x=1>three</custom><!-- c --></div><script>var a;</script>");
+    CrtAllocator allocator;
+    ParseErrorList errors(16, &allocator);
+    HtmlTreeBuilder builder(&allocator);
+    SizeClassAllocator nodes;
+    
+    Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &nodes);
+    Element* body = static_cast<Element*>(static_cast<Element*>(doc->childNode(0))->childNode(1));
+    Element* div = static_cast<Element*>(body->childNode(0));
+    
+    // what an edit frees is handed out again by the next one
+    size_t before = nodes.size();
+    div->removeChild(static_cast<size_t>(0), true);
+    div->appendElement("p")->addAttribute("title", "x");
+    div->addAttribute("class", "c");
+    div->removeAttribute("id");
+    EXPECT_LE(nodes.size(), before);
+    
+    CSOUP_DELETE(&nodes, doc);
+    EXPECT_EQ(0u, nodes.size());
+}
+
+TEST(DocumentTest, MemoryReportByCategory) {
+    std::string html("<html><head><title>t</title></head><body>"
+                     "<div id=\"main\" class=\"a long class list that is not a short string\">"
+                     "<p>hello</p><!-- note --></div></body></html>");
+    CrtAllocator crt;
+    ParseErrorList errors(16, &crt);
+    HtmlTreeBuilder builder(&crt);
+    
+    InstrumentingAllocator scratch(builder.scratchPool(), CSOUP_ALLOCATION_SCRATCH);
+    builder.setScratchAllocator(&scratch);
+    InstrumentingAllocator allocator(&crt);
+    Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &allocator);
+    
+    MemoryUsage usage = doc->memoryUsage();
+    EXPECT_EQ(&allocator, usage.allocations);
+    EXPECT_EQ(7u, usage.elements);
+    EXPECT_EQ(10u, usage.nodes);
+    EXPECT_EQ(2u, usage.attributes);
+    EXPECT_EQ(html.size(), usage.sourceBytes);
+    
+    EXPECT_GT(allocator.stats(CSOUP_ALLOCATION_NODES).liveBytes, 0u);
+    EXPECT_GT(allocator.stats(CSOUP_ALLOCATION_ATTRIBUTES).liveBytes, 0u);
+    EXPECT_GE(allocator.stats(CSOUP_ALLOCATION_STRINGS).liveBytes, html.size());
+    EXPECT_EQ(0u, allocator.stats(CSOUP_ALLOCATION_TOKENS).allocations);
+    
+    // the parser's temporaries are gone, but were counted
+    EXPECT_GT(scratch.stats(CSOUP_ALLOCATION_TOKENS).peakBytes, 0u);
+    EXPECT_GT(scratch.stats(CSOUP_ALLOCATION_SCRATCH).peakBytes, 0u);
+    EXPECT_EQ(0u, scratch.total().liveBytes);
+    
+    StringBuffer report(&crt);
+    doc->writeMemoryReport(&report);
+    EXPECT_TRUE(std::strstr(std::string(report.data(), report.size()).c_str(), "10 nodes, 7 elements, 2 attributes") != NULL);
+    EXPECT_TRUE(std::strstr(std::string(report.data(), report.size()).c_str(), "\nstrings ") != NULL);
+    
+    CSOUP_DELETE(&allocator, doc);
+    EXPECT_EQ(0u, allocator.total().liveBytes);
+    builder.setScratchAllocator(NULL);
+}
+
+namespace {
+    // counts the nodes below and including node that share baseUri
+    size_t countSharing(Node* node, BaseUri* baseUri) {
+        size_t count = node->sharedBaseUri() == baseUri ? 1 : 0;
+        if (node->type() == CSOUP_NODE_TEXT || node->type() == CSOUP_NODE_COMMENT || node->type() == CSOUP_NODE_CDATA)
+            return count;
+        
+        Element* el = static_cast<Element*>(node);
+        for (size_t i = 0; i < el->childNodeSize(); ++ i) {
+            count += countSharing(el->childNode(i), baseUri);
+        }
+        return count;
+    }
+}
+
+TEST(DocumentTest, NodesShareTheBaseUri) {
+    std::string html("<html><head></head><body><div><p>one</p><!-- c --><p>two</p></div></body></html>");
+    CrtAllocator crt;
+    ParseErrorList errors(16, &crt);
+    HtmlTreeBuilder builder(&crt);
+    Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/a/long/base/uri/"), &errors, &crt);
+    
+    BaseUri* shared = doc->sharedBaseUri();
+    EXPECT_TRUE(doc->baseUri().equals("http://example.com/a/long/base/uri/"));
+    EXPECT_EQ(doc->memoryUsage().nodes, countSharing(doc, shared));
+    
+    Element* body = static_cast<Element*>(static_cast<Element*>(doc->childNode(0))->childNode(1));
+    Element* div = static_cast<Element*>(body->childNode(0));
+    EXPECT_EQ(shared, div->appendElement("span")->sharedBaseUri());
+    
+    // a subtree with a base URI of its own; children made later take it
+    div->setBaseUri("http://example.com/other/");
+    EXPECT_NE(shared, div->sharedBaseUri());
+    EXPECT_TRUE(static_cast<Element*>(div->childNode(0))->baseUri().equals("http://example.com/other/"));
+    EXPECT_EQ(div->sharedBaseUri(), div->appendElement("b")->sharedBaseUri());
+    EXPECT_EQ(shared, body->sharedBaseUri());
+    
+    // the document's URI changes everything that shared it, not the subtree
+    doc->setBaseUri("http://example.org/");
+    EXPECT_TRUE(body->baseUri().equals("http://example.org/"));
+    EXPECT_TRUE(div->baseUri().equals("http://example.com/other/"));
+    
+    CSOUP_DELETE(&crt, doc);
+}
+
+TEST(DocumentTest, BaseElementSetsTheBaseUri) {
+    std::string html("<html><head><base href=\"http://base.example.com/\"><base href=\"http://ignored/\"></head>"
+                     "<body><p>text</p></body></html>");
+    CrtAllocator crt;
+    ParseErrorList errors(16, &crt);
+    HtmlTreeBuilder builder(&crt);
+    Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, NULL);
+    
+    EXPECT_TRUE(doc->baseUri().equals("http://base.example.com/"));
+    EXPECT_EQ(doc->memoryUsage().nodes, countSharing(doc, doc->sharedBaseUri()));
+    
+    delete doc;
+}
+
+namespace {
+    const char* kIndexHtml = "<html><head></head><body>"
+                             "<div id=\"main\" class=\"box Price\"><p class=\"price  price\">1</p><p>2</p></div>"
+                             "<ul><li class=\"price\" id=\"main\">3</li><li class=\"old\">4</li></ul>"
+                             "</body></html>";
+    
+    std::string classList(Document* doc, const StringRef& className) {
+        CrtAllocator crt;
+        ElementsRef found(&crt);
+        doc->getElementsByClass(className, &found);
+        
+        std::string list;
+        for (size_t i = 0; i < found.size(); ++ i) {
+            StringBuffer text(&crt);
+            found.get(i)->appendWholeText(&text);
+            list += found.get(i)->tagName().data()[0];
+            list.append(text.ref().data(), text.ref().size());
+        }
+        return list;
+    }
+}
+
+TEST(DocumentTest, IndexFindsIdsAndClasses) {
+    std::string html(kIndexHtml);
+    CrtAllocator crt;
+    ParseErrorList errors(16, &crt);
+    HtmlTreeBuilder builder(&crt);
+    Document* walked = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &crt);
+    builder.setIndexDocuments(true);
+    Document* indexed = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &crt);
+    EXPECT_FALSE(walked->isIndexed());
+    EXPECT_TRUE(indexed->isIndexed());
+    
+    // both answer the same, in document order; class names ignore case
+    Document* docs[] = { walked, indexed };
+    for (size_t i = 0; i < 2; ++ i) {
+        Element* main = docs[i]->getElementById("main");
+        ASSERT_TRUE(main != NULL);
+        EXPECT_EQ(CSOUP_TAG_DIV, main->tagId());
+        EXPECT_TRUE(docs[i]->getElementById("MAIN") == NULL);
+        EXPECT_TRUE(docs[i]->getElementById("none") == NULL);
+        EXPECT_EQ("d12p1l3", classList(docs[i], "price"));
+        EXPECT_EQ("d12", classList(docs[i], "BOX"));
+        EXPECT_EQ("", classList(docs[i], "pri"));
+        EXPECT_TRUE(main->hasClass("price"));
+        EXPECT_FALSE(main->hasClass("pri"));
+    }
+    
+    CSOUP_DELETE(&crt, walked);
+    CSOUP_DELETE(&crt, indexed);
+}
+
+TEST(DocumentTest, IndexFollowsEdits) {
+    std::string html(kIndexHtml);
+    CrtAllocator crt;
+    ParseErrorList errors(16, &crt);
+    HtmlTreeBuilder builder(&crt);
+    Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &crt);
+    doc->indexIdsAndClasses();
+    
+    Element* div = doc->getElementById("main");
+    Element* ul = static_cast<Element*>(div->nextSibling());
+    Element* li = static_cast<Element*>(ul->firstChild());
+    EXPECT_EQ("d12p1l3", classList(doc, "price"));
+    
+    // changing attributes moves an element between keys
+    div->addAttribute("id", "box");
+    EXPECT_EQ(li, doc->getElementById("main"));
+    EXPECT_EQ(div, doc->getElementById("box"));
+    div->removeAttribute("class");
+    EXPECT_EQ("p1l3", classList(doc, "price"));
+    li->addAttribute("CLASS", "old price");
+    EXPECT_EQ("l3l4", classList(doc, "old"));
+    
+    // removing a subtree takes its elements out; putting it back in front
+    // adds them where they now are in document order
+    div->removeFromParent(false);
+    EXPECT_TRUE(doc->getElementById("box") == NULL);
+    EXPECT_EQ("l3", classList(doc, "price"));
+    ul->before(div);
+    EXPECT_EQ(div, doc->getElementById("box"));
+    EXPECT_EQ("p1l3", classList(doc, "price"));
+    
+    Element* b = static_cast<Element*>(div->firstChild())->appendElement("b");
+    b->addAttribute("id", "main");
+    b->addAttribute("class", "price");
+    EXPECT_EQ(b, doc->getElementById("main"));
+    EXPECT_EQ("p1bl3", classList(doc, "price"));
+    
+    ul->removeFromParent(true);
+    EXPECT_EQ(b, doc->getElementById("main"));
+    EXPECT_EQ("", classList(doc, "old"));
+    
+    CSOUP_DELETE(&crt, doc);
+}
+
+TEST(DocumentTest, IndexMatchesWalkAfterManyEdits) {
+    std::string html("<body>");
+    char buf[64];
+    for (int i = 0; i < 500; ++ i) {
+        std::sprintf(buf, "<div id=\"i%d\" class=\"%s\"></div>", i % 7, i % 2 ? "c odd" : "c");
+        html += buf;
+    }
+    CrtAllocator crt;
+    ParseErrorList errors(16, &crt);
+    HtmlTreeBuilder builder(&crt);
+    Document* doc = builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, &crt);
+    doc->indexIdsAndClasses();
+    Element* body = static_cast<Element*>(static_cast<Element*>(doc->firstChild())->lastChild());
+    ASSERT_EQ(CSOUP_TAG_BODY, body->tagId());
+    
+    // drop some, rename some and put new ones in front of others
+    int i = 0;
+    for (Node* child = body->firstChild(); child != NULL; ++ i) {
+        Element* div = static_cast<Element*>(child);
+        child = child->nextSibling();
+        if (i % 3 == 0) {
+            div->removeFromParent(true);
+        } else if (i % 5 == 0) {
+            div->addAttribute("class", "odd other");
+        } else if (i % 4 == 0) {
+            Element* p = div->appendElement("p");
+            p->addAttribute("class", "c");
+            p->removeFromParent(false);
+            div->before(p);
+        }
+    }
+    
+    const char* classes[] = { "c", "odd", "other" };
+    for (size_t c = 0; c < 3; ++ c) {
+        const StringRef className(classes[c], std::strlen(classes[c]));
+        ElementsRef found(&crt);
+        doc->getElementsByClass(className, &found);
+        size_t expected = 0;
+        for (Node* child = body->firstChild(); child != NULL; child = child->nextSibling()) {
+            Element* el = static_cast<Element*>(child);
+            if (!el->hasClass(className)) continue;
+            ASSERT_LT(expected, found.size());
+            EXPECT_EQ(el, found.get(expected ++));
+        }
+        EXPECT_EQ(expected, found.size());
+    }
+    
+    for (int k = 0; k < 7; ++ k) {
+        std::sprintf(buf, "i%d", k);
+        const StringRef id(buf, std::strlen(buf));
+        Element* first = NULL;
+        for (Node* child = body->firstChild(); child != NULL && first == NULL; child = child->nextSibling()) {
+            if (static_cast<Element*>(child)->attr("id").equals(id)) first = static_cast<Element*>(child);
+        }
+        EXPECT_EQ(first, doc->getElementById(id));
+    }
+    
+    CSOUP_DELETE(&crt, doc);
+}
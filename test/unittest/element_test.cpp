@@ -6,3 +6,71 @@
 #include "nodes/element.h"
 #include "util/allocators.h"
 
+
+using namespace csoup;
+
+namespace {
+    // the tag names of el's children, read by following the sibling links
+    // both ways; the two must agree
+    std::string childTags(const Element* el) {
+        std::string forward, backward;
+        for (const Node* child = el->firstChild(); child != NULL; child = child->nextSibling()) {
+            forward += static_cast<const Element*>(child)->tagName().data()[0];
+        }
+        for (const Node* child = el->lastChild(); child != NULL; child = child->previousSibling()) {
+            backward.insert(backward.begin(), static_cast<const Element*>(child)->tagName().data()[0]);
+        }
+        EXPECT_EQ(forward, backward);
+        return forward;
+    }
+}
+
+TEST(ElementTest, ChildrenAreLinked) {
+    CrtAllocator allocator;
+    Element root("div", NULL, &allocator);
+    EXPECT_EQ(NULL, root.firstChild());
+    EXPECT_EQ(NULL, root.lastChild());
+    
+    Element* a = root.appendElement("a");
+    Element* b = root.appendElement("b");
+    root.insertElement(0, "p");
+    root.insertElement(2, "i");
+    EXPECT_EQ("paib", childTags(&root));
+    EXPECT_EQ(4u, root.childNodeSize());
+    
+    for (size_t i = 0; i < root.childNodeSize(); ++ i) {
+        EXPECT_EQ(i, root.childNode(i)->siblingIndex());
+        EXPECT_EQ(&root, root.childNode(i)->parentNode());
+    }
+    EXPECT_EQ(a, root.childNode(1));
+    EXPECT_EQ(b, root.childNode(3));
+}
+
+TEST(ElementTest, RemoveAndMoveChildren) {
+    CrtAllocator allocator;
+    Element root("div", NULL, &allocator);
+    root.appendElement("a");
+    Element* b = root.appendElement("b");
+    root.appendElement("c");
+    Element* d = root.appendElement("d");
+    
+    root.removeChild(b, false);
+    EXPECT_EQ("acd", childTags(&root));
+    EXPECT_EQ(NULL, b->parentNode());
+    EXPECT_EQ(NULL, b->nextSibling());
+    EXPECT_EQ(2u, d->siblingIndex());
+    
+    // before() and after() put the node next to the one they're called on
+    d->before(b);
+    EXPECT_EQ("acbd", childTags(&root));
+    root.removeChild(b, false);
+    d->after(b);
+    EXPECT_EQ("acdb", childTags(&root));
+    EXPECT_EQ(3u, b->siblingIndex());
+    
+    root.removeChild(static_cast<size_t>(0), true);
+    root.removeChild(root.lastChild(), true);
+    EXPECT_EQ("cd", childTags(&root));
+    EXPECT_EQ(0u, root.firstChild()->siblingIndex());
+    EXPECT_EQ(1u, d->siblingIndex());
+}
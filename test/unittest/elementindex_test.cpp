@@ -0,0 +1,87 @@
+//
+//  elementindex_test.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include <cstdio>
+#include <cstring>
+#include "gtest/gtest/gtest.h"
+#include "nodes/element.h"
+#include "nodes/elementindex.h"
+#include "selector/elementsref.h"
+#include "util/allocators.h"
+
+using namespace csoup;
+
+TEST(ElementIndexTest, KeysGoWithTheLastElement) {
+    CrtAllocator allocator;
+    internal::ElementIndex index(&allocator);
+    Element div("div", NULL, &allocator);
+    Element p("p", NULL, &allocator);
+
+    div.addAttribute("id", "main");
+    div.addAttribute("class", "a b");
+    p.addAttribute("class", "B");
+    index.add(&div);
+    index.add(&p);
+    EXPECT_EQ(3u, index.keyCount());
+
+    index.remove(&div);
+    EXPECT_EQ(1u, index.keyCount());
+    EXPECT_TRUE(index.findById("main") == NULL);
+    index.remove(&p);
+    EXPECT_EQ(0u, index.keyCount());
+
+    // an element that keeps changing its class leaves nothing behind
+    char name[32];
+    for (int i = 0; i < 1000; ++ i) {
+        std::sprintf(name, "edited%d", i);
+        div.addAttribute("class", StringRef(name, std::strlen(name)));
+        index.add(&div, internal::ElementIndex::kClass);
+        index.remove(&div, internal::ElementIndex::kClass);
+    }
+    EXPECT_EQ(0u, index.keyCount());
+
+    index.add(&div);
+    ElementsRef found(&allocator);
+    index.findByClass(StringRef(name, std::strlen(name)), &found);
+    EXPECT_EQ(1u, found.size());
+    EXPECT_EQ(&div, index.findById("main"));
+    index.remove(&div);
+}
+
+// erasing keys moves others back in the table, which must still find them
+TEST(ElementIndexTest, FindsKeysAfterOthersGo) {
+    const int kCount = 300;
+    CrtAllocator allocator;
+    internal::ElementIndex index(&allocator);
+    Element* els[kCount];
+    char id[32];
+    for (int i = 0; i < kCount; ++ i) {
+        els[i] = CSOUP_NEW3(&allocator, Element, StringRef("div"), NULL, &allocator);
+        std::sprintf(id, "e%d", i);
+        els[i]->addAttribute("id", StringRef(id, std::strlen(id)));
+        index.add(els[i]);
+    }
+
+    for (int i = 0; i < kCount; i += 2) {
+        index.remove(els[i]);
+    }
+    EXPECT_EQ(static_cast<size_t>(kCount / 2), index.keyCount());
+
+    for (int i = 0; i < kCount; ++ i) {
+        std::sprintf(id, "e%d", i);
+        EXPECT_EQ(i % 2 ? els[i] : NULL, index.findById(StringRef(id, std::strlen(id))));
+    }
+
+    for (int i = 1; i < kCount; i += 2) {
+        index.remove(els[i]);
+    }
+    EXPECT_EQ(0u, index.keyCount());
+    for (int i = 0; i < kCount; ++ i) {
+        CSOUP_DELETE(&allocator, els[i]);
+    }
+}
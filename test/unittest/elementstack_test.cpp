@@ -0,0 +1,162 @@
+//
+//  elementstack_test.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include "gtest/gtest/gtest.h"
+#include "parser/elementstack.h"
+#include "nodes/element.h"
+#include "util/allocators.h"
+
+using namespace csoup;
+
+namespace {
+    // checks the parallel tag ids and the counts against the elements
+    void expectInStep(const ElementStack& stack) {
+        size_t counts[CSOUP_TAG_UNKNOWN + 1] = {0};
+        for (size_t i = 0; i < stack.size(); ++ i) {
+            EXPECT_EQ((*stack.at(i))->tagId(), stack.tagIdAt(i));
+            ++ counts[(*stack.at(i))->tagId()];
+        }
+        
+        for (size_t id = 0; id <= CSOUP_TAG_UNKNOWN; ++ id) {
+            EXPECT_EQ(counts[id], stack.count(static_cast<TagIdEnum>(id)));
+        }
+    }
+}
+
+TEST(ElementStackTest, KeepsTagIdsAndCountsInStep) {
+    CrtAllocator allocator;
+    Element html("html", NULL, &allocator);
+    Element body("body", NULL, &allocator);
+    Element p1("p", NULL, &allocator);
+    Element p2("p", NULL, &allocator);
+    Element foo("foo", NULL, &allocator);
+    Element div("div", NULL, &allocator);
+    
+    ElementStack stack(&allocator);
+    EXPECT_TRUE(stack.empty());
+    
+    stack.push(&html);
+    stack.push(&body);
+    stack.push(&p1);
+    stack.push(&foo);
+    expectInStep(stack);
+    EXPECT_EQ(1u, stack.count(CSOUP_TAG_P));
+    EXPECT_EQ(1u, stack.count(CSOUP_TAG_UNKNOWN));
+    EXPECT_EQ(CSOUP_TAG_UNKNOWN, stack.tagIdAt(3));
+    
+    stack.insert(2, &p2);
+    expectInStep(stack);
+    EXPECT_EQ(2u, stack.count(CSOUP_TAG_P));
+    EXPECT_EQ(&p2, *stack.at(2));
+    
+    stack.replace(3, &div);
+    expectInStep(stack);
+    EXPECT_EQ(1u, stack.count(CSOUP_TAG_P));
+    EXPECT_EQ(CSOUP_TAG_DIV, stack.tagIdAt(3));
+    EXPECT_TRUE(stack.contains(&div));
+    EXPECT_FALSE(stack.contains(&p1));
+    
+    stack.remove(1);
+    expectInStep(stack);
+    EXPECT_EQ(0u, stack.count(CSOUP_TAG_BODY));
+    
+    stack.pop();
+    expectInStep(stack);
+    EXPECT_EQ(0u, stack.count(CSOUP_TAG_UNKNOWN));
+    EXPECT_EQ(&div, *stack.back());
+    EXPECT_EQ(&html, *stack.front());
+    
+    stack.clear();
+    expectInStep(stack);
+    EXPECT_TRUE(stack.empty());
+}
+
+namespace {
+    // the boundaries HtmlTreeBuilder passes in
+    const TagSet kDefaultScope = makeTagSet(CSOUP_TAG_APPLET, CSOUP_TAG_CAPTION, CSOUP_TAG_HTML, CSOUP_TAG_TABLE,
+                                            CSOUP_TAG_TD, CSOUP_TAG_TH, CSOUP_TAG_MARQUEE, CSOUP_TAG_OBJECT);
+    const TagSet kListItemScope = kDefaultScope | makeTagSet(CSOUP_TAG_OL, CSOUP_TAG_UL);
+    const TagSet kButtonScope = kDefaultScope | makeTagSet(CSOUP_TAG_BUTTON);
+    const TagSet kTableScope = makeTagSet(CSOUP_TAG_HTML, CSOUP_TAG_TABLE);
+}
+
+TEST(ElementStackTest, ScopeStopsAtTheBoundary) {
+    CrtAllocator allocator;
+    Element html("html", NULL, &allocator);
+    Element body("body", NULL, &allocator);
+    Element p("p", NULL, &allocator);
+    Element button("button", NULL, &allocator);
+    Element table("table", NULL, &allocator);
+    Element span("span", NULL, &allocator);
+    
+    ElementStack stack(&allocator);
+    stack.push(&html);
+    stack.push(&body);
+    stack.push(&p);
+    stack.push(&button);
+    stack.push(&span);
+    
+    EXPECT_TRUE(stack.inScope("p", kDefaultScope));
+    EXPECT_FALSE(stack.inScope("p", kButtonScope));
+    EXPECT_TRUE(stack.inScope("button", kButtonScope)); // the target may be a boundary itself
+    EXPECT_FALSE(stack.inScope("div", kDefaultScope));
+    
+    stack.push(&table);
+    EXPECT_FALSE(stack.inScope("p", kDefaultScope));
+    EXPECT_FALSE(stack.inScope("button", kTableScope));
+    EXPECT_TRUE(stack.inScope("table", kTableScope));
+    EXPECT_TRUE(stack.inScope(makeTagSet(CSOUP_TAG_SPAN, CSOUP_TAG_TABLE), kTableScope));
+    EXPECT_FALSE(stack.inScope(makeTagSet(CSOUP_TAG_SPAN, CSOUP_TAG_P), kDefaultScope));
+    
+    stack.pop();
+    EXPECT_TRUE(stack.inScope("p", kDefaultScope));
+    EXPECT_TRUE(stack.inScope(makeTagSet(CSOUP_TAG_SPAN, CSOUP_TAG_P), kDefaultScope));
+}
+
+TEST(ElementStackTest, ListItemScope) {
+    CrtAllocator allocator;
+    Element html("html", NULL, &allocator);
+    Element body("body", NULL, &allocator);
+    Element ul("ul", NULL, &allocator);
+    Element li("li", NULL, &allocator);
+    Element ol("ol", NULL, &allocator);
+    Element div("div", NULL, &allocator);
+    
+    ElementStack stack(&allocator);
+    stack.push(&html);
+    stack.push(&body);
+    stack.push(&ul);
+    stack.push(&li);
+    stack.push(&div);
+    EXPECT_TRUE(stack.inScope("li", kListItemScope));
+    
+    // a nested list hides the outer item
+    stack.push(&ol);
+    EXPECT_FALSE(stack.inScope("li", kListItemScope));
+    EXPECT_TRUE(stack.inScope("li", kDefaultScope));
+}
+
+TEST(ElementStackTest, UnknownTagsInScopeByName) {
+    CrtAllocator allocator;
+    Element html("html", NULL, &allocator);
+    Element foo("foo", NULL, &allocator);
+    Element td("td", NULL, &allocator);
+    Element bar("bar", NULL, &allocator);
+    
+    ElementStack stack(&allocator);
+    stack.push(&html);
+    stack.push(&foo);
+    EXPECT_TRUE(stack.inScope("foo", kDefaultScope));
+    EXPECT_FALSE(stack.inScope("bar", kDefaultScope));
+    
+    stack.push(&td);
+    stack.push(&bar);
+    EXPECT_TRUE(stack.inScope("bar", kDefaultScope));
+    EXPECT_FALSE(stack.inScope("foo", kDefaultScope));
+    EXPECT_TRUE(stack.inScope("foo", kTableScope));
+}
@@ -0,0 +1,90 @@
+//
+//  entities_test.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include <cstring>
+#include "gtest/gtest/gtest.h"
+#include "nodes/entities.h"
+#include "util/stringref.h"
+
+using namespace csoup;
+
+TEST(EntitiesTest, NamedEntities) {
+    EXPECT_TRUE(Entities::isNamedEntity("amp"));
+    EXPECT_TRUE(Entities::isNamedEntity("AMP"));
+    EXPECT_TRUE(Entities::isNamedEntity("notin"));
+    EXPECT_TRUE(Entities::isNamedEntity("zwnj"));
+    EXPECT_TRUE(Entities::isNamedEntity("AElig"));
+    
+    EXPECT_FALSE(Entities::isNamedEntity(""));
+    EXPECT_FALSE(Entities::isNamedEntity("am"));
+    EXPECT_FALSE(Entities::isNamedEntity("ampx"));
+    EXPECT_FALSE(Entities::isNamedEntity("Amp"));
+    EXPECT_FALSE(Entities::isNamedEntity("zzzz"));
+}
+
+TEST(EntitiesTest, BaseNamedEntities) {
+    EXPECT_TRUE(Entities::isBaseNamedEntity("amp"));
+    EXPECT_TRUE(Entities::isBaseNamedEntity("not"));
+    EXPECT_TRUE(Entities::isBaseNamedEntity("sup3"));
+    
+    // needs its ';'
+    EXPECT_FALSE(Entities::isBaseNamedEntity("notin"));
+    EXPECT_FALSE(Entities::isBaseNamedEntity("zwnj"));
+}
+
+TEST(EntitiesTest, CharacterByName) {
+    EXPECT_EQ(0x26, Entities::getCharacterByName("amp"));
+    EXPECT_EQ(0x3C, Entities::getCharacterByName("lt"));
+    EXPECT_EQ(0x2209, Entities::getCharacterByName("notin"));
+    EXPECT_EQ(0x1D56B, Entities::getCharacterByName("zopf"));
+    EXPECT_EQ(-1, Entities::getCharacterByName("nope"));
+    
+    // names that are prefixes of other names
+    EXPECT_EQ(0x2003, Entities::getCharacterByName("emsp"));
+    EXPECT_EQ(0x2004, Entities::getCharacterByName("emsp13"));
+    EXPECT_EQ(0x2005, Entities::getCharacterByName("emsp14"));
+    EXPECT_EQ(0x2283, Entities::getCharacterByName("sup"));
+    EXPECT_EQ(0xB3, Entities::getCharacterByName("sup3"));
+}
+
+TEST(EntitiesTest, LongestMatch) {
+    int codePoint = -1;
+    EXPECT_EQ(5u, Entities::matchNamedEntity("notin", false, &codePoint));
+    EXPECT_EQ(0x2209, codePoint);
+    
+    EXPECT_EQ(3u, Entities::matchNamedEntity("notit", false, &codePoint));
+    EXPECT_EQ(0xAC, codePoint);
+    
+    EXPECT_EQ(3u, Entities::matchNamedEntity("notin", true, &codePoint));
+    EXPECT_EQ(0xAC, codePoint);
+    
+    EXPECT_EQ(4u, Entities::matchNamedEntity("sup3x", true, &codePoint));
+    EXPECT_EQ(0xB3, codePoint);
+    
+    EXPECT_EQ(0u, Entities::matchNamedEntity("xyz", false, &codePoint));
+    EXPECT_EQ(0u, Entities::matchNamedEntity("", false, &codePoint));
+}
+
+// the lookup binary searches the tables, so they must stay sorted
+TEST(EntitiesTest, TablesAreSorted) {
+    const bool tables[] = {true, false};
+    for (size_t t = 0; t < arrayLength(tables); ++ t) {
+        const size_t count = Entities::entityCount(tables[t]);
+        ASSERT_GT(count, 0u);
+        for (size_t i = 1; i < count; ++ i) {
+            EXPECT_LT(std::strcmp(Entities::entityName(tables[t], i - 1), Entities::entityName(tables[t], i)), 0)
+                << Entities::entityName(tables[t], i - 1) << " is not before " << Entities::entityName(tables[t], i);
+        }
+    }
+    
+    // every entity that may go without ';' is a full entity as well
+    for (size_t i = 0; i < Entities::entityCount(true); ++ i) {
+        const char* name = Entities::entityName(true, i);
+        EXPECT_TRUE(Entities::isNamedEntity(StringRef(name, std::strlen(name)))) << name;
+    }
+}
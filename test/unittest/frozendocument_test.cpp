@@ -0,0 +1,240 @@
+//
+//  frozendocument_test.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include "gtest/gtest/gtest.h"
+#include "nodes/document.h"
+#include "nodes/frozendocument.h"
+#include "parser/htmltreebuilder.h"
+#include "parser/parseerrorlist.h"
+#include "util/stringbuffer.h"
+
+using namespace csoup;
+
+namespace {
+    const char* kHtml = "<!DOCTYPE html><html><head><title>t</title><script>var a = 1;</script></head><body>"
+                        "<div id=\"main\" class=\"a b\"><p>one <i>two</i> three</p>"
+                        "<custom data-x=\"1\">four</custom><!-- note --></div><p>five</p></body></html>";
+
+    Document* parse(const std::string& html, Allocator* allocator) {
+        ParseErrorList errors(16, allocator);
+        HtmlTreeBuilder builder(allocator);
+        return builder.parse(StringRef(html.data(), html.size()), StringRef("http://example.com/"), &errors, NULL);
+    }
+
+    // walks the object tree and the frozen one side by side; returns the
+    // number the frozen copy gives the node after node's subtree
+    size_t expectSame(const Node* node, const FrozenDocument& frozen, size_t index, size_t parent) {
+        EXPECT_EQ(node->type(), frozen.type(index));
+        EXPECT_EQ(parent, frozen.parentNode(index));
+
+        switch (node->type()) {
+            case CSOUP_NODE_TEXT:
+                EXPECT_TRUE(frozen.text(index).equals(static_cast<const TextNode*>(node)->wholeText()));
+                return index + 1;
+            case CSOUP_NODE_COMMENT:
+                EXPECT_TRUE(frozen.text(index).equals(static_cast<const CommentNode*>(node)->comment()));
+                return index + 1;
+            case CSOUP_NODE_CDATA:
+                EXPECT_TRUE(frozen.text(index).equals(static_cast<const DataNode*>(node)->wholeData()));
+                return index + 1;
+            default:
+                break;
+        }
+
+        const Element* el = static_cast<const Element*>(node);
+        EXPECT_EQ(el->tagId(), frozen.tagId(index));
+        EXPECT_TRUE(frozen.tagName(index).equals(el->tagName()));
+        EXPECT_EQ(el->childNodeSize(), frozen.childNodeSize(index));
+
+        const size_t attributes = el->attributes() ? el->attributes()->size() : 0;
+        EXPECT_EQ(attributes, frozen.attributeSize(index));
+        for (size_t i = 0; i < attributes; ++ i) {
+            const Attribute* attr = el->attributes()->get(i);
+            EXPECT_TRUE(frozen.attributeKey(index, i).equals(attr->key().ref()));
+            EXPECT_TRUE(frozen.attr(index, attr->key().ref()).equals(attr->value().ref()));
+        }
+
+        size_t next = index + 1;
+        size_t frozenChild = frozen.firstChild(index);
+        for (const Node* child = el->firstChild(); child != NULL; child = child->nextSibling()) {
+            EXPECT_EQ(next, frozenChild);
+            next = expectSame(child, frozen, next, index);
+            frozenChild = frozen.nextSibling(frozenChild);
+        }
+        EXPECT_EQ(FrozenDocument::kNoNode, frozenChild);
+        EXPECT_EQ(next, frozen.subtreeEnd(index));
+        return next;
+    }
+
+    const char* kSnapshotPath = "frozendocument_test.snapshot";
+
+    std::string readFile(const char* path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const char* path, const std::string& contents) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), contents.size());
+    }
+}
+
+TEST(FrozenDocumentTest, MatchesTheDocument) {
+    CrtAllocator allocator;
+    Document* doc = parse(kHtml, &allocator);
+    FrozenDocument frozen(doc, &allocator);
+
+    EXPECT_EQ(doc->memoryUsage().nodes, frozen.size());
+    EXPECT_EQ(frozen.size(), expectSame(doc, frozen, 0, FrozenDocument::kNoNode));
+    EXPECT_TRUE(frozen.baseUri().equals("http://example.com/"));
+
+    StringBuffer objectText(&allocator), frozenText(&allocator);
+    doc->appendWholeText(&objectText);
+    frozen.appendWholeText(0, &frozenText);
+    EXPECT_TRUE(objectText.ref().equals("tone two threefourfive"));
+    EXPECT_TRUE(frozenText.ref().equals(objectText.ref()));
+
+    delete doc;
+}
+
+TEST(FrozenDocumentTest, OutlivesTheDocument) {
+    CrtAllocator allocator;
+    Document* doc = parse(kHtml, &allocator);
+    FrozenDocument frozen(doc, &allocator);
+    delete doc;
+
+    size_t custom = FrozenDocument::kNoNode;
+    for (size_t i = 0; i < frozen.size(); ++ i) {
+        if (frozen.tagName(i).equals("custom")) custom = i;
+    }
+    ASSERT_NE(FrozenDocument::kNoNode, custom);
+    EXPECT_EQ(CSOUP_TAG_UNKNOWN, frozen.tagId(custom));
+    EXPECT_TRUE(frozen.hasAttribute(custom, "DATA-X"));
+    EXPECT_TRUE(frozen.attr(custom, "data-x").equals("1"));
+    EXPECT_FALSE(frozen.hasAttribute(custom, "id"));
+    EXPECT_TRUE(frozen.attr(custom, "id").equals(""));
+
+    StringBuffer text(&allocator);
+    frozen.appendWholeText(custom, &text);
+    EXPECT_TRUE(text.ref().equals("four"));
+
+    size_t div = frozen.parentNode(custom);
+    EXPECT_EQ(CSOUP_TAG_DIV, frozen.tagId(div));
+    EXPECT_TRUE(frozen.attr(div, "class").equals("a b"));
+}
+
+// the parser takes nesting this deep, so copying it mustn't run out of stack
+TEST(FrozenDocumentTest, DeepTrees) {
+    const size_t kDepth = 200000;
+    std::string html;
+    for (size_t i = 0; i < kDepth; ++ i) html += "<div>";
+
+    CrtAllocator allocator;
+    Document* doc = parse(html, &allocator);
+    EXPECT_EQ(kDepth + 4, doc->memoryUsage().nodes);
+
+    FrozenDocument frozen(doc, &allocator);
+    ASSERT_EQ(kDepth + 4, frozen.size());
+    const size_t last = frozen.size() - 1;
+    EXPECT_EQ(CSOUP_TAG_DIV, frozen.tagId(last));
+    EXPECT_EQ(last - 1, frozen.parentNode(last));
+    EXPECT_EQ(last, frozen.firstChild(last - 1));
+    EXPECT_EQ(FrozenDocument::kNoNode, frozen.nextSibling(last));
+
+    // html, head and body, and head's sibling body
+    EXPECT_EQ(1u, frozen.firstChild(0));
+    EXPECT_EQ(3u, frozen.nextSibling(2));
+    EXPECT_EQ(frozen.size(), frozen.subtreeEnd(3));
+
+    delete doc;
+}
+
+TEST(FrozenDocumentTest, SnapshotRoundTrip) {
+    CrtAllocator allocator;
+    Document* doc = parse(kHtml, &allocator);
+    {
+        FrozenDocument frozen(doc, &allocator);
+        ASSERT_EQ(CSOUP_SNAPSHOT_OK, frozen.save(kSnapshotPath));
+        EXPECT_EQ(frozen.memorySize(), readFile(kSnapshotPath).size());
+    }
+
+    FrozenDocument loaded(&allocator);
+    EXPECT_EQ(0u, loaded.size());
+    ASSERT_EQ(CSOUP_SNAPSHOT_OK, loaded.load(kSnapshotPath));
+    EXPECT_EQ(loaded.size(), expectSame(doc, loaded, 0, FrozenDocument::kNoNode));
+    EXPECT_TRUE(loaded.baseUri().equals("http://example.com/"));
+    EXPECT_TRUE(loaded.name().equals("html"));
+    EXPECT_TRUE(loaded.publicIdentifier().equals(""));
+    EXPECT_EQ(doc->quirksMode(), loaded.quirksMode());
+
+    // loading again replaces the mapping
+    ASSERT_EQ(CSOUP_SNAPSHOT_OK, loaded.load(kSnapshotPath, false));
+    EXPECT_EQ(doc->memoryUsage().nodes, loaded.size());
+
+    delete doc;
+    std::remove(kSnapshotPath);
+}
+
+TEST(FrozenDocumentTest, SnapshotRejectsDamage) {
+    CrtAllocator allocator;
+    Document* doc = parse(kHtml, &allocator);
+    FrozenDocument(doc, &allocator).save(kSnapshotPath);
+    delete doc;
+    const std::string good = readFile(kSnapshotPath);
+    FrozenDocument loaded(&allocator);
+
+    std::string damaged = good;
+    damaged[damaged.size() / 2] ^= 0x10;
+    writeFile(kSnapshotPath, damaged);
+    EXPECT_EQ(CSOUP_SNAPSHOT_BAD_CHECKSUM, loaded.load(kSnapshotPath));
+    EXPECT_EQ(0u, loaded.size());
+    EXPECT_EQ(CSOUP_SNAPSHOT_OK, loaded.load(kSnapshotPath, false));
+
+    // the version follows the eight byte magic
+    std::string newer = good;
+    newer[8] = static_cast<char>(FrozenDocument::kSnapshotVersion + 1);
+    writeFile(kSnapshotPath, newer);
+    EXPECT_EQ(CSOUP_SNAPSHOT_BAD_VERSION, loaded.load(kSnapshotPath));
+
+    // so do snapshots of a different list of tags; the hash of the tag
+    // names follows the size and the checksum
+    std::string otherTags = good;
+    otherTags[32] ^= 0x01;
+    writeFile(kSnapshotPath, otherTags);
+    EXPECT_EQ(CSOUP_SNAPSHOT_BAD_VERSION, loaded.load(kSnapshotPath, false));
+
+    // the checksum covers the header, whose ranges point into the text,
+    // and the ranges and node numbers are checked even without it; the
+    // base URI's range is at byte 56, and the arrays start after the 88
+    // byte header with a byte per node type
+    std::string badRange = good;
+    badRange[59] = 0x7f;
+    writeFile(kSnapshotPath, badRange);
+    EXPECT_EQ(CSOUP_SNAPSHOT_BAD_CHECKSUM, loaded.load(kSnapshotPath));
+    EXPECT_EQ(CSOUP_SNAPSHOT_BAD_FORMAT, loaded.load(kSnapshotPath, false));
+    EXPECT_EQ(0u, loaded.size());
+
+    const size_t nodes = static_cast<unsigned char>(good[40]);
+    const size_t tagIds = (88 + nodes + 7) / 8 * 8;
+    const size_t parents = (tagIds + 2 * nodes + 7) / 8 * 8;
+    std::string badParent = good;
+    badParent[parents + 4 * 2] = 5;    // node 2's parent, after it
+    writeFile(kSnapshotPath, badParent);
+    EXPECT_EQ(CSOUP_SNAPSHOT_BAD_FORMAT, loaded.load(kSnapshotPath, false));
+
+    writeFile(kSnapshotPath, good.substr(0, good.size() - 8));
+    EXPECT_EQ(CSOUP_SNAPSHOT_BAD_FORMAT, loaded.load(kSnapshotPath));
+    writeFile(kSnapshotPath, "<html></html>");
+    EXPECT_EQ(CSOUP_SNAPSHOT_BAD_FORMAT, loaded.load(kSnapshotPath));
+
+    std::remove(kSnapshotPath);
+    EXPECT_EQ(CSOUP_SNAPSHOT_IO_ERROR, loaded.load(kSnapshotPath));
+}
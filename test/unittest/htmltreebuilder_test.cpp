@@ -0,0 +1,92 @@
+//
+//  htmltreebuilder_test.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include <cstring>
+#include <string>
+#include "gtest/gtest/gtest.h"
+#include "nodes/document.h"
+#include "nodes/element.h"
+#include "nodes/textnode.h"
+#include "parser/htmltreebuilder.h"
+#include "parser/parseerrorlist.h"
+
+using namespace csoup;
+
+namespace {
+    // writes the tree as "tag(child,child)", with text nodes as their text
+    void outline(Node* node, std::string* out) {
+        if (node->type() == CSOUP_NODE_TEXT) {
+            StringRef text = static_cast<TextNode*>(node)->wholeText();
+            out->append(text.data(), text.size());
+            return;
+        }
+        if (node->type() != CSOUP_NODE_ELEMENT && node->type() != CSOUP_NODE_FORMELEMENT) {
+            return;
+        }
+
+        Element* el = static_cast<Element*>(node);
+        out->append(el->tagName().data(), el->tagName().size());
+        if (el->firstChild() != NULL) {
+            out->push_back('(');
+            for (Node* child = el->firstChild(); child != NULL; child = child->nextSibling()) {
+                if (child != el->firstChild()) {
+                    out->push_back(',');
+                }
+                outline(child, out);
+            }
+            out->push_back(')');
+        }
+    }
+
+    // the outline of <body> after parsing html
+    std::string parseBody(const char* html) {
+        CrtAllocator allocator;
+        ParseErrorList errors(16, &allocator);
+        HtmlTreeBuilder builder(&allocator);
+        Document* doc = builder.parse(StringRef(html, std::strlen(html)), StringRef("http://example.com/"), &errors, NULL);
+
+        std::string out;
+        outline(static_cast<Element*>(doc->firstChild())->lastChild(), &out);
+        delete doc;
+        return out;
+    }
+}
+
+TEST(HtmlTreeBuilderTest, TableTagsCloseSelectInTable) {
+    EXPECT_EQ("body(table(tbody(tr(td(select(option(a))),td(b)))))",
+              parseBody("<table><tr><td><select><option>a<td>b</select></table>"));
+    EXPECT_EQ("body(table(tbody(tr(td(select(option(a)),table(b))))))",
+              parseBody("<table><tr><td><select><option>a<table>b</table>"));
+    // an end tag for something not in table scope is still ignored
+    EXPECT_EQ("body(table(tbody(tr(td(select(option(a,b)))))))",
+              parseBody("<table><tr><td><select><option>a</caption>b</table>"));
+}
+
+TEST(HtmlTreeBuilderTest, AdoptionAgencyMovesTheFurthestBlock) {
+    EXPECT_EQ("body(b(1),p(b(2),3))", parseBody("<b>1<p>2</b>3</p>"));
+    EXPECT_EQ("body(a(1),div(a(2,i(3)),i(4)))", parseBody("<a>1<div>2<i>3</a>4</i></div>"));
+    // a cell hides the formatting element, so the end tag is ignored
+    EXPECT_EQ("body(b(table(tbody(tr(td(x))))))", parseBody("<b><table><td></b>x</td></table>"));
+}
+
+TEST(HtmlTreeBuilderTest, FormIsInsertedOnce) {
+    EXPECT_EQ("body(form(input,input))", parseBody("<form><input><form><input></form>"));
+    EXPECT_EQ("body(form(x),form(y))", parseBody("<form>x</form><form>y</form>"));
+}
+
+TEST(HtmlTreeBuilderTest, CellStartTagClosesTheOpenCell) {
+    EXPECT_EQ("body(table(tbody(tr(td(a),td(b),th(c)))))", parseBody("<table><tr><td>a<td>b<th>c</table>"));
+    EXPECT_EQ("body(table(tbody(tr(td(b(a)),th(b)))))", parseBody("<table><tr><td><b>a<th>b</table>"));
+}
+
+TEST(HtmlTreeBuilderTest, ScopeBoundaries) {
+    // p is not in button scope, so the button keeps the new p
+    EXPECT_EQ("body(p(button(p(x))))", parseBody("<p><button><p>x"));
+    // the outer li is not in list item scope inside the ol
+    EXPECT_EQ("body(ul(li(a,ol(li(b))),li(c)))", parseBody("<ul><li>a<ol><li>b</ol><li>c</ul>"));
+}
@@ -0,0 +1,166 @@
+//
+//  scan_test.cpp
+//  test
+//
+//  Created by mac on 10/17/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "gtest/gtest/gtest.h"
+#include "internal/scan.h"
+#include "parser/characterreader.h"
+#include "util/stringbuffer.h"
+#include "util/allocators.h"
+
+using namespace csoup;
+using namespace csoup::internal;
+
+namespace {
+    const CharType* naiveFindAnyOf(const CharType* begin, const CharType* end,
+                                   const CharType* set, size_t setSize) {
+        for (; begin < end; ++ begin) {
+            if (std::memchr(set, *begin, setSize) != NULL) break;
+        }
+        return begin;
+    }
+    
+    const CharType* naiveFindSequence(const CharType* begin, const CharType* end,
+                                      const CharType* seq, size_t seqSize) {
+        for (const CharType* p = begin; p + seqSize <= end; ++ p) {
+            if (std::memcmp(p, seq, seqSize) == 0) return p;
+        }
+        return end;
+    }
+    
+    // a few letters only, so that matches (and near matches) show up often
+    std::string randomText(size_t len) {
+        const char alphabet[] = "abc-<]>\r\n\xe4\xbd\xa0";
+        std::string ret(len, ' ');
+        for (size_t i = 0; i < len; ++ i) {
+            ret[i] = alphabet[std::rand() % (sizeof(alphabet) - 1)];
+        }
+        return ret;
+    }
+    
+    std::vector<const ScanKernels*> availableKernels() {
+        std::vector<const ScanKernels*> ret;
+        ret.push_back(scalarScanKernels());
+        if (sse2ScanKernels() != NULL) ret.push_back(sse2ScanKernels());
+        if (avx2ScanKernels() != NULL) ret.push_back(avx2ScanKernels());
+        return ret;
+    }
+}
+
+TEST(ScanTest, FindByte) {
+    std::vector<const ScanKernels*> kernels = availableKernels();
+    std::srand(1);
+    
+    for (size_t len = 0; len < 200; ++ len) {
+        std::string text = randomText(len);
+        const CharType* begin = text.data();
+        const CharType* end = begin + text.size();
+        
+        for (size_t k = 0; k < kernels.size(); ++ k) {
+            for (size_t offset = 0; offset < 3 && offset <= len; ++ offset) {
+                const CharType* expected = naiveFindAnyOf(begin + offset, end, "<", 1);
+                EXPECT_EQ(expected, kernels[k]->findByte(begin + offset, end, '<')) << kernels[k]->name;
+            }
+            EXPECT_EQ(end, kernels[k]->findByte(begin, end, 'z')) << kernels[k]->name;
+        }
+    }
+}
+
+TEST(ScanTest, FindAnyOf) {
+    std::vector<const ScanKernels*> kernels = availableKernels();
+    const char* sets[] = {"<", "<\0", "-<", "]>\xbd", "\t\f />=\"'`&"};
+    const size_t setSizes[] = {1, 2, 2, 3, 10};
+    std::srand(2);
+    
+    for (size_t len = 0; len < 200; ++ len) {
+        std::string text = randomText(len);
+        const CharType* begin = text.data();
+        const CharType* end = begin + text.size();
+        
+        for (size_t k = 0; k < kernels.size(); ++ k) {
+            for (size_t s = 0; s < arrayLength(sets); ++ s) {
+                EXPECT_EQ(naiveFindAnyOf(begin, end, sets[s], setSizes[s]),
+                          kernels[k]->findAnyOf(begin, end, sets[s], setSizes[s])) << kernels[k]->name;
+            }
+        }
+    }
+}
+
+TEST(ScanTest, FindSequence) {
+    std::vector<const ScanKernels*> kernels = availableKernels();
+    const char* seqs[] = {"<", "]]>", "--", "-->", "ab<c"};
+    std::srand(3);
+    
+    for (size_t len = 0; len < 300; ++ len) {
+        std::string text = randomText(len);
+        const CharType* begin = text.data();
+        const CharType* end = begin + text.size();
+        
+        for (size_t k = 0; k < kernels.size(); ++ k) {
+            for (size_t s = 0; s < arrayLength(seqs); ++ s) {
+                size_t n = std::strlen(seqs[s]);
+                EXPECT_EQ(naiveFindSequence(begin, end, seqs[s], n),
+                          kernels[k]->findSequence(begin, end, seqs[s], n)) << kernels[k]->name;
+            }
+        }
+    }
+}
+
+TEST(ScanTest, SkipPlainAscii) {
+    std::vector<const ScanKernels*> kernels = availableKernels();
+    std::srand(4);
+    
+    for (size_t len = 0; len < 200; ++ len) {
+        // mostly plain text with the odd control or non-ascii byte
+        std::string text(len, 'a');
+        for (size_t i = 0; i < len; ++ i) {
+            int r = std::rand() % 64;
+            text[i] = r == 0 ? '\r' : r == 1 ? '\x7f' : r == 2 ? '\x1f' : r == 3 ? '\xe4' :
+                      r == 4 ? '\t' : r == 5 ? '\n' : static_cast<char>(' ' + r);
+        }
+        const CharType* begin = text.data();
+        const CharType* end = begin + text.size();
+        
+        const CharType* expected = begin;
+        while (expected < end && isPlainAscii(static_cast<unsigned char>(*expected))) ++ expected;
+        
+        for (size_t k = 0; k < kernels.size(); ++ k) {
+            EXPECT_EQ(expected, kernels[k]->skipPlainAscii(begin, end)) << kernels[k]->name;
+        }
+    }
+}
+
+TEST(ScanTest, CharacterReaderConsumeTo) {
+    CrtAllocator allocator;
+    StringBuffer buffer(&allocator);
+    
+    CharacterReader reader(StringRef("one\r\ntwo\rthree]]>rest"));
+    reader.consumeTo(StringRef("]]>"), &buffer);
+    EXPECT_EQ(std::string("one\ntwo\nthree"), std::string(buffer.data(), buffer.size()));
+    EXPECT_TRUE(reader.matches(StringRef("]]>")));
+    
+    buffer.clear();
+    reader.consumeToEnd(&buffer);
+    EXPECT_EQ(std::string("]]>rest"), std::string(buffer.data(), buffer.size()));
+    EXPECT_EQ(-1, reader.peek());
+}
+
+TEST(ScanTest, CharacterReaderConsumeToAny) {
+    CrtAllocator allocator;
+    StringBuffer buffer(&allocator);
+    const CharType terms[] = {'-', '<'};
+    
+    CharacterReader reader(StringRef("var a = b\r\n< c -- d"));
+    EXPECT_EQ(11u, reader.consumeToAny(terms, arrayLength(terms), &buffer));
+    EXPECT_EQ(std::string("var a = b\n"), std::string(buffer.data(), buffer.size()));
+    EXPECT_EQ('<', reader.peek());
+    EXPECT_EQ(0u, reader.consumeToAny(terms, arrayLength(terms), &buffer));
+}
@@ -0,0 +1,106 @@
+//
+//  tag_test.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include <cstring>
+#include "gtest/gtest/gtest.h"
+#include "nodes/tag.h"
+#include "nodes/tagset.h"
+#include "nodes/element.h"
+#include "util/stringref.h"
+#include "util/allocators.h"
+
+using namespace csoup;
+
+namespace {
+    const char* const kTagNames[] = {
+#define CSOUP_TAG_NAME(name, NAME) #name,
+        CSOUP_TAGS(CSOUP_TAG_NAME)
+#undef CSOUP_TAG_NAME
+    };
+}
+
+TEST(TagTest, EveryKnownNameHasItsId) {
+    ASSERT_EQ(static_cast<size_t>(CSOUP_TAG_UNKNOWN), arrayLength(kTagNames));
+    
+    for (size_t i = 0; i < arrayLength(kTagNames); ++ i) {
+        StringRef name(kTagNames[i], std::strlen(kTagNames[i]));
+        EXPECT_EQ(static_cast<TagIdEnum>(i), Tag::idOf(name)) << kTagNames[i];
+        
+        Tag* tag = Tag::valueOf(name);
+        ASSERT_TRUE(tag != NULL) << kTagNames[i];
+        EXPECT_EQ(static_cast<TagIdEnum>(i), tag->id());
+        EXPECT_TRUE(tag->tagName().equals(name));
+        EXPECT_TRUE(tag->isKnownTag());
+        EXPECT_EQ(tag, Tag::valueOf(static_cast<TagIdEnum>(i)));
+    }
+}
+
+TEST(TagTest, UnknownNames) {
+    EXPECT_EQ(CSOUP_TAG_UNKNOWN, Tag::idOf(""));
+    EXPECT_EQ(CSOUP_TAG_UNKNOWN, Tag::idOf("foo"));
+    EXPECT_EQ(CSOUP_TAG_UNKNOWN, Tag::idOf("DIV"));
+    EXPECT_EQ(CSOUP_TAG_UNKNOWN, Tag::idOf("di"));
+    EXPECT_EQ(CSOUP_TAG_UNKNOWN, Tag::idOf("divv"));
+    EXPECT_EQ(CSOUP_TAG_UNKNOWN, Tag::idOf("h7"));
+    EXPECT_EQ(CSOUP_TAG_UNKNOWN, Tag::idOf("my-element"));
+    
+    EXPECT_TRUE(Tag::valueOf("foo") == NULL);
+    EXPECT_TRUE(Tag::valueOf(CSOUP_TAG_UNKNOWN) == NULL);
+    EXPECT_FALSE(Tag::isKnownTag("foo"));
+}
+
+TEST(TagTest, Properties) {
+    EXPECT_EQ(CSOUP_TAG_DIV, Tag::idOf("div"));
+    EXPECT_TRUE(Tag::valueOf(CSOUP_TAG_DIV)->block());
+    EXPECT_FALSE(Tag::valueOf(CSOUP_TAG_SPAN)->block());
+    EXPECT_TRUE(Tag::valueOf(CSOUP_TAG_BR)->empty());
+    EXPECT_TRUE(Tag::valueOf(CSOUP_TAG_PRE)->preserveWhitespace());
+    EXPECT_TRUE(Tag::valueOf(CSOUP_TAG_INPUT)->formSubmittable());
+    EXPECT_TRUE(Tag::valueOf(CSOUP_TAG_ARTICLE)->block());
+}
+
+TEST(TagTest, ElementWithUnknownTag) {
+    CrtAllocator allocator;
+    Element el("foo", NULL, &allocator);
+    
+    EXPECT_EQ(CSOUP_TAG_UNKNOWN, el.tagId());
+    EXPECT_TRUE(el.tagName().equals("foo"));
+    EXPECT_FALSE(el.tag()->isKnownTag());
+    EXPECT_FALSE(el.tag()->block());
+    
+    el.setTagName("div");
+    EXPECT_EQ(CSOUP_TAG_DIV, el.tagId());
+    EXPECT_EQ(Tag::valueOf(CSOUP_TAG_DIV), el.tag());
+    
+    el.setTagName("bar");
+    EXPECT_TRUE(el.tagName().equals("bar"));
+    el.setTagName(el.tagName());
+    EXPECT_TRUE(el.tagName().equals("bar"));
+}
+
+TEST(TagTest, TagSet) {
+    static constexpr TagSet headings = makeTagSet(CSOUP_TAG_H1, CSOUP_TAG_H2, CSOUP_TAG_H6);
+    static_assert(headings.contains(CSOUP_TAG_H6), "built at compile time");
+    
+    EXPECT_TRUE(headings.contains(CSOUP_TAG_H1));
+    EXPECT_TRUE(headings.contains(CSOUP_TAG_H2));
+    EXPECT_FALSE(headings.contains(CSOUP_TAG_H3));
+    EXPECT_FALSE(headings.contains(CSOUP_TAG_UNKNOWN));
+    EXPECT_FALSE(TagSet().contains(CSOUP_TAG_A));
+    
+    // ids in every word of the set
+    const TagSet spread = makeTagSet(CSOUP_TAG_A, CSOUP_TAG_P, CSOUP_TAG_XMP);
+    EXPECT_TRUE(spread.contains(CSOUP_TAG_A));
+    EXPECT_TRUE(spread.contains(CSOUP_TAG_P));
+    EXPECT_TRUE(spread.contains(CSOUP_TAG_XMP));
+    EXPECT_FALSE(spread.contains(CSOUP_TAG_WBR));
+    
+    const TagSet both = headings | spread;
+    EXPECT_TRUE(both.contains(CSOUP_TAG_H2));
+    EXPECT_TRUE(both.contains(CSOUP_TAG_XMP));
+}
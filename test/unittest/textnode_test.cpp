@@ -12,3 +12,32 @@
 #include <cctype>
 #include "gtest/gtest/gtest.h"
 #include "nodes/textnode.h"
+
+using namespace csoup;
+
+TEST(TextNodeTest, WholeTextIsCopied) {
+    CrtAllocator allocator;
+    char text[] = "some text that does not fit a short string";
+    TextNode node(StringRef(text, sizeof(text) - 1), BaseUri::create("http://example.com/", &allocator), &allocator);
+    
+    text[0] = 'S';
+    EXPECT_FALSE(node.sharesText());
+    EXPECT_TRUE(node.wholeText().equals("some text that does not fit a short string"));
+}
+
+TEST(TextNodeTest, ShareWholeText) {
+    CrtAllocator allocator;
+    const char source[] = "<p>shared text</p>";
+    TextNode node(BaseUri::create("http://example.com/", &allocator), &allocator);
+    EXPECT_EQ(0u, node.wholeText().size());
+    
+    node.shareWholeText(StringRef(source + 3, 11));
+    EXPECT_TRUE(node.sharesText());
+    EXPECT_EQ(source + 3, node.wholeText().data());
+    EXPECT_TRUE(node.wholeText().equals("shared text"));
+    
+    // setting the text again makes the node hold its own copy
+    node.setWholeText(StringRef("own"));
+    EXPECT_FALSE(node.sharesText());
+    EXPECT_TRUE(node.wholeText().equals("own"));
+}
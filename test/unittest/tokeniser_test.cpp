@@ -0,0 +1,244 @@
+//
+//  tokeniser_test.cpp
+//  test
+//
+//  Created by mac on 10/18/26.
+//  Copyright (c) 2026 windpls. All rights reserved.
+//
+
+#include <string>
+#include <vector>
+#include "gtest/gtest/gtest.h"
+#include "parser/characterreader.h"
+#include "parser/tokeniser.h"
+#include "parser/tokeniserstate.h"
+#include "parser/token.h"
+#include "parser/parseerrorlist.h"
+#include "util/allocators.h"
+
+using namespace csoup;
+
+namespace {
+    std::string str(const StringRef& ref) {
+        return std::string(ref.data(), ref.size());
+    }
+    
+    // The state a tree builder would switch the tokeniser to after a start tag,
+    // or NULL if it stays in data.
+    internal::TokeniserState* stateAfter(const StringRef& tagName) {
+        if (tagName.equals("script")) return internal::ScriptData::instance();
+        if (tagName.equals("style") || tagName.equals("xmp")) return internal::RawText::instance();
+        if (tagName.equals("title") || tagName.equals("textarea")) return internal::Rcdata::instance();
+        if (tagName.equals("plaintext")) return internal::PlainText::instance();
+        return NULL;
+    }
+    
+    // Tokenises html and describes every token on one line.
+    std::vector<std::string> tokenise(const char* html, internal::TokeniserState* state = NULL) {
+        CrtAllocator allocator;
+        CharacterReader reader((StringRef(html)));
+        ParseErrorList errors(16, &allocator);
+        Tokeniser tokeniser(&reader, &errors, &allocator);
+        if (state != NULL) tokeniser.transition(state);
+        
+        std::vector<std::string> ret;
+        while (true) {
+            Token* token = tokeniser.read();
+            bool isEnd = token->tokenType() == CSOUP_TOKEN_EOF;
+            
+            switch (token->tokenType()) {
+                case CSOUP_TOKEN_CHARACTER:
+                    ret.push_back("chars " + str(token->asCharacterToken()->data()));
+                    break;
+                case CSOUP_TOKEN_START_TAG:
+                case CSOUP_TOKEN_END_TAG: {
+                    TagToken* tag = token->asTagToken();
+                    std::string desc = (token->isStartTagToken() ? "start " : "end ") + str(tag->tagName());
+                    for (size_t i = 0; i < tag->attributeCount(); ++ i) {
+                        desc += " " + str(tag->attributeKey(i)) + "=" + str(tag->attributeValue(i));
+                    }
+                    if (tag->selfClosing()) desc += " /";
+                    ret.push_back(desc);
+                    
+                    if (token->isStartTagToken() && stateAfter(tag->tagName()) != NULL) {
+                        tokeniser.transition(stateAfter(tag->tagName()));
+                    }
+                    break;
+                }
+                case CSOUP_TOKEN_COMMENT:
+                    ret.push_back("comment " + str(token->asCommentToken()->data()));
+                    break;
+                case CSOUP_TOKEN_DOCTYPE: {
+                    DoctypeToken* doctype = token->asDoctypeToken();
+                    ret.push_back("doctype " + str(doctype->name()) + " " + str(doctype->publicIdentifier()) +
+                                  (doctype->forceQuirks() ? " quirks" : ""));
+                    break;
+                }
+                default:
+                    break;
+            }
+            
+            if (isEnd) break;
+        }
+        
+        return ret;
+    }
+}
+
+TEST(TokeniserTest, TagAndAttributeNamesAreLowercased) {
+    std::vector<std::string> tokens = tokenise("<DiV CLASS=\"Foo Bar\" Id='X1' data-Y=Z>text</DIV>");
+    
+    ASSERT_EQ(3u, tokens.size());
+    EXPECT_EQ("start div class=Foo Bar id=X1 data-y=Z", tokens[0]);
+    EXPECT_EQ("chars text", tokens[1]);
+    EXPECT_EQ("end div", tokens[2]);
+}
+
+TEST(TokeniserTest, NewlinesEndTagNames) {
+    std::vector<std::string> tokens = tokenise("<p\r\nclass=a>x\r\ny\rz</p\n>");
+    
+    ASSERT_EQ(3u, tokens.size());
+    EXPECT_EQ("start p class=a", tokens[0]);
+    EXPECT_EQ("chars x\ny\nz", tokens[1]);
+    EXPECT_EQ("end p", tokens[2]);
+}
+
+TEST(TokeniserTest, DuplicateAttributesAreDropped) {
+    std::vector<std::string> tokens = tokenise("<a href=x HREF=y title=t>");
+    
+    ASSERT_EQ(1u, tokens.size());
+    EXPECT_EQ("start a href=x title=t", tokens[0]);
+}
+
+TEST(TokeniserTest, CharacterReferences) {
+    std::vector<std::string> tokens = tokenise("&amp;&lt&notin; &notit; &emsp13;&#65;&#x42;&bogus; &");
+    
+    ASSERT_EQ(1u, tokens.size());
+    EXPECT_EQ("chars &<\xe2\x88\x89 \xc2\xacit; \xe2\x80\x84" "AB&bogus; &", tokens[0]);
+}
+
+TEST(TokeniserTest, CharacterReferencesInAttributes) {
+    std::vector<std::string> tokens = tokenise("<a href=\"?a=1&amp;b=2&not=3&notc&copy\" title='&notin;'>");
+    
+    ASSERT_EQ(1u, tokens.size());
+    EXPECT_EQ("start a href=?a=1&b=2&not=3&notc\xc2\xa9 title=\xe2\x88\x89", tokens[0]);
+}
+
+TEST(TokeniserTest, MultiByteText) {
+    std::vector<std::string> tokens = tokenise("<b title=\"\xe4\xbd\xa0\xe5\xa5\xbd\">\xe4\xb8\x96\xe7\x95\x8c</b>");
+    
+    ASSERT_EQ(3u, tokens.size());
+    EXPECT_EQ("start b title=\xe4\xbd\xa0\xe5\xa5\xbd", tokens[0]);
+    EXPECT_EQ("chars \xe4\xb8\x96\xe7\x95\x8c", tokens[1]);
+}
+
+TEST(TokeniserTest, Comment) {
+    std::vector<std::string> tokens = tokenise("<!-- a - b -->");
+    
+    ASSERT_EQ(1u, tokens.size());
+    EXPECT_EQ("comment  a - b ", tokens[0]);
+}
+
+TEST(TokeniserTest, RawText) {
+    std::vector<std::string> tokens = tokenise("if (a < b) x--;</script>", internal::ScriptData::instance());
+    
+    // there was no <script> start tag, so the end tag is just text
+    ASSERT_EQ(1u, tokens.size());
+    EXPECT_EQ("chars if (a < b) x--;</script>", tokens[0]);
+}
+
+TEST(TokeniserTest, TextIsASliceOfTheInput) {
+    const char html[] = "<p>caf\xc3\xa9 au lait</p>a\r\nb";
+    CrtAllocator allocator;
+    CharacterReader reader((StringRef(html)));
+    ParseErrorList errors(16, &allocator);
+    Tokeniser tokeniser(&reader, &errors, &allocator);
+    
+    Token* token = tokeniser.read();
+    ASSERT_TRUE(token->isStartTagToken());
+    
+    // text that reads back as it is in the input is not copied
+    token = tokeniser.read();
+    ASSERT_TRUE(token->isCharacterToken());
+    EXPECT_TRUE(token->asCharacterToken()->isSlice());
+    EXPECT_EQ(html + 3, token->asCharacterToken()->data().data());
+    EXPECT_EQ("caf\xc3\xa9 au lait", str(token->asCharacterToken()->data()));
+    
+    token = tokeniser.read();
+    ASSERT_TRUE(token->isEndTagToken());
+    
+    // \r\n reads as \n, so this one has to be a copy
+    token = tokeniser.read();
+    ASSERT_TRUE(token->isCharacterToken());
+    EXPECT_FALSE(token->asCharacterToken()->isSlice());
+    EXPECT_EQ("a\nb", str(token->asCharacterToken()->data()));
+    
+    token = tokeniser.read();
+    EXPECT_TRUE(token->isEOFToken());
+}
+
+namespace {
+    // counts the calls that go to the heap
+    class CountingAllocator : public CrtAllocator {
+    public:
+        CountingAllocator() : allocations_(0) {}
+        
+        void* malloc(size_t size) {
+            ++ allocations_;
+            return CrtAllocator::malloc(size);
+        }
+        
+        void* realloc(void* ptr, size_t oriSize, size_t newSize) {
+            ++ allocations_;
+            return CrtAllocator::realloc(ptr, oriSize, newSize);
+        }
+        
+        size_t allocations() const {
+            return allocations_;
+        }
+        
+    private:
+        size_t allocations_;
+    };
+    
+    // Reads tokens up to and including the next start tag named name, or up
+    // to the end, and returns how many there were. A tokeniser without a tree
+    // builder never leaves the data state on its own, so this switches to
+    // script data after <script> the way the tree builder would.
+    size_t readToStartTag(Tokeniser* tokeniser, const StringRef& name) {
+        size_t count = 0;
+        while (true) {
+            Token* token = tokeniser->read();
+            ++ count;
+            if (token->isEOFToken()) return count;
+            if (!token->isStartTagToken()) continue;
+            
+            StringRef tagName = token->asStartTagToken()->tagName();
+            if (tagName.equals("script")) tokeniser->transition(internal::ScriptData::instance());
+            if (tagName.equals(name)) return count;
+        }
+    }
+}
+
+TEST(TokeniserTest, SteadyStateDoesNotAllocate) {
+    // Every kind of token, long attribute values, entities and text that has
+    // to be copied. The first blocks warm the pool up, the rest must not
+    // allocate at all.
+    std::string block = "<div class=\"a-class-name-longer-than-the-inline-string\" id=x>"
+                        "some text &amp; more &#x41; text</div><!-- a comment -->"
+                        "<a href=\"http://example.com/a/rather/long/path?with=query\">"
+                        "line\r\nbreak</a><br/><script>if (a < b) x--;</script>";
+    std::string html = "<!DOCTYPE html>" + block + block + "<mark>";
+    for (int i = 0; i < 100; ++ i) html += block;
+    
+    CountingAllocator allocator;
+    CharacterReader reader((StringRef(html.data(), html.size())));
+    ParseErrorList errors(16, &allocator);
+    Tokeniser tokeniser(&reader, &errors, &allocator);
+    
+    readToStartTag(&tokeniser, "mark");
+    
+    const size_t before = allocator.allocations();
+    EXPECT_GT(readToStartTag(&tokeniser, ""), 1000u);
+    EXPECT_EQ(before, allocator.allocations());
+}